@@ -157,14 +157,10 @@ static unsigned long native_call_gp(struct vm_method *method,
 	size_t freg_count = 0;
 	size_t stack_count = 0;
 	struct vm_args_map *map = method->args_map;
-	unsigned long *stack, regs[6], fregs[8];
+	unsigned long stack[method->args_count + 1], regs[6], fregs[8];
 	unsigned long result;
 	unsigned long stack_size;
 
-	stack = malloc(sizeof(unsigned long) * method->args_count);
-	if (!stack)
-		abort();
-
 	for (i = 0; i < method->args_count; i++) {
 		if (map[i].reg == MACH_REG_UNASSIGNED)
 			stack[stack_count++] = args[i];
@@ -228,8 +224,6 @@ static unsigned long native_call_gp(struct vm_method *method,
 		: "rdi", "rsi", "rdx", "rcx", "r8", "r9", "r10", "r11", "cc", "memory"
 	);
 
-	free(stack);
-
 	return result;
 }
 
@@ -18,6 +18,7 @@
 #include "arch/encode.h"
 #include "arch/init.h"
 #include "arch/inline-cache.h"
+#include "arch/text.h"
 
 #include "cafebabe/method_info.h"
 
@@ -37,6 +38,7 @@
 #include "vm/backtrace.h"
 #include "vm/method.h"
 #include "vm/object.h"
+#include "vm/tlab.h"
 
 #include <stdbool.h>
 #include <assert.h>
@@ -91,7 +93,7 @@ static void write_imm32(struct buffer *buf, unsigned long offset, long imm32)
 		unsigned char b[4];
 	} imm_buf;
 
-	buffer = buf->buf;
+	buffer = buffer_write_ptr(buf);
 	imm_buf.val = imm32;
 
 	buffer[offset] = imm_buf.b[0];
@@ -301,10 +303,12 @@ static void __emit_mov_imm_reg(struct buffer *buf, long imm, enum machine_reg re
 static void fixup_branch_target(uint8_t *target_p, void *target)
 {
 	long cur = (long) (target - (void *) target_p) - 4;
-	target_p[3] = cur >> 24;
-	target_p[2] = cur >> 16;
-	target_p[1] = cur >> 8;
-	target_p[0] = cur;
+	uint8_t *p = jit_text_rw(target_p);
+
+	p[3] = cur >> 24;
+	p[2] = cur >> 16;
+	p[1] = cur >> 8;
+	p[0] = cur;
 }
 
 static void emit_really_indirect_jump_reg(struct buffer *buf, enum machine_reg reg)
@@ -575,6 +579,52 @@ static void emit_test_imm_memdisp(struct insn *insn, struct buffer *buf, struct
 	__emit_test_imm_memdisp(buf, insn->src.imm, insn->dest.disp);
 }
 
+/*
+ * Dirties the card of the reference slot whose address is in @tmp. The bias
+ * of the card table is read from memory with an absolute address like the
+ * safepoint poll does.
+ */
+static void __emit_card_mark(struct buffer *buf, enum machine_reg tmp)
+{
+	unsigned char reg = x86_encode_reg(tmp);
+
+	/* shr $GC_CARD_SHIFT, %tmp */
+	emit(buf, 0xc1);
+	emit(buf, x86_encode_mod_rm(0x03, 0x05, reg));
+	emit(buf, GC_CARD_SHIFT);
+
+	/* add gc_card_table_bias, %tmp */
+	emit(buf, 0x03);
+	emit(buf, x86_encode_mod_rm(0x00, reg, 0x05));
+	emit_imm32(buf, (unsigned long) &gc_card_table_bias);
+
+	/* movb $GC_CARD_DIRTY, (%tmp) */
+	__emit_membase(buf, 0xc6, tmp, 0, 0);
+	emit(buf, GC_CARD_DIRTY);
+}
+
+static void emit_card_mark_membase_reg(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	enum machine_reg tmp = mach_reg(&insn->dest.reg);
+
+	/* lea disp(%base), %tmp */
+	__emit_membase_reg(buf, 0x8d, mach_reg(&insn->src.base_reg), insn->src.disp, tmp);
+
+	__emit_card_mark(buf, tmp);
+}
+
+static void emit_card_mark_memindex_reg(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	enum machine_reg tmp = mach_reg(&insn->dest.reg);
+
+	/* lea (%base, %index, 1 << shift), %tmp */
+	emit(buf, 0x8d);
+	emit(buf, x86_encode_mod_rm(0x00, x86_encode_reg(tmp), 0x04));
+	emit(buf, x86_encode_sib(insn->src.shift, encode_reg(&insn->src.index_reg), encode_reg(&insn->src.base_reg)));
+
+	__emit_card_mark(buf, tmp);
+}
+
 static void emit_save_callee_save_regs(struct buffer *buf)
 {
 	int i;
@@ -802,6 +852,268 @@ static void emit_exception_test(struct buffer *buf, enum machine_reg reg)
 	__emit_test_membase_reg(buf, reg, 0, reg);
 }
 
+static void emit_array_check_membase_reg(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	struct compilation_unit *cu = bb->b_parent;
+	struct array_check_stub *stub;
+
+	stub = malloc(sizeof *stub);
+	if (!stub)
+		die("out of memory");
+
+	/* cmp array_length(%arrayref), %index */
+	__emit_membase_reg(buf, 0x3b, mach_reg(&insn->src.base_reg),
+			   insn->src.disp, mach_reg(&insn->dest.reg));
+
+	stub->insn = insn;
+	stub->branch_offset = buffer_offset(buf);
+	list_add_tail(&stub->list_node, &cu->array_check_stub_list);
+
+	/* jae <stub>, target is patched in emit_array_check_stubs() */
+	emit_branch_rel(buf, 0x0f, 0x83, 0);
+}
+
+void emit_array_check_stubs(struct compilation_unit *cu)
+{
+	struct buffer *buf = cu->objcode;
+	struct array_check_stub *stub;
+
+	list_for_each_entry(stub, &cu->array_check_stub_list, list_node) {
+		struct insn *insn = stub->insn;
+		unsigned long branch_end;
+
+		stub->start = buffer_offset(buf);
+
+		branch_end = stub->branch_offset + PREFIX_SIZE + BRANCH_INSN_SIZE;
+		write_imm32(buf, stub->branch_offset + PREFIX_SIZE + BRANCH_TARGET_OFFSET,
+			    stub->start - branch_end);
+
+		__emit_push_reg(buf, mach_reg(&insn->dest.reg));
+		__emit_push_reg(buf, mach_reg(&insn->src.base_reg));
+		__emit_call(buf, vm_object_check_array);
+		__emit_add_imm_reg(buf, 2 * PTR_SIZE, MACH_REG_ESP);
+
+		emit_exception_test(buf, MACH_REG_EAX);
+
+		/* Not reached: the check is known to fail here. */
+		__emit_jmp(buf, (unsigned long) buffer_ptr(buf) + branch_end);
+
+		stub->end = buffer_offset(buf);
+	}
+}
+
+/*
+ * Emits a forward conditional or unconditional jump whose target is set with
+ * resolve_forward_branch() and returns the offset of its displacement.
+ */
+static unsigned long emit_forward_branch(struct buffer *buf, unsigned char prefix,
+					 unsigned char opc)
+{
+	emit_branch_rel(buf, prefix, opc, 0);
+
+	return buffer_offset(buf) - 4;
+}
+
+static void resolve_forward_branch(struct buffer *buf, unsigned long disp_offset)
+{
+	write_imm32(buf, disp_offset, buffer_offset(buf) - (disp_offset + 4));
+}
+
+/*
+ * Compares the supertype of the class of the object in @ref that is at
+ * @disp in 'struct vm_class' to the class in @klass. The object reference
+ * is not null and it's left unchanged.
+ */
+static void __emit_super_check(struct buffer *buf, enum machine_reg ref,
+			       unsigned long disp, enum machine_reg klass)
+{
+	__emit_push_reg(buf, ref);
+	__emit_membase_reg(buf, 0x8b, ref, offsetof(struct vm_object, class), ref);
+	__emit_membase_reg(buf, 0x3b, ref, disp, klass);
+	__emit_pop_reg(buf, ref);
+}
+
+static void emit_instanceof_membase_reg(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	enum machine_reg ref, klass;
+	unsigned long is_null, no_match, done;
+
+	ref = mach_reg(&insn->src.base_reg);
+	klass = mach_reg(&insn->dest.reg);
+
+	/* test %ref, %ref; jz .false */
+	__emit_reg_reg(buf, 0x85, ref, ref);
+	is_null = emit_forward_branch(buf, 0x0f, 0x84);
+
+	/* cmp super_check_offset(%ref->class), %klass; jne .false */
+	__emit_super_check(buf, ref, insn->src.disp, klass);
+	no_match = emit_forward_branch(buf, 0x0f, 0x85);
+
+	/* mov $1, %klass; jmp .done */
+	__emit_mov_imm_reg(buf, 1, klass);
+	done = emit_forward_branch(buf, 0x00, 0xe9);
+
+	/* .false: mov $0, %klass */
+	resolve_forward_branch(buf, is_null);
+	resolve_forward_branch(buf, no_match);
+	__emit_mov_imm_reg(buf, 0, klass);
+
+	resolve_forward_branch(buf, done);
+}
+
+static void emit_checkcast_membase_reg(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	enum machine_reg ref, klass;
+	unsigned long is_null, match;
+
+	ref = mach_reg(&insn->src.base_reg);
+	klass = mach_reg(&insn->dest.reg);
+
+	/* test %ref, %ref; jz .done */
+	__emit_reg_reg(buf, 0x85, ref, ref);
+	is_null = emit_forward_branch(buf, 0x0f, 0x84);
+
+	/* cmp super_check_offset(%ref->class), %klass; je .done */
+	__emit_super_check(buf, ref, insn->src.disp, klass);
+	match = emit_forward_branch(buf, 0x0f, 0x84);
+
+	/*
+	 * The check is exact for classes in the supertype display so the cast
+	 * is known to fail here and vm_object_check_cast() throws.
+	 */
+	__emit_push_reg(buf, klass);
+	__emit_push_reg(buf, ref);
+	__emit_call(buf, vm_object_check_cast);
+	__emit_add_imm_reg(buf, 2 * PTR_SIZE, MACH_REG_ESP);
+
+	emit_exception_test(buf, MACH_REG_EAX);
+
+	resolve_forward_branch(buf, is_null);
+	resolve_forward_branch(buf, match);
+}
+
+static void emit_tlab_alloc_membase_reg(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	struct compilation_unit *cu = bb->b_parent;
+	enum machine_reg base, dest;
+	struct tlab_stub *stub;
+
+	stub = malloc(sizeof *stub);
+	if (!stub)
+		die("out of memory");
+
+	base = mach_reg(&insn->src.base_reg);
+	dest = mach_reg(&insn->dest.reg);
+
+	/* mov free_list(%ee), %obj */
+	__emit_membase_reg(buf, 0x8b, base, insn->src.disp, dest);
+
+	/* test %obj, %obj */
+	__emit_reg_reg(buf, 0x85, dest, dest);
+
+	stub->insn = insn;
+	stub->branch_offset = buffer_offset(buf);
+	list_add_tail(&stub->list_node, &cu->tlab_stub_list);
+
+	/* jz <stub>, target is patched in emit_tlab_stubs() */
+	emit_branch_rel(buf, 0x0f, 0x84, 0);
+
+	/* Unlink the object: push (%obj); pop free_list(%ee) */
+	__emit_push_membase(buf, dest, 0);
+	__emit_membase(buf, 0x8f, base, insn->src.disp, 0);
+
+	stub->return_offset = buffer_offset(buf);
+}
+
+static void __emit_push_xmm(struct buffer *buf, enum machine_reg reg)
+{
+	__emit_sub_imm_reg(buf, 0x08, MACH_REG_ESP);
+
+	/* movsd %xmm, (%esp) */
+	emit(buf, 0xf2);
+	emit(buf, 0x0f);
+	__emit_membase_reg(buf, 0x11, MACH_REG_ESP, 0, reg);
+}
+
+static void __emit_pop_xmm(struct buffer *buf, enum machine_reg reg)
+{
+	/* movsd (%esp), %xmm */
+	emit(buf, 0xf2);
+	emit(buf, 0x0f);
+	__emit_membase_reg(buf, 0x10, MACH_REG_ESP, 0, reg);
+
+	__emit_add_imm_reg(buf, 0x08, MACH_REG_ESP);
+}
+
+void emit_tlab_stubs(struct compilation_unit *cu)
+{
+	struct buffer *buf = cu->objcode;
+	struct tlab_stub *stub;
+
+	list_for_each_entry(stub, &cu->tlab_stub_list, list_node) {
+		struct insn *insn = stub->insn;
+		enum machine_reg base, dest;
+		unsigned long branch_end;
+		int i;
+
+		base = mach_reg(&insn->src.base_reg);
+		dest = mach_reg(&insn->dest.reg);
+
+		stub->start = buffer_offset(buf);
+
+		branch_end = stub->branch_offset + PREFIX_SIZE + BRANCH_INSN_SIZE;
+		write_imm32(buf, stub->branch_offset + PREFIX_SIZE + BRANCH_TARGET_OFFSET,
+			    stub->start - branch_end);
+
+		/* The allocation is not a call site so everything is live. */
+		for (i = 0; i < NR_CALLER_SAVE_REGS; i++) {
+			enum machine_reg reg = caller_save_regs[i];
+
+			if (reg == dest)
+				continue;
+
+			if (is_xmm_reg(reg))
+				__emit_push_xmm(buf, reg);
+			else
+				__emit_push_reg(buf, reg);
+		}
+
+		/* lea free_list(%ee), %eax */
+		__emit_membase_reg(buf, 0x8d, base, insn->src.disp, MACH_REG_EAX);
+		__emit_push_reg(buf, MACH_REG_EAX);
+		__emit_call(buf, tlab_refill);
+		__emit_add_imm_reg(buf, PTR_SIZE, MACH_REG_ESP);
+
+		if (dest != MACH_REG_EAX)
+			__emit_mov_reg_reg(buf, MACH_REG_EAX, dest);
+
+		for (i = NR_CALLER_SAVE_REGS - 1; i >= 0; i--) {
+			enum machine_reg reg = caller_save_regs[i];
+
+			if (reg == dest)
+				continue;
+
+			if (is_xmm_reg(reg))
+				__emit_pop_xmm(buf, reg);
+			else
+				__emit_pop_reg(buf, reg);
+		}
+
+		/* test %obj, %obj; jnz <return> */
+		__emit_reg_reg(buf, 0x85, dest, dest);
+		emit_branch_rel(buf, 0x0f, 0x85,
+			stub->return_offset - (buffer_offset(buf) + PREFIX_SIZE + BRANCH_INSN_SIZE));
+
+		/* Out of memory: the exception is pending so this faults. */
+		emit_exception_test(buf, dest);
+
+		/* Not reached */
+		__emit_jmp(buf, (unsigned long) buffer_ptr(buf) + stub->return_offset);
+
+		stub->end = buffer_offset(buf);
+	}
+}
+
 static void emit_conv_xmm_to_xmm64(struct insn *insn, struct buffer *buf, struct basic_block *bb)
 {
 	emit(buf, 0xf3);
@@ -893,9 +1205,7 @@ void emit_trampoline(struct compilation_unit *cu,
 {
 	struct buffer *buf = trampoline->objcode;
 
-	jit_text_lock();
-
-	buf->buf = jit_text_ptr();
+	jit_text_begin(buf, JIT_TEXT_COLD, TRAMPOLINE_MAX_SIZE);
 
 	/* This is for __builtin_return_address() to work and to access
 	   call arguments in correct manner. */
@@ -933,8 +1243,16 @@ void emit_trampoline(struct compilation_unit *cu,
 	__emit_pop_reg(buf, MACH_REG_EBP);
 	emit_indirect_jump_reg(buf, MACH_REG_EAX);
 
-	jit_text_reserve(buffer_offset(buf));
-	jit_text_unlock();
+	jit_text_end(buf);
+}
+
+/*
+ * The 32-bit instruction selector calls vm_object_lock() and
+ * vm_object_unlock() directly so there are no monitor stubs.
+ */
+void emit_monitor_stubs(struct compilation_unit *cu)
+{
+	assert(list_is_empty(&cu->monitor_stub_list));
 }
 
 void emit_lock(struct buffer *buf, struct vm_object *obj)
@@ -1028,14 +1346,72 @@ void emit_ic_miss_handler(struct buffer *buf, void *ic_check, struct vm_method *
 	emit_indirect_jump_reg(buf, MACH_REG_EAX);
 }
 
+/*
+ * Emits a polymorphic inline cache stub for @pic. The stub is called with the
+ * class of the receiver in %ecx and the arguments of the call on the stack.
+ * Every entry compares the class to an immediate and jumps to the entry
+ * point of the method that it resolves to. Unused entries compare against
+ * NULL which no class matches. They are filled in later by patching the
+ * immediate and the branch target.
+ *
+ * Other CPUs may be running the stub while it is patched, so the immediate
+ * and the branch target of every entry are padded to be 4-byte aligned.
+ * That way they never cross a cache line and are written atomically.
+ */
+void *emit_ic_pic_stub(struct ic_pic *pic)
+{
+	struct buffer *buf = alloc_exec_buffer();
+	void *miss;
+	int i;
+
+	if (!buf)
+		return NULL;
+
+	jit_text_begin(buf, JIT_TEXT_COLD, IC_PIC_STUB_MAX_SIZE);
+
+	for (i = 0; i < IC_PIC_SIZE; i++) {
+		/* The immediate follows the 2-byte opcode. */
+		while (((unsigned long) buffer_current(buf) + 2) % 4)
+			emit(buf, 0x90);
+
+		/* cmp $class, %ecx */
+		emit(buf, 0x81);
+		emit(buf, x86_encode_mod_rm(0x03, 0x07, x86_encode_reg(MACH_REG_ECX)));
+		pic->class_imm[i] = buffer_current(buf);
+		emit_imm32(buf, 0);
+
+		/* xchg %ax, %ax to align the branch target */
+		emit(buf, 0x66);
+		emit(buf, 0x90);
+
+		/* je <target> */
+		emit(buf, 0x0f);
+		emit(buf, 0x84);
+		pic->target_disp[i] = buffer_current(buf);
+		emit_imm32(buf, 0);
+	}
+
+	miss = buffer_current(buf);
+
+	for (i = 0; i < IC_PIC_SIZE; i++)
+		fixup_branch_target(pic->target_disp[i], miss);
+
+	__emit_mov_imm_reg(buf, (unsigned long) pic, MACH_REG_EAX);
+	__emit_jmp(buf, (unsigned long) ic_pic_miss);
+
+	jit_text_end(buf);
+
+	pic->buf = buf;
+
+	return buffer_ptr(buf);
+}
+
 extern void jni_trampoline(void);
 
 void emit_jni_trampoline(struct buffer *buf, struct vm_method *vmm,
 			 void *target)
 {
-	jit_text_lock();
-
-	buf->buf = jit_text_ptr();
+	jit_text_begin(buf, JIT_TEXT_COLD, TRAMPOLINE_MAX_SIZE);
 
 	__emit_pop_reg(buf, MACH_REG_xAX);	/* return address */
 
@@ -1046,8 +1422,7 @@ void emit_jni_trampoline(struct buffer *buf, struct vm_method *vmm,
 	__emit_push_reg(buf, MACH_REG_xBP);
 	__emit_jmp(buf, (unsigned long) jni_trampoline);
 
-	jit_text_reserve(buffer_offset(buf));
-	jit_text_unlock();
+	jit_text_end(buf);
 }
 
 /* The regparm(1) makes GCC get the first argument from %ecx and the rest
@@ -1149,16 +1524,12 @@ static void emit_itable_bsearch(struct buffer *buf,
 void *emit_itable_resolver_stub(struct vm_class *vmc,
 	struct itable_entry **table, unsigned int nr_entries)
 {
-	static struct buffer_operations exec_buf_ops = {
-		.expand = NULL,
-		.free   = NULL,
-	};
-
-	struct buffer *buf = __alloc_buffer(&exec_buf_ops);
+	struct buffer *buf = alloc_exec_buffer();
 
-	jit_text_lock();
+	if (!buf)
+		return NULL;
 
-	buf->buf = jit_text_ptr();
+	jit_text_begin(buf, JIT_TEXT_COLD, ITABLE_STUB_MAX_SIZE(nr_entries));
 
 	/* Note: When the stub is called, %eax contains the signature hash that
 	 * we look up in the stub. 0(%esp) contains the object reference. %ecx
@@ -1171,8 +1542,7 @@ void *emit_itable_resolver_stub(struct vm_class *vmc,
 
 	emit_itable_bsearch(buf, table, 0, nr_entries - 1);
 
-	jit_text_reserve(buffer_offset(buf));
-	jit_text_unlock();
+	jit_text_end(buf);
 
 	return buffer_ptr(buf);
 }
@@ -1191,9 +1561,15 @@ static emit_fn_t emitters[] = {
 	DECL_EMITTER(INSN_ADD_IMM_REG, insn_encode),
 	DECL_EMITTER(INSN_ADD_REG_REG, insn_encode),
 	DECL_EMITTER(INSN_AND_REG_REG, insn_encode),
+	DECL_EMITTER(INSN_ANDPD_XMM_XMM, insn_encode),
+	DECL_EMITTER(INSN_ANDPS_XMM_XMM, insn_encode),
 	DECL_EMITTER(INSN_CALL_REG, insn_encode),
 	DECL_EMITTER(INSN_CALL_REL, emit_call),
+	DECL_EMITTER(INSN_CARD_MARK_MEMBASE_REG, emit_card_mark_membase_reg),
+	DECL_EMITTER(INSN_CARD_MARK_MEMINDEX_REG, emit_card_mark_memindex_reg),
 	DECL_EMITTER(INSN_CLTD_REG_REG, insn_encode),
+	DECL_EMITTER(INSN_CMOVG_REG_REG, insn_encode),
+	DECL_EMITTER(INSN_CMOVL_REG_REG, insn_encode),
 	DECL_EMITTER(INSN_DIVSD_XMM_XMM, insn_encode),
 	DECL_EMITTER(INSN_DIVSS_XMM_XMM, insn_encode),
 	DECL_EMITTER(INSN_FLD_64_MEMLOCAL, insn_encode),
@@ -1248,6 +1624,7 @@ static emit_fn_t emitters[] = {
 	DECL_EMITTER(INSN_SAR_REG_REG, insn_encode),
 	DECL_EMITTER(INSN_SHL_REG_REG, insn_encode),
 	DECL_EMITTER(INSN_SHR_REG_REG, insn_encode),
+	DECL_EMITTER(INSN_SQRTSD_XMM_XMM, insn_encode),
 	DECL_EMITTER(INSN_SUBSD_XMM_XMM, insn_encode),
 	DECL_EMITTER(INSN_SUBSS_XMM_XMM, insn_encode),
 	DECL_EMITTER(INSN_SUB_IMM_REG, insn_encode),
@@ -1263,6 +1640,9 @@ static emit_fn_t emitters[] = {
 	DECL_EMITTER(INSN_AND_MEMBASE_REG, insn_encode),
 	DECL_EMITTER(INSN_CMP_IMM_REG, insn_encode),
 	DECL_EMITTER(INSN_CMP_MEMBASE_REG, insn_encode),
+	DECL_EMITTER(INSN_ARRAY_CHECK_MEMBASE_REG, emit_array_check_membase_reg),
+	DECL_EMITTER(INSN_CHECKCAST_MEMBASE_REG, emit_checkcast_membase_reg),
+	DECL_EMITTER(INSN_INSTANCEOF_MEMBASE_REG, emit_instanceof_membase_reg),
 	DECL_EMITTER(INSN_CMP_REG_REG, insn_encode),
 	DECL_EMITTER(INSN_CONV_FPU64_TO_GPR, emit_conv_fpu64_to_gpr),
 	DECL_EMITTER(INSN_CONV_FPU_TO_GPR, emit_conv_fpu_to_gpr),
@@ -1308,6 +1688,7 @@ static emit_fn_t emitters[] = {
 	DECL_EMITTER(INSN_SUB_MEMBASE_REG, insn_encode),
 	DECL_EMITTER(INSN_TEST_IMM_MEMDISP, emit_test_imm_memdisp),
 	DECL_EMITTER(INSN_TEST_MEMBASE_REG, insn_encode),
+	DECL_EMITTER(INSN_TLAB_ALLOC_MEMBASE_REG, emit_tlab_alloc_membase_reg),
 	DECL_EMITTER(INSN_SAVE_CALLER_REGS, emit_pseudo),
 	DECL_EMITTER(INSN_RESTORE_CALLER_REGS, emit_pseudo),
 	DECL_EMITTER(INSN_RESTORE_CALLER_REGS_I32, emit_pseudo),
@@ -18,6 +18,7 @@
 #include "arch/encode.h"
 #include "arch/init.h"
 #include "arch/inline-cache.h"
+#include "arch/text.h"
 
 #include "cafebabe/method_info.h"
 
@@ -37,6 +38,7 @@
 #include "vm/backtrace.h"
 #include "vm/method.h"
 #include "vm/object.h"
+#include "vm/tlab.h"
 
 #include <stdbool.h>
 #include <assert.h>
@@ -91,7 +93,7 @@ static void write_imm32(struct buffer *buf, unsigned long offset, long imm32)
 		unsigned char b[4];
 	} imm_buf;
 
-	buffer = buf->buf;
+	buffer = buffer_write_ptr(buf);
 	imm_buf.val = imm32;
 
 	buffer[offset] = imm_buf.b[0];
@@ -301,10 +303,12 @@ static void __emit_jmp(struct buffer *buf, unsigned long addr)
 static void fixup_branch_target(uint8_t *target_p, void *target)
 {
 	long cur = (long) (target - (void *) target_p) - 4;
-	target_p[3] = cur >> 24;
-	target_p[2] = cur >> 16;
-	target_p[1] = cur >> 8;
-	target_p[0] = cur;
+	uint8_t *p = jit_text_rw(target_p);
+
+	p[3] = cur >> 24;
+	p[2] = cur >> 16;
+	p[1] = cur >> 8;
+	p[0] = cur;
 }
 
 static void emit_really_indirect_jump_reg(struct buffer *buf, enum machine_reg reg)
@@ -931,6 +935,128 @@ static void emit_cmp_reg_reg(struct insn *insn, struct buffer *buf, struct basic
 	emit_reg_reg(buf, rex_w, 0x39, &insn->src, &insn->dest);
 }
 
+static void emit_array_check_membase_reg(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	struct compilation_unit *cu = bb->b_parent;
+	struct array_check_stub *stub;
+
+	stub = malloc(sizeof *stub);
+	if (!stub)
+		die("out of memory");
+
+	/* cmp array_length(%arrayref), %index */
+	emit_membase_reg(buf, 0, 0x3b, &insn->src, &insn->dest);
+
+	stub->insn = insn;
+	stub->branch_offset = buffer_offset(buf);
+	list_add_tail(&stub->list_node, &cu->array_check_stub_list);
+
+	/* jae <stub>, target is patched in emit_array_check_stubs() */
+	emit_branch_rel(buf, 0x0f, 0x83, 0);
+}
+
+static void emit_tlab_alloc_membase_reg(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	struct compilation_unit *cu = bb->b_parent;
+	enum machine_reg base, dest;
+	struct tlab_stub *stub;
+
+	stub = malloc(sizeof *stub);
+	if (!stub)
+		die("out of memory");
+
+	base = mach_reg(&insn->src.base_reg);
+	dest = mach_reg(&insn->dest.reg);
+
+	/* mov free_list(%ee), %obj */
+	__emit_membase_reg(buf, 1, 0x8b, base, insn->src.disp, dest);
+
+	/* test %obj, %obj */
+	__emit_reg_reg(buf, 1, 0x85, dest, dest);
+
+	stub->insn = insn;
+	stub->branch_offset = buffer_offset(buf);
+	list_add_tail(&stub->list_node, &cu->tlab_stub_list);
+
+	/* jz <stub>, target is patched in emit_tlab_stubs() */
+	emit_branch_rel(buf, 0x0f, 0x84, 0);
+
+	/* Unlink the object: push (%obj); pop free_list(%ee) */
+	__emit_membase(buf, 0, 0xff, dest, 0, 6);
+	__emit_membase(buf, 0, 0x8f, base, insn->src.disp, 0);
+
+	stub->return_offset = buffer_offset(buf);
+}
+
+static void __emit_lock_cmpxchg_reg_membase(struct buffer *buf,
+					    enum machine_reg src,
+					    enum machine_reg base,
+					    unsigned long disp)
+{
+	unsigned char opc[2] = { 0x0f, 0xb1 };
+
+	emit(buf, 0xf0); /* LOCK prefix */
+	__emit_lopc_reg_membase(buf, 1, opc, 2, src, base, disp);
+}
+
+/*
+ * Emits "lock cmpxchg" of the lock word of the object in the base register
+ * of the source operand. The destination is %rax which holds the expected
+ * value. The new value needs one more register which is saved on the stack
+ * because the instruction has no third operand.
+ */
+static void emit_monitor_membase_reg(struct insn *insn, struct buffer *buf,
+				     struct basic_block *bb, bool enter)
+{
+	struct compilation_unit *cu = bb->b_parent;
+	struct monitor_stub *stub;
+	enum machine_reg base, tmp;
+
+	stub = malloc(sizeof *stub);
+	if (!stub)
+		die("out of memory");
+
+	assert(mach_reg(&insn->dest.reg) == MACH_REG_RAX);
+
+	base = mach_reg(&insn->src.base_reg);
+	tmp = base == MACH_REG_RCX ? MACH_REG_RDX : MACH_REG_RCX;
+
+	__emit_push_reg(buf, tmp);
+
+	if (enter) {
+		/* mov %fs:thin_lock_word, %tmp */
+		emit(buf, 0x64);
+		__emit_memdisp_reg(buf, 1, 0x8b, get_thread_local_offset(&thin_lock_word), tmp);
+	} else {
+		/* xor %tmp, %tmp */
+		__emit_reg_reg(buf, 1, 0x31, tmp, tmp);
+	}
+
+	__emit_lock_cmpxchg_reg_membase(buf, tmp, base, insn->src.disp);
+
+	/* The pop does not change flags. */
+	__emit_pop_reg(buf, tmp);
+
+	stub->insn = insn;
+	stub->branch_offset = buffer_offset(buf);
+	list_add_tail(&stub->list_node, &cu->monitor_stub_list);
+
+	/* jnz <stub>, target is patched in emit_monitor_stubs() */
+	emit_branch_rel(buf, 0x0f, 0x85, 0);
+
+	stub->return_offset = buffer_offset(buf);
+}
+
+static void emit_monitor_enter_membase_reg(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	emit_monitor_membase_reg(insn, buf, bb, true);
+}
+
+static void emit_monitor_exit_membase_reg(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	emit_monitor_membase_reg(insn, buf, bb, false);
+}
+
 static void __emit_test_imm_memdisp(struct buffer *buf,
 				    int rex_w,
 				    long imm,
@@ -1007,6 +1133,55 @@ static void __emit_memindex_reg(struct buffer *buf,
 			     index_reg, base_reg, x86_encode_reg(dest_reg));
 }
 
+/*
+ * Dirties the card of the reference slot whose address is in @tmp. The bias
+ * of the card table is read from memory with an absolute address like the
+ * safepoint poll does.
+ */
+static void __emit_card_mark(struct buffer *buf, enum machine_reg tmp)
+{
+	unsigned char reg = x86_encode_reg(tmp);
+
+	/* shr $GC_CARD_SHIFT, %tmp */
+	emit(buf, REX_W | (reg_high(reg) ? REX_B : 0));
+	emit(buf, 0xc1);
+	emit(buf, x86_encode_mod_rm(0x03, 0x05, reg));
+	emit(buf, GC_CARD_SHIFT);
+
+	/* add gc_card_table_bias, %tmp */
+	emit(buf, REX_W | (reg_high(reg) ? REX_R : 0));
+	emit(buf, 0x03);
+	emit(buf, x86_encode_mod_rm(0x00, reg, 0x04));
+	emit(buf, 0x25);
+	emit_imm32(buf, (unsigned long) &gc_card_table_bias);
+
+	/* movb $GC_CARD_DIRTY, (%tmp) */
+	__emit_membase(buf, 0, 0xc6, tmp, 0, 0);
+	emit(buf, GC_CARD_DIRTY);
+}
+
+static void emit_card_mark_membase_reg(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	enum machine_reg tmp = mach_reg(&insn->dest.reg);
+
+	/* lea disp(%base), %tmp */
+	__emit_membase_reg(buf, 1, 0x8d, mach_reg(&insn->src.base_reg), insn->src.disp, tmp);
+
+	__emit_card_mark(buf, tmp);
+}
+
+static void emit_card_mark_memindex_reg(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	enum machine_reg tmp = mach_reg(&insn->dest.reg);
+
+	/* lea (%base, %index, 1 << shift), %tmp */
+	__emit_memindex_reg(buf, 1, 0x8d, insn->src.shift,
+			    mach_reg(&insn->src.index_reg),
+			    mach_reg(&insn->src.base_reg), tmp);
+
+	__emit_card_mark(buf, tmp);
+}
+
 static void __emit_reg_memindex(struct buffer *buf,
 				int rex_w,
 				unsigned char opc,
@@ -1304,9 +1479,7 @@ void emit_trampoline(struct compilation_unit *cu,
 {
 	struct buffer *buf = trampoline->objcode;
 
-	jit_text_lock();
-
-	buf->buf = jit_text_ptr();
+	jit_text_begin(buf, JIT_TEXT_COLD, TRAMPOLINE_MAX_SIZE);
 
 	/* This is for __builtin_return_address() to work and to access
 	   call arguments in correct manner. */
@@ -1358,8 +1531,7 @@ void emit_trampoline(struct compilation_unit *cu,
 	__emit_pop_reg(buf, MACH_REG_RBP);
 	emit_indirect_jump_reg(buf, MACH_REG_RAX);
 
-	jit_text_reserve(buffer_offset(buf));
-	jit_text_unlock();
+	jit_text_end(buf);
 }
 
 static void emit_exception_test(struct buffer *buf, enum machine_reg reg)
@@ -1373,8 +1545,335 @@ static void emit_exception_test(struct buffer *buf, enum machine_reg reg)
 	__emit64_test_membase_reg(buf, reg, 0, reg);
 }
 
+/*
+ * Emits a forward conditional or unconditional jump whose target is set with
+ * resolve_forward_branch() and returns the offset of its displacement.
+ */
+static unsigned long emit_forward_branch(struct buffer *buf, unsigned char prefix,
+					 unsigned char opc)
+{
+	emit_branch_rel(buf, prefix, opc, 0);
+
+	return buffer_offset(buf) - 4;
+}
+
+static void resolve_forward_branch(struct buffer *buf, unsigned long disp_offset)
+{
+	write_imm32(buf, disp_offset, buffer_offset(buf) - (disp_offset + 4));
+}
+
+/*
+ * Compares the supertype of the class of the object in @ref that is at
+ * @disp in 'struct vm_class' to the class in @klass. The object reference
+ * is not null and it's left unchanged.
+ */
+static void __emit_super_check(struct buffer *buf, enum machine_reg ref,
+			       unsigned long disp, enum machine_reg klass)
+{
+	__emit_push_reg(buf, ref);
+	__emit64_mov_membase_reg(buf, ref, offsetof(struct vm_object, class), ref);
+	__emit_membase_reg(buf, 1, 0x3b, ref, disp, klass);
+	__emit_pop_reg(buf, ref);
+}
+
+static void emit_instanceof_membase_reg(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	enum machine_reg ref, klass;
+	unsigned long is_null, no_match, done;
+
+	ref = mach_reg(&insn->src.base_reg);
+	klass = mach_reg(&insn->dest.reg);
+
+	/* test %ref, %ref; jz .false */
+	__emit_reg_reg(buf, 1, 0x85, ref, ref);
+	is_null = emit_forward_branch(buf, 0x0f, 0x84);
+
+	/* cmp super_check_offset(%ref->class), %klass; jne .false */
+	__emit_super_check(buf, ref, insn->src.disp, klass);
+	no_match = emit_forward_branch(buf, 0x0f, 0x85);
+
+	/* mov $1, %klass; jmp .done */
+	__emit_reg(buf, 0, 0xb8, klass);
+	emit_imm32(buf, 1);
+	done = emit_forward_branch(buf, 0x00, 0xe9);
+
+	/* .false: mov $0, %klass */
+	resolve_forward_branch(buf, is_null);
+	resolve_forward_branch(buf, no_match);
+	__emit_reg(buf, 0, 0xb8, klass);
+	emit_imm32(buf, 0);
+
+	resolve_forward_branch(buf, done);
+}
+
+static void emit_checkcast_membase_reg(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	enum machine_reg ref, klass;
+	unsigned long is_null, match;
+
+	ref = mach_reg(&insn->src.base_reg);
+	klass = mach_reg(&insn->dest.reg);
+
+	/* test %ref, %ref; jz .done */
+	__emit_reg_reg(buf, 1, 0x85, ref, ref);
+	is_null = emit_forward_branch(buf, 0x0f, 0x84);
+
+	/* cmp super_check_offset(%ref->class), %klass; je .done */
+	__emit_super_check(buf, ref, insn->src.disp, klass);
+	match = emit_forward_branch(buf, 0x0f, 0x84);
+
+	/*
+	 * The check is exact for classes in the supertype display so the cast
+	 * is known to fail here and vm_object_check_cast() throws.
+	 */
+	__emit_push_reg(buf, ref);
+	__emit_push_reg(buf, klass);
+	__emit_pop_reg(buf, MACH_REG_RSI);
+	__emit_pop_reg(buf, MACH_REG_RDI);
+
+	__emit_call(buf, vm_object_check_cast);
+	emit_exception_test(buf, MACH_REG_RAX);
+
+	resolve_forward_branch(buf, is_null);
+	resolve_forward_branch(buf, match);
+}
+
+void emit_array_check_stubs(struct compilation_unit *cu)
+{
+	struct buffer *buf = cu->objcode;
+	struct array_check_stub *stub;
+
+	list_for_each_entry(stub, &cu->array_check_stub_list, list_node) {
+		struct insn *insn = stub->insn;
+		unsigned long branch_end;
+
+		stub->start = buffer_offset(buf);
+
+		branch_end = stub->branch_offset + PREFIX_SIZE + BRANCH_INSN_SIZE;
+		write_imm32(buf, stub->branch_offset + PREFIX_SIZE + BRANCH_TARGET_OFFSET,
+			    stub->start - branch_end);
+
+		/* Registers may overlap with the argument registers. */
+		__emit_push_reg(buf, mach_reg(&insn->src.base_reg));
+		__emit_push_reg(buf, mach_reg(&insn->dest.reg));
+		__emit_pop_reg(buf, MACH_REG_RSI);
+		__emit_pop_reg(buf, MACH_REG_RDI);
+
+		__emit_call(buf, vm_object_check_array);
+		emit_exception_test(buf, MACH_REG_RAX);
+
+		/* Not reached: the check is known to fail here. */
+		__emit_jmp(buf, (unsigned long) buffer_ptr(buf) + branch_end);
+
+		stub->end = buffer_offset(buf);
+	}
+}
+
+void emit_tlab_stubs(struct compilation_unit *cu)
+{
+	struct buffer *buf = cu->objcode;
+	struct tlab_stub *stub;
+
+	list_for_each_entry(stub, &cu->tlab_stub_list, list_node) {
+		struct insn *insn = stub->insn;
+		enum machine_reg base, dest;
+		unsigned long branch_end;
+		int i, nr_pushed = 0;
+
+		base = mach_reg(&insn->src.base_reg);
+		dest = mach_reg(&insn->dest.reg);
+
+		stub->start = buffer_offset(buf);
+
+		branch_end = stub->branch_offset + PREFIX_SIZE + BRANCH_INSN_SIZE;
+		write_imm32(buf, stub->branch_offset + PREFIX_SIZE + BRANCH_TARGET_OFFSET,
+			    stub->start - branch_end);
+
+		/* The allocation is not a call site so everything is live. */
+		for (i = 0; i < NR_CALLER_SAVE_REGS; i++) {
+			enum machine_reg reg = caller_save_regs[i];
+
+			if (reg == dest)
+				continue;
+
+			if (is_xmm_reg(reg))
+				__emit64_push_xmm(buf, reg);
+			else
+				__emit_push_reg(buf, reg);
+
+			nr_pushed++;
+		}
+
+		if (nr_pushed & 1)
+			__emit64_sub_imm_reg(buf, 0x08, MACH_REG_RSP);
+
+		/* lea free_list(%ee), %rdi */
+		__emit_membase_reg(buf, 1, 0x8d, base, insn->src.disp, MACH_REG_RDI);
+
+		__emit_call(buf, tlab_refill);
+
+		if (nr_pushed & 1)
+			__emit_add_imm_reg(buf, 0x08, MACH_REG_RSP);
+
+		if (dest != MACH_REG_RAX)
+			__emit_mov_reg_reg(buf, MACH_REG_RAX, dest);
+
+		for (i = NR_CALLER_SAVE_REGS - 1; i >= 0; i--) {
+			enum machine_reg reg = caller_save_regs[i];
+
+			if (reg == dest)
+				continue;
+
+			if (is_xmm_reg(reg))
+				__emit64_pop_xmm(buf, reg);
+			else
+				__emit_pop_reg(buf, reg);
+		}
+
+		/* test %obj, %obj; jnz <return> */
+		__emit_reg_reg(buf, 1, 0x85, dest, dest);
+		emit_branch_rel(buf, 0x0f, 0x85,
+			stub->return_offset - (buffer_offset(buf) + PREFIX_SIZE + BRANCH_INSN_SIZE));
+
+		/* Out of memory: the exception is pending so this faults. */
+		emit_exception_test(buf, dest);
+
+		/* Not reached */
+		__emit_jmp(buf, (unsigned long) buffer_ptr(buf) + stub->return_offset);
+
+		stub->end = buffer_offset(buf);
+	}
+}
+
+void emit_monitor_stubs(struct compilation_unit *cu)
+{
+	struct buffer *buf = cu->objcode;
+	struct monitor_stub *stub;
+
+	list_for_each_entry(stub, &cu->monitor_stub_list, list_node) {
+		struct insn *insn = stub->insn;
+		unsigned long branch_end;
+		enum machine_reg base;
+		int i, nr_pushed = 0;
+		void *target;
+
+		base = mach_reg(&insn->src.base_reg);
+
+		if (insn->type == INSN_MONITOR_ENTER_MEMBASE_REG)
+			target = vm_object_lock;
+		else
+			target = vm_object_unlock;
+
+		stub->start = buffer_offset(buf);
+
+		branch_end = stub->branch_offset + PREFIX_SIZE + BRANCH_INSN_SIZE;
+		write_imm32(buf, stub->branch_offset + PREFIX_SIZE + BRANCH_TARGET_OFFSET,
+			    stub->start - branch_end);
+
+		/*
+		 * Monitor enter and exit are not call sites so everything is
+		 * live except %rax which the inlined code defines.
+		 */
+		for (i = 0; i < NR_CALLER_SAVE_REGS; i++) {
+			enum machine_reg reg = caller_save_regs[i];
+
+			if (reg == MACH_REG_RAX)
+				continue;
+
+			if (is_xmm_reg(reg))
+				__emit64_push_xmm(buf, reg);
+			else
+				__emit_push_reg(buf, reg);
+
+			nr_pushed++;
+		}
+
+		if (nr_pushed & 1)
+			__emit64_sub_imm_reg(buf, 0x08, MACH_REG_RSP);
+
+		__emit_mov_reg_reg(buf, base, MACH_REG_RDI);
+		__emit_call(buf, target);
+
+		if (nr_pushed & 1)
+			__emit_add_imm_reg(buf, 0x08, MACH_REG_RSP);
+
+		for (i = NR_CALLER_SAVE_REGS - 1; i >= 0; i--) {
+			enum machine_reg reg = caller_save_regs[i];
+
+			if (reg == MACH_REG_RAX)
+				continue;
+
+			if (is_xmm_reg(reg))
+				__emit64_pop_xmm(buf, reg);
+			else
+				__emit_pop_reg(buf, reg);
+		}
+
+		/* Faults if vm_object_lock() or vm_object_unlock() threw. */
+		emit_exception_test(buf, MACH_REG_RAX);
+
+		__emit_jmp(buf, (unsigned long) buffer_ptr(buf) + stub->return_offset);
+
+		stub->end = buffer_offset(buf);
+	}
+}
+
+/*
+ * Emits the thin lock fast path of monitor enter for the object in %r10
+ * and returns the offset of a "jz" that is taken if the lock was acquired.
+ * %rax and %r11 are clobbered. They are not used for arguments so this can
+ * be emitted in the method prologue.
+ */
+static unsigned long emit_thin_lock(struct buffer *buf)
+{
+	/* mov %fs:thin_lock_word, %r11 */
+	emit(buf, 0x64);
+	__emit_memdisp_reg(buf, 1, 0x8b, get_thread_local_offset(&thin_lock_word), MACH_REG_R11);
+
+	/* xor %eax, %eax */
+	__emit_reg_reg(buf, 0, 0x31, MACH_REG_RAX, MACH_REG_RAX);
+
+	__emit_lock_cmpxchg_reg_membase(buf, MACH_REG_R11, MACH_REG_R10,
+					offsetof(struct vm_object, monitor_record));
+
+	return emit_forward_branch(buf, 0x0f, 0x84);
+}
+
+/*
+ * Emits the thin lock fast path of monitor exit for the object in %r10
+ * and returns the offset of a "jz" that is taken if the lock was released.
+ * Only a lock that is not held recursively is released here. %r11 is
+ * clobbered and %rax, which holds the return value, is preserved.
+ */
+static unsigned long emit_thin_unlock(struct buffer *buf)
+{
+	__emit_push_reg(buf, MACH_REG_RAX);
+
+	/* mov %fs:thin_lock_word, %rax */
+	emit(buf, 0x64);
+	__emit_memdisp_reg(buf, 1, 0x8b, get_thread_local_offset(&thin_lock_word), MACH_REG_RAX);
+
+	/* xor %r11d, %r11d */
+	__emit_reg_reg(buf, 0, 0x31, MACH_REG_R11, MACH_REG_R11);
+
+	__emit_lock_cmpxchg_reg_membase(buf, MACH_REG_R11, MACH_REG_R10,
+					offsetof(struct vm_object, monitor_record));
+
+	/* The pop does not change flags. */
+	__emit_pop_reg(buf, MACH_REG_RAX);
+
+	return emit_forward_branch(buf, 0x0f, 0x84);
+}
+
 void emit_lock(struct buffer *buf, struct vm_object *obj)
 {
+	unsigned long done = 0;
+
+	if (opt_use_thin_locks) {
+		__emit_mov_imm_reg(buf, (unsigned long) obj, MACH_REG_R10);
+		done = emit_thin_lock(buf);
+	}
+
 	emit_save_arg_regs(buf);
 
 	__emit_mov_imm_reg(buf, (unsigned long) obj, MACH_REG_RDI);
@@ -1388,10 +1887,20 @@ void emit_lock(struct buffer *buf, struct vm_object *obj)
 	emit_exception_test(buf, MACH_REG_RAX);
 	__emit_pop_reg(buf, MACH_REG_RAX);
 	__emit_add_imm_reg(buf, 0x08, MACH_REG_RSP);
+
+	if (opt_use_thin_locks)
+		resolve_forward_branch(buf, done);
 }
 
 void emit_unlock(struct buffer *buf, struct vm_object *obj)
 {
+	unsigned long done = 0;
+
+	if (opt_use_thin_locks) {
+		__emit_mov_imm_reg(buf, (unsigned long) obj, MACH_REG_R10);
+		done = emit_thin_unlock(buf);
+	}
+
 	/* 16-byte stack alignment: */
 	__emit64_sub_imm_reg(buf, 0x08, MACH_REG_RSP);
 	__emit_push_reg(buf, MACH_REG_RAX);
@@ -1405,11 +1914,20 @@ void emit_unlock(struct buffer *buf, struct vm_object *obj)
 	emit_restore_arg_regs(buf);
 	__emit_pop_reg(buf, MACH_REG_RAX);
 	__emit_add_imm_reg(buf, 0x08, MACH_REG_RSP);
+
+	if (opt_use_thin_locks)
+		resolve_forward_branch(buf, done);
 }
 
 void emit_lock_this(struct buffer *buf, unsigned long frame_size)
 {
 	unsigned long this_offset = frame_size + 8 * NR_CALLEE_SAVE_REGS + 8;
+	unsigned long done = 0;
+
+	if (opt_use_thin_locks) {
+		__emit64_mov_membase_reg(buf, MACH_REG_RBP, - this_offset, MACH_REG_R10);
+		done = emit_thin_lock(buf);
+	}
 
 	__emit64_mov_membase_reg(buf, MACH_REG_RBP, - this_offset, MACH_REG_RDI);
 	emit_save_arg_regs(buf);
@@ -1422,11 +1940,20 @@ void emit_lock_this(struct buffer *buf, unsigned long frame_size)
 	emit_exception_test(buf, MACH_REG_RAX);
 	__emit_pop_reg(buf, MACH_REG_RAX);
 	__emit_add_imm_reg(buf, 0x08, MACH_REG_RSP);
+
+	if (opt_use_thin_locks)
+		resolve_forward_branch(buf, done);
 }
 
 void emit_unlock_this(struct buffer *buf, unsigned long frame_size)
 {
 	unsigned long this_offset = frame_size + 8 * NR_CALLEE_SAVE_REGS + 8;
+	unsigned long done = 0;
+
+	if (opt_use_thin_locks) {
+		__emit64_mov_membase_reg(buf, MACH_REG_RBP, - this_offset, MACH_REG_R10);
+		done = emit_thin_unlock(buf);
+	}
 
 	__emit64_mov_membase_reg(buf, MACH_REG_RBP, - this_offset, MACH_REG_RDI);
 	/* 16-byte stack alignment: */
@@ -1440,8 +1967,10 @@ void emit_unlock_this(struct buffer *buf, unsigned long frame_size)
 	emit_restore_arg_regs(buf);
 	__emit_pop_reg(buf, MACH_REG_RAX);
 	__emit_add_imm_reg(buf, 0x08, MACH_REG_RSP);
-}
 
+	if (opt_use_thin_locks)
+		resolve_forward_branch(buf, done);
+}
 
 void *emit_ic_check(struct buffer *buf)
 {
@@ -1452,14 +1981,17 @@ void emit_ic_miss_handler(struct buffer *buf, void *ic_check, struct vm_method *
 {
 }
 
+void *emit_ic_pic_stub(struct ic_pic *pic)
+{
+	return NULL;
+}
+
 extern void jni_trampoline(void);
 
 void emit_jni_trampoline(struct buffer *buf, struct vm_method *vmm,
 			 void *target)
 {
-	jit_text_lock();
-
-	buf->buf = jit_text_ptr();
+	jit_text_begin(buf, JIT_TEXT_COLD, TRAMPOLINE_MAX_SIZE);
 
 	__emit_pop_reg(buf, MACH_REG_xAX);	/* return address */
 
@@ -1472,8 +2004,7 @@ void emit_jni_trampoline(struct buffer *buf, struct vm_method *vmm,
 	__emit_push_reg(buf, MACH_REG_xBP);
 	__emit_jmp(buf, (unsigned long) jni_trampoline);
 
-	jit_text_reserve(buffer_offset(buf));
-	jit_text_unlock();
+	jit_text_end(buf);
 }
 
 /* The regparm(1) makes GCC get the first argument from %ecx and the rest
@@ -1575,16 +2106,12 @@ static void emit_itable_bsearch(struct buffer *buf,
 void *emit_itable_resolver_stub(struct vm_class *vmc,
 	struct itable_entry **table, unsigned int nr_entries)
 {
-	static struct buffer_operations exec_buf_ops = {
-		.expand = NULL,
-		.free   = NULL,
-	};
-
-	struct buffer *buf = __alloc_buffer(&exec_buf_ops);
+	struct buffer *buf = alloc_exec_buffer();
 
-	jit_text_lock();
+	if (!buf)
+		return NULL;
 
-	buf->buf = jit_text_ptr();
+	jit_text_begin(buf, JIT_TEXT_COLD, ITABLE_STUB_MAX_SIZE(nr_entries));
 
 	/* Note: When the stub is called, %eax contains the signature hash that
 	 * we look up in the stub. 0(%esp) contains the object reference. %ecx
@@ -1597,8 +2124,7 @@ void *emit_itable_resolver_stub(struct vm_class *vmc,
 
 	emit_itable_bsearch(buf, table, 0, nr_entries - 1);
 
-	jit_text_reserve(buffer_offset(buf));
-	jit_text_unlock();
+	jit_text_end(buf);
 
 	return buffer_ptr(buf);
 }
@@ -1617,15 +2143,24 @@ static emit_fn_t emitters[] = {
 	DECL_EMITTER(INSN_ADD_IMM_REG, insn_encode),
 	DECL_EMITTER(INSN_ADD_REG_REG, insn_encode),
 	DECL_EMITTER(INSN_AND_REG_REG, insn_encode),
+	DECL_EMITTER(INSN_ANDPD_XMM_XMM, insn_encode),
+	DECL_EMITTER(INSN_ANDPS_XMM_XMM, insn_encode),
+	DECL_EMITTER(INSN_ARRAY_CHECK_MEMBASE_REG, emit_array_check_membase_reg),
 	DECL_EMITTER(INSN_CALL_REG, insn_encode),
 	DECL_EMITTER(INSN_CALL_REL, emit_call),
+	DECL_EMITTER(INSN_CARD_MARK_MEMBASE_REG, emit_card_mark_membase_reg),
+	DECL_EMITTER(INSN_CARD_MARK_MEMINDEX_REG, emit_card_mark_memindex_reg),
+	DECL_EMITTER(INSN_CHECKCAST_MEMBASE_REG, emit_checkcast_membase_reg),
 	DECL_EMITTER(INSN_CLTD_REG_REG, insn_encode),
+	DECL_EMITTER(INSN_CMOVG_REG_REG, insn_encode),
+	DECL_EMITTER(INSN_CMOVL_REG_REG, insn_encode),
 	DECL_EMITTER(INSN_DIVSD_XMM_XMM, insn_encode),
 	DECL_EMITTER(INSN_DIVSS_XMM_XMM, insn_encode),
 	DECL_EMITTER(INSN_FLD_64_MEMLOCAL, insn_encode),
 	DECL_EMITTER(INSN_FLD_MEMLOCAL, insn_encode),
 	DECL_EMITTER(INSN_FSTP_64_MEMLOCAL, insn_encode),
 	DECL_EMITTER(INSN_FSTP_MEMLOCAL, insn_encode),
+	DECL_EMITTER(INSN_INSTANCEOF_MEMBASE_REG, emit_instanceof_membase_reg),
 	DECL_EMITTER(INSN_JE_BRANCH, emit_je_branch),
 	DECL_EMITTER(INSN_JGE_BRANCH, emit_jge_branch),
 	DECL_EMITTER(INSN_JG_BRANCH, emit_jg_branch),
@@ -1649,6 +2184,8 @@ static emit_fn_t emitters[] = {
 	DECL_EMITTER(INSN_MOVSS_XMM_MEMDISP, insn_encode),
 	DECL_EMITTER(INSN_MOVSS_XMM_MEMLOCAL, insn_encode),
 	DECL_EMITTER(INSN_MOVSS_XMM_XMM, insn_encode),
+	DECL_EMITTER(INSN_MONITOR_ENTER_MEMBASE_REG, emit_monitor_enter_membase_reg),
+	DECL_EMITTER(INSN_MONITOR_EXIT_MEMBASE_REG, emit_monitor_exit_membase_reg),
 	DECL_EMITTER(INSN_MOVSXD_REG_REG, insn_encode),
 	DECL_EMITTER(INSN_MOVSX_16_MEMBASE_REG, insn_encode),
 	DECL_EMITTER(INSN_MOVSX_16_REG_REG, insn_encode),
@@ -1674,6 +2211,7 @@ static emit_fn_t emitters[] = {
 	DECL_EMITTER(INSN_SAR_REG_REG, insn_encode),
 	DECL_EMITTER(INSN_SHL_REG_REG, insn_encode),
 	DECL_EMITTER(INSN_SHR_REG_REG, insn_encode),
+	DECL_EMITTER(INSN_SQRTSD_XMM_XMM, insn_encode),
 	DECL_EMITTER(INSN_SUBSD_XMM_XMM, insn_encode),
 	DECL_EMITTER(INSN_SUBSS_XMM_XMM, insn_encode),
 	DECL_EMITTER(INSN_SUB_IMM_REG, insn_encode),
@@ -1704,6 +2242,7 @@ static emit_fn_t emitters[] = {
 	DECL_EMITTER(INSN_MUL_REG_REG, emit_mul_reg_reg),
 	DECL_EMITTER(INSN_PUSH_IMM, emit_push_imm),
 	DECL_EMITTER(INSN_TEST_MEMBASE_REG, emit_test_membase_reg),
+	DECL_EMITTER(INSN_TLAB_ALLOC_MEMBASE_REG, emit_tlab_alloc_membase_reg),
 	DECL_EMITTER(INSN_TEST_IMM_MEMDISP, emit_test_imm_memdisp),
 	DECL_EMITTER(INSN_SAVE_CALLER_REGS, emit_pseudo),
 	DECL_EMITTER(INSN_RESTORE_CALLER_REGS, emit_pseudo),
@@ -191,6 +191,8 @@ static uint64_t encode_table[NR_INSN_TYPES] = {
 	[INSN_ADD_IMM_REG]		= OPCODE(0x81) | OPCODE_EXT(0)   | ADDMODE_IMM_REG | WIDTH_FULL | REX_W_PREFIX,
 	[INSN_ADD_MEMBASE_REG]		= OPCODE(0x03) | ADDMODE_RM_REG  | WIDTH_FULL | REX_W_PREFIX,
 	[INSN_ADD_REG_REG]		= OPCODE(0x01) | ADDMODE_REG_REG | DIR_REVERSED | WIDTH_FULL | REX_W_PREFIX,
+	[INSN_ANDPD_XMM_XMM]		= OPERAND_SIZE_PREFIX | ESCAPE_OPC_BYTE | OPCODE(0x54) | ADDMODE_REG_REG | WIDTH_FULL,
+	[INSN_ANDPS_XMM_XMM]		= ESCAPE_OPC_BYTE | OPCODE(0x54) | ADDMODE_REG_REG | WIDTH_FULL,
 	[INSN_AND_MEMBASE_REG]		= OPCODE(0x23) | ADDMODE_RM_REG  | WIDTH_FULL | REX_W_PREFIX,
 	[INSN_AND_REG_REG]		= OPCODE(0x21) | ADDMODE_REG_REG | DIR_REVERSED | WIDTH_FULL | REX_W_PREFIX,
 	[INSN_CALL_REG]			= OPCODE(0xFF) | OPCODE_EXT(2)   | ADDMODE_RM | WIDTH_FULL,
@@ -198,6 +200,8 @@ static uint64_t encode_table[NR_INSN_TYPES] = {
 	[INSN_CMP_IMM_REG]		= OPCODE(0x81) | OPCODE_EXT(7)   | ADDMODE_IMM_REG | WIDTH_FULL | REX_W_PREFIX,
 	[INSN_CMP_MEMBASE_REG]		= OPCODE(0x3b) | ADDMODE_RM_REG  | WIDTH_FULL | REX_W_PREFIX,
 	[INSN_CMP_REG_REG]		= OPCODE(0x39) | ADDMODE_REG_REG | DIR_REVERSED | WIDTH_FULL | REX_W_PREFIX,
+	[INSN_CMOVG_REG_REG]		= OPCODE(0x4f) | ESCAPE_OPC_BYTE | ADDMODE_REG_REG | WIDTH_FULL | REX_W_PREFIX,
+	[INSN_CMOVL_REG_REG]		= OPCODE(0x4c) | ESCAPE_OPC_BYTE | ADDMODE_REG_REG | WIDTH_FULL | REX_W_PREFIX,
 	[INSN_DIVSD_XMM_XMM]		= REPNE_PREFIX | ESCAPE_OPC_BYTE | OPCODE(0x5e) | ADDMODE_REG_REG | WIDTH_64,
 	[INSN_DIVSS_XMM_XMM]		= REPE_PREFIX  | ESCAPE_OPC_BYTE | OPCODE(0x5e) | ADDMODE_REG_REG | WIDTH_FULL,
 	[INSN_FLD_64_MEMLOCAL]		= OPCODE(0xdd) | OPCODE_EXT(0)   | ADDMODE_MEMLOCAL | WIDTH_64,
@@ -250,6 +254,7 @@ static uint64_t encode_table[NR_INSN_TYPES] = {
 	[INSN_SBB_REG_REG]		= OPCODE(0x19) | ADDMODE_REG_REG | DIR_REVERSED | WIDTH_FULL | REX_W_PREFIX,
 	[INSN_SHL_REG_REG]		= OPCODE(0xd3) | OPCODE_EXT(4)   | ADDMODE_REG_REG|DIR_REVERSED | WIDTH_FULL | REX_W_PREFIX,
 	[INSN_SHR_REG_REG]		= OPCODE(0xd3) | OPCODE_EXT(5)   | ADDMODE_REG_REG|DIR_REVERSED | WIDTH_FULL | REX_W_PREFIX,
+	[INSN_SQRTSD_XMM_XMM]		= REPNE_PREFIX | ESCAPE_OPC_BYTE | OPCODE(0x51) | ADDMODE_REG_REG | WIDTH_64,
 	[INSN_SUBSD_XMM_XMM]		= REPNE_PREFIX | ESCAPE_OPC_BYTE | OPCODE(0x5c) | ADDMODE_REG_REG | WIDTH_64,
 	[INSN_SUBSS_XMM_XMM]		= REPE_PREFIX  | ESCAPE_OPC_BYTE | OPCODE(0x5c) | ADDMODE_REG_REG | WIDTH_FULL,
 	[INSN_SUB_IMM_REG]		= OPCODE(0x81) | OPCODE_EXT(5)   | ADDMODE_IMM_REG | WIDTH_FULL | REX_W_PREFIX,
@@ -1,5 +1,6 @@
 #include "jit/cu-mapping.h"
 #include "jit/compiler.h"
+#include "jit/text.h"
 #include "arch/encode.h"
 #include "lib/list.h"
 #include "vm/class.h"
@@ -50,7 +51,7 @@ void fixup_direct_calls(struct jit_trampoline *t, unsigned long target)
 
 		site_addr = fixup_site_addr(this);
 		new_target = x86_call_disp(site_addr, (void *) target);
-		cpu_write_u32(site_addr+1, new_target);
+		jit_text_write_u32(site_addr+1, new_target);
 
 		VALGRIND_DISCARD_TRANSLATIONS(site_addr, X86_CALL_INSN_SIZE);
 
@@ -67,9 +68,9 @@ static void do_fixup_static(void *site_addr, int skip_count, void *new_target)
 
 #ifdef CONFIG_X86_64
 	/* We need RIP-relative addressing. */
-	cpu_write_u32(p, new_target - site_addr - (skip_count + 4));
+	jit_text_write_u32(p, new_target - site_addr - (skip_count + 4));
 #else
-	cpu_write_u32(p, (unsigned long) new_target);
+	jit_text_write_u32(p, (unsigned long) new_target);
 #endif
 
 	VALGRIND_DISCARD_TRANSLATIONS(site_addr, skip_count + 4);
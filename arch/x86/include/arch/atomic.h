@@ -25,6 +25,14 @@ static inline void atomic_set(atomic_t *v, int i)
 	v->counter = i;
 }
 
+static inline int atomic_xchg(atomic_t *v, int new)
+{
+	asm volatile("xchgl %0, %1"
+		     : "+r" (new), "+m" (v->counter)
+		     : : "memory");
+	return new;
+}
+
 static inline void atomic_inc(atomic_t *v)
 {
 	asm volatile("lock; incl %0"
@@ -3,22 +3,55 @@
 
 #include "arch/registers.h"
 
+#include "lib/list.h"
+
 #include <stdbool.h>
 
 #define IC_IMM_REG	MACH_REG_xAX
 #define IC_CLASS_REG	MACH_REG_xCX
 
+/*
+ * A call site that misses in its monomorphic inline cache is given a
+ * polymorphic stub that compares the receiver class against up to
+ * IC_PIC_SIZE classes. The call site becomes megamorphic when the stub is
+ * full and it has missed IC_PIC_MAX_MISSES more times.
+ */
+#define IC_PIC_SIZE		4
+#define IC_PIC_MAX_MISSES	16
+
 struct vm_class;
 struct vm_method;
 struct compilation_unit;
+struct buffer;
+
+struct ic_pic {
+	struct vm_method	*vmm;
+	void			*callsite;
+	void			*stub;
+	struct buffer		*buf;
+
+	/* Node in ->ic_pic_list of the compilation unit of the call site */
+	struct list_head	list_node;
+	unsigned int		nr_entries;
+	unsigned int		nr_misses;
+	struct vm_class		*classes[IC_PIC_SIZE];
+
+	/* Where the class and the target of each entry are patched */
+	void			*class_imm[IC_PIC_SIZE];
+	void			*target_disp[IC_PIC_SIZE];
+};
 
 void *ic_lookup_vtable(struct vm_class *vmc, struct vm_method *vmm);
 bool ic_supports_method(struct vm_method *vmm);
 void *do_ic_setup(struct vm_class *vmc, struct vm_method *i_vmm, void *callsite);
 int convert_ic_calls(struct compilation_unit *cu);
 void *resolve_ic_miss(struct vm_class *vmc, struct vm_method *vmm, void *callsite);
+void *do_ic_pic_miss(struct vm_class *vmc, struct ic_pic *pic, void *callsite);
+void *emit_ic_pic_stub(struct ic_pic *pic);
+void free_ic_pics(struct compilation_unit *cu);
 
 void ic_start(void);
 void ic_vcall_stub(void);
+void ic_pic_miss(void);
 
 #endif /* INLINE_CACHE_H */
@@ -97,14 +97,22 @@ enum insn_type {
 	INSN_ADD_IMM_REG,
 	INSN_ADD_MEMBASE_REG,
 	INSN_ADD_REG_REG,
+	INSN_ANDPD_XMM_XMM,
+	INSN_ANDPS_XMM_XMM,
 	INSN_AND_MEMBASE_REG,
 	INSN_AND_REG_REG,
+	INSN_ARRAY_CHECK_MEMBASE_REG,
 	INSN_CALL_REG,
 	INSN_CALL_REL,
+	INSN_CARD_MARK_MEMBASE_REG,
+	INSN_CARD_MARK_MEMINDEX_REG,
+	INSN_CHECKCAST_MEMBASE_REG,
 	INSN_CLTD_REG_REG,	/* CDQ in Intel manuals */
 	INSN_CMP_IMM_REG,
 	INSN_CMP_MEMBASE_REG,
 	INSN_CMP_REG_REG,
+	INSN_CMOVG_REG_REG,
+	INSN_CMOVL_REG_REG,
 	INSN_CONV_FPU64_TO_GPR,
 	INSN_CONV_FPU_TO_GPR,
 	INSN_CONV_GPR_TO_FPU,
@@ -128,6 +136,7 @@ enum insn_type {
 	INSN_FSTP_MEMBASE,
 	INSN_FSTP_MEMLOCAL,
 	INSN_IC_CALL,
+	INSN_INSTANCEOF_MEMBASE_REG,
 	INSN_JE_BRANCH,
 	INSN_JGE_BRANCH,
 	INSN_JG_BRANCH,
@@ -137,6 +146,8 @@ enum insn_type {
 	INSN_JMP_MEMBASE,
 	INSN_JMP_MEMINDEX,
 	INSN_JNE_BRANCH,
+	INSN_MONITOR_ENTER_MEMBASE_REG,
+	INSN_MONITOR_EXIT_MEMBASE_REG,
 	INSN_MOVSD_MEMBASE_XMM,
 	INSN_MOVSD_MEMDISP_XMM,
 	INSN_MOVSD_MEMINDEX_XMM,
@@ -202,6 +213,7 @@ enum insn_type {
 	INSN_SBB_REG_REG,
 	INSN_SHL_REG_REG,
 	INSN_SHR_REG_REG,
+	INSN_SQRTSD_XMM_XMM,
 	INSN_SUBSD_XMM_XMM,
 	INSN_SUBSS_XMM_XMM,
 	INSN_SUB_IMM_REG,
@@ -209,6 +221,7 @@ enum insn_type {
 	INSN_SUB_REG_REG,
 	INSN_TEST_IMM_MEMDISP,
 	INSN_TEST_MEMBASE_REG,
+	INSN_TLAB_ALLOC_MEMBASE_REG,
 	INSN_XORPD_XMM_XMM,
 	INSN_XOR_MEMBASE_REG,
 	INSN_XOR_REG_REG,
@@ -332,6 +345,11 @@ static inline bool insn_is_call_to(struct insn *insn, void *target)
 	return insn->operand.rel == (unsigned long) target;
 }
 
+static inline bool insn_is_array_check(struct insn *insn)
+{
+	return insn->type == INSN_ARRAY_CHECK_MEMBASE_REG;
+}
+
 static inline bool insn_is_jmp_branch(struct insn *insn)
 {
 	return insn->type == INSN_JMP_BRANCH;
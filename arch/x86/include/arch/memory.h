@@ -22,6 +22,9 @@
 
 #define barrier() __asm__ __volatile__("": : :"memory")
 
+/* Spin-wait loop hint */
+#define cpu_relax() __asm__ __volatile__("rep; nop": : :"memory")
+
 static inline void cpu_write_u32(unsigned char *p, uint32_t val)
 {
 	*((uint32_t*)p) = val;
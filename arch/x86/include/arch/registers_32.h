@@ -98,8 +98,29 @@ struct register_state {
 			unsigned long	esi;
 		};
 	};
+	unsigned long			sp;
+	unsigned long			bp;
 };
 
+/*
+ * Returns the value of general purpose register @reg in @regs.
+ */
+static inline unsigned long
+register_state_get(struct register_state *regs, enum machine_reg reg)
+{
+	switch (reg) {
+	case MACH_REG_EAX:	return regs->eax;
+	case MACH_REG_ECX:	return regs->ecx;
+	case MACH_REG_EDX:	return regs->edx;
+	case MACH_REG_EBX:	return regs->ebx;
+	case MACH_REG_ESI:	return regs->esi;
+	case MACH_REG_EDI:	return regs->edi;
+	case MACH_REG_ESP:	return regs->sp;
+	case MACH_REG_EBP:	return regs->bp;
+	default:		return 0;
+	}
+}
+
 static inline enum vm_type reg_default_type(enum machine_reg reg)
 {
 	if (reg < NR_GP_REGISTERS)
@@ -123,8 +123,37 @@ struct register_state {
 			unsigned long	r15;
 		};
 	};
+	unsigned long			sp;
+	unsigned long			bp;
 };
 
+/*
+ * Returns the value of general purpose register @reg in @regs.
+ */
+static inline unsigned long
+register_state_get(struct register_state *regs, enum machine_reg reg)
+{
+	switch (reg) {
+	case MACH_REG_RAX:	return regs->rax;
+	case MACH_REG_RCX:	return regs->rcx;
+	case MACH_REG_RDX:	return regs->rdx;
+	case MACH_REG_RBX:	return regs->rbx;
+	case MACH_REG_RSI:	return regs->rsi;
+	case MACH_REG_RDI:	return regs->rdi;
+	case MACH_REG_R8:	return regs->r8;
+	case MACH_REG_R9:	return regs->r9;
+	case MACH_REG_R10:	return regs->r10;
+	case MACH_REG_R11:	return regs->r11;
+	case MACH_REG_R12:	return regs->r12;
+	case MACH_REG_R13:	return regs->r13;
+	case MACH_REG_R14:	return regs->r14;
+	case MACH_REG_R15:	return regs->r15;
+	case MACH_REG_RSP:	return regs->sp;
+	case MACH_REG_RBP:	return regs->bp;
+	default:		return 0;
+	}
+}
+
 static inline enum vm_type reg_default_type(enum machine_reg reg)
 {
 	if (reg < NR_GP_REGISTERS)
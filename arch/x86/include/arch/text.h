@@ -7,6 +7,17 @@
  */
 #define TEXT_ALIGNMENT 16
 
+/*
+ * Upper bounds for the size of emitted code. Emission fails if the code
+ * does not fit in the part of the code cache that has been set aside for it.
+ */
+#define CODE_SIZE_FIXED			4096
+#define CODE_SIZE_PER_BB		64
+#define CODE_SIZE_PER_INSN		128
+#define TRAMPOLINE_MAX_SIZE		256
+#define ITABLE_STUB_MAX_SIZE(n)		(64 + 64 * (n))
+#define IC_PIC_STUB_MAX_SIZE		128
+
 #ifdef CONFIG_X86_64
 # define TEXT_MAP_FLAGS		MAP_32BIT
 #else
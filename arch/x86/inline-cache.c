@@ -5,11 +5,15 @@
 #include "jit/inline-cache.h"
 #include "jit/instruction.h"
 #include "jit/cu-mapping.h"
+#include "jit/text.h"
+
+#include "lib/buffer.h"
 
 #include "vm/method.h"
 #include "vm/class.h"
 #include "vm/trace.h"
 #include "vm/die.h"
+#include "vm/stdlib.h"
 
 #include "arch/instruction.h"
 #include "arch/isa.h"
@@ -85,6 +89,13 @@ bool ic_supports_method(struct vm_method *vmm)
 		&& !vm_class_is_primitive_class(vmm->class);
 }
 
+static void *ic_call_target(struct x86_ic *ic)
+{
+	int32_t disp = *(int32_t *) ic->fn;
+
+	return (void *) (ic->fn + sizeof(disp) + disp);
+}
+
 static void ic_set_to_monomorphic(struct vm_class *vmc, struct vm_method *vmm, void *callsite)
 {
 	struct x86_ic ic;
@@ -104,14 +115,17 @@ static void ic_set_to_monomorphic(struct vm_class *vmc, struct vm_method *vmm, v
 	if (pthread_mutex_lock(&ic_patch_lock) != 0)
 		die("Failed to lock ic_patch_lock\n");
 
-	cpu_write_u32((void *) ic.fn, x86_call_disp(callsite, ic_entry_point));
-	cpu_write_u32((void *) ic.imm, (unsigned long) vmc);
+	jit_text_write_u32((void *) ic.fn, x86_call_disp(callsite, ic_entry_point));
+	jit_text_write_u32((void *) ic.imm, (unsigned long) vmc);
 
 	if (pthread_mutex_unlock(&ic_patch_lock) != 0)
 		die("Failed to unlock ic_patch_lock\n");
 }
 
-static void ic_set_to_megamorphic(struct vm_method *vmm, void *callsite)
+/*
+ * The caller must hold ic_patch_lock.
+ */
+static void __ic_set_to_megamorphic(struct vm_method *vmm, void *callsite)
 {
 	struct x86_ic ic;
 
@@ -121,12 +135,83 @@ static void ic_set_to_megamorphic(struct vm_method *vmm, void *callsite)
 	ic_from_callsite(&ic, (unsigned long)callsite);
 	assert(is_valid_ic(&ic));
 
-	if (pthread_mutex_lock(&ic_patch_lock) != 0)
-		die("Failed to lock ic_patch_lock\n");
-	cpu_write_u32((void *) ic.fn, x86_call_disp(callsite, ic_vcall_stub));
-	cpu_write_u32((void *) ic.imm, (uint32_t)(vmm->virtual_index * sizeof(void *)));
-	if (pthread_mutex_unlock(&ic_patch_lock) != 0)
-		die("Failed to unlock ic_patch_lock\n");
+	/* The vtable stub needs the offset as soon as it's called. */
+	jit_text_write_u32((void *) ic.imm, (uint32_t)(vmm->virtual_index * sizeof(void *)));
+	jit_text_write_u32((void *) ic.fn, x86_call_disp(callsite, ic_vcall_stub));
+}
+
+/*
+ * Adds an entry for @vmc to @pic unless it's there already or @vmc
+ * resolves to a method that has not been compiled yet. The caller must hold
+ * ic_patch_lock.
+ */
+static void ic_pic_add(struct ic_pic *pic, struct vm_class *vmc, void *target)
+{
+	struct compilation_unit *cu;
+	unsigned int i;
+
+	for (i = 0; i < pic->nr_entries; i++) {
+		if (pic->classes[i] == vmc)
+			return;
+	}
+
+	cu = jit_lookup_cu((unsigned long) target);
+	if (!cu || !vm_method_is_compiled(cu->method))
+		return;
+
+	i = pic->nr_entries;
+
+	/* Set the target first so that the entry is never half done. */
+	jit_text_write_u32(pic->target_disp[i],
+			   vm_method_entry_point(cu->method) - (pic->target_disp[i] + 4));
+	jit_text_write_u32(pic->class_imm[i], (unsigned long) vmc);
+
+	pic->classes[i] = vmc;
+	pic->nr_entries++;
+}
+
+/*
+ * Turns the monomorphic call site at @callsite that calls @vmm into a
+ * polymorphic one. The caller must hold ic_patch_lock.
+ */
+static void ic_set_to_polymorphic(struct vm_class *vmc, struct vm_method *vmm, void *callsite)
+{
+	struct compilation_unit *cu;
+	struct vm_class *mono_vmc;
+	struct ic_pic *pic;
+	struct x86_ic ic;
+
+	ic_from_callsite(&ic, (unsigned long) callsite);
+	assert(is_valid_ic(&ic));
+
+	cu = jit_lookup_cu((unsigned long) callsite);
+	if (!cu)
+		goto megamorphic;
+
+	mono_vmc = (struct vm_class *) (unsigned long) *(uint32_t *) ic.imm;
+
+	pic = zalloc(sizeof *pic);
+	if (!pic)
+		goto megamorphic;
+
+	pic->vmm	= vmm;
+	pic->callsite	= callsite;
+	pic->stub	= emit_ic_pic_stub(pic);
+	if (!pic->stub) {
+		free(pic);
+		goto megamorphic;
+	}
+
+	list_add(&pic->list_node, &cu->ic_pic_list);
+
+	ic_pic_add(pic, mono_vmc, vm_method_entry_point(vmm));
+	ic_pic_add(pic, vmc, ic_lookup_vtable(vmc, vmm));
+
+	jit_text_write_u32((void *) ic.fn, x86_call_disp(callsite, pic->stub));
+	return;
+
+megamorphic:
+	__ic_set_to_megamorphic(vmm, callsite);
 }
 
 void *do_ic_setup(struct vm_class *vmc, struct vm_method *i_vmm, void *return_addr)
@@ -221,11 +306,75 @@ int convert_ic_calls(struct compilation_unit *cu)
 	return 0;
 }
 
+/*
+ * Called from the inline cache check of @vmm when a monomorphic call site
+ * sees a receiver of another class @vmc.
+ */
 void *resolve_ic_miss(struct vm_class *vmc, struct vm_method *vmm, void *return_addr)
 {
 	void *callsite = return_addr - X86_CALL_INSN_SIZE;
+	struct x86_ic ic;
 
-	ic_set_to_megamorphic(vmm, callsite);
+	ic_from_callsite(&ic, (unsigned long) callsite);
+
+	if (pthread_mutex_lock(&ic_patch_lock) != 0)
+		die("Failed to lock ic_patch_lock\n");
+
+	/* Another thread may have already changed the call site. */
+	if (ic_call_target(&ic) == vm_method_ic_entry_point(vmm))
+		ic_set_to_polymorphic(vmc, vmm, callsite);
+
+	if (pthread_mutex_unlock(&ic_patch_lock) != 0)
+		die("Failed to unlock ic_patch_lock\n");
 
 	return ic_lookup_vtable(vmc, vmm);
 }
+
+/*
+ * Frees the polymorphic stubs of the call sites in @cu. A stub may still be
+ * running after its call site has been patched again, so stubs are only
+ * freed when the code that calls them goes away.
+ */
+void free_ic_pics(struct compilation_unit *cu)
+{
+	struct ic_pic *pic, *next;
+
+	if (pthread_mutex_lock(&ic_patch_lock) != 0)
+		die("Failed to lock ic_patch_lock\n");
+
+	list_for_each_entry_safe(pic, next, &cu->ic_pic_list, list_node) {
+		list_del(&pic->list_node);
+
+		jit_text_free(buffer_ptr(pic->buf), buffer_offset(pic->buf));
+		free_buffer(pic->buf);
+		free(pic);
+	}
+
+	if (pthread_mutex_unlock(&ic_patch_lock) != 0)
+		die("Failed to unlock ic_patch_lock\n");
+}
+
+/*
+ * Called from the polymorphic stub @pic when none of its entries matches
+ * the receiver class @vmc.
+ */
+void *do_ic_pic_miss(struct vm_class *vmc, struct ic_pic *pic, void *return_addr)
+{
+	void *target = ic_lookup_vtable(vmc, pic->vmm);
+	struct x86_ic ic;
+
+	ic_from_callsite(&ic, (unsigned long) pic->callsite);
+
+	if (pthread_mutex_lock(&ic_patch_lock) != 0)
+		die("Failed to lock ic_patch_lock\n");
+
+	if (pic->nr_entries < IC_PIC_SIZE)
+		ic_pic_add(pic, vmc, target);
+	else if (++pic->nr_misses >= IC_PIC_MAX_MISSES && ic_call_target(&ic) == pic->stub)
+		__ic_set_to_megamorphic(pic->vmm, pic->callsite);
+
+	if (pthread_mutex_unlock(&ic_patch_lock) != 0)
+		die("Failed to unlock ic_patch_lock\n");
+
+	return target;
+}
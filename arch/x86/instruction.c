@@ -772,14 +772,22 @@ static unsigned long insn_flags[] = {
 	[INSN_ADD_IMM_REG]			= USE_DST | DEF_DST,
 	[INSN_ADD_MEMBASE_REG]			= USE_SRC | USE_DST | DEF_DST,
 	[INSN_ADD_REG_REG]			= USE_SRC | USE_DST | DEF_DST,
+	[INSN_ANDPD_XMM_XMM]			= USE_SRC | USE_DST | DEF_DST,
+	[INSN_ANDPS_XMM_XMM]			= USE_SRC | USE_DST | DEF_DST,
 	[INSN_AND_MEMBASE_REG]			= USE_SRC | USE_DST | DEF_DST,
 	[INSN_AND_REG_REG]			= USE_SRC | USE_DST | DEF_DST,
+	[INSN_ARRAY_CHECK_MEMBASE_REG]		= USE_SRC | USE_DST | DEF_NONE,
 	[INSN_CALL_REG]				= USE_DST | DEF_NONE | TYPE_CALL,
 	[INSN_CALL_REL]				= USE_NONE | DEF_NONE | TYPE_CALL,
+	[INSN_CARD_MARK_MEMBASE_REG]		= USE_SRC | DEF_DST,
+	[INSN_CARD_MARK_MEMINDEX_REG]		= USE_SRC | USE_IDX_SRC | DEF_DST,
+	[INSN_CHECKCAST_MEMBASE_REG]		= USE_SRC | USE_DST | DEF_NONE,
 	[INSN_CLTD_REG_REG]			= USE_SRC | DEF_SRC | DEF_DST,
 	[INSN_CMP_IMM_REG]			= USE_DST,
 	[INSN_CMP_MEMBASE_REG]			= USE_SRC | USE_DST,
 	[INSN_CMP_REG_REG]			= USE_SRC | USE_DST,
+	[INSN_CMOVG_REG_REG]			= USE_SRC | USE_DST | DEF_DST,
+	[INSN_CMOVL_REG_REG]			= USE_SRC | USE_DST | DEF_DST,
 	[INSN_CONV_FPU64_TO_GPR]		= USE_SRC | DEF_DST,
 	[INSN_CONV_FPU_TO_GPR]			= USE_SRC | DEF_DST,
 	[INSN_CONV_GPR_TO_FPU64]		= USE_SRC | DEF_DST,
@@ -803,6 +811,7 @@ static unsigned long insn_flags[] = {
 	[INSN_FSTP_MEMBASE]			= USE_SRC | DEF_NONE,
 	[INSN_FSTP_MEMLOCAL]			= USE_FP | DEF_NONE,
 	[INSN_IC_CALL]				= USE_SRC | DEF_xAX | DEF_xCX | TYPE_CALL,
+	[INSN_INSTANCEOF_MEMBASE_REG]		= USE_SRC | USE_DST | DEF_DST,
 	[INSN_JE_BRANCH]			= USE_NONE | DEF_NONE | TYPE_BRANCH,
 	[INSN_JGE_BRANCH]			= USE_NONE | DEF_NONE | TYPE_BRANCH,
 	[INSN_JG_BRANCH]			= USE_NONE | DEF_NONE | TYPE_BRANCH,
@@ -812,6 +821,9 @@ static unsigned long insn_flags[] = {
 	[INSN_JMP_MEMBASE]			= USE_DST | DEF_NONE | TYPE_BRANCH,
 	[INSN_JMP_MEMINDEX]			= USE_IDX_DST | USE_DST | DEF_NONE | TYPE_BRANCH,
 	[INSN_JNE_BRANCH]			= USE_NONE | DEF_NONE | TYPE_BRANCH,
+	/* The destination is the fixed %rax which cmpxchg compares against. */
+	[INSN_MONITOR_ENTER_MEMBASE_REG]	= USE_SRC | USE_DST | DEF_DST,
+	[INSN_MONITOR_EXIT_MEMBASE_REG]		= USE_SRC | USE_DST | DEF_DST,
 	[INSN_MOVSD_MEMBASE_XMM]		= USE_SRC | DEF_DST,
 	[INSN_MOVSD_MEMDISP_XMM]		= USE_NONE | DEF_DST,
 	[INSN_MOVSD_MEMINDEX_XMM]		= USE_SRC | USE_IDX_SRC | DEF_DST,
@@ -877,6 +889,7 @@ static unsigned long insn_flags[] = {
 	[INSN_SBB_REG_REG]			= USE_SRC | USE_DST | DEF_DST,
 	[INSN_SHL_REG_REG]			= USE_SRC | USE_DST | DEF_DST,
 	[INSN_SHR_REG_REG]			= USE_SRC | USE_DST | DEF_DST,
+	[INSN_SQRTSD_XMM_XMM]			= USE_SRC | DEF_DST,
 	[INSN_SUBSD_XMM_XMM]			= USE_SRC | USE_DST | DEF_DST,
 	[INSN_SUBSS_XMM_XMM]			= USE_SRC | USE_DST | DEF_DST,
 	[INSN_SUB_IMM_REG]			= USE_DST | DEF_DST,
@@ -884,6 +897,8 @@ static unsigned long insn_flags[] = {
 	[INSN_SUB_REG_REG]			= USE_SRC | USE_DST | DEF_DST,
 	[INSN_TEST_IMM_MEMDISP]			= USE_NONE | DEF_NONE,
 	[INSN_TEST_MEMBASE_REG]			= USE_SRC | USE_DST | DEF_NONE,
+	/* The destination is written before the source is used for the last time. */
+	[INSN_TLAB_ALLOC_MEMBASE_REG]		= USE_SRC | USE_DST | DEF_DST,
 	[INSN_XORPD_XMM_XMM]			= USE_SRC | USE_DST | DEF_DST,
 	[INSN_XOR_MEMBASE_REG]			= USE_SRC | USE_DST | DEF_DST,
 	[INSN_XOR_REG_REG]			= USE_SRC | USE_DST | DEF_DST,
@@ -284,6 +284,12 @@ static int print_subsd_xmm_xmm(struct string *str, struct insn *insn)
 	return print_reg_reg(str, insn);
 }
 
+static int print_sqrtsd_xmm_xmm(struct string *str, struct insn *insn)
+{
+	print_func_name(str);
+	return print_reg_reg(str, insn);
+}
+
 static int print_mulss_xmm_xmm(struct string *str, struct insn *insn)
 {
 	print_func_name(str);
@@ -407,6 +413,24 @@ static int print_and_reg_reg(struct string *str, struct insn *insn)
 	return print_reg_reg(str, insn);
 }
 
+static int print_andpd_xmm_xmm(struct string *str, struct insn *insn)
+{
+	print_func_name(str);
+	return print_reg_reg(str, insn);
+}
+
+static int print_andps_xmm_xmm(struct string *str, struct insn *insn)
+{
+	print_func_name(str);
+	return print_reg_reg(str, insn);
+}
+
+static int print_array_check_membase_reg(struct string *str, struct insn *insn)
+{
+	print_func_name(str);
+	return print_membase_reg(str, insn);
+}
+
 static int print_call_reg(struct string *str, struct insn *insn)
 {
 	print_func_name(str);
@@ -421,6 +445,24 @@ static int print_call_rel(struct string *str, struct insn *insn)
 	return print_rel(str, &insn->operand);
 }
 
+static int print_card_mark_membase_reg(struct string *str, struct insn *insn)
+{
+	print_func_name(str);
+	return print_membase_reg(str, insn);
+}
+
+static int print_card_mark_memindex_reg(struct string *str, struct insn *insn)
+{
+	print_func_name(str);
+	return print_memindex_reg(str, insn);
+}
+
+static int print_checkcast_membase_reg(struct string *str, struct insn *insn)
+{
+	print_func_name(str);
+	return print_membase_reg(str, insn);
+}
+
 static int print_cltd_reg_reg(struct string *str, struct insn *insn)	/* CDQ in Intel manuals*/
 {
 	print_func_name(str);
@@ -445,6 +487,18 @@ static int print_cmp_reg_reg(struct string *str, struct insn *insn)
 	return print_reg_reg(str, insn);
 }
 
+static int print_cmovg_reg_reg(struct string *str, struct insn *insn)
+{
+	print_func_name(str);
+	return print_reg_reg(str, insn);
+}
+
+static int print_cmovl_reg_reg(struct string *str, struct insn *insn)
+{
+	print_func_name(str);
+	return print_reg_reg(str, insn);
+}
+
 static int print_div_membase_reg(struct string *str, struct insn *insn)
 {
 	print_func_name(str);
@@ -517,6 +571,12 @@ static int print_conv_xmm64_to_xmm(struct string *str, struct insn *insn)
 	return print_reg_reg(str, insn);
 }
 
+static int print_instanceof_membase_reg(struct string *str, struct insn *insn)
+{
+	print_func_name(str);
+	return print_membase_reg(str, insn);
+}
+
 static int print_je_branch(struct string *str, struct insn *insn)
 {
 	print_func_name(str);
@@ -932,6 +992,24 @@ static int print_test_membase_reg(struct string *str, struct insn *insn)
 	return print_membase_reg(str, insn);
 }
 
+static int print_tlab_alloc_membase_reg(struct string *str, struct insn *insn)
+{
+	print_func_name(str);
+	return print_membase_reg(str, insn);
+}
+
+static int print_monitor_enter_membase_reg(struct string *str, struct insn *insn)
+{
+	print_func_name(str);
+	return print_membase_reg(str, insn);
+}
+
+static int print_monitor_exit_membase_reg(struct string *str, struct insn *insn)
+{
+	print_func_name(str);
+	return print_membase_reg(str, insn);
+}
+
 static int print_xor_membase_reg(struct string *str, struct insn *insn)
 {
 	print_func_name(str);
@@ -999,12 +1077,20 @@ static print_insn_fn insn_printers[] = {
 	[INSN_ADD_REG_REG] = print_add_reg_reg,
 	[INSN_AND_MEMBASE_REG] = print_and_membase_reg,
 	[INSN_AND_REG_REG] = print_and_reg_reg,
+	[INSN_ANDPD_XMM_XMM] = print_andpd_xmm_xmm,
+	[INSN_ANDPS_XMM_XMM] = print_andps_xmm_xmm,
+	[INSN_ARRAY_CHECK_MEMBASE_REG] = print_array_check_membase_reg,
 	[INSN_CALL_REG] = print_call_reg,
 	[INSN_CALL_REL] = print_call_rel,
+	[INSN_CARD_MARK_MEMBASE_REG] = print_card_mark_membase_reg,
+	[INSN_CARD_MARK_MEMINDEX_REG] = print_card_mark_memindex_reg,
+	[INSN_CHECKCAST_MEMBASE_REG] = print_checkcast_membase_reg,
 	[INSN_CLTD_REG_REG] = print_cltd_reg_reg,	/* CDQ in Intel manuals*/
 	[INSN_CMP_IMM_REG] = print_cmp_imm_reg,
 	[INSN_CMP_MEMBASE_REG] = print_cmp_membase_reg,
 	[INSN_CMP_REG_REG] = print_cmp_reg_reg,
+	[INSN_CMOVG_REG_REG] = print_cmovg_reg_reg,
+	[INSN_CMOVL_REG_REG] = print_cmovl_reg_reg,
 	[INSN_CONV_FPU64_TO_GPR] = print_conv_fpu64_to_gpr,
 	[INSN_CONV_FPU_TO_GPR] = print_conv_fpu_to_gpr,
 	[INSN_CONV_GPR_TO_FPU64] = print_conv_gpr_to_fpu64,
@@ -1028,6 +1114,7 @@ static print_insn_fn insn_printers[] = {
 	[INSN_FSTP_MEMBASE] = print_fstp_membase,
 	[INSN_FSTP_MEMLOCAL] = print_fstp_memlocal,
 	[INSN_IC_CALL] = print_ic_call,
+	[INSN_INSTANCEOF_MEMBASE_REG] = print_instanceof_membase_reg,
 	[INSN_JE_BRANCH] = print_je_branch,
 	[INSN_JGE_BRANCH] = print_jge_branch,
 	[INSN_JG_BRANCH] = print_jg_branch,
@@ -1037,6 +1124,8 @@ static print_insn_fn insn_printers[] = {
 	[INSN_JMP_MEMBASE] = print_jmp_membase,
 	[INSN_JMP_MEMINDEX] = print_jmp_memindex,
 	[INSN_JNE_BRANCH] = print_jne_branch,
+	[INSN_MONITOR_ENTER_MEMBASE_REG] = print_monitor_enter_membase_reg,
+	[INSN_MONITOR_EXIT_MEMBASE_REG] = print_monitor_exit_membase_reg,
 	[INSN_MOVSD_MEMBASE_XMM] = print_movsd_membase_xmm,
 	[INSN_MOVSD_MEMDISP_XMM] = print_movsd_memdisp_xmm,
 	[INSN_MOVSD_MEMINDEX_XMM] = print_movsd_memindex_xmm,
@@ -1099,6 +1188,7 @@ static print_insn_fn insn_printers[] = {
 	[INSN_SBB_REG_REG] = print_sbb_reg_reg,
 	[INSN_SHL_REG_REG] = print_shl_reg_reg,
 	[INSN_SHR_REG_REG] = print_shr_reg_reg,
+	[INSN_SQRTSD_XMM_XMM] = print_sqrtsd_xmm_xmm,
 	[INSN_SUBSD_XMM_XMM] = print_subsd_xmm_xmm,
 	[INSN_SUBSS_XMM_XMM] = print_subss_xmm_xmm,
 	[INSN_SUB_IMM_REG] = print_sub_imm_reg,
@@ -1106,6 +1196,7 @@ static print_insn_fn insn_printers[] = {
 	[INSN_SUB_REG_REG] = print_sub_reg_reg,
 	[INSN_TEST_IMM_MEMDISP] = print_test_imm_memdisp,
 	[INSN_TEST_MEMBASE_REG] = print_test_membase_reg,
+	[INSN_TLAB_ALLOC_MEMBASE_REG] = print_tlab_alloc_membase_reg,
 	[INSN_XORPD_XMM_XMM] = print_xor_64_xmm_reg_reg,
 	[INSN_XORPS_XMM_XMM] = print_xor_xmm_reg_reg,
 	[INSN_XOR_MEMBASE_REG] = print_xor_membase_reg,
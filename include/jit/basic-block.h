@@ -123,6 +123,9 @@ struct basic_block {
 
 		/* Set of variables that are live when exiting this basic block.  */
 		struct bitset *live_out_set;
+
+		/* Position of this basic block in CFG postorder.  */
+		unsigned long postorder;
 	};
 };
 
@@ -9,10 +9,41 @@
 #include "vm/die.h"
 
 #include "lib/string.h"
+
+#include <stdint.h>
 #include <limits.h>
 
 #define BC_OFFSET_UNKNOWN ULONG_MAX
 
+/* Number of runs between two checkpoints of a bytecode offset table */
+#define BC_OFFSET_CHECKPOINT_INTERVAL	16
+
+/*
+ * Decoded state of the run that starts a group of
+ * BC_OFFSET_CHECKPOINT_INTERVAL runs. @data_pos is the position of the next
+ * run in the encoded data.
+ */
+struct bc_offset_checkpoint {
+	uint32_t		native_offset;
+	uint32_t		bc_offset;
+	uint32_t		data_pos;
+};
+
+/*
+ * Maps machine code offsets of a method to bytecode offsets. Machine code
+ * is divided into runs of bytes that map to the same bytecode offset. Each
+ * run is encoded as the distance from the start of the previous run
+ * followed by the difference of the bytecode offsets, both as LEB128
+ * numbers. See jit/bc-offset-mapping.c for details.
+ */
+struct bc_offset_table {
+	unsigned long			nr_runs;
+	unsigned long			nr_checkpoints;
+	struct bc_offset_checkpoint	*checkpoints;
+	unsigned long			data_size;
+	unsigned char			*data;
+};
+
 unsigned long jit_lookup_bc_offset(struct compilation_unit *cu,
 				   unsigned char *native_ptr);
 void print_bytecode_offset(unsigned long bc_offset, struct string *str);
@@ -20,6 +51,8 @@ void tree_patch_bc_offset(struct tree_node *node, unsigned long bc_offset);
 bool all_insn_have_bytecode_offset(struct compilation_unit *cu);
 int bytecode_offset_to_line_no(struct vm_method *mb, unsigned long bc_offset);
 int build_bc_offset_map(struct compilation_unit *cu);
+unsigned long bc_offset_table_size(struct bc_offset_table *table);
+void trace_bc_offset_table(struct compilation_unit *cu);
 
 static inline void insn_set_bc_offset(struct insn *insn, unsigned long offset)
 {
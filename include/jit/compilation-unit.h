@@ -19,6 +19,8 @@
 #include <pthread.h>
 #include <semaphore.h>
 
+struct bc_offset_table;
+struct gc_map_table;
 struct buffer;
 struct vm_method;
 struct insn;
@@ -56,6 +58,14 @@ struct compilation_unit {
 	/* See enum compilation_state for values */
 	unsigned long state;
 
+	/*
+	 * Background compilation state. See jit/compile-queue.c for details.
+	 * Protected by the compile queue lock.
+	 */
+	struct list_head compile_queue_node;
+	unsigned long queue_state;
+	uint64_t queue_time;
+
 	pthread_mutex_t mutex;
 
 	/* The frame pointer for this method.  */
@@ -116,6 +126,12 @@ struct compilation_unit {
 	struct list_head tableswitch_list;
 	struct list_head lookupswitch_list;
 	struct list_head ic_call_list;
+	struct list_head array_check_stub_list;
+	struct list_head tlab_stub_list;
+	struct list_head monitor_stub_list;
+
+	/* Polymorphic inline cache stubs of the call sites in this unit */
+	struct list_head ic_pic_list;
 
 	/*
 	 * Entry points to the method's code. These values are
@@ -131,10 +147,15 @@ struct compilation_unit {
 	void *ic_entry_point;
 
 	/*
-	 * This maps bytecode offset to every native address
-	 * inside JIT code.
+	 * This maps native addresses inside JIT code to bytecode offsets.
+	 */
+	struct bc_offset_table *bc_offset_map;
+
+	/*
+	 * GC maps of the safepoints in JIT code. Only generated when the
+	 * exact garbage collector is enabled. See jit/gc-map.c for details.
 	 */
-	unsigned long *bc_offset_map;
+	struct gc_map_table *gc_maps;
 
 	/*
 	 * This maps LIR offset to instruction.
@@ -0,0 +1,22 @@
+#ifndef JATO_JIT_COMPILE_QUEUE_H
+#define JATO_JIT_COMPILE_QUEUE_H
+
+#include <stdbool.h>
+
+struct compilation_unit;
+
+enum compile_queue_state {
+	COMPILE_QUEUE_NONE,
+	COMPILE_QUEUE_QUEUED,
+	COMPILE_QUEUE_FAILED,
+};
+
+extern bool opt_background_compilation;
+extern unsigned long opt_compiler_count;
+extern bool opt_print_compile_stats;
+
+int compile_queue_init(void);
+bool compile_queue_submit(struct compilation_unit *cu);
+void compile_queue_print_stats(void);
+
+#endif /* JATO_JIT_COMPILE_QUEUE_H */
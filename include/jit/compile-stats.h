@@ -0,0 +1,96 @@
+#ifndef JATO_JIT_COMPILE_STATS_H
+#define JATO_JIT_COMPILE_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct compilation_unit;
+
+enum compile_pass {
+	PASS_INLINE_SUBROUTINES,
+	PASS_ANALYZE_CONTROL_FLOW,
+	PASS_CONVERT_TO_IR,
+	PASS_DOMINATORS,
+	PASS_LOOP_ABC_REMOVAL,
+	PASS_SELECT_INSTRUCTIONS,
+	PASS_SSA,
+	PASS_LIVENESS,
+	PASS_ALLOCATE_REGISTERS,
+	PASS_MARK_CLOBBERS,
+	PASS_SPILL_RELOAD,
+	PASS_INLINE_CACHE,
+	PASS_PEEPHOLE,
+	PASS_EMIT_CODE,
+	PASS_BC_OFFSET_MAP,
+	PASS_FIXUPS,
+	NR_COMPILE_PASSES,	/* Not a real pass. Keep this last.  */
+};
+
+struct compile_pass_stats {
+	uint64_t		wall_ns;
+	uint64_t		cpu_ns;
+	uint64_t		arena_bytes;
+	int64_t			malloc_bytes;
+
+	/* Size of the IR or LIR after the pass has run.  */
+	unsigned long		nr_nodes;
+};
+
+/*
+ * Per-method compilation statistics. This lives on the stack of the
+ * compiling thread and is merged into the global totals when compilation
+ * finishes so that the passes themselves do not take any locks.
+ */
+struct compile_stats {
+	struct compile_pass_stats	passes[NR_COMPILE_PASSES];
+	bool				pass_ran[NR_COMPILE_PASSES];
+
+	unsigned long			nr_ir_nodes;
+	unsigned long			nr_insns;
+
+	/*
+	 * State of the pass that is currently running. The pass is
+	 * NR_COMPILE_PASSES when none is.
+	 */
+	enum compile_pass		current_pass;
+	uint64_t			start_wall;
+	uint64_t			start_cpu;
+	uint64_t			start_arena;
+	int64_t				start_malloc;
+};
+
+extern bool opt_jit_stats;
+extern const char *opt_jit_stats_csv;
+extern unsigned long opt_jit_stats_top;
+
+void __compile_stats_begin(struct compile_stats *stats);
+void __compile_pass_begin(struct compile_stats *stats, struct compilation_unit *cu, enum compile_pass pass);
+void __compile_pass_end(struct compile_stats *stats, struct compilation_unit *cu, enum compile_pass pass);
+void __compile_stats_end(struct compile_stats *stats, struct compilation_unit *cu, int err);
+void compile_stats_print(void);
+
+static inline void compile_stats_begin(struct compile_stats *stats)
+{
+	if (opt_jit_stats)
+		__compile_stats_begin(stats);
+}
+
+static inline void compile_pass_begin(struct compile_stats *stats, struct compilation_unit *cu, enum compile_pass pass)
+{
+	if (opt_jit_stats)
+		__compile_pass_begin(stats, cu, pass);
+}
+
+static inline void compile_pass_end(struct compile_stats *stats, struct compilation_unit *cu, enum compile_pass pass)
+{
+	if (opt_jit_stats)
+		__compile_pass_end(stats, cu, pass);
+}
+
+static inline void compile_stats_end(struct compile_stats *stats, struct compilation_unit *cu, int err)
+{
+	if (opt_jit_stats)
+		__compile_stats_end(stats, cu, err);
+}
+
+#endif /* JATO_JIT_COMPILE_STATS_H */
@@ -57,6 +57,7 @@ struct parse_context {
 
 void convert_expression(struct parse_context *ctx, struct expression *expr);
 void convert_statement(struct parse_context *ctx, struct statement *stmt);
+int convert_invoke_direct(struct parse_context *ctx, struct vm_method *target);
 void do_convert_statement(struct basic_block *bb, struct statement *stmt,
 			  unsigned long bc_offset);
 
@@ -73,11 +74,13 @@ int ssa_to_lir(struct compilation_unit *cu);
 int dce(struct compilation_unit *cu);
 void imm_copy_propagation(struct compilation_unit *cu);
 void abc_removal(struct compilation_unit *cu);
+int loop_abc_removal(struct compilation_unit *cu);
 int allocate_registers(struct compilation_unit *cu);
 int mark_clobbers(struct compilation_unit *cu);
 int insert_spill_reload_insns(struct compilation_unit *cu);
 int emit_machine_code(struct compilation_unit *);
 void *jit_magic_trampoline(struct compilation_unit *);
+void *jit_compile(struct compilation_unit *);
 void jit_no_such_method_stub(void);
 
 struct jit_trampoline *alloc_jit_trampoline(void);
@@ -119,6 +122,7 @@ extern bool opt_trace_gate;
 extern regex_t method_trace_gate_regex;
 
 extern bool opt_trace_ssa;
+extern bool opt_trace_abc;
 extern bool opt_trace_cfg;
 extern bool opt_trace_tree_ir;
 extern bool opt_trace_lir;
@@ -135,6 +139,7 @@ extern bool opt_trace_compile;
 extern bool opt_print_compilation;
 
 extern bool opt_ssa_enable;
+extern bool opt_abc_enable;
 extern bool running_on_valgrind;
 
 extern bool opt_llvm_enable;
@@ -149,6 +154,7 @@ static inline bool cu_matches_regex(struct compilation_unit *cu)
 }
 
 void trace_ssa(struct compilation_unit *);
+void trace_abc(struct compilation_unit *, unsigned long, unsigned long);
 void trace_magic_trampoline(struct compilation_unit *);
 void trace_method(struct compilation_unit *);
 void trace_cfg(struct compilation_unit *);
@@ -6,6 +6,9 @@ struct compilation_unit;
 int add_cu_mapping(unsigned long addr, struct compilation_unit *cu);
 void remove_cu_mapping(unsigned long addr);
 struct compilation_unit *jit_lookup_cu(unsigned long addr);
+struct compilation_unit *__jit_lookup_cu(unsigned long addr);
+void cu_mapping_read_lock(void);
+void cu_mapping_read_unlock(void);
 void init_cu_mapping(void);
 
 #endif
@@ -3,6 +3,8 @@
 
 #include "jit/stack-slot.h"
 
+#include "lib/list.h"
+
 struct compilation_unit;
 struct jit_trampoline;
 struct basic_block;
@@ -12,6 +14,47 @@ struct vm_object;
 struct vm_jni_env;
 struct vm_method;
 
+/*
+ * Out-of-line slow path of an inlined array bounds check. The stub is emitted
+ * after the method body and its machine code maps to the bytecode offset of
+ * the array access so that the exception is dispatched to the right handler.
+ */
+struct array_check_stub {
+	struct list_head	list_node;
+	struct insn		*insn;		/* the inlined check */
+	unsigned long		branch_offset;	/* offset of "jae <stub>" */
+	unsigned long		start;		/* stub machine code range */
+	unsigned long		end;
+};
+
+/*
+ * Out-of-line slow path of an inlined allocation from the thread-local
+ * allocation buffer. The stub is entered when the free list is empty. It
+ * refills the list with tlab_refill() and jumps back to the inlined code.
+ */
+struct tlab_stub {
+	struct list_head	list_node;
+	struct insn		*insn;		/* the inlined allocation */
+	unsigned long		branch_offset;	/* offset of "jz <stub>" */
+	unsigned long		return_offset;	/* end of the inlined code */
+	unsigned long		start;		/* stub machine code range */
+	unsigned long		end;
+};
+
+/*
+ * Out-of-line slow path of an inlined thin lock enter or exit. The stub is
+ * entered when the compare-and-swap on the lock word fails. It calls
+ * vm_object_lock() or vm_object_unlock() and jumps back to the inlined code.
+ */
+struct monitor_stub {
+	struct list_head	list_node;
+	struct insn		*insn;		/* the inlined enter or exit */
+	unsigned long		branch_offset;	/* offset of "jnz <stub>" */
+	unsigned long		return_offset;	/* end of the inlined code */
+	unsigned long		start;		/* stub machine code range */
+	unsigned long		end;
+};
+
 extern void emit_prolog(struct buffer *, struct stack_frame *, unsigned long);
 extern void emit_trace_invoke(struct buffer *, struct compilation_unit *);
 extern void emit_epilog(struct buffer *);
@@ -26,6 +69,9 @@ extern void emit_insn(struct buffer *, struct basic_block *, struct insn *);
 extern void emit_nop(struct buffer *buf);
 extern void backpatch_branch_target(struct buffer *buf, struct insn *insn,
 				    unsigned long target_offset);
+extern void emit_array_check_stubs(struct compilation_unit *);
+extern void emit_tlab_stubs(struct compilation_unit *);
+extern void emit_monitor_stubs(struct compilation_unit *);
 extern void emit_jni_trampoline(struct buffer *, struct vm_method *, void *);
 
 extern void *emit_ic_check(struct buffer *);
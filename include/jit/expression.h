@@ -74,6 +74,8 @@ enum binary_operator {
 	OP_AND,
 	OP_OR,
 	OP_XOR,
+	OP_MIN,
+	OP_MAX,
 
 	OP_CMP,
 	OP_CMPL,
@@ -105,6 +107,10 @@ enum unary_operator {
 	OP_NEG	= BINOP_LAST,
 	OP_FNEG,
 	OP_DNEG,
+	OP_ABS,
+	OP_FABS,
+	OP_DABS,
+	OP_DSQRT,
 	OP_LAST,	/* Not a real operator. Keep this last. */
 };
 
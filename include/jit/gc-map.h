@@ -4,10 +4,46 @@
 #include <arch/registers.h>
 #include <vm/system.h>
 
+struct compilation_unit;
+struct insn;
+
 #define GC_REGISTER_MAP_SIZE	DIV_ROUND_UP(NR_GP_REGISTERS, BITS_PER_LONG)
 
+enum gc_map_type {
+	GC_MAP_POLL,		/* safepoint poll, found at the faulting IP */
+	GC_MAP_CALL,		/* call, found at the return address */
+};
+
 struct gc_map {
+	unsigned long		offset;		/* offset in machine code */
+	enum gc_map_type	type;
 	unsigned long		register_map[GC_REGISTER_MAP_SIZE];	/* references in registers */
+	unsigned long		*slot_map;	/* references in the locals area */
 };
 
+struct gc_map_table {
+	/* Maps sorted by ->offset */
+	struct gc_map		*maps;
+	unsigned long		nr_maps;
+	unsigned long		max_maps;
+
+	/* Number of words in the locals area of the stack frame */
+	unsigned long		nr_slots;
+
+	/* Slots that hold references at every safepoint */
+	unsigned long		*fixed_slot_map;
+};
+
+/*
+ * Word @slot of a slot map is at 'frame pointer - (@slot + 1) * sizeof(long)'.
+ */
+static inline unsigned long gc_map_slot_offset(unsigned long slot)
+{
+	return (slot + 1) * sizeof(unsigned long);
+}
+
+void gc_map_add(struct compilation_unit *cu, struct insn *insn, unsigned long lir_pos, unsigned long start, unsigned long end);
+struct gc_map *gc_map_lookup(struct compilation_unit *cu, unsigned long offset, enum gc_map_type type);
+void free_gc_maps(struct compilation_unit *cu);
+
 #endif
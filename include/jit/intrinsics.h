@@ -0,0 +1,20 @@
+#ifndef JIT_INTRINSICS_H
+#define JIT_INTRINSICS_H
+
+#include <stdbool.h>
+
+struct parse_context;
+struct vm_method;
+
+extern bool opt_use_intrinsics;
+
+typedef int (*intrinsic_convert_fn)(struct parse_context *, struct vm_method *);
+
+struct intrinsic {
+	struct vm_method	**method;
+	intrinsic_convert_fn	convert;
+};
+
+const struct intrinsic *lookup_intrinsic(struct vm_method *vmm);
+
+#endif
@@ -1,15 +1,42 @@
 #ifndef JIT_TEXT_H
 #define JIT_TEXT_H
 
+#include "arch/memory.h"
+
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+
+struct buffer;
+
+enum jit_text_region {
+	JIT_TEXT_COLD,		/* trampolines and stubs */
+	JIT_TEXT_HOT,		/* method bodies */
+	JIT_TEXT_NR_REGIONS,
+};
+
+/* Distance from executable code to its writable view */
+extern unsigned long jit_text_rw_delta;
 
 void jit_text_init(void);
-void jit_text_lock(void);
-void jit_text_unlock(void);
-void *jit_text_ptr(void);
-void jit_text_reserve(size_t size);
+void jit_text_begin(struct buffer *buf, enum jit_text_region region, size_t max_size);
+void jit_text_end(struct buffer *buf);
+void *jit_text_alloc(enum jit_text_region region, size_t size);
+void jit_text_free(void *p, size_t size);
+void *jit_text_top(enum jit_text_region region);
 bool is_jit_text(void *);
 
-#endif
+/*
+ * Returns the writable address of code at @p.
+ */
+static inline void *jit_text_rw(void *p)
+{
+	return p + jit_text_rw_delta;
+}
+
+static inline void jit_text_write_u32(void *p, uint32_t val)
+{
+	cpu_write_u32(jit_text_rw(p), val);
+}
 
+#endif
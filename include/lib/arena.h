@@ -21,6 +21,7 @@ struct arena {
 struct arena *arena_new(void);
 void arena_delete(struct arena *self);
 void *arena_alloc_expand(struct arena *arena, size_t size);
+size_t arena_size(struct arena *arena);
 
 static inline void *arena_alloc_noexpand(struct arena *arena, size_t size)
 {
@@ -17,10 +17,16 @@ struct buffer_operations {
 	void (*free)(struct buffer *);
 };
 
+/**
+ *	@write_delta: Distance from @buf to the address that the buffer is
+ *		written through. This is zero unless the memory is mapped
+ *		twice, like JIT code is (see jit/text.c).
+ */
 struct buffer {
 	unsigned char *buf;
 	size_t offset;
 	size_t size;
+	unsigned long write_delta;
 	struct buffer_operations *ops;
 };
 
@@ -30,12 +36,17 @@ struct buffer *alloc_buffer(void);
 void free_buffer(struct buffer *);
 int append_buffer_str(struct buffer *buf, unsigned char *str, size_t len);
 
+static inline unsigned char *buffer_write_ptr(struct buffer *buf)
+{
+	return buf->buf + buf->write_delta;
+}
+
 static inline int append_buffer(struct buffer *buf, unsigned char c)
 {
 	if (buf->size - buf->offset < 1)
 		return append_buffer_str(buf, &c, 1);
 
-	buf->buf[buf->offset++] = c;
+	buffer_write_ptr(buf)[buf->offset++] = c;
 
 	return 0;
 }
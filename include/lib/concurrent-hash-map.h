@@ -0,0 +1,82 @@
+#ifndef LIB_CONCURRENT_HASH_MAP_H
+#define LIB_CONCURRENT_HASH_MAP_H
+
+#include "lib/hash-map.h"
+
+#include <stdbool.h>
+#include <pthread.h>
+
+/*
+ * A hash map for tables that are shared by all threads of the VM. Lookups
+ * do not take any locks. Updates are serialized with a mutex. See
+ * lib/concurrent-hash-map.c for details.
+ */
+struct concurrent_hash_map_entry {
+	volatile unsigned long		hash;
+	const void * volatile		key;
+	void * volatile			value;
+};
+
+struct concurrent_hash_map_table {
+	unsigned long			mask;
+	unsigned long			nr_used;
+
+	/*
+	 * The table whose entries are being moved to this one or NULL when
+	 * the resize that created this table has finished.
+	 */
+	struct concurrent_hash_map_table * volatile from;
+
+	/* Index of the next entry of this table to move to the new table */
+	volatile unsigned long		migrated;
+
+	struct concurrent_hash_map_table *retired_next;
+	struct concurrent_hash_map_entry entries[];
+};
+
+struct concurrent_hash_map {
+	struct key_operations		key_ops;
+	struct concurrent_hash_map_table * volatile table;
+	unsigned long			size;
+
+	/* Tables that have been replaced but may still be read */
+	struct concurrent_hash_map_table *retired;
+
+	pthread_mutex_t			mutex;
+};
+
+struct concurrent_hash_map *alloc_concurrent_hash_map(struct key_operations *key_ops);
+struct concurrent_hash_map *alloc_concurrent_hash_map_with_size(unsigned long initial_size, struct key_operations *key_ops);
+void free_concurrent_hash_map(struct concurrent_hash_map *map);
+void *concurrent_hash_map_get(struct concurrent_hash_map *map, const void *key);
+int concurrent_hash_map_put(struct concurrent_hash_map *map, const void *key, void *value);
+int concurrent_hash_map_put_if_absent(struct concurrent_hash_map *map, const void *key, void *value, void **old_value_p);
+int concurrent_hash_map_remove(struct concurrent_hash_map *map, const void *key);
+unsigned long concurrent_hash_map_size(struct concurrent_hash_map *map);
+
+bool concurrent_hash_map_entry_is_used(const struct concurrent_hash_map_entry *entry);
+
+struct concurrent_hash_map_iterator {
+	struct concurrent_hash_map_table *table;
+	struct concurrent_hash_map_table *from;
+	unsigned long			index;
+	unsigned long			from_index;
+};
+
+struct concurrent_hash_map_entry *
+concurrent_hash_map_first_entry(struct concurrent_hash_map *map, struct concurrent_hash_map_iterator *iter);
+struct concurrent_hash_map_entry *
+concurrent_hash_map_next_entry(struct concurrent_hash_map_iterator *iter);
+
+/*
+ * Iterates over the entries of @map without locking. Entries that are put
+ * or removed during the iteration may or may not be visited. Entries that
+ * are moved to a new table by a resize during the iteration may be visited
+ * twice.
+ */
+#define concurrent_hash_map_for_each_entry(this, map)					\
+	for (struct concurrent_hash_map_iterator iter__, *p__ = &iter__; p__; p__ = NULL) \
+		for ((this) = concurrent_hash_map_first_entry(map, p__);		\
+		     (this); (this) = concurrent_hash_map_next_entry(p__))
+
+#endif /* LIB_CONCURRENT_HASH_MAP_H */
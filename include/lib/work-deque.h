@@ -0,0 +1,29 @@
+#ifndef LIB_WORK_DEQUE_H
+#define LIB_WORK_DEQUE_H
+
+#include <stdbool.h>
+
+/*
+ * A bounded work-stealing deque. The owner pushes and pops elements at the
+ * bottom and other threads steal them from the top. See lib/work-deque.c
+ * for details.
+ */
+struct work_deque {
+	volatile long			top;
+	volatile long			bottom;
+	unsigned long			mask;
+	void				**elements;
+};
+
+struct work_deque *alloc_work_deque(unsigned long capacity);
+void free_work_deque(struct work_deque *deque);
+bool work_deque_push(struct work_deque *deque, void *element);
+void *work_deque_pop(struct work_deque *deque);
+void *work_deque_steal(struct work_deque *deque);
+
+static inline bool work_deque_is_empty(struct work_deque *deque)
+{
+	return deque->bottom - deque->top <= 0;
+}
+
+#endif /* LIB_WORK_DEQUE_H */
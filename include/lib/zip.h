@@ -13,10 +13,14 @@ struct string;
 
 struct zip_entry {
 	char			*filename;
+	uint32_t		crc32;
 	uint32_t		comp_size;
 	uint32_t		uncomp_size;
 	uint32_t		lh_offset;
 	uint16_t		compression;
+
+	/* Offset of the uncompressed data in the cache file or zero */
+	uint32_t		cache_offset;
 };
 
 struct zip {
@@ -27,6 +31,10 @@ struct zip {
 	struct zip_entry	*entries;
 	struct hash_map		*entry_cache;
 	struct hash_map		*class_cache;
+
+	/* Uncompressed class files, see zip_set_cache_dir() */
+	void			*cache_mmap;
+	size_t			cache_len;
 };
 
 #define zip_for_each_entry(idx, entry, zip)		\
@@ -39,5 +47,8 @@ void zip_close(struct zip *zip);
 struct zip_entry *zip_entry_find(struct zip *zip, const char *filename);
 struct zip_entry *zip_entry_find_class(struct zip *zip, struct string *classname);
 void *zip_entry_data(struct zip *zip, struct zip_entry *entry);
+const void *zip_entry_map(struct zip *zip, struct zip_entry *entry);
+void zip_entry_unmap(struct zip *zip, const void *data);
+void zip_set_cache_dir(const char *dir);
 
 #endif /* JATO__LIB_ZIP_H */
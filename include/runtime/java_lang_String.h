@@ -0,0 +1,10 @@
+#ifndef JATO__JAVA_LANG_STRING_H
+#define JATO__JAVA_LANG_STRING_H
+
+#include "vm/jni.h"
+
+jboolean java_lang_String_equals(jobject this, jobject other);
+jint java_lang_String_hashCode(jobject this);
+jint java_lang_String_indexOf(jobject this, jint ch, jint from_index);
+
+#endif /* JATO__JAVA_LANG_STRING_H */
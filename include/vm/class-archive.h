@@ -0,0 +1,25 @@
+#ifndef __VM_CLASS_ARCHIVE_H
+#define __VM_CLASS_ARCHIVE_H
+
+#include <stdbool.h>
+
+struct cafebabe_class;
+struct vm_class;
+
+enum class_archive_mode {
+	CLASS_ARCHIVE_OFF,
+	CLASS_ARCHIVE_AUTO,	/* use the archive if it can be mapped */
+	CLASS_ARCHIVE_ON,	/* fail if the archive can't be mapped */
+	CLASS_ARCHIVE_DUMP,	/* write the archive at exit */
+};
+
+extern enum class_archive_mode class_archive_mode;
+extern const char *class_archive_path;
+
+int class_archive_open(void);
+struct cafebabe_class *class_archive_find(const char *class_name);
+void class_archive_add(struct vm_class *vmc);
+int class_archive_dump(void);
+void class_archive_print_stats(void);
+
+#endif
@@ -3,6 +3,8 @@
 
 #include <assert.h>
 #include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #include "vm/field.h"
 #include "vm/itable.h"
@@ -37,10 +39,22 @@ enum vm_class_kind {
 };
 
 /*
- * NOTE NOTE NOTE! You must update supertype_cache_test() if you change this
- * constant.
+ * Number of superclasses that are kept in the supertype display. Classes
+ * that are deeper than this in the hierarchy are checked for like interfaces.
  */
-#define SUPERTYPE_CACHE_SIZE           2
+#define VM_CLASS_DISPLAY_SIZE		8
+
+/*
+ * A slot in the hash index of the methods or fields of a class. The index
+ * refers to vmc->methods or vmc->fields and is VM_MEMBER_SLOT_EMPTY for
+ * unused slots.
+ */
+struct vm_member_slot {
+	uint32_t		hash;
+	uint32_t		index;
+};
+
+#define VM_MEMBER_SLOT_EMPTY	UINT32_MAX
 
 struct vm_class {
 	/* Compile lock for fast class initialization */
@@ -65,9 +79,26 @@ struct vm_class {
 	unsigned int nr_annotations;
 	struct vm_annotation **annotations;
 
+	/* Open-addressed hash indices of the methods and the fields by name
+	 * and type. The number of slots is a power of two. */
+	struct vm_member_slot *method_index;
+	unsigned int method_index_mask;
+	struct vm_member_slot *field_index;
+	unsigned int field_index_mask;
+
+	/* Classes, fields and methods that constant pool entries have been
+	 * resolved to, indexed by constant pool index. NULL until the entry
+	 * is resolved for the first time. */
+	void **resolved;
+
 	unsigned int object_size;
 	unsigned int static_size;
 
+	/* Offsets of instance fields of reference type relative to
+	 * vm_object_fields(). Used by the garbage collector. */
+	unsigned int nr_ref_offsets;
+	unsigned int *ref_offsets;
+
 	unsigned int vtable_size;
 	struct vtable vtable;
 
@@ -106,12 +137,24 @@ struct vm_class {
 	struct cafebabe_enclosing_method_attribute enclosing_method_attribute;
 
 	/*
-	 * The supertype cache contains pointers to 'struct vm_class' of
-	 * recently accessed supertypes of this class. The purpose of this
-	 * cache is to speed up subtype checks.
+	 * Supertypes of this class for fast subtype checks. display[i] is the
+	 * superclass at depth i of the hierarchy where java.lang.Object is at
+	 * depth 0 and display[depth] is this class. The secondary supertypes
+	 * are all the interfaces this class implements and the superclasses
+	 * that don't fit in the display. The last secondary supertype that a
+	 * check succeeded for is remembered in secondary_super_cache.
+	 *
+	 * To check if class S is a subtype of T, the word at
+	 * T->super_check_offset in S is compared to T. The offset points to
+	 * display[T->depth] if T is in the display of its subclasses and to
+	 * secondary_super_cache otherwise. JIT code does the same check inline.
 	 */
-	const struct vm_class			*supertype_cache[SUPERTYPE_CACHE_SIZE];
-	unsigned int				supertype_cache_ndx;
+	unsigned int				depth;
+	struct vm_class				*display[VM_CLASS_DISPLAY_SIZE];
+	unsigned int				nr_secondary_supers;
+	struct vm_class				**secondary_supers;
+	const struct vm_class			*secondary_super_cache;
+	unsigned long				super_check_offset;
 };
 
 int vm_class_link(struct vm_class *vmc, const struct cafebabe_class *class);
@@ -190,6 +233,10 @@ static inline bool vm_class_is_member(const struct vm_class *vmc)
 	return vmc->declaring_class;
 }
 
+extern bool opt_print_resolve_stats;
+
+void vm_class_print_resolve_stats(void);
+
 struct vm_class *vm_class_resolve_class(const struct vm_class *vmc, uint16_t i);
 
 struct vm_field *vm_class_get_field(const struct vm_class *vmc,
@@ -206,6 +253,8 @@ struct vm_method *vm_class_get_method(const struct vm_class *vmc,
 	const char *name, const char *type);
 struct vm_method *vm_class_get_method_recursive(const struct vm_class *vmc,
 	const char *name, const char *type);
+struct vm_method *vm_class_get_virtual_method(const struct vm_class *vmc,
+	const struct vm_method *vmm);
 
 int vm_class_resolve_method(const struct vm_class *vmc, uint16_t i,
 	struct vm_class **r_vmc, char **r_name, char **r_type);
@@ -219,14 +268,27 @@ struct vm_method *vm_class_resolve_interface_method_recursive(
 
 bool vm_class_is_assignable_from_slow(struct vm_class *vmc, const struct vm_class *from);
 
-static inline bool supertype_cache_test(const struct vm_class *vmc, const struct vm_class *super)
+/*
+ * Returns true if subtype checks against @vmc are decided by the supertype
+ * display alone.
+ */
+static inline bool vm_class_is_primary_super(const struct vm_class *vmc)
 {
-	return vmc->supertype_cache[0] == super || vmc->supertype_cache[1] == super;
+	return vmc->super_check_offset != offsetof(struct vm_class, secondary_super_cache);
 }
 
 static inline bool vm_class_is_assignable_from(struct vm_class *vmc, const struct vm_class *from)
 {
-	return supertype_cache_test(vmc, from) || vm_class_is_assignable_from_slow(vmc, from);
+	const struct vm_class *super;
+
+	super = *(const struct vm_class **) ((void *) from + vmc->super_check_offset);
+	if (super == vmc)
+		return true;
+
+	if (vm_class_is_primary_super(vmc))
+		return false;
+
+	return vm_class_is_assignable_from_slow(vmc, from);
 }
 
 bool vm_class_is_primitive_type_name(const char *class_name);
@@ -2,8 +2,10 @@
 #define __VM_CLASSLOADER_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 extern bool opt_trace_classloader;
+extern bool opt_print_classpath_stats;
 
 struct vm_class;
 struct vm_object;
@@ -13,6 +15,8 @@ int try_to_add_zip_to_classpath(const char *zip);
 
 void classloader_init(void);
 void classloader_destroy(void);
+void classloader_print_classpath_stats(void);
+uint64_t classloader_classpath_fingerprint(void);
 
 struct vm_class *classloader_load(struct vm_object *loader,
 				  const char *class_name);
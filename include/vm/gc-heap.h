@@ -0,0 +1,96 @@
+#ifndef JATO_VM_GC_HEAP_H
+#define JATO_VM_GC_HEAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Heap of the exact garbage collector. The heap is reserved up front and
+ * divided into blocks. Small objects are allocated from blocks that hold
+ * objects of one size class and large objects get a run of whole blocks.
+ * Mark and allocation bits are kept in side tables with one bit per granule.
+ * Blocks that objects have been allocated from since the last collection
+ * form the nursery. Stores of references into the heap are recorded in a
+ * card table so that the nursery can be collected without tracing the rest
+ * of the heap. See vm/gc-heap.c for details.
+ *
+ * None of the functions do any locking. The caller must serialize access to
+ * the heap (see vm/gc.c). The exception is gc_heap_mark() which may be called
+ * by several marking threads at once.
+ */
+#define GC_GRANULE		16
+#define GC_BLOCK_SHIFT		16
+#define GC_BLOCK_SIZE		(1UL << GC_BLOCK_SHIFT)
+#define GC_MAX_SMALL_SIZE	(GC_BLOCK_SIZE / 8)
+
+#define GC_CARD_SHIFT		9
+#define GC_CARD_SIZE		(1UL << GC_CARD_SHIFT)
+#define GC_CARD_DIRTY		1
+
+/*
+ * The card of address A is at gc_card_table_bias + (A >> GC_CARD_SHIFT).
+ * JIT code reads the bias from memory so it must not be made static.
+ */
+extern unsigned long gc_card_table_bias;
+extern unsigned long gc_heap_base;
+extern unsigned long gc_heap_reserved;
+
+struct gc_heap_stats {
+	unsigned long		nr_live_objects;
+	unsigned long		live_bytes;
+	unsigned long		nr_freed_objects;
+	unsigned long		freed_bytes;
+};
+
+typedef void (*gc_card_scan_fn)(void *obj, unsigned long start, unsigned long end);
+
+int gc_heap_init(unsigned long max_size, unsigned long nursery_size);
+void *gc_heap_alloc(size_t size, bool grow);
+void *gc_heap_alloc_many(size_t size, bool grow);
+void *gc_heap_find_object(unsigned long addr);
+size_t gc_heap_object_size(void *obj);
+bool gc_heap_mark(void *obj);
+bool gc_heap_is_marked(void *obj);
+void gc_heap_clear_marks(void);
+void gc_heap_scan_cards(gc_card_scan_fn scan);
+bool gc_heap_needs_full(void);
+void gc_heap_sweep(struct gc_heap_stats *stats, bool full);
+unsigned long gc_heap_size(void);
+
+static inline bool gc_write_barrier_enabled(void)
+{
+	return gc_heap_reserved != 0;
+}
+
+/*
+ * Records that a reference has been stored to @slot. This must be called
+ * after the store for every reference that is stored into a heap object
+ * outside of JIT code, which has the barrier inlined. Addresses outside of
+ * the heap are ignored.
+ */
+static inline void gc_write_barrier(void *slot)
+{
+	unsigned long addr = (unsigned long) slot;
+
+	if (addr - gc_heap_base >= gc_heap_reserved)
+		return;
+
+	((uint8_t *) gc_card_table_bias)[addr >> GC_CARD_SHIFT] = GC_CARD_DIRTY;
+}
+
+static inline void gc_write_barrier_range(void *start, size_t size)
+{
+	unsigned long addr = (unsigned long) start;
+	unsigned long end = addr + size;
+
+	if (!size || addr - gc_heap_base >= gc_heap_reserved)
+		return;
+
+	for (; addr < end; addr += GC_CARD_SIZE)
+		gc_write_barrier((void *) addr);
+
+	gc_write_barrier((void *) (end - 1));
+}
+
+#endif /* JATO_VM_GC_HEAP_H */
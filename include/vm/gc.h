@@ -9,6 +9,8 @@
 struct register_state;
 
 extern unsigned long		max_heap_size;
+extern unsigned long		nursery_size;
+extern unsigned int		gc_nr_threads;
 extern void			*gc_safepoint_page;
 extern bool			newgc_enabled;
 extern bool			verbose_gc;
@@ -19,10 +21,12 @@ typedef void (*finalizer_fn)(struct vm_object *object);
 struct gc_operations {
 	void *(*gc_alloc)(size_t size);
 	void *(*gc_alloc_noscan)(size_t size);
+	void *(*gc_alloc_many)(size_t size);
 	void *(*vm_alloc)(size_t size);
 	void (*vm_free)(void *p);
 	int (*gc_register_finalizer)(struct vm_object *object, finalizer_fn finalizer);
 	void (*gc_setup_signals)(void);
+	void (*gc_collect)(void);
 };
 
 void gc_setup_boehm(void);
@@ -73,6 +77,12 @@ extern struct gc_operations gc_ops;
  *		Allocates collectable memory region. Can not be freed
  *              manually. The content is NOT scanned for object references.
  *              This is used to allocate memory for primitives.
+ *
+ * gc_alloc_many()
+ *		Allocates a batch of collectable memory regions of the same
+ *		size. The regions are linked through their first word and
+ *		are zeroed otherwise. This is used to refill thread-local
+ *		allocation buffers (see include/vm/tlab.h) and is optional.
  */
 
 static inline void *gc_alloc(size_t size)
@@ -85,6 +95,11 @@ static inline void *gc_alloc_noscan(size_t size)
 	return gc_ops.gc_alloc_noscan(size);
 }
 
+static inline void *gc_alloc_many(size_t size)
+{
+	return gc_ops.gc_alloc_many(size);
+}
+
 static inline void *vm_alloc(size_t size)
 {
 	return gc_ops.vm_alloc(size);
@@ -110,6 +125,24 @@ gc_setup_signals(void)
 		gc_ops.gc_setup_signals();
 }
 
+/*
+ * Runs a full collection if the collector supports explicit collections.
+ */
+static inline void
+gc_collect(void)
+{
+	if (gc_ops.gc_collect)
+		gc_ops.gc_collect();
+}
+
+/*
+ * Keeps @object alive while native code holds a direct pointer into it.
+ * Pins nest and every gc_pin_object() must be paired with a call to
+ * gc_unpin_object().
+ */
+int gc_pin_object(struct vm_object *object);
+void gc_unpin_object(struct vm_object *object);
+
 void gc_safepoint(struct register_state *);
 void suspend_handler(int, siginfo_t *, void *);
 void wakeup_handler(int, siginfo_t *, void *);
@@ -1,13 +1,23 @@
 #ifndef JATO__VM_INTERP_H
 #define JATO__VM_INTERP_H
 
+#include "jit/compile-queue.h"
+
+#include "vm/method.h"
 #include "vm/jni.h"
 
+#include <stdbool.h>
 #include <stdarg.h>
 
 struct vm_method;
 struct vm_object;
 
+extern bool opt_interp_only;
+extern bool opt_tiered;
+extern unsigned long opt_compile_threshold;
+extern unsigned long opt_backedge_threshold;
+
+void vm_interp_method_a(struct vm_method *method, unsigned long *args, union jvalue *result);
 void vm_interp_method_v(struct vm_method *method, va_list args, union jvalue *result);
 
 static inline void vm_interp_method(struct vm_method *method, ...)
@@ -20,4 +30,40 @@ static inline void vm_interp_method(struct vm_method *method, ...)
 	va_end(args);
 }
 
+static inline bool vm_interp_enabled(void)
+{
+	return opt_interp_only || opt_tiered;
+}
+
+/*
+ * Returns true if a call to @vmm should be executed by the interpreter. In
+ * tiered mode a method is interpreted until its invocation counter reaches
+ * the compile threshold or its back-edge counter reaches the back-edge
+ * threshold after which calls go through the JIT trampoline. With background
+ * compilation, a hot method is queued for compilation instead and interpreted
+ * until the compiler thread has finished. The counters are updated without
+ * synchronization so the thresholds are approximate when the same method runs
+ * in many threads.
+ */
+static inline bool vm_method_use_interp(struct vm_method *vmm)
+{
+	if (!vm_interp_enabled())
+		return false;
+
+	if (vm_method_is_native(vmm) || vm_method_is_abstract(vmm))
+		return false;
+
+	if (opt_interp_only)
+		return true;
+
+	if (vm_method_is_missing(vmm) || vm_method_is_compiled(vmm))
+		return false;
+
+	if (vmm->backedge_count < opt_backedge_threshold &&
+	    ++vmm->invocation_count < opt_compile_threshold)
+		return true;
+
+	return compile_queue_submit(vmm->compilation_unit);
+}
+
 #endif /* JATO__VM_INTERP_H */
@@ -19,6 +19,7 @@
 
 #include "lib/buffer.h"
 
+struct reflection_stub;
 struct vm_class;
 
 #ifdef CONFIG_ARGS_MAP
@@ -59,6 +60,15 @@ struct vm_method {
 	struct compilation_unit *compilation_unit;
 	struct jit_trampoline *trampoline;
 
+	/* Profiling counters for mixed-mode execution. See "vm/interp.h".  */
+	unsigned long invocation_count;
+	unsigned long backedge_count;
+
+	/* Number of reflective calls and the stub that is used for them
+	 * once the method is called often enough. See runtime/reflection.c */
+	unsigned long reflection_count;
+	struct reflection_stub *reflection_stub;
+
 	char flags;
 
 	unsigned int nr_annotations;
@@ -104,9 +114,15 @@ static inline bool vm_method_is_final(struct vm_method *vmm)
 	return vmm->method->access_flags & CAFEBABE_METHOD_ACC_FINAL;
 }
 
+/*
+ * Bytecode methods that preload overrides with a VM native are native too.
+ * The override is recorded in @vmm rather than in the method_info so that
+ * archived class files are never written to.
+ */
 static inline bool vm_method_is_native(struct vm_method *vmm)
 {
-	return vmm->method->access_flags & CAFEBABE_METHOD_ACC_NATIVE;
+	return vmm->method->access_flags & CAFEBABE_METHOD_ACC_NATIVE
+		|| (vmm->flags & VM_METHOD_FLAG_VM_NATIVE);
 }
 
 static inline bool vm_method_is_abstract(struct vm_method *vmm)
@@ -141,8 +157,7 @@ static inline bool vm_method_is_jni(struct vm_method *vmm)
 
 static inline bool vm_method_is_vm_native(struct vm_method *vmm)
 {
-	return vmm->method->access_flags & CAFEBABE_METHOD_ACC_NATIVE
-		&& (vmm->flags & VM_METHOD_FLAG_VM_NATIVE);
+	return vmm->flags & VM_METHOD_FLAG_VM_NATIVE;
 }
 
 static inline bool vm_method_is_traceable(struct vm_method *vmm)
@@ -6,11 +6,47 @@
 #include "arch/atomic.h"
 
 #include <semaphore.h>
+#include <stdbool.h>
 #include <pthread.h>
 
 struct vm_exec_env;
 struct vm_object;
 
+/*
+ * The monitor_record field in the object header is the lock word of the
+ * object. It is zero when the object is unlocked. An object that is locked
+ * by only one thread at a time holds a thin lock: the lowest bit of the lock
+ * word is set and the rest of the word holds the thin lock id of the owner
+ * and the number of times it has re-entered the monitor. A thin lock is
+ * acquired and released with a single compare-and-swap.
+ *
+ *   31            16 15             1   0
+ *  +----------------+----------------+---+
+ *  |   owner id     |  recursion     | 1 |
+ *  +----------------+----------------+---+
+ *
+ * On contention, wait(), or when the recursion count overflows the lock is
+ * inflated: the lock word is replaced with a pointer to a vm_monitor_record
+ * that is owned by the thread that held the thin lock. Inflated locks use
+ * the relaxed-lock protocol described below and go back to zero when they
+ * are deflated.
+ */
+#define THIN_LOCK_BIT		1UL
+#define THIN_LOCK_COUNT_SHIFT	1
+#define THIN_LOCK_COUNT_ONE	(1UL << THIN_LOCK_COUNT_SHIFT)
+#define THIN_LOCK_COUNT_MASK	(0x7fffUL << THIN_LOCK_COUNT_SHIFT)
+#define THIN_LOCK_ID_SHIFT	16
+#define THIN_LOCK_MAX_ID	0xffffU
+
+/*
+ * Lock word of a thin lock that the current thread holds once. Same as
+ * vm_get_exec_env()->thin_lock_word but accessible from JIT code.
+ */
+extern __thread unsigned long thin_lock_word;
+
+extern bool opt_use_thin_locks;
+extern bool opt_use_spinning;
+
 /*
  * Structure used in relaxed-lock protocol for monitor locking.
  * Locking thread acquires the lock by placing pointer to its
@@ -32,6 +68,13 @@ struct vm_monitor_record {
 	atomic_t		nr_waiting;
 	atomic_t		candidate;
 	int			lock_count;
+
+	/*
+	 * Number of iterations a contending thread spins before it blocks.
+	 * Adapts to how often spinning has acquired this monitor.
+	 */
+	int			spin_limit;
+
 	struct list_head	ee_free_list_node;
 	sem_t			sem;
 	pthread_mutex_t		notify_mutex;
@@ -45,5 +88,7 @@ int vm_object_timed_wait(struct vm_object *self, uint64_t ms, int ns);
 int vm_object_notify(struct vm_object *self);
 int vm_object_notify_all(struct vm_object *self);
 void vm_monitor_record_free(struct vm_monitor_record *vmr);
+int vm_monitor_alloc_thin_lock_id(struct vm_exec_env *ee);
+void vm_monitor_free_thin_lock_id(struct vm_exec_env *ee);
 
 #endif
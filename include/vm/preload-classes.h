@@ -27,6 +27,7 @@ PRELOAD_CLASS("java/lang/RuntimeException", vm_java_lang_RuntimeException, 0)
 PRELOAD_CLASS("java/lang/UnsatisfiedLinkError", vm_java_lang_UnsatisfiedLinkError, 0)
 PRELOAD_CLASS("java/lang/NoSuchFieldError", vm_java_lang_NoSuchFieldError, 0)
 PRELOAD_CLASS("java/lang/NoSuchMethodError", vm_java_lang_NoSuchMethodError, 0)
+PRELOAD_CLASS("java/lang/AbstractMethodError", vm_java_lang_AbstractMethodError, 0)
 PRELOAD_CLASS("java/lang/StackOverflowError", vm_java_lang_StackOverflowError, 0)
 PRELOAD_CLASS("java/lang/VerifyError", vm_java_lang_VerifyError, 0)
 PRELOAD_CLASS("java/lang/Thread", vm_java_lang_Thread, 0)
@@ -36,6 +37,8 @@ PRELOAD_CLASS("java/lang/InheritableThreadLocal", vm_java_lang_InheritableThread
 PRELOAD_CLASS("java/lang/IllegalMonitorStateException", vm_java_lang_IllegalMonitorStateException, 0)
 PRELOAD_CLASS("java/lang/InstantiationException", vm_java_lang_InstantiationException, 0)
 PRELOAD_CLASS("java/lang/System", vm_java_lang_System, 0)
+PRELOAD_CLASS("java/lang/VMSystem", vm_java_lang_VMSystem, 0)
+PRELOAD_CLASS("java/lang/Math", vm_java_lang_Math, 0)
 PRELOAD_CLASS("[Ljava/lang/annotation/Annotation;", vm_array_of_java_lang_annotation_Annotation, 0)
 PRELOAD_CLASS("java/lang/reflect/Field", vm_java_lang_reflect_Field, 0)
 PRELOAD_CLASS("java/lang/reflect/VMField", vm_java_lang_reflect_VMField, PRELOAD_OPTIONAL) /* Classpath 0.98 */
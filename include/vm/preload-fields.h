@@ -2,6 +2,7 @@ PRELOAD_FIELD(vm_java_lang_Class,			vmdata,		"Ljava/lang/Object;",		PRELOAD_MAND
 PRELOAD_FIELD(vm_java_lang_String,			offset,		"I",				PRELOAD_MANDATORY)
 PRELOAD_FIELD(vm_java_lang_String,			count,		"I",				PRELOAD_MANDATORY)
 PRELOAD_FIELD(vm_java_lang_String,			value,		"[C",				PRELOAD_MANDATORY)
+PRELOAD_FIELD(vm_java_lang_String,			cachedHashCode,	"I",				PRELOAD_MANDATORY)
 PRELOAD_FIELD(vm_java_lang_Throwable,			detailMessage,	"Ljava/lang/String;",		PRELOAD_MANDATORY)
 PRELOAD_FIELD(vm_java_lang_VMThrowable,			vmdata,		"Ljava/lang/Object;",		PRELOAD_MANDATORY)
 PRELOAD_FIELD(vm_java_lang_Thread,			daemon,		"Z",				PRELOAD_MANDATORY)
@@ -41,6 +42,15 @@ PRELOAD_FIELD(vm_java_lang_reflect_VMMethod,		m,		"Ljava/lang/reflect/Method;",
 PRELOAD_FIELD(vm_java_lang_reflect_VMMethod,		name,		"Ljava/lang/String;",		PRELOAD_OPTIONAL)
 PRELOAD_FIELD(vm_java_lang_reflect_VMMethod,		slot,		"I",				PRELOAD_OPTIONAL)
 
+PRELOAD_FIELD(vm_java_lang_Boolean,			value,		"Z",				PRELOAD_OPTIONAL)
+PRELOAD_FIELD(vm_java_lang_Byte,			value,		"B",				PRELOAD_OPTIONAL)
+PRELOAD_FIELD(vm_java_lang_Character,			value,		"C",				PRELOAD_OPTIONAL)
+PRELOAD_FIELD(vm_java_lang_Short,			value,		"S",				PRELOAD_OPTIONAL)
+PRELOAD_FIELD(vm_java_lang_Integer,			value,		"I",				PRELOAD_OPTIONAL)
+PRELOAD_FIELD(vm_java_lang_Long,			value,		"J",				PRELOAD_OPTIONAL)
+PRELOAD_FIELD(vm_java_lang_Float,			value,		"F",				PRELOAD_OPTIONAL)
+PRELOAD_FIELD(vm_java_lang_Double,			value,		"D",				PRELOAD_OPTIONAL)
+
 PRELOAD_FIELD(vm_java_lang_ref_Reference,		referent,	"Ljava/lang/Object;",		PRELOAD_MANDATORY)
 PRELOAD_FIELD(vm_java_lang_ref_Reference,		lock,		"Ljava/lang/Object;",		PRELOAD_MANDATORY)
 
@@ -19,6 +19,15 @@ PRELOAD_METHOD(vm_java_lang_Integer, "<init>", "(I)V", vm_java_lang_Integer_init
 PRELOAD_METHOD(vm_java_lang_Integer, "valueOf", "(I)Ljava/lang/Integer;", vm_java_lang_Integer_valueOf)
 PRELOAD_METHOD(vm_java_lang_Long, "<init>", "(J)V", vm_java_lang_Long_init)
 PRELOAD_METHOD(vm_java_lang_Long, "valueOf", "(J)Ljava/lang/Long;", vm_java_lang_Long_valueOf)
+PRELOAD_METHOD(vm_java_lang_Math, "abs", "(D)D", vm_java_lang_Math_abs_D)
+PRELOAD_METHOD(vm_java_lang_Math, "abs", "(F)F", vm_java_lang_Math_abs_F)
+PRELOAD_METHOD(vm_java_lang_Math, "abs", "(I)I", vm_java_lang_Math_abs_I)
+PRELOAD_METHOD(vm_java_lang_Math, "abs", "(J)J", vm_java_lang_Math_abs_J)
+PRELOAD_METHOD(vm_java_lang_Math, "max", "(II)I", vm_java_lang_Math_max_II)
+PRELOAD_METHOD(vm_java_lang_Math, "max", "(JJ)J", vm_java_lang_Math_max_JJ)
+PRELOAD_METHOD(vm_java_lang_Math, "min", "(II)I", vm_java_lang_Math_min_II)
+PRELOAD_METHOD(vm_java_lang_Math, "min", "(JJ)J", vm_java_lang_Math_min_JJ)
+PRELOAD_METHOD(vm_java_lang_Math, "sqrt", "(D)D", vm_java_lang_Math_sqrt)
 PRELOAD_METHOD(vm_java_lang_Number, "doubleValue", "()D", vm_java_lang_Number_doubleValue)
 PRELOAD_METHOD(vm_java_lang_Number, "floatValue", "()F", vm_java_lang_Number_floatValue)
 PRELOAD_METHOD(vm_java_lang_Number, "intValue", "()I", vm_java_lang_Number_intValue)
@@ -26,7 +35,12 @@ PRELOAD_METHOD(vm_java_lang_Number, "longValue", "()J", vm_java_lang_Number_long
 PRELOAD_METHOD(vm_java_lang_Short, "<init>", "(S)V", vm_java_lang_Short_init)
 PRELOAD_METHOD(vm_java_lang_Short, "valueOf", "(S)Ljava/lang/Short;", vm_java_lang_Short_valueOf)
 PRELOAD_METHOD(vm_java_lang_StackTraceElement, "<init>", "(Ljava/lang/String;ILjava/lang/String;Ljava/lang/String;Z)V", vm_java_lang_StackTraceElement_init)
+PRELOAD_METHOD(vm_java_lang_String, "equals", "(Ljava/lang/Object;)Z", vm_java_lang_String_equals)
+PRELOAD_METHOD(vm_java_lang_String, "hashCode", "()I", vm_java_lang_String_hashCode)
+PRELOAD_METHOD(vm_java_lang_String, "indexOf", "(I)I", vm_java_lang_String_indexOf_I)
+PRELOAD_METHOD(vm_java_lang_String, "indexOf", "(II)I", vm_java_lang_String_indexOf_II)
 PRELOAD_METHOD(vm_java_lang_String, "length", "()I", vm_java_lang_String_length)
+PRELOAD_METHOD(vm_java_lang_System, "arraycopy", "(Ljava/lang/Object;ILjava/lang/Object;II)V", vm_java_lang_System_arraycopy)
 PRELOAD_METHOD(vm_java_lang_System, "exit", "(I)V", vm_java_lang_System_exit)
 PRELOAD_METHOD(vm_java_lang_Thread, "<init>", "(Ljava/lang/VMThread;Ljava/lang/String;IZ)V", vm_java_lang_Thread_init)
 PRELOAD_METHOD(vm_java_lang_Thread, "getName", "()Ljava/lang/String;", vm_java_lang_Thread_getName)
@@ -39,6 +53,7 @@ PRELOAD_METHOD(vm_java_lang_Throwable, "initCause", "(Ljava/lang/Throwable;)Ljav
 PRELOAD_METHOD(vm_java_lang_Throwable, "setStackTrace", "([Ljava/lang/StackTraceElement;)V", vm_java_lang_Throwable_setStackTrace)
 PRELOAD_METHOD(vm_java_lang_Throwable, "stackTraceString", "()Ljava/lang/String;", vm_java_lang_Throwable_stackTraceString)
 PRELOAD_METHOD(vm_java_lang_VMString, "intern", "(Ljava/lang/String;)Ljava/lang/String;", vm_java_lang_VMString_intern)
+PRELOAD_METHOD(vm_java_lang_VMSystem, "arraycopy", "(Ljava/lang/Object;ILjava/lang/Object;II)V", vm_java_lang_VMSystem_arraycopy)
 PRELOAD_METHOD(vm_java_lang_VMThread, "<init>", "(Ljava/lang/Thread;)V", vm_java_lang_VMThread_init)
 PRELOAD_METHOD(vm_java_lang_VMThread, "run", "()V", vm_java_lang_VMThread_run)
 PRELOAD_METHOD(vm_java_lang_ref_Reference, "clear", "()V", vm_java_lang_ref_Reference_clear)
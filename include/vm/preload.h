@@ -37,6 +37,7 @@ extern struct vm_field *vm_java_lang_Class_vmdata;
 extern struct vm_field *vm_java_lang_String_offset;
 extern struct vm_field *vm_java_lang_String_count;
 extern struct vm_field *vm_java_lang_String_value;
+extern struct vm_field *vm_java_lang_String_cachedHashCode;
 extern struct vm_field *vm_java_lang_Throwable_detailMessage;
 extern struct vm_field *vm_java_lang_VMThrowable_vmdata;
 extern struct vm_field *vm_java_lang_Thread_daemon;
@@ -69,6 +70,14 @@ extern struct vm_field *vm_java_lang_reflect_VMMethod_name;
 extern struct vm_field *vm_java_lang_reflect_VMMethod_slot;
 extern struct vm_field *vm_java_lang_reflect_VMMethod_m;
 extern struct vm_field *vm_java_lang_ClassLoader_systemClassLoader;
+extern struct vm_field *vm_java_lang_Boolean_value;
+extern struct vm_field *vm_java_lang_Byte_value;
+extern struct vm_field *vm_java_lang_Character_value;
+extern struct vm_field *vm_java_lang_Short_value;
+extern struct vm_field *vm_java_lang_Integer_value;
+extern struct vm_field *vm_java_lang_Long_value;
+extern struct vm_field *vm_java_lang_Float_value;
+extern struct vm_field *vm_java_lang_Double_value;
 extern struct vm_field *vm_java_lang_ref_Reference_referent;
 extern struct vm_field *vm_java_lang_ref_Reference_lock;
 extern struct vm_field *vm_java_nio_Buffer_address;
@@ -79,7 +88,11 @@ extern struct vm_field *vm_gnu_classpath_PointerNN_data;
 #include "vm/preload-methods.h"
 #undef PRELOAD_METHOD
 
+/* Upper limit for -Xclassload:threads= */
+#define PRELOAD_MAX_THREADS	64
+
 extern bool preload_finished;
+extern unsigned int preload_nr_threads;
 
 int vm_preload_add_class_fixup(struct vm_class *vmc);
 int preload_vm_classes(void);
@@ -5,6 +5,8 @@
 
 struct vm_object;
 
+extern bool opt_reflection_stubs;
+
 struct vm_class *vm_object_to_vm_class(struct vm_object *object);
 struct vm_field *vm_object_to_vm_field(struct vm_object *field);
 struct vm_object *vm_method_to_java_lang_reflect_method(struct vm_method *vmm, jobject clazz, int method_index);
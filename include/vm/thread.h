@@ -3,10 +3,14 @@
 
 #include "lib/list.h"
 
+#include "vm/tlab.h"
+
 #include "arch/atomic.h"
 #include "arch/registers.h"
 
 #include <stdio.h> /* for NOT_IMPLEMENTED */
+#include <stdbool.h>
+#include <stdint.h>
 #include <pthread.h>
 #include <semaphore.h>
 #include <signal.h>
@@ -39,13 +43,24 @@ struct vm_thread {
 	/* Points to object on which thread is waiting or NULL */
 	struct vm_object *waiting_mon;
 
-	/* Should be accessed only with vm_thread_(set|get)_state() */
+	/*
+	 * Whether the thread was stopped at a consistent point. Only used by
+	 * the garbage collector while the world is stopped.
+	 */
 	enum vm_thread_state thread_state;
 
-	/* Needed by sun.misc.Unsafe.park() */
-	pthread_mutex_t park_mutex;
-	pthread_cond_t park_cond;
-	bool unpark_called;
+	/*
+	 * Futex word of sun.misc.Unsafe.park(). See vm_thread_park() for
+	 * the states.
+	 */
+	atomic_t park_state;
+
+	/*
+	 * Native entry point for VM internal threads that are started with
+	 * vm_thread_start_native(). NULL for ordinary Java threads.
+	 */
+	void *(*start_routine)(void *);
+	void *start_arg;
 
 	struct vm_exec_env *ee;
 };
@@ -54,6 +69,9 @@ struct vm_exec_env {
 	struct vm_thread *thread;
 	struct list_head free_monitor_recs;
 
+	/* Lock word of a thin lock held once by this thread */
+	unsigned long thin_lock_word;
+
 	/*
 	 * Holds a reference to exception that has been signalled.  This
 	 * pointer is cleared when handler is executed or
@@ -70,13 +88,33 @@ struct vm_exec_env {
 	/* Signal register state */
 	struct register_state thread_register_state;
 
+	/*
+	 * The following are used by the exact garbage collector to scan the
+	 * stack of this thread while it is stopped in a safepoint.
+	 */
+
+	/* Highest address of the native stack of this thread */
+	void *stack_end;
+
+	/* Frame of gc_start() while this thread waits for a collection */
+	void *gc_frame;
+
+	/* Register state of this thread when it entered the safepoint */
+	struct register_state *gc_regs;
+
 	struct string *trace_buffer;
+
+	/* Thread-local allocation buffer */
+	struct tlab tlab;
 };
 
 unsigned int vm_nr_threads(void);
 
 extern pthread_key_t current_exec_env_key;
 
+/* Same as vm_get_exec_env() but accessible from JIT code. */
+extern __thread struct vm_exec_env *current_exec_env;
+
 static inline struct vm_exec_env *vm_get_exec_env(void)
 {
 	return pthread_getspecific(current_exec_env_key);
@@ -93,8 +131,11 @@ static inline struct vm_thread *vm_thread_self(void)
 }
 
 void init_exec_env(void);
+int vm_exec_env_attach(void);
+void vm_exec_env_detach(void);
 int init_threading(void);
 int vm_thread_start(struct vm_object *vmthread);
+int vm_thread_start_native(const char *name, void *(*start_routine)(void *), void *arg);
 void vm_thread_wait_for_non_daemons(void);
 void vm_thread_set_state(struct vm_thread *thread, enum vm_thread_state state);
 enum vm_thread_state vm_thread_get_state(struct vm_thread *thread);
@@ -104,6 +145,8 @@ bool vm_thread_is_interrupted(struct vm_thread *thread);
 bool vm_thread_interrupted(struct vm_thread *thread);
 void vm_thread_interrupt(struct vm_thread *thread);
 void vm_thread_yield(void);
+void vm_thread_park(bool is_absolute, int64_t timeout);
+void vm_thread_unpark(struct vm_thread *thread);
 struct vm_thread *vm_thread_from_vmthread(struct vm_object *vmthread);
 struct vm_thread *vm_thread_from_java_thread(struct vm_object *jthread);
 void vm_lock_thread_count(void);
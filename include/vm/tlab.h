@@ -0,0 +1,39 @@
+#ifndef JATO_VM_TLAB_H
+#define JATO_VM_TLAB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Thread-local allocation buffers. Every thread has a list of free objects
+ * for each small size class that the garbage collector hands out in batches.
+ * The objects are zeroed except for the first word which links the list.
+ * JIT code pops objects off the lists inline and only calls tlab_refill()
+ * when a list is empty. See vm/tlab.c for details.
+ */
+#define TLAB_GRANULE		16
+#define TLAB_NR_SIZE_CLASSES	16
+#define TLAB_MAX_SIZE		(TLAB_GRANULE * TLAB_NR_SIZE_CLASSES)
+
+struct tlab {
+	void			*free_list[TLAB_NR_SIZE_CLASSES];
+};
+
+extern bool opt_use_tlab;
+
+static inline unsigned int tlab_size_class(size_t size)
+{
+	return (size - 1) / TLAB_GRANULE;
+}
+
+static inline size_t tlab_size_class_size(unsigned int size_class)
+{
+	return (size_class + 1) * TLAB_GRANULE;
+}
+
+void tlab_init(struct tlab *tlab);
+bool tlab_enabled(void);
+void *tlab_alloc(size_t size);
+void *tlab_refill(void **free_list);
+
+#endif /* JATO_VM_TLAB_H */
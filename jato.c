@@ -35,11 +35,14 @@
 #include "runtime/runtime.h"
 
 #include "jit/llvm/core.h"
+#include "jit/compile-queue.h"
+#include "jit/compile-stats.h"
 #include "jit/compiler.h"
 #include "jit/cu-mapping.h"
 #include "jit/gdb.h"
 #include "jit/exception.h"
 #include "jit/inline-cache.h"
+#include "jit/intrinsics.h"
 #include "jit/perf-map.h"
 #include "jit/debug.h"
 #include "jit/text.h"
@@ -48,6 +51,7 @@
 #include "lib/string.h"
 #include "lib/parse.h"
 #include "lib/list.h"
+#include "lib/zip.h"
 
 #include "vm/fault-inject.h"
 #include "vm/verifier.h"
@@ -56,6 +60,7 @@
 #include "vm/reflection.h"
 #include "vm/natives.h"
 #include "vm/preload.h"
+#include "vm/class-archive.h"
 #include "vm/version.h"
 #include "vm/interp.h"
 #include "vm/itable.h"
@@ -73,6 +78,7 @@
 #include "vm/jar.h"
 #include "vm/jni.h"
 #include "vm/gc.h"
+#include "vm/tlab.h"
 #include "vm/vm.h"
 #include "vm/java-version.h"
 
@@ -83,11 +89,13 @@
 #include "runtime/java_lang_reflect_VMField.h"
 #include "runtime/java_lang_VMClassLoader.h"
 #include "runtime/java_lang_VMString.h"
+#include "runtime/java_lang_String.h"
 #include "runtime/java_lang_VMSystem.h"
 #include "runtime/java_lang_VMThread.h"
 #include "runtime/java_lang_VMClass.h"
 #include "runtime/sun_misc_Unsafe.h"
 
+static const char *bootclasspath;
 static const char *bootclasspath_append;
 
 static bool dump_maps;
@@ -105,8 +113,6 @@ static bool use_system_classloader = true;
  */
 bool opt_ssa_enable;
 
-static bool opt_interp_only;
-
 /*
  * Enable LLVM backend:
  */
@@ -122,8 +128,55 @@ bool opt_llvm_verbose;
  */
 bool running_on_valgrind;
 
+/*
+ * Startup timings for -Xclassload:stats. Time to main is measured from the
+ * start of main() to the invocation of the Java main method.
+ */
+static bool opt_print_startup_stats;
+static struct timespec startup_time;
+static unsigned long preload_usecs;
+static unsigned long time_to_main_usecs;
+
+static unsigned long usecs_since_startup(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (unsigned long) (now.tv_sec - startup_time.tv_sec) * 1000000
+		+ (now.tv_nsec - startup_time.tv_nsec) / 1000;
+}
+
+static void print_startup_stats(void)
+{
+	fprintf(stderr, "Startup statistics (%u class loading threads):\n", preload_nr_threads);
+	fprintf(stderr, "  %8lu us preloading classes\n", preload_usecs);
+	fprintf(stderr, "  %8lu us time to main\n", time_to_main_usecs);
+
+	if (class_archive_mode == CLASS_ARCHIVE_ON || class_archive_mode == CLASS_ARCHIVE_AUTO)
+		class_archive_print_stats();
+}
+
 static void vm_atexit(void)
 {
+	if (opt_print_compile_stats)
+		compile_queue_print_stats();
+
+	if (opt_jit_stats)
+		compile_stats_print();
+
+	if (opt_print_resolve_stats)
+		vm_class_print_resolve_stats();
+
+	if (opt_print_classpath_stats)
+		classloader_print_classpath_stats();
+
+	if (opt_print_startup_stats)
+		print_startup_stats();
+
+	if (class_archive_mode == CLASS_ARCHIVE_DUMP)
+		class_archive_dump();
+
 	classloader_destroy();
 
 	if (opt_llvm_enable)
@@ -479,6 +532,9 @@ static struct vm_native natives[] = {
 	DEFINE_NATIVE("java/lang/VMRuntime", "runFinalization", java_lang_VMRuntime_runFinalization),
 	DEFINE_NATIVE("java/lang/VMRuntime", "traceInstructions", native_vmruntime_trace_instructions),
 	DEFINE_NATIVE("java/lang/VMRuntime", "traceMethodCalls", native_vmruntime_trace_method_calls),
+	DEFINE_NATIVE("java/lang/String", "equals", java_lang_String_equals),
+	DEFINE_NATIVE("java/lang/String", "hashCode", java_lang_String_hashCode),
+	DEFINE_NATIVE("java/lang/String", "indexOf", java_lang_String_indexOf),
 	DEFINE_NATIVE("java/lang/VMString", "intern", java_lang_VMString_intern),
 	DEFINE_NATIVE("java/lang/VMSystem", "arraycopy", java_lang_VMSystem_arraycopy),
 	DEFINE_NATIVE("java/lang/VMSystem", "identityHashCode", java_lang_VMSystem_identityHashCode),
@@ -585,6 +641,41 @@ static void jit_init_natives(void)
 	"  -version	   print out version number and copyright information\n"	\
 	"\n"										\
 	"  -Xint           operate in interpreter-only mode\n"				\
+	"  -Xtiered        interpret methods until they are hot, then compile them\n"	\
+	"  -Xresolve:stats print constant pool resolution cache statistics at exit\n"	\
+	"  -Xnoreflstubs   disable argument marshalling stubs for reflective calls\n"	\
+	"  -Xclasspath:stats\n"								\
+	"                  print time spent opening and loading from each classpath entry at exit\n" \
+	"  -Xclassload:threads=<n>\n"							\
+	"                  number of threads that load the core classes at startup\n"	\
+	"  -Xclassload:stats\n"								\
+	"                  print class preloading time and time to main at exit\n"	\
+	"  -Xjit:stats     print time, memory and IR size per JIT compiler pass at exit\n" \
+	"  -Xjit:stats:csv=<file>\n"							\
+	"                  also write per-method JIT compilation statistics to <file>\n" \
+	"  -Xjit:stats:top=<n>\n"							\
+	"                  number of most expensive methods to compile listed (default 10)\n" \
+	"  -Xshare:dump    write the boot classes that are loaded to the shared archive at exit\n" \
+	"  -Xshare:on      load boot classes from the shared archive\n"		\
+	"  -Xshare:auto    load boot classes from the shared archive if it can be used\n" \
+	"  -Xshare:off     do not use the shared archive (default)\n"		\
+	"  -XX:SharedArchiveFile=<file>\n"						\
+	"                  path of the shared archive\n"				\
+	"  -Xzipcache:<dir>\n"								\
+	"                  cache inflated class files of JAR and ZIP files in <dir>\n"	\
+	"  -XX:CompileThreshold=<n>\n"							\
+	"                  number of interpreted calls before a method is compiled\n"	\
+	"  -XX:BackEdgeThreshold=<n>\n"							\
+	"                  number of interpreted loop iterations before a method is compiled\n" \
+	"  -XX:+BackgroundCompilation\n"						\
+	"                  compile hot methods in compiler threads (with -Xtiered)\n"	\
+	"  -XX:CICompilerCount=<n>\n"							\
+	"                  number of compiler threads for background compilation\n"	\
+	"  -XX:+CITime     print background compilation statistics at exit\n"		\
+	"  -XX:-UseTLAB    disable thread-local allocation buffers\n"			\
+	"  -XX:-UseThinLocks disable thin locks and always use monitor records\n"	\
+	"  -XX:-UseSpinning  block on contended monitors without spinning first\n"	\
+	"  -XX:-UseIntrinsics call library methods instead of inlining fast paths\n"	\
 	"  -XX:+PrintCompilation Print a message when a method is compiled\n"
 
 static void usage(FILE *f, int retval)
@@ -634,9 +725,23 @@ static void bootclasspath_parse_and_append(const void *arg)
 	}
 }
 
+/*
+ * The boot class path is opened after all options have been parsed so that
+ * options like -Xzipcache apply to it regardless of their order.
+ */
 static void handle_bootclasspath(const char *arg)
 {
-	bootclasspath_parse_and_append(arg);
+	char *cp;
+
+	if (!bootclasspath) {
+		bootclasspath = arg;
+		return;
+	}
+
+	if (asprintf(&cp, "%s:%s", bootclasspath, arg) < 0)
+		die("asprintf");
+
+	bootclasspath = cp;
 }
 
 static void handle_bootclasspath_append(const char *arg)
@@ -714,16 +819,31 @@ static void handle_ssa(void)
 	opt_ssa_enable = true;
 }
 
+static void handle_no_abc(void)
+{
+	opt_abc_enable = false;
+}
+
 static void handle_no_ic(void)
 {
 	opt_ic_enabled  = false;
 }
 
+static void handle_no_reflection_stubs(void)
+{
+	opt_reflection_stubs = false;
+}
+
 static void handle_int(void)
 {
 	opt_interp_only  = true;
 }
 
+static void handle_tiered(void)
+{
+	opt_tiered = true;
+}
+
 static void handle_llvm(void)
 {
 	opt_llvm_enable = true;
@@ -768,6 +888,11 @@ static void handle_debug_stack(void)
 	opt_debug_stack = true;
 }
 
+static void handle_trace_abc(void)
+{
+	opt_trace_abc = true;
+}
+
 static void handle_trace_asm(void)
 {
 	opt_trace_machine_code = true;
@@ -823,6 +948,7 @@ static void handle_trace_liveness(void)
 static void handle_trace_jit(void)
 {
 	opt_trace_ssa = true;
+	opt_trace_abc = true;
 	opt_trace_cfg = true;
 	opt_trace_tree_ir = true;
 	opt_trace_lir = true;
@@ -898,6 +1024,26 @@ static void handle_max_heap_size(const char *arg)
 	}
 }
 
+static void handle_nursery_size(const char *arg)
+{
+	nursery_size = parse_long(arg);
+
+	if (!nursery_size) {
+		fprintf(stderr, "%s: unparseable nursery size '%s'\n", program_name, arg);
+		usage(stderr, EXIT_FAILURE);
+	}
+}
+
+static void handle_gc_threads(const char *arg)
+{
+	gc_nr_threads = parse_long(arg);
+
+	if (!gc_nr_threads) {
+		fprintf(stderr, "%s: unparseable GC thread count '%s'\n", program_name, arg);
+		usage(stderr, EXIT_FAILURE);
+	}
+}
+
 static void handle_thread_stack_size(const char *arg)
 {
 	/* Ignore */
@@ -908,6 +1054,168 @@ static void handle_print_compilation(void)
 	opt_print_compilation = true;
 }
 
+static void handle_compile_threshold(const char *arg)
+{
+	opt_compile_threshold = parse_long(arg);
+
+	if (!opt_compile_threshold) {
+		fprintf(stderr, "%s: unparseable compile threshold '%s'\n", program_name, arg);
+		usage(stderr, EXIT_FAILURE);
+	}
+}
+
+static void handle_backedge_threshold(const char *arg)
+{
+	opt_backedge_threshold = parse_long(arg);
+
+	if (!opt_backedge_threshold) {
+		fprintf(stderr, "%s: unparseable back-edge threshold '%s'\n", program_name, arg);
+		usage(stderr, EXIT_FAILURE);
+	}
+}
+
+static void handle_background_compilation(void)
+{
+	opt_background_compilation = true;
+}
+
+static void handle_compiler_count(const char *arg)
+{
+	opt_compiler_count = parse_long(arg);
+
+	if (!opt_compiler_count) {
+		fprintf(stderr, "%s: unparseable compiler thread count '%s'\n", program_name, arg);
+		usage(stderr, EXIT_FAILURE);
+	}
+}
+
+static void handle_use_tlab(void)
+{
+	opt_use_tlab = true;
+}
+
+static void handle_no_use_tlab(void)
+{
+	opt_use_tlab = false;
+}
+
+static void handle_use_thin_locks(void)
+{
+	opt_use_thin_locks = true;
+}
+
+static void handle_no_use_thin_locks(void)
+{
+	opt_use_thin_locks = false;
+}
+
+static void handle_use_spinning(void)
+{
+	opt_use_spinning = true;
+}
+
+static void handle_no_use_spinning(void)
+{
+	opt_use_spinning = false;
+}
+
+static void handle_use_intrinsics(void)
+{
+	opt_use_intrinsics = true;
+}
+
+static void handle_no_use_intrinsics(void)
+{
+	opt_use_intrinsics = false;
+}
+
+static void handle_print_compile_stats(void)
+{
+	opt_print_compile_stats = true;
+}
+
+static void handle_jit_stats(void)
+{
+	opt_jit_stats = true;
+}
+
+static void handle_jit_stats_csv(const char *arg)
+{
+	opt_jit_stats = true;
+	opt_jit_stats_csv = arg;
+}
+
+static void handle_jit_stats_top(const char *arg)
+{
+	opt_jit_stats = true;
+	opt_jit_stats_top = parse_long(arg);
+
+	if (!opt_jit_stats_top) {
+		fprintf(stderr, "%s: unparseable method count '%s'\n", program_name, arg);
+		usage(stderr, EXIT_FAILURE);
+	}
+}
+
+static void handle_print_resolve_stats(void)
+{
+	opt_print_resolve_stats = true;
+}
+
+static void handle_print_classpath_stats(void)
+{
+	opt_print_classpath_stats = true;
+}
+
+static void handle_print_startup_stats(void)
+{
+	opt_print_startup_stats = true;
+}
+
+static void handle_classload_threads(const char *arg)
+{
+	unsigned long nr_threads = parse_long(arg);
+
+	if (!nr_threads) {
+		fprintf(stderr, "%s: unparseable class loading thread count '%s'\n", program_name, arg);
+		usage(stderr, EXIT_FAILURE);
+	}
+
+	if (nr_threads > PRELOAD_MAX_THREADS)
+		nr_threads = PRELOAD_MAX_THREADS;
+
+	preload_nr_threads = nr_threads;
+}
+
+static void handle_share_dump(void)
+{
+	class_archive_mode = CLASS_ARCHIVE_DUMP;
+}
+
+static void handle_share_on(void)
+{
+	class_archive_mode = CLASS_ARCHIVE_ON;
+}
+
+static void handle_share_auto(void)
+{
+	class_archive_mode = CLASS_ARCHIVE_AUTO;
+}
+
+static void handle_share_off(void)
+{
+	class_archive_mode = CLASS_ARCHIVE_OFF;
+}
+
+static void handle_shared_archive_file(const char *arg)
+{
+	class_archive_path = arg;
+}
+
+static void handle_zip_cache(const char *arg)
+{
+	zip_set_cache_dir(arg);
+}
+
 const struct option options[] = {
 	DEFINE_OPTION("version",		handle_version),
 	DEFINE_OPTION("h",			handle_help),
@@ -922,12 +1230,24 @@ const struct option options[] = {
 	DEFINE_OPTION("Xnosystemclassloader",	handle_no_system_classloader),
 	DEFINE_OPTION("Xperf",			handle_perf),
 	DEFINE_OPTION("Xssa",			handle_ssa),
+	DEFINE_OPTION("Xnoabc",			handle_no_abc),
 	DEFINE_OPTION("Xnoic",			handle_no_ic),
+	DEFINE_OPTION("Xnoreflstubs",		handle_no_reflection_stubs),
 	DEFINE_OPTION("Xint",			handle_int),
+	DEFINE_OPTION("Xtiered",		handle_tiered),
 	DEFINE_OPTION("Xllvm",			handle_llvm),
 	DEFINE_OPTION("Xllvm:verbose",		handle_llvm_verbose),
+	DEFINE_OPTION("Xresolve:stats",		handle_print_resolve_stats),
+	DEFINE_OPTION("Xclasspath:stats",	handle_print_classpath_stats),
+	DEFINE_OPTION("Xclassload:stats",	handle_print_startup_stats),
+	DEFINE_OPTION("Xjit:stats",		handle_jit_stats),
+	DEFINE_OPTION("Xshare:dump",		handle_share_dump),
+	DEFINE_OPTION("Xshare:on",		handle_share_on),
+	DEFINE_OPTION("Xshare:auto",		handle_share_auto),
+	DEFINE_OPTION("Xshare:off",		handle_share_off),
 
 	DEFINE_OPTION("Xdebug:stack",		handle_debug_stack),
+	DEFINE_OPTION("Xtrace:abc",		handle_trace_abc),
 	DEFINE_OPTION("Xtrace:asm",		handle_trace_asm),
 	DEFINE_OPTION("Xtrace:bytecode",	handle_trace_bytecode),
 	DEFINE_OPTION("Xtrace:bytecode-offset",	handle_trace_bytecode_offset),
@@ -954,9 +1274,29 @@ const struct option options[] = {
 	DEFINE_OPTION_ADJACENT_ARG("Xbootclasspath/a:",	handle_bootclasspath_append),
 	DEFINE_OPTION_ADJACENT_ARG("D",		handle_define),
 	DEFINE_OPTION_ADJACENT_ARG("Xmx",	handle_max_heap_size),
+	DEFINE_OPTION_ADJACENT_ARG("Xmn",	handle_nursery_size),
+	DEFINE_OPTION_ADJACENT_ARG("Xgc:threads=",	handle_gc_threads),
+	DEFINE_OPTION_ADJACENT_ARG("Xclassload:threads=",	handle_classload_threads),
+	DEFINE_OPTION_ADJACENT_ARG("Xjit:stats:csv=",	handle_jit_stats_csv),
+	DEFINE_OPTION_ADJACENT_ARG("Xjit:stats:top=",	handle_jit_stats_top),
 	DEFINE_OPTION_ADJACENT_ARG("Xss",	handle_thread_stack_size),
+	DEFINE_OPTION_ADJACENT_ARG("Xzipcache:",	handle_zip_cache),
+	DEFINE_OPTION_ADJACENT_ARG("XX:SharedArchiveFile=",	handle_shared_archive_file),
 
 	DEFINE_OPTION("XX:+PrintCompilation",	handle_print_compilation),
+	DEFINE_OPTION_ADJACENT_ARG("XX:CompileThreshold=",	handle_compile_threshold),
+	DEFINE_OPTION_ADJACENT_ARG("XX:BackEdgeThreshold=",	handle_backedge_threshold),
+	DEFINE_OPTION("XX:+BackgroundCompilation",	handle_background_compilation),
+	DEFINE_OPTION_ADJACENT_ARG("XX:CICompilerCount=",	handle_compiler_count),
+	DEFINE_OPTION("XX:+CITime",		handle_print_compile_stats),
+	DEFINE_OPTION("XX:+UseTLAB",		handle_use_tlab),
+	DEFINE_OPTION("XX:-UseTLAB",		handle_no_use_tlab),
+	DEFINE_OPTION("XX:+UseThinLocks",	handle_use_thin_locks),
+	DEFINE_OPTION("XX:-UseThinLocks",	handle_no_use_thin_locks),
+	DEFINE_OPTION("XX:+UseSpinning",	handle_use_spinning),
+	DEFINE_OPTION("XX:-UseSpinning",	handle_no_use_spinning),
+	DEFINE_OPTION("XX:+UseIntrinsics",	handle_use_intrinsics),
+	DEFINE_OPTION("XX:-UseIntrinsics",	handle_no_use_intrinsics),
 };
 
 static void parse_options(int argc, char *argv[])
@@ -1062,7 +1402,9 @@ do_main_class(void)
 		array_set_field_object(args, i, arg);
 	}
 
-	if (opt_interp_only) {
+	time_to_main_usecs = usecs_since_startup();
+
+	if (vm_method_use_interp(vmm)) {
 		vm_interp_method(vmm, args);
 	} else {
 		void (*java_main)(void *);
@@ -1117,6 +1459,9 @@ static bool gnu_classpath_autodiscovery(void)
 
 static bool init_classpath(void)
 {
+	if (bootclasspath)
+		bootclasspath_parse_and_append(bootclasspath);
+
 	if (!system_property_get("java.boot.class.path")) {
 		if (!gnu_classpath_autodiscovery())
 			return false;
@@ -1161,6 +1506,8 @@ main(int argc, char *argv[])
 
 	program_name = argv[0];
 
+	clock_gettime(CLOCK_MONOTONIC, &startup_time);
+
 	atexit(vm_atexit);
 
 #ifndef NDEBUG
@@ -1216,17 +1563,33 @@ main(int argc, char *argv[])
 		exit(EXIT_FAILURE);
 	}
 
+	if (class_archive_mode == CLASS_ARCHIVE_ON || class_archive_mode == CLASS_ARCHIVE_AUTO) {
+		if (class_archive_open() && class_archive_mode == CLASS_ARCHIVE_ON) {
+			fprintf(stderr, "Unable to use the shared class archive\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	preload_usecs = usecs_since_startup();
+
 	if (preload_vm_classes()) {
 		fprintf(stderr, "Unable to preload system classes\n");
 		exit(EXIT_FAILURE);
 	}
 
+	preload_usecs = usecs_since_startup() - preload_usecs;
+
 	init_stack_trace_printing();
 	if (init_threading()) {
 		fprintf(stderr, "could not initialize threading\n");
 		goto out_check_exception;
 	}
 
+	if (opt_tiered && opt_background_compilation && compile_queue_init()) {
+		fprintf(stderr, "could not start compiler threads\n");
+		goto out_check_exception;
+	}
+
 	switch (operation) {
 	case OPERATION_MAIN_CLASS:
 		status = do_main_class();
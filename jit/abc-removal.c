@@ -34,7 +34,7 @@ void abc_removal(struct compilation_unit *cu)
 
 	for_each_basic_block(bb, &cu->bb_list)
 		list_for_each_entry(insn, &bb->insn_list, insn_list_node)
-			if (insn_is_call_to(insn, vm_object_alloc_primitive_array))
+			if (insn_is_array_check(insn))
 				nr_array_check++;
 
 	struct insn *delete[nr_array_check];
@@ -66,17 +66,11 @@ void abc_removal(struct compilation_unit *cu)
 				}
 			}
 
-			if (insn_is_call_to(insn, vm_object_check_array)) {
-				struct insn *insn_push_index, *insn_push_array;
+			if (insn_is_array_check(insn)) {
 				uint32_t index_reg, array_reg;
 
-				insn_push_index = list_entry(insn->insn_list_node.prev->prev,
-								struct insn, insn_list_node);
-				index_reg = insn_push_index->src.reg.interval->var_info->vreg;
-
-				insn_push_array = list_entry(insn->insn_list_node.prev,
-								struct insn, insn_list_node);
-				array_reg = insn_push_array->src.reg.interval->var_info->vreg;
+				index_reg = insn->dest.reg.interval->var_info->vreg;
+				array_reg = insn->src.base_reg.interval->var_info->vreg;
 
 				if (regs_value[index_reg].active && arrays_value[array_reg].active) {
 					if (regs_value[index_reg].val < arrays_value[array_reg].size)
@@ -86,28 +80,6 @@ void abc_removal(struct compilation_unit *cu)
 		}
 	}
 
-	for (int i = 0; i < index; i++) {
-		struct insn *insn_push_index, *insn_push_array,
-			*insn, *insn_args_cleanup,
-			*insn_exception_test1, *insn_exception_test2;
-
-		insn = delete[i];
-		insn_push_index = list_entry(insn->insn_list_node.prev->prev,
-					struct insn, insn_list_node);
-		insn_push_array = list_entry(insn->insn_list_node.prev,
-					struct insn, insn_list_node);
-		insn_args_cleanup = list_entry(insn->insn_list_node.next,
-					struct insn, insn_list_node);
-		insn_exception_test1 = list_entry(insn->insn_list_node.next->next,
-					struct insn, insn_list_node);
-		insn_exception_test2 = list_entry(insn->insn_list_node.next->next->next,
-					struct insn, insn_list_node);
-
-		remove_insn(insn);
-		remove_insn(insn_push_index);
-		remove_insn(insn_push_array);
-		remove_insn(insn_args_cleanup);
-		remove_insn(insn_exception_test1);
-		remove_insn(insn_exception_test2);
-	}
+	for (int i = 0; i < index; i++)
+		remove_insn(delete[i]);
 }
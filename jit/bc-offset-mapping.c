@@ -8,6 +8,7 @@
 #include "jit/bc-offset-mapping.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <stdio.h>
 
@@ -16,9 +17,13 @@
 #include "jit/statement.h"
 #include "jit/expression.h"
 #include "jit/instruction.h"
+#include "jit/emit-code.h"
 
 #include "lib/buffer.h"
 
+#include "vm/stdlib.h"
+#include "vm/trace.h"
+
 /**
  * tree_patch_bc_offset - sets bytecode_offset field of a tree node
  *                        unless it is already set.
@@ -38,46 +43,357 @@ void tree_patch_bc_offset(struct tree_node *node, unsigned long bc_offset)
 		tree_patch_bc_offset(node->kids[i], bc_offset);
 }
 
+/*
+ * Bytecode offset tables
+ *
+ * A table is built from points that say that the machine code starting at
+ * some offset maps to a bytecode offset. Every instruction starts a point and
+ * every out-of-line stub starts a point at its first byte and one with an
+ * unknown bytecode offset after its last byte. Where several points are at
+ * the same offset, the last one wins and points that don't change the
+ * bytecode offset are dropped. What is left are the runs of the table.
+ *
+ * Runs are delta-encoded to LEB128 numbers so that most of them take two
+ * bytes. Every BC_OFFSET_CHECKPOINT_INTERVAL runs a checkpoint records the
+ * decoded state so that a lookup can binary search the checkpoints and
+ * decode at most BC_OFFSET_CHECKPOINT_INTERVAL - 1 runs.
+ *
+ * A byte in the middle of an instruction maps to the bytecode offset of the
+ * instruction, so a return address - 1 maps to the call that it returns
+ * from.
+ */
+
+struct bc_offset_point {
+	unsigned long		native_offset;
+	unsigned long		bc_offset;
+	unsigned long		seq;
+	bool			is_end;
+};
+
+static int bc_offset_point_cmp(const void *p1, const void *p2)
+{
+	const struct bc_offset_point *a = p1, *b = p2;
+
+	if (a->native_offset != b->native_offset)
+		return a->native_offset < b->native_offset ? -1 : 1;
+
+	/* A stub that starts where another one ends wins. */
+	if (a->is_end != b->is_end)
+		return a->is_end ? -1 : 1;
+
+	return a->seq < b->seq ? -1 : 1;
+}
+
+/* Bytecode offsets are encoded with 0 for unknown offsets. */
+static uint32_t bc_offset_encode(unsigned long bc_offset)
+{
+	if (bc_offset == BC_OFFSET_UNKNOWN)
+		return 0;
+
+	return bc_offset + 1;
+}
+
+static unsigned long bc_offset_decode(uint32_t value)
+{
+	if (!value)
+		return BC_OFFSET_UNKNOWN;
+
+	return value - 1;
+}
+
+static uint32_t zigzag_encode(int32_t value)
+{
+	return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+}
+
+static int32_t zigzag_decode(uint32_t value)
+{
+	return (int32_t) (value >> 1) ^ -(int32_t) (value & 1);
+}
+
+static unsigned long uleb128_size(uint32_t value)
+{
+	unsigned long size = 1;
+
+	while (value >= 0x80) {
+		value >>= 7;
+		size++;
+	}
+
+	return size;
+}
+
+static unsigned char *uleb128_write(unsigned char *p, uint32_t value)
+{
+	while (value >= 0x80) {
+		*p++ = (value & 0x7f) | 0x80;
+		value >>= 7;
+	}
+	*p++ = value;
+
+	return p;
+}
+
+static const unsigned char *uleb128_read(const unsigned char *p, uint32_t *value)
+{
+	unsigned int shift = 0;
+	uint32_t result = 0;
+
+	do {
+		result |= (uint32_t) (*p & 0x7f) << shift;
+		shift += 7;
+	} while (*p++ & 0x80);
+
+	*value = result;
+
+	return p;
+}
+
+static void add_point(struct bc_offset_point *points, unsigned long *nr_points,
+		      unsigned long native_offset, unsigned long bc_offset, bool is_end)
+{
+	struct bc_offset_point *point = &points[*nr_points];
+
+	point->native_offset	= native_offset;
+	point->bc_offset	= bc_offset_encode(bc_offset);
+	point->seq		= *nr_points;
+	point->is_end		= is_end;
+
+	(*nr_points)++;
+}
+
+static unsigned long collect_points(struct compilation_unit *cu, struct bc_offset_point *points)
+{
+	struct array_check_stub *stub;
+	struct monitor_stub *monitor_stub;
+	struct tlab_stub *tlab_stub;
+	unsigned long nr_points = 0;
+	struct basic_block *bb;
+	struct insn *insn;
+
+	for_each_basic_block(bb, &cu->bb_list) {
+		for_each_insn(insn, &bb->insn_list) {
+			if (points)
+				add_point(points, &nr_points, insn->mach_offset, insn_get_bc_offset(insn), false);
+			else
+				nr_points++;
+		}
+	}
+
+	/*
+	 * The exit and unwind code after the body doesn't belong to any
+	 * bytecode. Exceptions that unlocking the monitor of a synchronized
+	 * method throws there must not be caught by handlers in the method.
+	 */
+	if (points) {
+		add_point(points, &nr_points, cu->exit_bb->mach_offset, BC_OFFSET_UNKNOWN, false);
+		add_point(points, &nr_points, cu->unwind_bb->mach_offset, BC_OFFSET_UNKNOWN, false);
+	} else
+		nr_points += 2;
+
+	/*
+	 * Array check stubs throw on behalf of the inlined check so map
+	 * their whole machine code range to the bytecode offset of it.
+	 */
+	list_for_each_entry(stub, &cu->array_check_stub_list, list_node) {
+		if (points) {
+			add_point(points, &nr_points, stub->start, insn_get_bc_offset(stub->insn), false);
+			add_point(points, &nr_points, stub->end, BC_OFFSET_UNKNOWN, true);
+		} else
+			nr_points += 2;
+	}
+
+	/* Same for allocation stubs which throw OutOfMemoryError. */
+	list_for_each_entry(tlab_stub, &cu->tlab_stub_list, list_node) {
+		if (points) {
+			add_point(points, &nr_points, tlab_stub->start, insn_get_bc_offset(tlab_stub->insn), false);
+			add_point(points, &nr_points, tlab_stub->end, BC_OFFSET_UNKNOWN, true);
+		} else
+			nr_points += 2;
+	}
+
+	/* Monitor stubs throw IllegalMonitorStateException. */
+	list_for_each_entry(monitor_stub, &cu->monitor_stub_list, list_node) {
+		if (points) {
+			add_point(points, &nr_points, monitor_stub->start, insn_get_bc_offset(monitor_stub->insn), false);
+			add_point(points, &nr_points, monitor_stub->end, BC_OFFSET_UNKNOWN, true);
+		} else
+			nr_points += 2;
+	}
+
+	return nr_points;
+}
+
+/*
+ * Turns sorted points to runs in place and returns the number of runs.
+ */
+static unsigned long points_to_runs(struct bc_offset_point *points, unsigned long nr_points)
+{
+	unsigned long nr_runs = 0;
+
+	for (unsigned long i = 0; i < nr_points; i++) {
+		struct bc_offset_point *point = &points[i];
+
+		if (i + 1 < nr_points && points[i + 1].native_offset == point->native_offset)
+			continue;
+
+		if (nr_runs && points[nr_runs - 1].bc_offset == point->bc_offset)
+			continue;
+
+		/* Code before the first run maps to an unknown offset. */
+		if (!nr_runs && !point->bc_offset)
+			continue;
+
+		points[nr_runs++] = *point;
+	}
+
+	return nr_runs;
+}
+
 /**
  * Constructs native to bytecode offset translation table.
  * Must be called after compiltion is finished.
  */
 int build_bc_offset_map(struct compilation_unit *cu)
 {
-	unsigned long code_size;
-	struct basic_block *bb;
-	struct insn *insn;
-	struct insn *prev_insn;
-
-	code_size = buffer_offset(cu->objcode);
-	cu->bc_offset_map = malloc(sizeof(unsigned long) * code_size);
-	if (!cu->bc_offset_map)
+	struct bc_offset_point *points;
+	struct bc_offset_table *table;
+	unsigned long nr_points;
+	unsigned long nr_runs;
+	unsigned long size;
+	unsigned char *p;
+	uint32_t prev_native, prev_bc;
+	int err = 0;
+
+	nr_points = collect_points(cu, NULL);
+
+	points = malloc(sizeof(*points) * (nr_points + 1));
+	if (!points)
 		return -ENOMEM;
 
-	/* Set all fields to unknown (ULONG_MAX) by default. */
-	memset(cu->bc_offset_map, 0xff, sizeof(unsigned long) * code_size);
+	collect_points(cu, points);
 
-	prev_insn = NULL;
+	qsort(points, nr_points, sizeof(*points), bc_offset_point_cmp);
 
-	for_each_basic_block(bb, &cu->bb_list) {
-		for_each_insn(insn, &bb->insn_list) {
-			/* We put bc-offset mapping not only for the
-			 * insn offset but also for the offset of last
-			 * insn byte. That's because for call site
-			 * bc-offset we pall for return address - 1.
-			 */
-			if (prev_insn)
-				cu->bc_offset_map[insn->mach_offset - 1] =
-					insn_get_bc_offset(prev_insn);
-
-			cu->bc_offset_map[insn->mach_offset] =
-				insn_get_bc_offset(insn);
-
-			prev_insn = insn;
+	nr_runs = points_to_runs(points, nr_points);
+
+	table = zalloc(sizeof(*table));
+	if (!table) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	table->nr_runs		= nr_runs;
+	table->nr_checkpoints	= DIV_ROUND_UP(nr_runs, BC_OFFSET_CHECKPOINT_INTERVAL);
+
+	size = 0;
+	prev_native = prev_bc = 0;
+
+	for (unsigned long i = 0; i < nr_runs; i++) {
+		if (i % BC_OFFSET_CHECKPOINT_INTERVAL) {
+			size += uleb128_size(points[i].native_offset - prev_native);
+			size += uleb128_size(zigzag_encode(points[i].bc_offset - prev_bc));
+		}
+
+		prev_native	= points[i].native_offset;
+		prev_bc		= points[i].bc_offset;
+	}
+
+	table->data_size	= size;
+	table->checkpoints	= malloc(sizeof(*table->checkpoints) * table->nr_checkpoints + size);
+	if (!table->checkpoints && nr_runs) {
+		free(table);
+		err = -ENOMEM;
+		goto out;
+	}
+
+	table->data = (unsigned char *) (table->checkpoints + table->nr_checkpoints);
+
+	p = table->data;
+	prev_native = prev_bc = 0;
+
+	for (unsigned long i = 0; i < nr_runs; i++) {
+		if (i % BC_OFFSET_CHECKPOINT_INTERVAL) {
+			p = uleb128_write(p, points[i].native_offset - prev_native);
+			p = uleb128_write(p, zigzag_encode(points[i].bc_offset - prev_bc));
+		} else {
+			struct bc_offset_checkpoint *checkpoint;
+
+			checkpoint = &table->checkpoints[i / BC_OFFSET_CHECKPOINT_INTERVAL];
+			checkpoint->native_offset	= points[i].native_offset;
+			checkpoint->bc_offset		= points[i].bc_offset;
+			checkpoint->data_pos		= p - table->data;
 		}
+
+		prev_native	= points[i].native_offset;
+		prev_bc		= points[i].bc_offset;
+	}
+
+	cu->bc_offset_map = table;
+out:
+	free(points);
+
+	return err;
+}
+
+/*
+ * Returns the number of bytes that @table takes in memory.
+ */
+unsigned long bc_offset_table_size(struct bc_offset_table *table)
+{
+	if (!table)
+		return 0;
+
+	return sizeof(*table)
+		+ sizeof(*table->checkpoints) * table->nr_checkpoints
+		+ table->data_size;
+}
+
+static unsigned long bc_offset_table_lookup(struct bc_offset_table *table, unsigned long offset)
+{
+	struct bc_offset_checkpoint *checkpoint;
+	const unsigned char *p;
+	unsigned long lo, hi, run;
+	uint32_t native, bc;
+
+	if (!table->nr_checkpoints || offset < table->checkpoints[0].native_offset)
+		return BC_OFFSET_UNKNOWN;
+
+	/* Find the last checkpoint that starts at or before @offset. */
+	lo = 0;
+	hi = table->nr_checkpoints;
+
+	while (hi - lo > 1) {
+		unsigned long mid = (lo + hi) / 2;
+
+		if (table->checkpoints[mid].native_offset <= offset)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	checkpoint = &table->checkpoints[lo];
+	native	= checkpoint->native_offset;
+	bc	= checkpoint->bc_offset;
+	p	= table->data + checkpoint->data_pos;
+
+	for (run = lo * BC_OFFSET_CHECKPOINT_INTERVAL + 1; run < table->nr_runs; run++) {
+		uint32_t delta, bc_delta;
+
+		if (run % BC_OFFSET_CHECKPOINT_INTERVAL == 0)
+			break;
+
+		p = uleb128_read(p, &delta);
+		if (native + delta > offset)
+			break;
+
+		p = uleb128_read(p, &bc_delta);
+
+		native	+= delta;
+		bc	+= zigzag_decode(bc_delta);
 	}
 
-	return 0;
+	return bc_offset_decode(bc);
 }
 
 /**
@@ -107,7 +423,18 @@ jit_lookup_bc_offset(struct compilation_unit *cu, unsigned char *native_ptr)
 	if (offset >= buffer_offset(cu->objcode))
 		return BC_OFFSET_UNKNOWN;
 
-	return cu->bc_offset_map[offset];
+	return bc_offset_table_lookup(cu->bc_offset_map, offset);
+}
+
+void trace_bc_offset_table(struct compilation_unit *cu)
+{
+	struct bc_offset_table *table = cu->bc_offset_map;
+
+	trace_printf("Bytecode offset table:\n");
+	trace_printf("  runs:        %lu\n", table->nr_runs);
+	trace_printf("  checkpoints: %lu\n", table->nr_checkpoints);
+	trace_printf("  size:        %lu bytes for %lu bytes of code\n\n",
+		     bc_offset_table_size(table), buffer_offset(cu->objcode));
 }
 
 void print_bytecode_offset(unsigned long bytecode_offset, struct string *str)
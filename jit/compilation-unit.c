@@ -4,16 +4,21 @@
  * This file is released under the 2-clause BSD license. Please refer to the
  * file LICENSE for details.
  */
+#include "arch/inline-cache.h"
 #include "arch/registers.h"
 
 #include "jit/constant-pool.h"
 
 #include "jit/args.h"
 #include "jit/basic-block.h"
+#include "jit/bc-offset-mapping.h"
 #include "jit/compilation-unit.h"
+#include "jit/emit-code.h"
+#include "jit/gc-map.h"
 #include "jit/instruction.h"
 #include "jit/stack-slot.h"
 #include "jit/statement.h"
+#include "jit/text.h"
 #include "jit/vars.h"
 #include "lib/buffer.h"
 #include "vm/method.h"
@@ -106,6 +111,11 @@ struct compilation_unit *compilation_unit_alloc(struct vm_method *method)
 		INIT_LIST_HEAD(&cu->tableswitch_list);
 		INIT_LIST_HEAD(&cu->lookupswitch_list);
 		INIT_LIST_HEAD(&cu->ic_call_list);
+		INIT_LIST_HEAD(&cu->array_check_stub_list);
+		INIT_LIST_HEAD(&cu->tlab_stub_list);
+		INIT_LIST_HEAD(&cu->monitor_stub_list);
+		INIT_LIST_HEAD(&cu->ic_pic_list);
+		INIT_LIST_HEAD(&cu->compile_queue_node);
 
 		cu->lir_insn_map = NULL;
 
@@ -145,8 +155,12 @@ static void free_var_infos(struct compilation_unit *cu, struct var_info *var_inf
 	}
 }
 
-static void free_bc_offset_map(unsigned long *map)
+static void free_bc_offset_map(struct bc_offset_table *map)
 {
+	if (!map)
+		return;
+
+	free(map->checkpoints);
 	free(map);
 }
 
@@ -182,6 +196,39 @@ static void free_call_fixup_sites(struct compilation_unit *cu)
 	}
 }
 
+static void free_array_check_stubs(struct compilation_unit *cu)
+{
+	struct array_check_stub *this, *next;
+
+	list_for_each_entry_safe(this, next, &cu->array_check_stub_list, list_node)
+	{
+		list_del(&this->list_node);
+		free(this);
+	}
+}
+
+static void free_tlab_stubs(struct compilation_unit *cu)
+{
+	struct tlab_stub *this, *next;
+
+	list_for_each_entry_safe(this, next, &cu->tlab_stub_list, list_node)
+	{
+		list_del(&this->list_node);
+		free(this);
+	}
+}
+
+static void free_monitor_stubs(struct compilation_unit *cu)
+{
+	struct monitor_stub *this, *next;
+
+	list_for_each_entry_safe(this, next, &cu->monitor_stub_list, list_node)
+	{
+		list_del(&this->list_node);
+		free(this);
+	}
+}
+
 static void free_lir_insn_map(struct compilation_unit *cu)
 {
 	free_radix_tree(cu->lir_insn_map);
@@ -204,6 +251,10 @@ void shrink_compilation_unit(struct compilation_unit *cu)
 	free(cu->doms);
 	cu->doms = NULL;
 
+	free_array_check_stubs(cu);
+	free_tlab_stubs(cu);
+	free_monitor_stubs(cu);
+
 	if (cu->arena)
 		arena_delete(cu->arena);
 	cu->arena = NULL;
@@ -214,6 +265,7 @@ void free_compilation_unit(struct compilation_unit *cu)
 	struct basic_block *bb, *tmp_bb;
 
 	free_call_fixup_sites(cu);
+	free_ic_pics(cu);
 	shrink_compilation_unit(cu);
 
 	list_for_each_entry_safe(bb, tmp_bb, &cu->bb_list, bb_list_node)
@@ -222,9 +274,12 @@ void free_compilation_unit(struct compilation_unit *cu)
 	pthread_mutex_destroy(&cu->mutex);
 	free_basic_block(cu->exit_bb);
 	free_basic_block(cu->unwind_bb);
+	if (cu->objcode)
+		jit_text_free(buffer_ptr(cu->objcode), buffer_offset(cu->objcode));
 	free_buffer(cu->objcode);
 	free_stack_frame(cu->stack_frame);
 	free_bc_offset_map(cu->bc_offset_map);
+	free_gc_maps(cu);
 	free_lookupswitch_list(cu);
 	free_tableswitch_list(cu);
 	free_lir_insn_map(cu);
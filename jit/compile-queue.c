@@ -0,0 +1,227 @@
+/*
+ * Background compilation
+ *
+ * This file is released under the 2-clause BSD license. Please refer to the
+ * file LICENSE for details.
+ *
+ * In tiered mode, methods that become hot are put on a compile queue that is
+ * served by a pool of compiler threads. The thread that triggered compilation
+ * keeps running the method in the interpreter until a compiler thread has
+ * installed the new code. JIT code always calls through the method trampoline
+ * so a call from compiled code to a method that is still queued compiles it
+ * synchronously in jit_magic_trampoline() like before.
+ *
+ * If background compilation of a method fails, the exception is discarded
+ * and the method is marked as failed. The next call then goes through the
+ * trampoline which compiles the method again on the calling thread so that
+ * the error is reported in the right context.
+ */
+
+#include "jit/compile-queue.h"
+
+#include "jit/compilation-unit.h"
+#include "jit/compiler.h"
+#include "jit/exception.h"
+
+#include "vm/method.h"
+#include "vm/thread.h"
+#include "vm/die.h"
+
+#include "lib/list.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+bool opt_background_compilation;
+unsigned long opt_compiler_count = 2;
+bool opt_print_compile_stats;
+
+static pthread_mutex_t compile_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t compile_queue_cond = PTHREAD_COND_INITIALIZER;
+static struct list_head compile_queue = LIST_HEAD_INIT(compile_queue);
+
+static bool compile_queue_running;
+
+/* Protected by compile_queue_mutex */
+static struct {
+	unsigned long	nr_queued;
+	unsigned long	nr_compiled;
+	unsigned long	nr_failed;
+	unsigned long	depth;
+	unsigned long	max_depth;
+	uint64_t	total_wait;
+	uint64_t	max_wait;
+	uint64_t	total_latency;
+	uint64_t	max_latency;
+} stats;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static struct compilation_unit *compile_queue_take(void)
+{
+	struct compilation_unit *cu;
+	uint64_t wait;
+
+	pthread_mutex_lock(&compile_queue_mutex);
+
+	while (list_is_empty(&compile_queue))
+		pthread_cond_wait(&compile_queue_cond, &compile_queue_mutex);
+
+	cu = list_first_entry(&compile_queue, struct compilation_unit, compile_queue_node);
+	list_del(&cu->compile_queue_node);
+
+	wait = now_ns() - cu->queue_time;
+
+	stats.depth--;
+	stats.total_wait += wait;
+	if (wait > stats.max_wait)
+		stats.max_wait = wait;
+
+	pthread_mutex_unlock(&compile_queue_mutex);
+
+	return cu;
+}
+
+static void compile_queue_done(struct compilation_unit *cu, bool success, uint64_t latency)
+{
+	pthread_mutex_lock(&compile_queue_mutex);
+
+	if (success) {
+		cu->queue_state = COMPILE_QUEUE_NONE;
+		stats.nr_compiled++;
+	} else {
+		cu->queue_state = COMPILE_QUEUE_FAILED;
+		stats.nr_failed++;
+	}
+
+	stats.total_latency += latency;
+	if (latency > stats.max_latency)
+		stats.max_latency = latency;
+
+	pthread_mutex_unlock(&compile_queue_mutex);
+}
+
+static void *compile_thread(void *arg)
+{
+	for (;;) {
+		struct compilation_unit *cu;
+		uint64_t start;
+		void *entry;
+
+		cu = compile_queue_take();
+
+		start = now_ns();
+
+		entry = jit_compile(cu);
+		if (!entry)
+			clear_exception();
+
+		compile_queue_done(cu, entry != NULL, now_ns() - start);
+
+		if (entry)
+			fixup_direct_calls(cu->method->trampoline, (unsigned long) entry);
+	}
+
+	return NULL;
+}
+
+int compile_queue_init(void)
+{
+	unsigned long i;
+
+	for (i = 0; i < opt_compiler_count; i++) {
+		char name[48];
+
+		snprintf(name, sizeof(name), "JIT Compiler Thread %lu", i);
+
+		if (vm_thread_start_native(name, compile_thread, NULL))
+			return -1;
+	}
+
+	compile_queue_running = true;
+
+	return 0;
+}
+
+/*
+ * Queues @cu for background compilation. Returns true if the caller should
+ * keep interpreting the method because it is queued or being compiled, and
+ * false if the caller should compile the method itself.
+ */
+bool compile_queue_submit(struct compilation_unit *cu)
+{
+	bool ret = true;
+
+	if (!compile_queue_running)
+		return false;
+
+	/* Optimistic unlocked check */
+	if (cu->queue_state == COMPILE_QUEUE_QUEUED)
+		return true;
+
+	pthread_mutex_lock(&compile_queue_mutex);
+
+	switch (cu->queue_state) {
+	case COMPILE_QUEUE_NONE:
+		if (compilation_unit_get_state(cu) == COMPILATION_STATE_COMPILED) {
+			ret = false;
+			break;
+		}
+
+		cu->queue_state = COMPILE_QUEUE_QUEUED;
+		cu->queue_time = now_ns();
+		list_add_tail(&cu->compile_queue_node, &compile_queue);
+
+		stats.nr_queued++;
+		if (++stats.depth > stats.max_depth)
+			stats.max_depth = stats.depth;
+
+		pthread_cond_signal(&compile_queue_cond);
+		break;
+	case COMPILE_QUEUE_QUEUED:
+		break;
+	case COMPILE_QUEUE_FAILED:
+		ret = false;
+		break;
+	default:
+		error("invalid compile queue state %lu", cu->queue_state);
+	}
+
+	pthread_mutex_unlock(&compile_queue_mutex);
+
+	return ret;
+}
+
+void compile_queue_print_stats(void)
+{
+	unsigned long nr_done;
+
+	pthread_mutex_lock(&compile_queue_mutex);
+
+	nr_done = stats.nr_compiled + stats.nr_failed;
+
+	fprintf(stderr, "Background compilation:\n");
+	fprintf(stderr, "  compiler threads: %lu\n", opt_compiler_count);
+	fprintf(stderr, "  queued:           %lu\n", stats.nr_queued);
+	fprintf(stderr, "  compiled:         %lu\n", stats.nr_compiled);
+	fprintf(stderr, "  failed:           %lu\n", stats.nr_failed);
+	fprintf(stderr, "  queue depth:      %lu (max %lu)\n", stats.depth, stats.max_depth);
+	fprintf(stderr, "  queue wait:       avg %" PRIu64 " us, max %" PRIu64 " us\n",
+		stats.nr_queued - stats.depth ? stats.total_wait / (stats.nr_queued - stats.depth) / 1000 : 0,
+		stats.max_wait / 1000);
+	fprintf(stderr, "  compile latency:  avg %" PRIu64 " us, max %" PRIu64 " us\n",
+		nr_done ? stats.total_latency / nr_done / 1000 : 0,
+		stats.max_latency / 1000);
+
+	pthread_mutex_unlock(&compile_queue_mutex);
+}
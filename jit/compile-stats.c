@@ -0,0 +1,416 @@
+/*
+ * JIT compilation statistics
+ *
+ * This file is released under the 2-clause BSD license. Please refer to the
+ * file LICENSE for details.
+ *
+ * With -Xjit:stats, do_compile() brackets every pass with compile_pass_begin()
+ * and compile_pass_end(). For each pass we record wall-clock time, CPU time of
+ * the compiling thread, bytes allocated from the compilation unit arena, the
+ * net change in malloc'd bytes, and the number of IR nodes or LIR
+ * instructions after the pass has run. The malloc numbers come from
+ * mallinfo2() which is process-wide, so they also include whatever other
+ * threads allocated while the pass was running.
+ *
+ * Per-pass totals and a list of the most expensive methods to compile are
+ * printed at exit. With -Xjit:stats:csv=<file>, one row per compiled method
+ * is also written to <file>.
+ */
+
+#include "jit/compile-stats.h"
+
+#include "jit/compilation-unit.h"
+#include "jit/basic-block.h"
+#include "jit/instruction.h"
+#include "jit/compiler.h"
+#include "jit/statement.h"
+#include "jit/tree-node.h"
+
+#include "vm/method.h"
+#include "vm/class.h"
+#include "vm/die.h"
+
+#include "lib/arena.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+bool opt_jit_stats;
+const char *opt_jit_stats_csv;
+unsigned long opt_jit_stats_top = 10;
+
+static const char *compile_pass_names[NR_COMPILE_PASSES] = {
+	[PASS_INLINE_SUBROUTINES]	= "inline_subroutines",
+	[PASS_ANALYZE_CONTROL_FLOW]	= "analyze_control_flow",
+	[PASS_CONVERT_TO_IR]		= "convert_to_ir",
+	[PASS_DOMINATORS]		= "dominators",
+	[PASS_LOOP_ABC_REMOVAL]		= "loop_abc_removal",
+	[PASS_SELECT_INSTRUCTIONS]	= "select_instructions",
+	[PASS_SSA]			= "ssa",
+	[PASS_LIVENESS]			= "liveness",
+	[PASS_ALLOCATE_REGISTERS]	= "allocate_registers",
+	[PASS_MARK_CLOBBERS]		= "mark_clobbers",
+	[PASS_SPILL_RELOAD]		= "spill_reload",
+	[PASS_INLINE_CACHE]		= "inline_cache",
+	[PASS_PEEPHOLE]			= "peephole",
+	[PASS_EMIT_CODE]		= "emit_code",
+	[PASS_BC_OFFSET_MAP]		= "bc_offset_map",
+	[PASS_FIXUPS]			= "fixups",
+};
+
+struct method_compile_stats {
+	char			*name;
+	unsigned long		bytecode_size;
+	unsigned long		nr_ir_nodes;
+	unsigned long		nr_insns;
+	unsigned long		code_size;
+	uint64_t		wall_ns;
+	uint64_t		cpu_ns;
+	uint64_t		arena_bytes;
+	int64_t			malloc_bytes;
+	uint64_t		pass_wall_ns[NR_COMPILE_PASSES];
+};
+
+static pthread_mutex_t compile_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Protected by compile_stats_mutex */
+static struct {
+	unsigned long			nr_compiled;
+	unsigned long			nr_failed;
+	uint64_t			bytecode_size;
+	uint64_t			nr_ir_nodes;
+	uint64_t			nr_insns;
+	uint64_t			code_size;
+	struct compile_pass_stats	passes[NR_COMPILE_PASSES];
+	unsigned long			nr_pass_runs[NR_COMPILE_PASSES];
+
+	struct method_compile_stats	*methods;
+	unsigned long			nr_methods;
+	unsigned long			max_methods;
+} stats;
+
+static uint64_t clock_ns(clockid_t clock)
+{
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int64_t malloc_bytes_in_use(void)
+{
+#ifdef __GLIBC__
+#if __GLIBC_PREREQ(2, 33)
+	struct mallinfo2 mi = mallinfo2();
+#else
+	struct mallinfo mi = mallinfo();
+#endif
+	return (int64_t) mi.uordblks + mi.hblkhd;
+#else
+	return 0;
+#endif
+}
+
+static unsigned long count_tree_nodes(struct tree_node *node)
+{
+	unsigned long count = 1;
+	int i;
+
+	for (i = 0; i < node_nr_kids(node); i++) {
+		if (node->kids[i])
+			count += count_tree_nodes(node->kids[i]);
+	}
+
+	return count;
+}
+
+static unsigned long count_ir_nodes(struct compilation_unit *cu)
+{
+	unsigned long count = 0;
+	struct basic_block *bb;
+
+	for_each_basic_block(bb, &cu->bb_list) {
+		struct statement *stmt;
+
+		for_each_stmt(stmt, &bb->stmt_list)
+			count += count_tree_nodes(&stmt->node);
+	}
+
+	return count;
+}
+
+static unsigned long count_insns(struct compilation_unit *cu)
+{
+	unsigned long count = 0;
+	struct basic_block *bb;
+
+	for_each_basic_block(bb, &cu->bb_list) {
+		struct insn *insn;
+
+		for_each_insn(insn, &bb->insn_list)
+			count++;
+	}
+
+	return count;
+}
+
+void __compile_stats_begin(struct compile_stats *s)
+{
+	memset(s, 0, sizeof *s);
+
+	s->current_pass = NR_COMPILE_PASSES;
+}
+
+void __compile_pass_begin(struct compile_stats *s, struct compilation_unit *cu, enum compile_pass pass)
+{
+	s->current_pass	= pass;
+	s->start_malloc	= malloc_bytes_in_use();
+	s->start_arena	= arena_size(cu->arena);
+	s->start_cpu	= clock_ns(CLOCK_THREAD_CPUTIME_ID);
+	s->start_wall	= clock_ns(CLOCK_MONOTONIC);
+}
+
+static void compile_pass_account(struct compile_stats *s, struct compilation_unit *cu, enum compile_pass pass)
+{
+	struct compile_pass_stats *p = &s->passes[pass];
+	uint64_t wall, cpu;
+
+	wall		= clock_ns(CLOCK_MONOTONIC);
+	cpu		= clock_ns(CLOCK_THREAD_CPUTIME_ID);
+
+	p->wall_ns	+= wall - s->start_wall;
+	p->cpu_ns	+= cpu - s->start_cpu;
+	p->arena_bytes	+= arena_size(cu->arena) - s->start_arena;
+	p->malloc_bytes	+= malloc_bytes_in_use() - s->start_malloc;
+
+	s->pass_ran[pass] = true;
+	s->current_pass = NR_COMPILE_PASSES;
+}
+
+void __compile_pass_end(struct compile_stats *s, struct compilation_unit *cu, enum compile_pass pass)
+{
+	struct compile_pass_stats *p = &s->passes[pass];
+
+	compile_pass_account(s, cu, pass);
+
+	/*
+	 * Counting is done after the clocks have been read so that it is not
+	 * charged to the pass.
+	 */
+	if (pass < PASS_SELECT_INSTRUCTIONS) {
+		p->nr_nodes = count_ir_nodes(cu);
+		s->nr_ir_nodes = p->nr_nodes;
+	} else {
+		p->nr_nodes = count_insns(cu);
+		s->nr_insns = p->nr_nodes;
+	}
+}
+
+static void record_method(struct method_compile_stats *m)
+{
+	if (stats.nr_methods == stats.max_methods) {
+		unsigned long max = stats.max_methods ? stats.max_methods * 2 : 256;
+		struct method_compile_stats *methods;
+
+		methods = realloc(stats.methods, max * sizeof *methods);
+		if (!methods) {
+			free(m->name);
+			return;
+		}
+
+		stats.methods		= methods;
+		stats.max_methods	= max;
+	}
+
+	stats.methods[stats.nr_methods++] = *m;
+}
+
+void __compile_stats_end(struct compile_stats *s, struct compilation_unit *cu, int err)
+{
+	struct method_compile_stats m;
+	char symbol[128];
+	unsigned int i;
+
+	/*
+	 * A pass that fails jumps past compile_pass_end(). Its cost is still
+	 * accounted but the IR it leaves behind is not counted.
+	 */
+	if (s->current_pass != NR_COMPILE_PASSES)
+		compile_pass_account(s, cu, s->current_pass);
+
+	memset(&m, 0, sizeof m);
+
+	for (i = 0; i < NR_COMPILE_PASSES; i++) {
+		struct compile_pass_stats *p = &s->passes[i];
+
+		m.wall_ns		+= p->wall_ns;
+		m.cpu_ns		+= p->cpu_ns;
+		m.arena_bytes		+= p->arena_bytes;
+		m.malloc_bytes		+= p->malloc_bytes;
+		m.pass_wall_ns[i]	= p->wall_ns;
+	}
+
+	if (!err) {
+		m.name		= strdup(cu_symbol(cu, symbol, sizeof symbol));
+		m.bytecode_size	= cu->method->code_attribute.code_length;
+		m.nr_ir_nodes	= s->nr_ir_nodes;
+		m.nr_insns	= s->nr_insns;
+		m.code_size	= cu_native_size(cu);
+	}
+
+	pthread_mutex_lock(&compile_stats_mutex);
+
+	for (i = 0; i < NR_COMPILE_PASSES; i++) {
+		struct compile_pass_stats *total = &stats.passes[i];
+		struct compile_pass_stats *p = &s->passes[i];
+
+		if (!s->pass_ran[i])
+			continue;
+
+		total->wall_ns		+= p->wall_ns;
+		total->cpu_ns		+= p->cpu_ns;
+		total->arena_bytes	+= p->arena_bytes;
+		total->malloc_bytes	+= p->malloc_bytes;
+		total->nr_nodes		+= p->nr_nodes;
+		stats.nr_pass_runs[i]++;
+	}
+
+	if (err) {
+		stats.nr_failed++;
+	} else {
+		stats.nr_compiled++;
+		stats.bytecode_size	+= m.bytecode_size;
+		stats.nr_ir_nodes	+= m.nr_ir_nodes;
+		stats.nr_insns		+= m.nr_insns;
+		stats.code_size		+= m.code_size;
+
+		if (m.name)
+			record_method(&m);
+	}
+
+	pthread_mutex_unlock(&compile_stats_mutex);
+}
+
+static void write_csv(const char *path)
+{
+	unsigned long i;
+	unsigned int j;
+	FILE *f;
+
+	f = fopen(path, "w");
+	if (!f) {
+		warn("unable to open %s: %s", path, strerror(errno));
+		return;
+	}
+
+	fprintf(f, "method,bytecode_bytes,ir_nodes,lir_insns,code_bytes,wall_ns,cpu_ns,arena_bytes,malloc_bytes");
+	for (j = 0; j < NR_COMPILE_PASSES; j++)
+		fprintf(f, ",%s_wall_ns", compile_pass_names[j]);
+	fprintf(f, "\n");
+
+	for (i = 0; i < stats.nr_methods; i++) {
+		struct method_compile_stats *m = &stats.methods[i];
+
+		fprintf(f, "\"%s\",%lu,%lu,%lu,%lu,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRId64,
+			m->name, m->bytecode_size, m->nr_ir_nodes, m->nr_insns, m->code_size,
+			m->wall_ns, m->cpu_ns, m->arena_bytes, m->malloc_bytes);
+
+		for (j = 0; j < NR_COMPILE_PASSES; j++)
+			fprintf(f, ",%" PRIu64, m->pass_wall_ns[j]);
+		fprintf(f, "\n");
+	}
+
+	if (fclose(f))
+		warn("unable to write %s: %s", path, strerror(errno));
+}
+
+static int method_compile_stats_cmp(const void *a, const void *b)
+{
+	const struct method_compile_stats *x = a, *y = b;
+
+	if (x->wall_ns > y->wall_ns)
+		return -1;
+
+	if (x->wall_ns < y->wall_ns)
+		return 1;
+
+	return 0;
+}
+
+static void print_top_methods(void)
+{
+	unsigned long i, nr;
+
+	nr = stats.nr_methods < opt_jit_stats_top ? stats.nr_methods : opt_jit_stats_top;
+	if (!nr)
+		return;
+
+	qsort(stats.methods, stats.nr_methods, sizeof *stats.methods, method_compile_stats_cmp);
+
+	fprintf(stderr, "\n  Top %lu methods by compile time:\n", nr);
+	fprintf(stderr, "     wall us     cpu us  bytecode  ir nodes  lir insns   code  method\n");
+
+	for (i = 0; i < nr; i++) {
+		struct method_compile_stats *m = &stats.methods[i];
+
+		fprintf(stderr, "  %10" PRIu64 " %10" PRIu64 "  %8lu  %8lu  %9lu  %5lu  %s\n",
+			m->wall_ns / 1000, m->cpu_ns / 1000, m->bytecode_size,
+			m->nr_ir_nodes, m->nr_insns, m->code_size, m->name);
+	}
+}
+
+void compile_stats_print(void)
+{
+	uint64_t total_wall = 0, total_cpu = 0;
+	unsigned int i;
+
+	pthread_mutex_lock(&compile_stats_mutex);
+
+	for (i = 0; i < NR_COMPILE_PASSES; i++) {
+		total_wall	+= stats.passes[i].wall_ns;
+		total_cpu	+= stats.passes[i].cpu_ns;
+	}
+
+	fprintf(stderr, "JIT compilation statistics:\n");
+	fprintf(stderr, "  methods compiled: %lu (%lu failed)\n", stats.nr_compiled, stats.nr_failed);
+	fprintf(stderr, "  bytecode:         %" PRIu64 " bytes\n", stats.bytecode_size);
+	fprintf(stderr, "  IR nodes:         %" PRIu64 "\n", stats.nr_ir_nodes);
+	fprintf(stderr, "  LIR instructions: %" PRIu64 "\n", stats.nr_insns);
+	fprintf(stderr, "  machine code:     %" PRIu64 " bytes\n", stats.code_size);
+	fprintf(stderr, "  compile time:     %" PRIu64 " us wall, %" PRIu64 " us cpu\n",
+		total_wall / 1000, total_cpu / 1000);
+
+	fprintf(stderr, "\n  %-22s %8s %10s %10s %6s %12s %12s %9s\n",
+		"pass", "runs", "wall us", "cpu us", "wall%", "arena bytes", "malloc bytes", "avg size");
+
+	for (i = 0; i < NR_COMPILE_PASSES; i++) {
+		struct compile_pass_stats *p = &stats.passes[i];
+		unsigned long runs = stats.nr_pass_runs[i];
+
+		if (!runs)
+			continue;
+
+		fprintf(stderr, "  %-22s %8lu %10" PRIu64 " %10" PRIu64 " %6.1f %12" PRIu64 " %12" PRId64 " %9lu\n",
+			compile_pass_names[i], runs, p->wall_ns / 1000, p->cpu_ns / 1000,
+			total_wall ? 100.0 * p->wall_ns / total_wall : 0.0,
+			p->arena_bytes, p->malloc_bytes, p->nr_nodes / runs);
+	}
+
+	if (opt_jit_stats_csv)
+		write_csv(opt_jit_stats_csv);
+
+	print_top_methods();
+
+	pthread_mutex_unlock(&compile_stats_mutex);
+}
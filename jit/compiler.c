@@ -14,6 +14,7 @@
 #include "jit/compilation-unit.h"
 #include "jit/statement.h"
 #include "jit/bc-offset-mapping.h"
+#include "jit/compile-stats.h"
 #include "jit/exception.h"
 #include "jit/perf-map.h"
 #include "jit/subroutine.h"
@@ -59,36 +60,59 @@ static bool uses_array_ops(struct compilation_unit *cu)
 
 static int do_compile(struct compilation_unit *cu)
 {
+	struct compile_stats stats;
 	bool ssa_enable;
 	int err;
 
+	compile_stats_begin(&stats);
+
 	if (opt_print_compilation)
 		print_compilation(cu->method);
 
 	if (opt_trace_compile)
 		trace_method(cu);
 
+	compile_pass_begin(&stats, cu, PASS_INLINE_SUBROUTINES);
 	err = inline_subroutines(cu->method);
 	if (err)
 		goto out;
+	compile_pass_end(&stats, cu, PASS_INLINE_SUBROUTINES);
 
 	if (opt_trace_bytecode)
 		trace_bytecode(cu->method);
 
+	compile_pass_begin(&stats, cu, PASS_ANALYZE_CONTROL_FLOW);
 	err = analyze_control_flow(cu);
 	if (err)
 		goto out;
+	compile_pass_end(&stats, cu, PASS_ANALYZE_CONTROL_FLOW);
 
+	compile_pass_begin(&stats, cu, PASS_CONVERT_TO_IR);
 	err = convert_to_ir(cu);
 	if (err)
 		goto out;
+	compile_pass_end(&stats, cu, PASS_CONVERT_TO_IR);
 
 	ssa_enable = opt_ssa_enable && uses_array_ops(cu);
 
-	if (ssa_enable) {
+	if (uses_array_ops(cu)) {
+		compile_pass_begin(&stats, cu, PASS_DOMINATORS);
 		err = compute_dfns(cu);
 		if (err)
 			goto out;
+
+		err = compute_dom(cu);
+		if (err)
+			goto out;
+		compile_pass_end(&stats, cu, PASS_DOMINATORS);
+	}
+
+	if (opt_abc_enable && uses_array_ops(cu)) {
+		compile_pass_begin(&stats, cu, PASS_LOOP_ABC_REMOVAL);
+		err = loop_abc_removal(cu);
+		if (err)
+			goto out;
+		compile_pass_end(&stats, cu, PASS_LOOP_ABC_REMOVAL);
 	}
 
 	if (opt_trace_cfg)
@@ -97,20 +121,19 @@ static int do_compile(struct compilation_unit *cu)
 	if (opt_trace_tree_ir)
 		trace_tree_ir(cu);
 
+	compile_pass_begin(&stats, cu, PASS_SELECT_INSTRUCTIONS);
 	err = select_instructions(cu);
 	if (err)
 		goto out;
 
 	compute_insn_positions(cu);
+	compile_pass_end(&stats, cu, PASS_SELECT_INSTRUCTIONS);
 
 	if (opt_trace_lir)
 		trace_lir(cu);
 
 	if (ssa_enable) {
-		err = compute_dom(cu);
-		if (err)
-			goto out;
-
+		compile_pass_begin(&stats, cu, PASS_SSA);
 		err = compute_dom_frontier(cu);
 		if (err)
 			goto out;
@@ -133,55 +156,79 @@ static int do_compile(struct compilation_unit *cu)
 		err = ssa_to_lir(cu);
 		if (err)
 			goto out;
+		compile_pass_end(&stats, cu, PASS_SSA);
 	}
 
+	compile_pass_begin(&stats, cu, PASS_LIVENESS);
 	err = analyze_liveness(cu);
 	if (err)
 		goto out;
+	compile_pass_end(&stats, cu, PASS_LIVENESS);
 
 	if (opt_trace_liveness)
 		trace_liveness(cu);
 
+	compile_pass_begin(&stats, cu, PASS_ALLOCATE_REGISTERS);
 	err = allocate_registers(cu);
 	if (err)
 		goto out;
+	compile_pass_end(&stats, cu, PASS_ALLOCATE_REGISTERS);
 
+	compile_pass_begin(&stats, cu, PASS_MARK_CLOBBERS);
 	err = mark_clobbers(cu);
 	if (err)
 		goto out;
+	compile_pass_end(&stats, cu, PASS_MARK_CLOBBERS);
 
+	compile_pass_begin(&stats, cu, PASS_SPILL_RELOAD);
 	err = insert_spill_reload_insns(cu);
 	if (err)
 		goto out;
+	compile_pass_end(&stats, cu, PASS_SPILL_RELOAD);
 
 	if (opt_trace_regalloc)
 		trace_regalloc(cu);
 
+	compile_pass_begin(&stats, cu, PASS_INLINE_CACHE);
 	err = convert_ic_calls(cu);
 	if (err)
 		goto out;
+	compile_pass_end(&stats, cu, PASS_INLINE_CACHE);
 
 	assert(all_insn_have_bytecode_offset(cu));
 
+	compile_pass_begin(&stats, cu, PASS_PEEPHOLE);
 	err = peephole_optimize(cu);
 	if (err)
 		goto out;
+	compile_pass_end(&stats, cu, PASS_PEEPHOLE);
 
+	compile_pass_begin(&stats, cu, PASS_EMIT_CODE);
 	err = emit_machine_code(cu);
 	if (err)
 		goto out;
+	compile_pass_end(&stats, cu, PASS_EMIT_CODE);
 
+	compile_pass_begin(&stats, cu, PASS_BC_OFFSET_MAP);
 	err = build_bc_offset_map(cu);
 	if (err)
 		goto out;
+	compile_pass_end(&stats, cu, PASS_BC_OFFSET_MAP);
+
+	if (opt_trace_bytecode_offset)
+		trace_bc_offset_table(cu);
 
 	if (opt_trace_machine_code)
 		trace_machine_code(cu);
 
+	compile_pass_begin(&stats, cu, PASS_FIXUPS);
 	resolve_fixup_offsets(cu);
 
 	perf_append_cu(cu);
+	compile_pass_end(&stats, cu, PASS_FIXUPS);
   out:
+	compile_stats_end(&stats, cu, err);
+
 	if (opt_trace_compile)
 		trace_flush();
 
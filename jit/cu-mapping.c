@@ -63,3 +63,23 @@ struct compilation_unit *jit_lookup_cu(unsigned long addr)
 
 	return cu;
 }
+
+/*
+ * Same as jit_lookup_cu() but does not take the mapping lock. The garbage
+ * collector uses this while the world is stopped and must make sure that no
+ * thread was stopped while modifying the mapping.
+ */
+struct compilation_unit *__jit_lookup_cu(unsigned long addr)
+{
+	return radix_tree_lookup_prev(cu_map, addr);
+}
+
+void cu_mapping_read_lock(void)
+{
+	pthread_rwlock_rdlock(&cu_map_rwlock);
+}
+
+void cu_mapping_read_unlock(void)
+{
+	pthread_rwlock_unlock(&cu_map_rwlock);
+}
@@ -17,6 +17,10 @@
 #include "jit/gdb.h"
 #include "jit/text.h"
 
+#include "arch/text.h"
+
+#include "vm/system.h"
+
 #ifdef CONFIG_32_BIT
 
 typedef Elf32_Ehdr	elf_ehdr_t;
@@ -56,6 +60,8 @@ typedef Elf64_Sym	elf_sym_t;
 #define N_SECTIONS	5
 #define GDB_BUF_SIZE	(SHTABLE_START + N_SECTIONS * sizeof(Elf64_Shdr))
 
+/* The ELF image is in the code cache and written through its writable view. */
+static void *elf_text;
 static void *elf_buf;
 
 static elf_sym_t *symtab;
@@ -134,7 +140,7 @@ static void elf_init_sections(void)
 	shdr[3].sh_name		= 19;
 	shdr[3].sh_type		= SHT_PROGBITS;
 	shdr[3].sh_flags	= SHF_ALLOC | SHF_EXECINSTR;
-	shdr[3].sh_offset	= (unsigned long) (jit_text_ptr() - elf_buf);
+	shdr[3].sh_offset	= ALIGN(GDB_BUF_SIZE, TEXT_ALIGNMENT);
 	shdr[3].sh_size		= -1;	/* Maybe this needs to be fixed. */
 	shdr[3].sh_link		= SHN_UNDEF;
 	shdr[3].sh_info		= 0;
@@ -163,13 +169,13 @@ static void elf_init_sections(void)
 
 void *elf_init(void)
 {
-	elf_buf = jit_text_ptr();
-	jit_text_reserve(GDB_BUF_SIZE);
+	elf_text = jit_text_alloc(JIT_TEXT_COLD, GDB_BUF_SIZE);
+	elf_buf = jit_text_rw(elf_text);
 
 	elf_init_ehdr();
 	elf_init_sections();
 
-	return elf_buf;
+	return elf_text;
 }
 
 void elf_add_symbol(char *name, void *addr, size_t size)
@@ -195,7 +201,7 @@ void elf_add_symbol(char *name, void *addr, size_t size)
 
 size_t elf_get_size(void)
 {
-	return jit_text_ptr() - elf_buf;
+	return jit_text_top(JIT_TEXT_HOT) - elf_text;
 }
 
 #endif
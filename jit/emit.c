@@ -8,12 +8,14 @@
  */
 
 #include "arch/inline-cache.h"
+#include "arch/text.h"
 
 #include "lib/buffer.h"
 #include "vm/class.h"
 #include "vm/method.h"
 #include "vm/object.h"
 #include "vm/die.h"
+#include "vm/gc.h"
 #include "vm/vm.h"
 
 #include "jit/compilation-unit.h"
@@ -21,6 +23,7 @@
 #include "jit/compiler.h"
 #include "jit/emit-code.h"
 #include "jit/exception.h"
+#include "jit/gc-map.h"
 #include "jit/gdb.h"
 #include "jit/instruction.h"
 #include "jit/statement.h"
@@ -137,7 +140,14 @@ void emit_body(struct basic_block *bb, struct buffer *buf)
 	bb->is_emitted = true;
 
 	for_each_insn(insn, &bb->insn_list) {
+		/* emit_insn() overwrites the LIR position with the offset. */
+		unsigned long lir_pos = insn->lir_pos;
+		unsigned long start = buffer_offset(buf);
+
 		emit_insn(buf, bb, insn);
+
+		if (newgc_enabled && (insn->flags & INSN_FLAG_SAFEPOINT))
+			gc_map_add(bb->b_parent, insn, lir_pos, start, buffer_offset(buf));
 	}
 
 	if (opt_trace_machine_code)
@@ -180,6 +190,33 @@ static void process_call_fixup_sites(struct compilation_unit *cu)
 	}
 }
 
+/*
+ * Returns an upper bound for the size of the machine code of @cu. No LIR
+ * instruction expands to more than CODE_SIZE_PER_INSN bytes, including the
+ * out-of-line stubs some of them have.
+ */
+static unsigned long max_code_size(struct compilation_unit *cu)
+{
+	unsigned long size = CODE_SIZE_FIXED;
+	struct basic_block *bb;
+	struct insn *insn;
+
+	for_each_basic_block(bb, &cu->bb_list) {
+		size += CODE_SIZE_PER_BB;
+
+		for_each_insn(insn, &bb->insn_list)
+			size += CODE_SIZE_PER_INSN;
+	}
+
+	for_each_insn(insn, &cu->exit_bb->insn_list)
+		size += CODE_SIZE_PER_INSN;
+
+	for_each_insn(insn, &cu->unwind_bb->insn_list)
+		size += CODE_SIZE_PER_INSN;
+
+	return size;
+}
+
 int emit_machine_code(struct compilation_unit *cu)
 {
 	unsigned long frame_size;
@@ -192,9 +229,7 @@ int emit_machine_code(struct compilation_unit *cu)
 	if (!buf)
 		return warn("out of memory"), -ENOMEM;
 
-	jit_text_lock();
-
-	buf->buf = jit_text_ptr();
+	jit_text_begin(buf, JIT_TEXT_HOT, max_code_size(cu));
 	cu->objcode = buf;
 
 	frame_size = frame_locals_size(cu->stack_frame);
@@ -231,6 +266,10 @@ int emit_machine_code(struct compilation_unit *cu)
 	cu->unwind_past_unlock_ptr = buffer_current(cu->objcode);
 	emit_unwind(cu->objcode);
 
+	emit_array_check_stubs(cu);
+	emit_tlab_stubs(cu);
+	emit_monitor_stubs(cu);
+
 	for_each_basic_block(bb, &cu->bb_list) {
 		emit_resolution_blocks(bb, cu->objcode);
 	}
@@ -251,9 +290,7 @@ int emit_machine_code(struct compilation_unit *cu)
 		emit_ic_miss_handler(buf, ic_check, cu->method);
 	}
 
-	jit_text_reserve(buffer_offset(cu->objcode));
-
-	jit_text_unlock();
+	jit_text_end(cu->objcode);
 
 	gdb_register_method(cu->method);
 
@@ -286,6 +323,8 @@ struct jit_trampoline *alloc_jit_trampoline(void)
 
 void free_jit_trampoline(struct jit_trampoline *trampoline)
 {
+	if (trampoline->objcode)
+		jit_text_free(buffer_ptr(trampoline->objcode), buffer_offset(trampoline->objcode));
 	free_buffer(trampoline->objcode);
 	free(trampoline);
 }
@@ -0,0 +1,291 @@
+/*
+ * GC maps
+ *
+ * This file is released under the 2-clause BSD license. Please refer to the
+ * file LICENSE for details.
+ *
+ * A GC map tells the garbage collector where a method keeps references at a
+ * safepoint: which machine registers hold them and which words of the locals
+ * area of the stack frame may hold them. Maps are generated during code
+ * emission for every instruction that is marked as a safepoint. The map of a
+ * safepoint poll is found with the address of the poll instruction, which is
+ * where the thread faults, and the map of a call with the return address,
+ * which is what the collector finds when it walks the stack.
+ *
+ * Stack slots are classified by the type of the virtual registers that are
+ * stored to them. A word of the locals area is in the map if it is the spill
+ * slot of a reference that is live at the safepoint, a Java local variable
+ * that a reference is ever stored to or loaded from, the exception spill slot
+ * or a slot that caller-saved registers are saved to around calls. Slots that
+ * only hold primitive values are never looked at by the collector.
+ */
+
+#include "jit/gc-map.h"
+
+#include "jit/compilation-unit.h"
+#include "jit/basic-block.h"
+#include "jit/instruction.h"
+#include "jit/stack-slot.h"
+#include "jit/vars.h"
+
+#include "arch/stack-frame.h"
+
+#include "lib/bitset.h"
+
+#include "vm/stdlib.h"
+#include "vm/die.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned long slot_map_size(struct gc_map_table *table)
+{
+	return DIV_ROUND_UP(table->nr_slots, BITS_PER_LONG) * sizeof(unsigned long);
+}
+
+static void slot_map_set(struct gc_map_table *table, unsigned long *slot_map,
+			 struct stack_slot *slot)
+{
+	struct stack_frame *frame;
+	unsigned long word;
+
+	if (!slot)
+		return;
+
+	/* Arguments on the stack are in the frame of the caller. */
+	frame = slot->parent;
+	if (slot->index < frame->nr_args)
+		return;
+
+	word = slot->index - frame->nr_args;
+	if (word >= table->nr_slots)
+		return;
+
+	set_bit(slot_map, word);
+}
+
+static bool vm_type_is_pointer(enum vm_type type)
+{
+	return type == J_REFERENCE || type == J_NATIVE_PTR;
+}
+
+static bool operand_is_pointer(struct operand *operand)
+{
+	struct live_interval *it = operand->reg.interval;
+
+	return it && vm_type_is_pointer(it->var_info->vm_type);
+}
+
+static void init_fixed_slot_map(struct compilation_unit *cu, struct gc_map_table *table)
+{
+	unsigned long *map = table->fixed_slot_map;
+	struct basic_block *bb;
+	struct insn *insn;
+	unsigned int i;
+
+	for_each_basic_block(bb, &cu->bb_list) {
+		for_each_insn(insn, &bb->insn_list) {
+			switch (insn->type) {
+			case INSN_MOV_REG_MEMLOCAL:
+				if (operand_is_pointer(&insn->src))
+					slot_map_set(table, map, insn->dest.slot);
+				break;
+			case INSN_MOV_MEMLOCAL_REG:
+				if (operand_is_pointer(&insn->dest))
+					slot_map_set(table, map, insn->src.slot);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	slot_map_set(table, map, cu->exception_spill_slot);
+
+	for (i = 0; i < NR_GP_REGISTERS; i++)
+		slot_map_set(table, map, cu->clobber_slots[i]);
+}
+
+static struct gc_map_table *alloc_gc_map_table(struct compilation_unit *cu)
+{
+	struct gc_map_table *table;
+
+	table = zalloc(sizeof *table);
+	if (!table)
+		return NULL;
+
+	table->nr_slots = frame_locals_size(cu->stack_frame) / sizeof(unsigned long);
+
+	if (!table->nr_slots)
+		return table;
+
+	table->fixed_slot_map = zalloc(slot_map_size(table));
+	if (!table->fixed_slot_map) {
+		free(table);
+		return NULL;
+	}
+
+	init_fixed_slot_map(cu, table);
+
+	return table;
+}
+
+static struct live_interval *last_child(struct live_interval *it)
+{
+	while (it->next_child)
+		it = it->next_child;
+
+	return it;
+}
+
+/*
+ * Returns true if @var is live at @pos, either in a register or in one of its
+ * spill slots.
+ */
+static bool var_is_live_at(struct var_info *var, unsigned long pos)
+{
+	struct live_interval *first = var->interval;
+	struct live_interval *last = last_child(first);
+
+	if (interval_is_empty(first) || interval_is_empty(last))
+		return false;
+
+	return pos >= interval_start(first) && pos < interval_end(last);
+}
+
+static void gc_map_mark_live_vars(struct compilation_unit *cu, struct gc_map_table *table,
+				  struct gc_map *map, unsigned long pos)
+{
+	struct var_info *var;
+
+	for_each_variable(var, cu->var_infos) {
+		struct live_interval *it;
+
+		if (!vm_type_is_pointer(var->vm_type))
+			continue;
+
+		if (!var_is_live_at(var, pos))
+			continue;
+
+		for (it = var->interval; it != NULL; it = it->next_child) {
+			if (map->slot_map && interval_needs_spill(it))
+				slot_map_set(table, map->slot_map, it->spill_slot);
+
+			if (it->reg == MACH_REG_UNASSIGNED || it->reg >= NR_GP_REGISTERS)
+				continue;
+
+			if (interval_covers(it, pos))
+				set_bit(map->register_map, it->reg);
+		}
+	}
+}
+
+/*
+ * Records a GC map for safepoint instruction @insn which was emitted at
+ * [@start, @end) in the method code. @lir_pos is the LIR position of the
+ * instruction before emission overwrote it.
+ */
+void gc_map_add(struct compilation_unit *cu, struct insn *insn, unsigned long lir_pos,
+		unsigned long start, unsigned long end)
+{
+	struct gc_map_table *table = cu->gc_maps;
+	struct gc_map *map;
+
+	if (!table) {
+		table = cu->gc_maps = alloc_gc_map_table(cu);
+		if (!table)
+			die("out of memory");
+	}
+
+	if (table->nr_maps == table->max_maps) {
+		unsigned long max_maps = table->max_maps ? table->max_maps * 2 : 16;
+		struct gc_map *maps;
+
+		maps = realloc(table->maps, max_maps * sizeof(*maps));
+		if (!maps)
+			die("out of memory");
+
+		table->maps	= maps;
+		table->max_maps	= max_maps;
+	}
+
+	map = &table->maps[table->nr_maps];
+	memset(map, 0, sizeof(*map));
+
+	if (insn_is_call(insn)) {
+		map->type	= GC_MAP_CALL;
+		map->offset	= end;
+	} else {
+		map->type	= GC_MAP_POLL;
+		map->offset	= start;
+	}
+
+	if (table->nr_slots) {
+		map->slot_map = malloc(slot_map_size(table));
+		if (!map->slot_map)
+			die("out of memory");
+
+		memcpy(map->slot_map, table->fixed_slot_map, slot_map_size(table));
+	}
+
+	gc_map_mark_live_vars(cu, table, map, lir_pos);
+
+	/* Instructions are emitted in order so the table stays sorted. */
+	assert(table->nr_maps == 0 || table->maps[table->nr_maps - 1].offset <= map->offset);
+
+	table->nr_maps++;
+}
+
+/*
+ * Looks up the GC map of type @type at @offset in the code of @cu. This does
+ * not allocate memory or take locks so that it can be used while the world is
+ * stopped.
+ */
+struct gc_map *gc_map_lookup(struct compilation_unit *cu, unsigned long offset,
+			     enum gc_map_type type)
+{
+	struct gc_map_table *table = cu->gc_maps;
+	unsigned long lo, hi;
+
+	if (!table)
+		return NULL;
+
+	lo = 0;
+	hi = table->nr_maps;
+
+	while (lo < hi) {
+		unsigned long mid = lo + (hi - lo) / 2;
+
+		if (table->maps[mid].offset < offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	/* The return address of a call can be the address of the next poll. */
+	for (; lo < table->nr_maps && table->maps[lo].offset == offset; lo++) {
+		if (table->maps[lo].type == type)
+			return &table->maps[lo];
+	}
+
+	return NULL;
+}
+
+void free_gc_maps(struct compilation_unit *cu)
+{
+	struct gc_map_table *table = cu->gc_maps;
+	unsigned long i;
+
+	if (!table)
+		return;
+
+	for (i = 0; i < table->nr_maps; i++)
+		free(table->maps[i].slot_map);
+
+	free(table->maps);
+	free(table->fixed_slot_map);
+	free(table);
+
+	cu->gc_maps = NULL;
+}
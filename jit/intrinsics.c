@@ -0,0 +1,177 @@
+/*
+ * JIT intrinsics
+ *
+ * This file is released under the 2-clause BSD license. Please refer to the
+ * file LICENSE for details.
+ *
+ * Calls to some well-known library methods are replaced at bytecode parsing
+ * time with inline expressions or with direct calls to VM natives:
+ *
+ *   - Math.abs(), Math.min(), Math.max() and Math.sqrt() are converted to
+ *     unary and binary operators that map to a few machine instructions.
+ *     Floating point min() and max() are left alone because of the NaN and
+ *     negative zero rules.
+ *
+ *   - System.arraycopy() calls the VMSystem.arraycopy() VM native directly
+ *     instead of going through the Java wrapper.
+ *
+ *   - String.equals(), String.hashCode() and String.indexOf() are replaced
+ *     with VM natives in vm/preload.c. String is final so calls to them are
+ *     devirtualized here.
+ *
+ * Intrinsics are keyed by preloaded method pointers so that a lookup is a
+ * handful of pointer compares.
+ */
+
+#include "jit/intrinsics.h"
+
+#include "jit/expression.h"
+#include "jit/compiler.h"
+
+#include "vm/preload.h"
+#include "vm/method.h"
+#include "vm/system.h"
+#include "vm/die.h"
+
+#include "lib/stack.h"
+
+#include <errno.h>
+
+bool opt_use_intrinsics = true;
+
+static int convert_unary_intrinsic(struct parse_context *ctx, enum vm_type vm_type,
+				   enum unary_operator unary_operator)
+{
+	struct expression *expr, *arg;
+
+	arg = stack_pop(ctx->bb->mimic_stack);
+
+	expr = unary_op_expr(vm_type, unary_operator, arg);
+	if (!expr)
+		return warn("out of memory"), -ENOMEM;
+
+	convert_expression(ctx, expr);
+	return 0;
+}
+
+static int convert_binop_intrinsic(struct parse_context *ctx, enum vm_type vm_type,
+				   enum binary_operator binary_operator)
+{
+	struct expression *left, *right, *expr;
+
+	right = stack_pop(ctx->bb->mimic_stack);
+	left = stack_pop(ctx->bb->mimic_stack);
+
+	expr = binop_expr(vm_type, binary_operator, left, right);
+	if (!expr)
+		return warn("out of memory"), -ENOMEM;
+
+	convert_expression(ctx, expr);
+	return 0;
+}
+
+static int convert_iabs(struct parse_context *ctx, struct vm_method *target)
+{
+	return convert_unary_intrinsic(ctx, J_INT, OP_ABS);
+}
+
+static int convert_fabs(struct parse_context *ctx, struct vm_method *target)
+{
+	return convert_unary_intrinsic(ctx, J_FLOAT, OP_FABS);
+}
+
+static int convert_dabs(struct parse_context *ctx, struct vm_method *target)
+{
+	return convert_unary_intrinsic(ctx, J_DOUBLE, OP_DABS);
+}
+
+static int convert_dsqrt(struct parse_context *ctx, struct vm_method *target)
+{
+	return convert_unary_intrinsic(ctx, J_DOUBLE, OP_DSQRT);
+}
+
+static int convert_imin(struct parse_context *ctx, struct vm_method *target)
+{
+	return convert_binop_intrinsic(ctx, J_INT, OP_MIN);
+}
+
+static int convert_imax(struct parse_context *ctx, struct vm_method *target)
+{
+	return convert_binop_intrinsic(ctx, J_INT, OP_MAX);
+}
+
+#ifndef CONFIG_32_BIT
+static int convert_labs(struct parse_context *ctx, struct vm_method *target)
+{
+	return convert_unary_intrinsic(ctx, J_LONG, OP_ABS);
+}
+
+static int convert_lmin(struct parse_context *ctx, struct vm_method *target)
+{
+	return convert_binop_intrinsic(ctx, J_LONG, OP_MIN);
+}
+
+static int convert_lmax(struct parse_context *ctx, struct vm_method *target)
+{
+	return convert_binop_intrinsic(ctx, J_LONG, OP_MAX);
+}
+#endif
+
+static int convert_arraycopy(struct parse_context *ctx, struct vm_method *target)
+{
+	return convert_invoke_direct(ctx, vm_java_lang_VMSystem_arraycopy);
+}
+
+static int convert_string_call(struct parse_context *ctx, struct vm_method *target)
+{
+	return convert_invoke_direct(ctx, target);
+}
+
+static int convert_string_index_of(struct parse_context *ctx, struct vm_method *target)
+{
+	struct expression *from_index;
+
+	from_index = value_expr(J_INT, 0);
+	if (!from_index)
+		return warn("out of memory"), -ENOMEM;
+
+	convert_expression(ctx, from_index);
+
+	return convert_invoke_direct(ctx, vm_java_lang_String_indexOf_II);
+}
+
+static const struct intrinsic intrinsics[] = {
+	{ &vm_java_lang_Math_abs_I,		convert_iabs },
+	{ &vm_java_lang_Math_abs_F,		convert_fabs },
+	{ &vm_java_lang_Math_abs_D,		convert_dabs },
+	{ &vm_java_lang_Math_min_II,		convert_imin },
+	{ &vm_java_lang_Math_max_II,		convert_imax },
+	{ &vm_java_lang_Math_sqrt,		convert_dsqrt },
+#ifndef CONFIG_32_BIT
+	{ &vm_java_lang_Math_abs_J,		convert_labs },
+	{ &vm_java_lang_Math_min_JJ,		convert_lmin },
+	{ &vm_java_lang_Math_max_JJ,		convert_lmax },
+#endif
+	{ &vm_java_lang_System_arraycopy,	convert_arraycopy },
+	{ &vm_java_lang_String_equals,		convert_string_call },
+	{ &vm_java_lang_String_hashCode,	convert_string_call },
+	{ &vm_java_lang_String_indexOf_I,	convert_string_index_of },
+	{ &vm_java_lang_String_indexOf_II,	convert_string_call },
+};
+
+const struct intrinsic *lookup_intrinsic(struct vm_method *vmm)
+{
+	if (!opt_use_intrinsics)
+		return NULL;
+
+	if (vmm->class != vm_java_lang_Math && vmm->class != vm_java_lang_System &&
+	    vmm->class != vm_java_lang_String)
+		return NULL;
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(intrinsics); i++) {
+		if (*intrinsics[i].method == vmm)
+			return &intrinsics[i];
+	}
+
+	return NULL;
+}
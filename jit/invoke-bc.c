@@ -8,6 +8,7 @@
 
 #include "jit/bytecode-to-ir.h"
 
+#include "jit/intrinsics.h"
 #include "jit/exception.h"
 #include "jit/statement.h"
 #include "jit/compiler.h"
@@ -296,6 +297,7 @@ failed:
 
 int convert_invokevirtual(struct parse_context *ctx)
 {
+	const struct intrinsic *intrinsic;
 	struct vm_method *invoke_target;
 	struct statement *stmt;
 	int err = -ENOMEM;
@@ -304,6 +306,10 @@ int convert_invokevirtual(struct parse_context *ctx)
 	if (!invoke_target)
 		return warn("unable to resolve invocation target"), -EINVAL;
 
+	intrinsic = lookup_intrinsic(invoke_target);
+	if (intrinsic)
+		return intrinsic->convert(ctx, invoke_target);
+
 	stmt = invoke_stmt(ctx, STMT_INVOKEVIRTUAL, invoke_target);
 	if (!stmt)
 		return warn("out of memory"), -ENOMEM;
@@ -323,27 +329,27 @@ int convert_invokevirtual(struct parse_context *ctx)
 	return err;
 }
 
-int convert_invokespecial(struct parse_context *ctx)
+/**
+ * Converts a non-virtual call to @target whose arguments are on the mimic
+ * stack. The receiver of an instance method is null checked.
+ */
+int convert_invoke_direct(struct parse_context *ctx, struct vm_method *target)
 {
-	struct vm_method *invoke_target;
 	struct statement *stmt;
 	int err;
 
-	invoke_target = resolve_invoke_target(ctx, CAFEBABE_CLASS_ACC_STATIC);
-	if (!invoke_target)
-		return warn("unable to resolve invocation target"), -EINVAL;
-
-	stmt = invoke_stmt(ctx, STMT_INVOKE, invoke_target);
+	stmt = invoke_stmt(ctx, STMT_INVOKE, target);
 	if (!stmt)
 		return warn("out of memory"), -ENOMEM;
 
-	err = convert_and_add_args(ctx, invoke_target, stmt);
+	err = convert_and_add_args(ctx, target, stmt);
 	if (err)
 		goto failed;
 
-	null_check_this_arg(to_expr(stmt->args_list));
+	if (!vm_method_is_static(target))
+		null_check_this_arg(to_expr(stmt->args_list));
 
-	err = insert_before_args_stmt(ctx, invoke_target);
+	err = insert_before_args_stmt(ctx, target);
 	if (err)
 		goto failed;
 
@@ -354,31 +360,29 @@ int convert_invokespecial(struct parse_context *ctx)
 	return err;
 }
 
-int convert_invokestatic(struct parse_context *ctx)
+int convert_invokespecial(struct parse_context *ctx)
 {
 	struct vm_method *invoke_target;
-	struct statement *stmt;
-	int err;
 
 	invoke_target = resolve_invoke_target(ctx, CAFEBABE_CLASS_ACC_STATIC);
 	if (!invoke_target)
 		return warn("unable to resolve invocation target"), -EINVAL;
 
-	stmt = invoke_stmt(ctx, STMT_INVOKE, invoke_target);
-	if (!stmt)
-		return warn("out of memory"), -ENOMEM;
+	return convert_invoke_direct(ctx, invoke_target);
+}
 
-	err = convert_and_add_args(ctx, invoke_target, stmt);
-	if (err)
-		goto failed;
+int convert_invokestatic(struct parse_context *ctx)
+{
+	const struct intrinsic *intrinsic;
+	struct vm_method *invoke_target;
 
-	err = insert_before_args_stmt(ctx, invoke_target);
-	if (err)
-		goto failed;
+	invoke_target = resolve_invoke_target(ctx, CAFEBABE_CLASS_ACC_STATIC);
+	if (!invoke_target)
+		return warn("unable to resolve invocation target"), -EINVAL;
 
-	insert_invoke_stmt(ctx, stmt);
-	return 0;
-      failed:
-	free_statement(stmt);
-	return err;
+	intrinsic = lookup_intrinsic(invoke_target);
+	if (intrinsic)
+		return intrinsic->convert(ctx, invoke_target);
+
+	return convert_invoke_direct(ctx, invoke_target);
 }
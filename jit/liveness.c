@@ -15,6 +15,7 @@
 #include "lib/bitset.h"
 #include "vm/die.h"
 
+#include <assert.h>
 #include <errno.h>
 #include <stdlib.h>
 
@@ -57,79 +58,249 @@ static void __update_live_ranges(struct compilation_unit *cu, struct basic_block
 	}
 }
 
-static void update_live_ranges(struct compilation_unit *cu)
+/*
+ * Builds live intervals in one backward pass over the basic blocks like in
+ * Wimmer's linear scan: every variable that is live-out of a block is first
+ * live for the whole block and the instructions of the block then shorten
+ * the ranges at definitions and extend them at uses.
+ */
+static int update_live_ranges(struct compilation_unit *cu)
 {
+	struct var_info **vars, *var;
 	struct basic_block *this;
 
+	vars = calloc(cu->nr_vregs, sizeof(*vars));
+	if (!vars)
+		return warn("out of memory"), -ENOMEM;
+
+	for_each_variable(var, cu->var_infos)
+		vars[var->vreg] = var;
+
 	for_each_basic_block_reverse(this, &cu->bb_list) {
-		struct var_info *var;
+		struct bitset *live_out = this->live_out_set;
+		int vreg;
 
-		for_each_variable(var, cu->var_infos) {
-			if (test_bit(this->live_out_set->bits, var->vreg))
-				interval_add_range(cu, var->interval, this->start_insn, this->end_insn);
+		for (vreg = bitset_ffs(live_out); vreg >= 0; vreg = bitset_ffs_from(live_out, vreg + 1)) {
+			if (vars[vreg])
+				interval_add_range(cu, vars[vreg]->interval, this->start_insn, this->end_insn);
+
+			if ((unsigned long) vreg + 1 >= live_out->nr_bits)
+				break;
 		}
 
 		__update_live_ranges(cu, this);
 	}
+
+	free(vars);
+
+	return 0;
 }
 
-int analyze_live_sets(struct compilation_unit *cu)
+struct postorder_walk {
+	struct basic_block	**order;
+	unsigned long		nr_order;
+	struct basic_block	**stack;
+	unsigned long		*next_succ;
+	struct bitset		*visited;
+};
+
+static void postorder_walk(struct postorder_walk *w, struct basic_block *root)
 {
-	struct bitset *old_live_out_set = NULL;
-	struct bitset *old_live_in_set = NULL;
-	struct basic_block *this;
-	bool changed;
+	unsigned long sp = 0;
+
+	set_bit(w->visited->bits, root->postorder);
+	w->stack[0] = root;
+	w->next_succ[0] = 0;
+
+	for (;;) {
+		struct basic_block *bb = w->stack[sp];
+		struct basic_block *succ;
+
+		if (w->next_succ[sp] == bb->nr_successors) {
+			w->order[w->nr_order++] = bb;
+			if (!sp)
+				break;
+
+			sp--;
+			continue;
+		}
+
+		succ = bb->successors[w->next_succ[sp]++];
+		if (test_bit(w->visited->bits, succ->postorder))
+			continue;
+
+		set_bit(w->visited->bits, succ->postorder);
+		w->stack[++sp] = succ;
+		w->next_succ[sp] = 0;
+	}
+}
+
+/*
+ * Puts the basic blocks to @order in postorder of a depth-first walk of
+ * the CFG that starts from the entry block. Blocks that are not reachable
+ * from it, like exception handlers, start walks of their own.
+ */
+static int compute_postorder(struct compilation_unit *cu, struct basic_block **order,
+			     unsigned long nr_blocks)
+{
+	struct postorder_walk w;
+	struct basic_block *bb;
+	unsigned long i;
 	int err = 0;
 
-	old_live_in_set = alloc_bitset(cu->nr_vregs);
-	if (!old_live_in_set) {
+	w.order		= order;
+	w.nr_order	= 0;
+	w.stack		= malloc(nr_blocks * sizeof(*w.stack));
+	w.next_succ	= malloc(nr_blocks * sizeof(*w.next_succ));
+	w.visited	= alloc_bitset(nr_blocks);
+	if (!w.stack || !w.next_succ || !w.visited) {
 		err = -ENOMEM;
 		goto out;
 	}
 
-	old_live_out_set = alloc_bitset(cu->nr_vregs);
-	if (!old_live_out_set) {
+	/* The postorder field holds the list position during the walk.  */
+	i = 0;
+	for_each_basic_block(bb, &cu->bb_list)
+		bb->postorder = i++;
+
+	if (cu->entry_bb)
+		postorder_walk(&w, cu->entry_bb);
+
+	for_each_basic_block(bb, &cu->bb_list) {
+		if (!test_bit(w.visited->bits, bb->postorder))
+			postorder_walk(&w, bb);
+	}
+
+	assert(w.nr_order == nr_blocks);
+
+	for (i = 0; i < nr_blocks; i++)
+		order[i]->postorder = i;
+  out:
+	free(w.visited);
+	free(w.next_succ);
+	free(w.stack);
+	return err;
+}
+
+/*
+ * Recomputes the live-out and live-in sets of @bb from the live-in sets of
+ * its successors. Returns true if the live-in set changed.
+ */
+static bool update_live_sets(struct basic_block *bb, struct bitset *live_in)
+{
+	unsigned long i;
+
+	bitset_clear_all(bb->live_out_set);
+	for (i = 0; i < bb->nr_successors; i++)
+		bitset_union_to(bb->successors[i]->live_in_set, bb->live_out_set);
+
+	bitset_copy_to(bb->live_out_set, live_in);
+	bitset_sub(bb->def_set, live_in);
+	bitset_union_to(bb->use_set, live_in);
+
+	if (bitset_equal(live_in, bb->live_in_set))
+		return false;
+
+	bitset_copy_to(live_in, bb->live_in_set);
+
+	return true;
+}
+
+int analyze_live_sets(struct compilation_unit *cu)
+{
+	unsigned long *pred_start = NULL, *preds = NULL;
+	struct basic_block **order = NULL;
+	struct bitset *pending = NULL;
+	struct bitset *live_in = NULL;
+	unsigned long nr_blocks, nr_edges, i, j;
+	struct basic_block *this;
+	long ndx;
+	int err = 0;
+
+	nr_blocks = 0;
+	nr_edges = 0;
+	for_each_basic_block(this, &cu->bb_list) {
+		nr_blocks++;
+		nr_edges += this->nr_successors;
+	}
+
+	if (!nr_blocks)
+		return 0;
+
+	order		= malloc(nr_blocks * sizeof(*order));
+	pred_start	= calloc(nr_blocks + 1, sizeof(*pred_start));
+	preds		= malloc((nr_edges + 1) * sizeof(*preds));
+	pending		= alloc_bitset(nr_blocks);
+	live_in		= alloc_bitset(cu->nr_vregs);
+	if (!order || !pred_start || !preds || !pending || !live_in) {
 		err = -ENOMEM;
 		goto out;
 	}
 
+	err = compute_postorder(cu, order, nr_blocks);
+	if (err)
+		goto out;
+
 	/*
-	 * This is your standard text-book iterative liveness analysis
-	 * algorithm for computing live-in and live-out sets for each
-	 * basic block.
+	 * Predecessor lists in postorder numbering, derived from the successor
+	 * lists that the data flow equations use.
 	 */
-	do {
-		changed = false;
+	for (i = 0; i < nr_blocks; i++) {
+		for (j = 0; j < order[i]->nr_successors; j++)
+			pred_start[order[i]->successors[j]->postorder + 1]++;
+	}
 
-		for_each_basic_block_reverse(this, &cu->bb_list) {
-			struct basic_block *succ;
-			unsigned long i;
+	for (i = 0; i < nr_blocks; i++)
+		pred_start[i + 1] += pred_start[i];
 
-			bitset_copy_to(this->live_in_set, old_live_in_set);
-			bitset_copy_to(this->live_out_set, old_live_out_set);
+	for (i = 0; i < nr_blocks; i++) {
+		for (j = 0; j < order[i]->nr_successors; j++) {
+			unsigned long succ = order[i]->successors[j]->postorder;
 
-			bitset_copy_to(this->live_out_set, this->live_in_set);
-			bitset_sub(this->def_set, this->live_in_set);
-			bitset_union_to(this->use_set, this->live_in_set);
+			preds[pred_start[succ]++] = i;
+		}
+	}
 
-			bitset_clear_all(this->live_out_set);
-			for (i = 0; i < this->nr_successors; i++) {
-				succ = this->successors[i];
-				bitset_union_to(succ->live_in_set, this->live_out_set);
-			}
+	for (i = nr_blocks; i > 0; i--)
+		pred_start[i] = pred_start[i - 1];
+	pred_start[0] = 0;
+
+	/*
+	 * Liveness flows backwards so blocks are visited in postorder and a
+	 * block is revisited only when the live-in set of one of its
+	 * successors has changed. The scan for pending blocks continues from
+	 * where it left off so that loops are iterated in postorder as well.
+	 */
+	for (i = 0; i < nr_blocks; i++)
+		set_bit(pending->bits, i);
+
+	ndx = 0;
+	for (;;) {
+		if ((unsigned long) ndx >= nr_blocks)
+			ndx = 0;
+
+		ndx = bitset_ffs_from(pending, ndx);
+		if (ndx < 0) {
+			ndx = bitset_ffs(pending);
+			if (ndx < 0)
+				break;
+		}
+
+		clear_bit(pending->bits, ndx);
 
-			/*
-			 * If live-in or live-out set changed, we must
-			 * iterate at least once more.
-			 */
-			if (!bitset_equal(this->live_in_set, old_live_in_set) ||
-			    !bitset_equal(this->live_out_set, old_live_out_set))
-				changed = true;
+		if (update_live_sets(order[ndx], live_in)) {
+			for (j = pred_start[ndx]; j < pred_start[ndx + 1]; j++)
+				set_bit(pending->bits, preds[j]);
 		}
-	} while (changed);
+
+		ndx++;
+	}
   out:
-	free(old_live_out_set);
-	free(old_live_in_set);
+	free(live_in);
+	free(pending);
+	free(preds);
+	free(pred_start);
+	free(order);
 	return err;
 }
 
@@ -222,7 +393,7 @@ int analyze_liveness(struct compilation_unit *cu)
 	if (err)
 		goto out;
 
-	update_live_ranges(cu);
+	err = update_live_ranges(cu);
 
   out:
 	return err;
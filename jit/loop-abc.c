@@ -0,0 +1,554 @@
+/*
+ * Array bounds check elimination for loops
+ *
+ * This file is released under the 2-clause BSD license. Please refer to the
+ * file LICENSE for details.
+ *
+ * The pass works on the HIR in the default (non-SSA) pipeline and removes
+ * STMT_ARRAY_CHECK statements of the form a[i] where both a and i are local
+ * variables and the following holds:
+ *
+ *   - Every definition of i is either 'i = c' for a constant c >= 0 or
+ *     'i = i + 1' at a point where 'i < x.length' is known to hold. Thus i
+ *     can never be negative.
+ *
+ *   - The check is dominated by the edge of a conditional branch that tests
+ *     'i < a.length' and neither i nor a is redefined between the branch and
+ *     the check.
+ *
+ * This covers the canonical 'for (i = 0; i < a.length; i++)' loop that javac
+ * generates with the loop test at the bottom of the loop.
+ */
+
+#include "jit/compilation-unit.h"
+#include "jit/basic-block.h"
+#include "jit/expression.h"
+#include "jit/statement.h"
+#include "jit/compiler.h"
+
+#include "lib/bitset.h"
+
+#include "vm/method.h"
+#include "vm/types.h"
+
+#include <stdlib.h>
+#include <errno.h>
+
+bool opt_abc_enable = true;
+
+#define NO_LOCAL	(~0UL)
+
+enum nonneg_state {
+	NONNEG_UNKNOWN,
+	NONNEG_YES,
+	NONNEG_NO,
+};
+
+/*
+ * The edge from @guard_bb to @body_bb is taken only if the local variable
+ * @index is less than the length of the array in local variable @array.
+ */
+struct bounds_guard {
+	unsigned long		index;
+	unsigned long		array;
+	struct basic_block	*guard_bb;
+	struct basic_block	*body_bb;
+};
+
+struct abc_context {
+	struct compilation_unit	*cu;
+	struct bounds_guard	*guards;
+	unsigned long		nr_guards;
+	unsigned char		*nonneg;
+	struct bitset		*visited;
+	struct basic_block	**worklist;
+};
+
+typedef unsigned long (*resolve_fn)(struct basic_block *, struct statement *, struct expression *);
+
+static inline struct statement *stmt_entry(struct list_head *head)
+{
+	return list_entry(head, struct statement, stmt_list_node);
+}
+
+static bool stmt_defines_local(struct statement *stmt, unsigned long idx)
+{
+	struct expression *dest;
+
+	if (stmt_type(stmt) != STMT_STORE)
+		return false;
+
+	dest = to_expr(stmt->store_dest);
+
+	if (expr_type(dest) != EXPR_LOCAL && expr_type(dest) != EXPR_FLOAT_LOCAL)
+		return false;
+
+	if (dest->local_index == idx)
+		return true;
+
+	return vm_type_is_pair(dest->vm_type) && dest->local_index + 1 == idx;
+}
+
+static bool stmt_defines_temporary(struct statement *stmt, struct expression *tmp)
+{
+	struct expression *dest;
+
+	switch (stmt_type(stmt)) {
+	case STMT_STORE:
+		dest = to_expr(stmt->store_dest);
+		break;
+	case STMT_INVOKE:
+	case STMT_INVOKEVIRTUAL:
+	case STMT_INVOKEINTERFACE:
+		dest = stmt->invoke_result;
+		break;
+	default:
+		return false;
+	}
+
+	return dest && expr_type(dest) == EXPR_TEMPORARY && dest->tmp_low == tmp->tmp_low;
+}
+
+/*
+ * Returns true if local variable @idx is defined by a statement after @from
+ * and before @to in the same basic block.
+ */
+static bool local_redefined(struct statement *from, struct statement *to, unsigned long idx)
+{
+	struct list_head *pos;
+
+	for (pos = from->stmt_list_node.next; pos != &to->stmt_list_node; pos = pos->next) {
+		if (stmt_defines_local(stmt_entry(pos), idx))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Temporaries generated by bytecode conversion are defined in the same basic
+ * block before they are used. Look up the value of temporary @tmp at @stmt
+ * and return the local variable it is a copy of.
+ */
+static unsigned long resolve_temporary(struct basic_block *bb, struct statement *stmt,
+				       struct expression *tmp, resolve_fn resolve)
+{
+	struct list_head *pos;
+
+	for (pos = stmt->stmt_list_node.prev; pos != &bb->stmt_list; pos = pos->prev) {
+		struct statement *def = stmt_entry(pos);
+		unsigned long idx;
+
+		if (!stmt_defines_temporary(def, tmp))
+			continue;
+
+		if (stmt_type(def) != STMT_STORE)
+			return NO_LOCAL;
+
+		idx = resolve(bb, def, to_expr(def->store_src));
+		if (idx == NO_LOCAL || local_redefined(def, stmt, idx))
+			return NO_LOCAL;
+
+		return idx;
+	}
+
+	return NO_LOCAL;
+}
+
+/*
+ * Returns the local variable that @expr evaluates to at @stmt or NO_LOCAL
+ * if @expr is not a plain copy of one.
+ */
+static unsigned long resolve_local(struct basic_block *bb, struct statement *stmt, struct expression *expr)
+{
+	switch (expr_type(expr)) {
+	case EXPR_LOCAL:
+		if (vm_type_is_pair(expr->vm_type))
+			return NO_LOCAL;
+
+		return expr->local_index;
+	case EXPR_NULL_CHECK:
+		return resolve_local(bb, stmt, to_expr(expr->null_check_ref));
+	case EXPR_TEMPORARY:
+		return resolve_temporary(bb, stmt, expr, resolve_local);
+	default:
+		return NO_LOCAL;
+	}
+}
+
+/*
+ * Returns the local variable whose array length @expr evaluates to at @stmt
+ * or NO_LOCAL.
+ */
+static unsigned long resolve_arraylength(struct basic_block *bb, struct statement *stmt, struct expression *expr)
+{
+	switch (expr_type(expr)) {
+	case EXPR_ARRAYLENGTH:
+		return resolve_local(bb, stmt, to_expr(expr->arraylength_ref));
+	case EXPR_TEMPORARY:
+		return resolve_temporary(bb, stmt, expr, resolve_arraylength);
+	default:
+		return NO_LOCAL;
+	}
+}
+
+static inline bool bb_is_reachable(struct compilation_unit *cu, struct basic_block *bb)
+{
+	return bb == cu->entry_bb || bb->dfn;
+}
+
+static bool dominates(struct compilation_unit *cu, struct basic_block *dom, struct basic_block *bb)
+{
+	if (!bb_is_reachable(cu, bb))
+		return false;
+
+	while (bb != dom) {
+		if (bb == cu->entry_bb)
+			return false;
+
+		bb = cu->doms[bb->dfn];
+	}
+
+	return true;
+}
+
+static struct basic_block *fallthrough_successor(struct basic_block *bb, struct basic_block *if_true)
+{
+	if (bb->nr_successors != 2)
+		return NULL;
+
+	if (bb->successors[0] == if_true)
+		return bb->successors[1];
+
+	if (bb->successors[1] == if_true)
+		return bb->successors[0];
+
+	return NULL;
+}
+
+static bool collect_guard(struct basic_block *bb, struct bounds_guard *guard)
+{
+	struct basic_block *body, *fallthrough;
+	struct expression *cond, *left, *right;
+	struct statement *stmt;
+
+	if (list_is_empty(&bb->stmt_list))
+		return false;
+
+	stmt = stmt_entry(bb->stmt_list.prev);
+	if (stmt_type(stmt) != STMT_IF)
+		return false;
+
+	cond = to_expr(stmt->if_conditional);
+	if (expr_type(cond) != EXPR_BINOP || cond->vm_type != J_INT)
+		return false;
+
+	fallthrough = fallthrough_successor(bb, stmt->if_true);
+	if (!fallthrough || fallthrough == stmt->if_true)
+		return false;
+
+	left	= to_expr(cond->binary_left);
+	right	= to_expr(cond->binary_right);
+
+	switch (expr_bin_op(cond)) {
+	case OP_LT:
+		body = stmt->if_true;
+		break;
+	case OP_GE:
+		body = fallthrough;
+		break;
+	case OP_GT:
+		body = stmt->if_true;
+		left = to_expr(cond->binary_right);
+		right = to_expr(cond->binary_left);
+		break;
+	case OP_LE:
+		body = fallthrough;
+		left = to_expr(cond->binary_right);
+		right = to_expr(cond->binary_left);
+		break;
+	default:
+		return false;
+	}
+
+	/*
+	 * The condition only holds in the body if the guard is the sole way
+	 * to enter it.
+	 */
+	if (body->nr_predecessors != 1 || body->predecessors[0] != bb)
+		return false;
+
+	guard->index	= resolve_local(bb, stmt, left);
+	guard->array	= resolve_arraylength(bb, stmt, right);
+	guard->guard_bb	= bb;
+	guard->body_bb	= body;
+
+	return guard->index != NO_LOCAL && guard->array != NO_LOCAL;
+}
+
+static bool block_defines(struct basic_block *bb, unsigned long index, unsigned long array)
+{
+	struct statement *stmt;
+
+	list_for_each_entry(stmt, &bb->stmt_list, stmt_list_node) {
+		if (stmt_defines_local(stmt, index) || stmt_defines_local(stmt, array))
+			return true;
+	}
+
+	return false;
+}
+
+static void push_predecessors(struct abc_context *ctx, struct basic_block *bb, unsigned long *nr)
+{
+	unsigned int i;
+
+	for (i = 0; i < bb->nr_predecessors; i++) {
+		struct basic_block *pred = bb->predecessors[i];
+
+		if (!bb_is_reachable(ctx->cu, pred))
+			continue;
+
+		if (test_bit(ctx->visited->bits, pred->dfn))
+			continue;
+
+		set_bit(ctx->visited->bits, pred->dfn);
+		ctx->worklist[(*nr)++] = pred;
+	}
+}
+
+/*
+ * Returns true if @index or @array may be redefined on some path from the
+ * entry of @top to @stmt in @bb. @top must dominate @bb so the backwards walk
+ * never leaves the region dominated by @top.
+ */
+static bool path_redefines(struct abc_context *ctx, struct basic_block *top,
+			   struct basic_block *bb, struct statement *stmt,
+			   unsigned long index, unsigned long array)
+{
+	unsigned long nr = 0;
+	struct list_head *pos;
+
+	for (pos = bb->stmt_list.next; pos != &stmt->stmt_list_node; pos = pos->next) {
+		struct statement *s = stmt_entry(pos);
+
+		if (stmt_defines_local(s, index) || stmt_defines_local(s, array))
+			return true;
+	}
+
+	if (bb == top)
+		return false;
+
+	bitset_clear_all(ctx->visited);
+
+	push_predecessors(ctx, bb, &nr);
+
+	while (nr) {
+		bb = ctx->worklist[--nr];
+
+		if (block_defines(bb, index, array))
+			return true;
+
+		if (bb != top)
+			push_predecessors(ctx, bb, &nr);
+	}
+
+	return false;
+}
+
+static bool guard_holds(struct abc_context *ctx, struct bounds_guard *guard,
+			struct basic_block *bb, struct statement *stmt,
+			unsigned long index, unsigned long array)
+{
+	if (guard->index != index)
+		return false;
+
+	if (array != NO_LOCAL && guard->array != array)
+		return false;
+
+	if (!dominates(ctx->cu, guard->body_bb, bb))
+		return false;
+
+	return !path_redefines(ctx, guard->body_bb, bb, stmt, guard->index, guard->array);
+}
+
+/*
+ * Returns true if 'index < x.length' holds at @stmt for the given array
+ * local variable or for any array if @array is NO_LOCAL.
+ */
+static bool index_is_bounded(struct abc_context *ctx, struct basic_block *bb,
+			     struct statement *stmt, unsigned long index,
+			     unsigned long array)
+{
+	unsigned long i;
+
+	for (i = 0; i < ctx->nr_guards; i++) {
+		if (guard_holds(ctx, &ctx->guards[i], bb, stmt, index, array))
+			return true;
+	}
+
+	return false;
+}
+
+static bool is_int_value(struct expression *expr, int value)
+{
+	return expr_type(expr) == EXPR_VALUE && (int32_t) expr->value == value;
+}
+
+static bool is_nonnegative_def(struct abc_context *ctx, struct basic_block *bb,
+			       struct statement *stmt, unsigned long index)
+{
+	struct expression *dest, *src, *left, *right;
+
+	dest = to_expr(stmt->store_dest);
+	if (expr_type(dest) != EXPR_LOCAL || dest->vm_type != J_INT || dest->local_index != index)
+		return false;
+
+	src = to_expr(stmt->store_src);
+	if (expr_type(src) == EXPR_VALUE)
+		return (int32_t) src->value >= 0;
+
+	if (expr_type(src) != EXPR_BINOP || expr_bin_op(src) != OP_ADD)
+		return false;
+
+	left	= to_expr(src->binary_left);
+	right	= to_expr(src->binary_right);
+
+	if (is_int_value(left, 1)) {
+		left	= to_expr(src->binary_right);
+		right	= to_expr(src->binary_left);
+	}
+
+	if (!is_int_value(right, 1) || resolve_local(bb, stmt, left) != index)
+		return false;
+
+	/*
+	 * 'index + 1' can not overflow if 'index' is less than some array
+	 * length at this point.
+	 */
+	return index_is_bounded(ctx, bb, stmt, index, NO_LOCAL);
+}
+
+static bool index_is_nonnegative(struct abc_context *ctx, unsigned long index)
+{
+	struct compilation_unit *cu = ctx->cu;
+	struct basic_block *bb;
+	struct statement *stmt;
+
+	if (ctx->nonneg[index] != NONNEG_UNKNOWN)
+		return ctx->nonneg[index] == NONNEG_YES;
+
+	/* Arguments can have any value on entry. */
+	ctx->nonneg[index] = NONNEG_NO;
+
+	if (index < (unsigned long) cu->method->args_count)
+		return false;
+
+	for_each_basic_block(bb, &cu->bb_list) {
+		list_for_each_entry(stmt, &bb->stmt_list, stmt_list_node) {
+			if (!stmt_defines_local(stmt, index))
+				continue;
+
+			if (!is_nonnegative_def(ctx, bb, stmt, index))
+				return false;
+		}
+	}
+
+	ctx->nonneg[index] = NONNEG_YES;
+
+	return true;
+}
+
+static bool array_check_is_redundant(struct abc_context *ctx, struct basic_block *bb, struct statement *stmt)
+{
+	struct expression *deref;
+	unsigned long index, array;
+
+	deref = to_expr(stmt->expression);
+	if (expr_type(deref) != EXPR_ARRAY_DEREF)
+		return false;
+
+	array = resolve_local(bb, stmt, to_expr(deref->arrayref));
+	if (array == NO_LOCAL)
+		return false;
+
+	index = resolve_local(bb, stmt, to_expr(deref->array_index));
+	if (index == NO_LOCAL)
+		return false;
+
+	if (!index_is_nonnegative(ctx, index))
+		return false;
+
+	return index_is_bounded(ctx, bb, stmt, index, array);
+}
+
+static void do_loop_abc_removal(struct abc_context *ctx)
+{
+	struct compilation_unit *cu = ctx->cu;
+	unsigned long nr_checks = 0, nr_removed = 0;
+	struct statement *stmt, *tmp;
+	struct basic_block *bb;
+
+	for_each_basic_block(bb, &cu->bb_list) {
+		if (collect_guard(bb, &ctx->guards[ctx->nr_guards]))
+			ctx->nr_guards++;
+	}
+
+	for_each_basic_block(bb, &cu->bb_list) {
+		list_for_each_entry_safe(stmt, tmp, &bb->stmt_list, stmt_list_node) {
+			if (stmt_type(stmt) != STMT_ARRAY_CHECK)
+				continue;
+
+			nr_checks++;
+
+			if (!ctx->nr_guards || !array_check_is_redundant(ctx, bb, stmt))
+				continue;
+
+			list_del(&stmt->stmt_list_node);
+			free_statement(stmt);
+			nr_removed++;
+		}
+	}
+
+	if (opt_trace_abc)
+		trace_abc(cu, nr_checks, nr_removed);
+}
+
+int loop_abc_removal(struct compilation_unit *cu)
+{
+	struct abc_context ctx = { .cu = cu };
+	int err = -ENOMEM;
+
+	/*
+	 * Exception edges are not part of the CFG that dominance is computed
+	 * for so don't bother with methods that have exception handlers.
+	 */
+	if (cu->method->code_attribute.exception_table_length)
+		return 0;
+
+	ctx.guards = calloc(nr_bblocks(cu), sizeof(struct bounds_guard));
+	if (!ctx.guards)
+		goto out;
+
+	ctx.nonneg = calloc(cu->method->code_attribute.max_locals, 1);
+	if (!ctx.nonneg)
+		goto out;
+
+	ctx.visited = alloc_bitset(nr_bblocks(cu));
+	if (!ctx.visited)
+		goto out;
+
+	ctx.worklist = malloc(sizeof(struct basic_block *) * nr_bblocks(cu));
+	if (!ctx.worklist)
+		goto out;
+
+	do_loop_abc_removal(&ctx);
+
+	err = 0;
+out:
+	free(ctx.worklist);
+	free(ctx.visited);
+	free(ctx.nonneg);
+	free(ctx.guards);
+
+	return err;
+}
@@ -403,7 +403,14 @@ int convert_newarray(struct parse_context *ctx)
 	size = stack_pop(ctx->bb->mimic_stack);
 	type = bytecode_read_u8(ctx->buffer);
 
-	size_check = array_size_check_expr(size);
+	/*
+	 * Constant non-negative sizes need no check and let the instruction
+	 * selector allocate small arrays inline.
+	 */
+	if (expr_type(size) == EXPR_VALUE && (int32_t) size->value >= 0)
+		size_check = size;
+	else
+		size_check = array_size_check_expr(size);
 	if (!size_check)
 		return warn("out of memory"), -ENOMEM;
 
@@ -3,8 +3,31 @@
  *
  * This file is released under the 2-clause BSD license. Please refer to the
  * file LICENSE for details.
+ *
+ * JIT code cache
+ *
+ * All machine code that the JIT generates lives in one range of address space
+ * that is reserved when the VM starts. The range is split into two regions:
+ * the cold region holds trampolines and stubs and the hot region holds method
+ * bodies so that the code that runs most is packed together.
+ *
+ * Every thread that emits code owns a window in each region and emits into
+ * it without locking. When a window runs out, the thread claims a new chunk
+ * by bumping the top of the region with compare-and-swap or takes a range
+ * that has been freed. Code is freed with jit_text_free() when the
+ * compilation unit that owns it is discarded and the unused part of a window
+ * is freed when the thread that owns it exits. Freed ranges are kept on a
+ * list that is sorted by address and adjacent ranges are merged.
+ *
+ * The memory is mapped twice so that no page is both writable and
+ * executable: code runs from the read-only view and is written through the
+ * writable view. Buffers that are handed out by jit_text_begin() point to
+ * the executable view and write through the other one (see lib/buffer.h)
+ * and code is patched at run time with jit_text_write_u32(). If the memory
+ * can't be mapped twice, one writable and executable mapping is used.
  */
 
+#include <sys/syscall.h>
 #include <sys/mman.h>
 #include <pthread.h>
 #include <stdbool.h>
@@ -12,26 +35,271 @@
 #include <stdlib.h>
 #include <assert.h>
 
+#include "arch/cmpxchg.h"
 #include "arch/text.h"
 #include "jit/text.h"
 
+#include "lib/buffer.h"
+
 #include "vm/system.h"
 #include "vm/alloc.h"
 #include "vm/die.h"
 
-#define MAX_TEXT_SIZE (256 * 1024 * 1024) /* 256 MB */
+#define MAX_TEXT_SIZE	(256 * 1024 * 1024)	/* 256 MB */
+#define COLD_TEXT_SIZE	(64 * 1024 * 1024)	/* 64 MB */
 
-static pthread_mutex_t jit_text_mutex = PTHREAD_MUTEX_INITIALIZER;
-static unsigned long jit_text_offset;
-static void *jit_text;
+/* Amount of text a thread claims from the top of a region at a time */
+#define TEXT_CHUNK_SIZE	(256 * 1024)		/* 256 KB */
 
-void jit_text_init(void)
+struct text_range {
+	unsigned long		start;
+	unsigned long		end;
+	struct text_range	*next;
+};
+
+struct text_region {
+	unsigned long		start;
+	unsigned long		end;
+	volatile unsigned long	top;
+
+	pthread_mutex_t		free_mutex;
+	struct text_range	*free_list;
+};
+
+/* The part of a region that a thread emits code into */
+struct text_window {
+	unsigned long		ptr;
+	unsigned long		end;
+	bool			busy;
+};
+
+static struct text_region	jit_text_regions[JIT_TEXT_NR_REGIONS];
+static void			*jit_text;
+
+unsigned long			jit_text_rw_delta;
+
+static __thread struct text_window jit_text_windows[JIT_TEXT_NR_REGIONS];
+
+static pthread_key_t		jit_text_key;
+
+static struct text_region *text_region_of(unsigned long addr)
+{
+	unsigned int i;
+
+	for (i = 0; i < JIT_TEXT_NR_REGIONS; i++) {
+		struct text_region *r = &jit_text_regions[i];
+
+		if (addr >= r->start && addr < r->end)
+			return r;
+	}
+
+	return NULL;
+}
+
+static void text_region_free(struct text_region *r, unsigned long start, unsigned long end)
+{
+	struct text_range **prev, *next, *range;
+
+	if (start >= end)
+		return;
+
+	pthread_mutex_lock(&r->free_mutex);
+
+	for (prev = &r->free_list; *prev != NULL; prev = &(*prev)->next) {
+		if ((*prev)->start >= end)
+			break;
+	}
+
+	next = *prev;
+
+	if (next && next->start == end) {
+		next->start = start;
+		range = next;
+	} else {
+		range = malloc(sizeof *range);
+		if (!range) {
+			/* The memory is leaked but nothing breaks. */
+			pthread_mutex_unlock(&r->free_mutex);
+			return;
+		}
+
+		range->start	= start;
+		range->end	= end;
+		range->next	= next;
+		*prev		= range;
+	}
+
+	/* Merge with the previous range if it ends where this one starts. */
+	if (prev != &r->free_list) {
+		struct text_range *before = container_of(prev, struct text_range, next);
+
+		if (before->end == range->start) {
+			before->end	= range->end;
+			before->next	= range->next;
+			free(range);
+		}
+	}
+
+	pthread_mutex_unlock(&r->free_mutex);
+}
+
+/*
+ * Takes the first freed range that is at least @size bytes long.
+ */
+static bool text_region_reuse(struct text_region *r, unsigned long size,
+			      struct text_window *w)
+{
+	struct text_range **prev, *range;
+	bool found = false;
+
+	if (!r->free_list)
+		return false;
+
+	pthread_mutex_lock(&r->free_mutex);
+
+	for (prev = &r->free_list; (range = *prev) != NULL; prev = &range->next) {
+		if (range->end - range->start < size)
+			continue;
+
+		w->ptr	= range->start;
+		w->end	= range->end;
+		*prev	= range->next;
+		free(range);
+		found	= true;
+		break;
+	}
+
+	pthread_mutex_unlock(&r->free_mutex);
+
+	return found;
+}
+
+static bool text_region_claim(struct text_region *r, unsigned long size,
+			      struct text_window *w)
+{
+	unsigned long top, new_top;
+
+	size = ALIGN(size, TEXT_CHUNK_SIZE);
+
+	do {
+		top	= r->top;
+		new_top	= top + size;
+
+		if (new_top > r->end)
+			return false;
+	} while (cmpxchg_ptr((void *) &r->top, (void *) top, (void *) new_top) != (void *) top);
+
+	w->ptr	= top;
+	w->end	= new_top;
+
+	return true;
+}
+
+static void text_window_refill(enum jit_text_region region, struct text_window *w,
+			       unsigned long size)
+{
+	struct text_region *r = &jit_text_regions[region];
+	unsigned long old_ptr = w->ptr, old_end = w->end;
+
+	/* Make sure the window is given back when the thread exits. */
+	if (!old_end)
+		pthread_setspecific(jit_text_key, jit_text_windows);
+
+	if (!text_region_reuse(r, size, w) && !text_region_claim(r, size, w))
+		die("out of memory for JIT code");
+
+	text_region_free(r, old_ptr, old_end);
+}
+
+static void jit_text_thread_exit(void *arg)
+{
+	struct text_window *windows = arg;
+	unsigned int i;
+
+	for (i = 0; i < JIT_TEXT_NR_REGIONS; i++) {
+		struct text_window *w = &windows[i];
+
+		text_region_free(&jit_text_regions[i], w->ptr, w->end);
+		w->ptr = w->end = 0;
+	}
+}
+
+static int jit_text_open(void)
 {
-	jit_text = mmap(NULL, MAX_TEXT_SIZE,
-			PROT_READ | PROT_WRITE | PROT_EXEC,
-			MAP_PRIVATE | MAP_ANONYMOUS | TEXT_MAP_FLAGS, -1, 0);
+#ifdef __NR_memfd_create
+	return syscall(__NR_memfd_create, "jato-text", 0);
+#else
+	return -1;
+#endif
+}
+
+/*
+ * Maps the code cache as a read-only executable view and a writable view of
+ * the same memory. Returns false if that can't be done.
+ */
+static bool jit_text_map_views(void)
+{
+	void *rw;
+	int fd;
+
+	fd = jit_text_open();
+	if (fd < 0)
+		return false;
+
+	if (ftruncate(fd, MAX_TEXT_SIZE) < 0)
+		goto out_close;
+
+	jit_text = mmap(NULL, MAX_TEXT_SIZE, PROT_READ | PROT_EXEC,
+			MAP_SHARED | TEXT_MAP_FLAGS, fd, 0);
 	if (jit_text == MAP_FAILED)
-		die("mmap");
+		goto out_close;
+
+	rw = mmap(NULL, MAX_TEXT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (rw == MAP_FAILED) {
+		munmap(jit_text, MAX_TEXT_SIZE);
+		goto out_close;
+	}
+
+	close(fd);
+
+	jit_text_rw_delta = rw - jit_text;
+
+	return true;
+
+out_close:
+	close(fd);
+	return false;
+}
+
+void jit_text_init(void)
+{
+	unsigned long base;
+	unsigned int i;
+
+	if (!jit_text_map_views()) {
+		jit_text = mmap(NULL, MAX_TEXT_SIZE,
+				PROT_READ | PROT_WRITE | PROT_EXEC,
+				MAP_PRIVATE | MAP_ANONYMOUS | TEXT_MAP_FLAGS, -1, 0);
+		if (jit_text == MAP_FAILED)
+			die("mmap");
+	}
+
+	base = (unsigned long) jit_text;
+
+	jit_text_regions[JIT_TEXT_COLD].start	= base;
+	jit_text_regions[JIT_TEXT_COLD].end	= base + COLD_TEXT_SIZE;
+	jit_text_regions[JIT_TEXT_HOT].start	= base + COLD_TEXT_SIZE;
+	jit_text_regions[JIT_TEXT_HOT].end	= base + MAX_TEXT_SIZE;
+
+	for (i = 0; i < JIT_TEXT_NR_REGIONS; i++) {
+		struct text_region *r = &jit_text_regions[i];
+
+		r->top = r->start;
+		pthread_mutex_init(&r->free_mutex, NULL);
+	}
+
+	if (pthread_key_create(&jit_text_key, jit_text_thread_exit) != 0)
+		die("pthread_key_create");
 }
 
 bool is_jit_text(void *p)
@@ -39,28 +307,91 @@ bool is_jit_text(void *p)
 	return p >= jit_text && p <= (jit_text + MAX_TEXT_SIZE);
 }
 
-void jit_text_lock(void)
+/*
+ * Prepares @buf for emitting at most @max_size bytes of code to @region. The
+ * code is emitted to the window of the current thread which is not shared
+ * with other threads so no locking is needed until jit_text_end().
+ */
+void jit_text_begin(struct buffer *buf, enum jit_text_region region, size_t max_size)
 {
-	if (pthread_mutex_lock(&jit_text_mutex) != 0)
-		die("pthread_mutex_lock");
+	struct text_window *w = &jit_text_windows[region];
+
+	assert(!w->busy);
+
+	if (w->end - w->ptr < max_size)
+		text_window_refill(region, w, max_size);
+
+	w->busy = true;
+
+	buf->buf		= (void *) w->ptr;
+	buf->offset		= 0;
+	buf->size		= w->end - w->ptr;
+	buf->write_delta	= jit_text_rw_delta;
 }
 
-void jit_text_unlock(void)
+/*
+ * Finishes emitting to @buf. The code that was emitted stays allocated until
+ * it is freed with jit_text_free().
+ */
+void jit_text_end(struct buffer *buf)
 {
-	if (pthread_mutex_unlock(&jit_text_mutex) != 0)
-		die("pthread_mutex_lock");
+	struct text_region *r = text_region_of((unsigned long) buffer_ptr(buf));
+	struct text_window *w = &jit_text_windows[r - jit_text_regions];
+	unsigned long size;
+
+	assert(w->busy);
+
+	size = ALIGN(buffer_offset(buf), TEXT_ALIGNMENT);
+	if (size > w->end - w->ptr)
+		size = w->end - w->ptr;
+
+	buf->size	= buffer_offset(buf);
+	w->ptr		+= size;
+	w->busy		= false;
 }
 
-void *jit_text_ptr(void)
+/*
+ * Allocates @size bytes of text that is not emitted with a buffer.
+ */
+void *jit_text_alloc(enum jit_text_region region, size_t size)
 {
-	return jit_text + jit_text_offset;
+	struct text_window *w = &jit_text_windows[region];
+	unsigned long p;
+
+	assert(!w->busy);
+
+	if (w->end - w->ptr < size)
+		text_window_refill(region, w, size);
+
+	p = w->ptr;
+	w->ptr += ALIGN(size, TEXT_ALIGNMENT);
+	if (w->ptr > w->end)
+		w->ptr = w->end;
+
+	return (void *) p;
 }
 
-void jit_text_reserve(size_t size)
+/*
+ * Frees @size bytes of code at @p. The caller must make sure that no thread
+ * executes the code anymore.
+ */
+void jit_text_free(void *p, size_t size)
 {
-	jit_text_offset += ALIGN(size, TEXT_ALIGNMENT);
+	struct text_region *r = text_region_of((unsigned long) p);
+	unsigned long start = (unsigned long) p;
 
-	assert(jit_text_offset < MAX_TEXT_SIZE);
+	if (!r || !size)
+		return;
+
+	text_region_free(r, start, start + ALIGN(size, TEXT_ALIGNMENT));
+}
+
+/*
+ * Returns the end of the text that has been claimed from @region.
+ */
+void *jit_text_top(enum jit_text_region region)
+{
+	return (void *) jit_text_regions[region].top;
 }
 
 void *alloc_pages(int n)
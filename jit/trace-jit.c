@@ -48,6 +48,7 @@ bool opt_trace_gate;
 regex_t method_trace_gate_regex;
 
 bool opt_trace_ssa;
+bool opt_trace_abc;
 bool opt_trace_cfg;
 bool opt_trace_tree_ir;
 bool opt_trace_lir;
@@ -217,6 +218,18 @@ void trace_ssa(struct compilation_unit *cu)
 
 }
 
+void trace_abc(struct compilation_unit *cu, unsigned long nr_checks, unsigned long nr_removed)
+{
+	struct vm_method *method = cu->method;
+
+	if (!cu_matches_regex(cu))
+		return;
+
+	trace_printf("ABC: %s.%s%s: removed %lu of %lu array bounds checks\n",
+		method->class->name, method->name, method->type,
+		nr_removed, nr_checks);
+}
+
 void trace_cfg(struct compilation_unit *cu)
 {
 	struct basic_block *bb;
@@ -74,36 +74,24 @@ static void *jit_java_trampoline(struct compilation_unit *cu)
 	return cu_entry_point(cu);
 }
 
-void *jit_magic_trampoline(struct compilation_unit *cu)
+/*
+ * Compiles @cu unless some other thread has already done it and returns the
+ * entry point of the method. Returns NULL with an exception pending if
+ * compilation fails. Callers are responsible for patching call sites with
+ * fixup_direct_calls().
+ */
+void *jit_compile(struct compilation_unit *cu)
 {
-	struct vm_method *method = cu->method;
-	unsigned long state;
 	void *ret;
 
-	if (opt_debug_stack)
-		check_stack_align(method);
-
-	if (opt_trace_magic_trampoline)
-		trace_magic_trampoline(cu);
-
-	if (vm_method_is_static(method)) {
-		/* This is for "invokestatic"... */
-		if (vm_class_ensure_init(method->class))
-			return rethrow_exception();
-	}
-
-	state = compilation_unit_get_state(cu);
-
-	if (state == COMPILATION_STATE_COMPILED) {
-		ret = cu_entry_point(cu);
-		goto out_fixup;
-	}
+	if (compilation_unit_get_state(cu) == COMPILATION_STATE_COMPILED)
+		return cu_entry_point(cu);
 
 	pthread_mutex_lock(&cu->compile_mutex);
 
 	if (cu->state == COMPILATION_STATE_COMPILED) {
 		ret = cu_entry_point(cu);
-		goto out_unlock_fixup;
+		goto out_unlock;
 	}
 
 	assert(cu->state == COMPILATION_STATE_INITIAL);
@@ -122,10 +110,30 @@ void *jit_magic_trampoline(struct compilation_unit *cu)
 
 	shrink_compilation_unit(cu);
 
-out_unlock_fixup:
+out_unlock:
 	pthread_mutex_unlock(&cu->compile_mutex);
 
-out_fixup:
+	return ret;
+}
+
+void *jit_magic_trampoline(struct compilation_unit *cu)
+{
+	struct vm_method *method = cu->method;
+	void *ret;
+
+	if (opt_debug_stack)
+		check_stack_align(method);
+
+	if (opt_trace_magic_trampoline)
+		trace_magic_trampoline(cu);
+
+	if (vm_method_is_static(method)) {
+		/* This is for "invokestatic"... */
+		if (vm_class_ensure_init(method->class))
+			return rethrow_exception();
+	}
+
+	ret = jit_compile(cu);
 	if (!ret)
 		return rethrow_exception();
 
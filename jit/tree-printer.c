@@ -594,6 +594,8 @@ static const char *op_names[] = {
 	[OP_AND] = "and",
 	[OP_OR] = "or",
 	[OP_XOR] = "xor",
+	[OP_MIN] = "min",
+	[OP_MAX] = "max",
 	[OP_CMP] = "cmp",
 	[OP_CMPL] = "cmpl",
 	[OP_CMPG] = "cmpg",
@@ -604,6 +606,10 @@ static const char *op_names[] = {
 	[OP_GT] = "gt",
 	[OP_LE] = "le",
 	[OP_NEG] = "neg",
+	[OP_ABS] = "abs",
+	[OP_FABS] = "fabs",
+	[OP_DABS] = "dabs",
+	[OP_DSQRT] = "dsqrt",
 };
 
 static int print_binop_expr(int lvl, struct string *str,
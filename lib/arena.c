@@ -74,3 +74,18 @@ void *arena_alloc_expand(struct arena *arena, size_t size)
 
 	return arena_alloc_noexpand(arena, size);
 }
+
+/*
+ * Returns the number of bytes allocated from the arena. This walks all the
+ * blocks so it is meant for statistics, not for the allocation fast path.
+ */
+size_t arena_size(struct arena *arena)
+{
+	struct arena_block *block;
+	size_t size = 0;
+
+	for (block = arena->head; block; block = block->next)
+		size += block->free - (void *) block->data;
+
+	return size;
+}
@@ -10,8 +10,17 @@
 #include <stdlib.h>
 #include <string.h>
 
+/*
+ * Executable buffers are emitted to memory that is set up by jit/text.c and
+ * can't be grown.
+ */
+static int exec_buffer_expand(struct buffer *buf)
+{
+	return -ENOSPC;
+}
+
 static struct buffer_operations exec_buf_ops = {
-	.expand = NULL,
+	.expand = exec_buffer_expand,
 	.free   = NULL,
 };
 
@@ -54,7 +63,7 @@ int append_buffer_str(struct buffer *buf, unsigned char *str, size_t len)
 				return err;
 		}
 
-	memcpy(buf->buf + buf->offset, str, len);
+	memcpy(buffer_write_ptr(buf) + buf->offset, str, len);
 	buf->offset += len;
 
 	return 0;
@@ -0,0 +1,468 @@
+/*
+ * Concurrent hash map
+ *
+ * This file is released under the 2-clause BSD license. Please refer to the
+ * file LICENSE for details.
+ *
+ * The map is an open-addressed table with linear probing whose size is a
+ * power of two. Lookups read the table without any locking or atomic
+ * instructions. Updates are serialized with a per-map mutex which is fine
+ * for the VM-wide tables that use this map because they are read much more
+ * often than they are written.
+ *
+ * An entry is published by writing its value and hash before the key. An
+ * empty slot has a NULL key and a removed entry has its key replaced with a
+ * tombstone. Slots are never reused after they have been published so a
+ * reader that finds a key also finds the value that was stored with it.
+ *
+ * When the table gets too full, a new table is published with a single
+ * store and the live entries are moved to it incrementally: every put moves
+ * MIGRATE_BATCH slots of the old table so that no single update pays for
+ * copying the whole table while holding the mutex. Until all slots have been
+ * moved, lookups that miss in the new table also probe the old one. Moved
+ * entries stay in the old table so that a reader never misses a key that is
+ * in the map, and removals tombstone the key in both tables.
+ *
+ * The old table can't be freed without knowing that no reader is looking at
+ * it any more so it is kept until the map is freed. Readers that are still
+ * looking at it after the resize has finished see the map as it was then.
+ * The tables grow geometrically so that takes at most as much memory as the
+ * current table unless entries are removed frequently.
+ *
+ * Loads and stores are not reordered with other loads and stores on x86 so
+ * only compiler barriers are needed.
+ */
+
+#include "lib/concurrent-hash-map.h"
+
+#include "arch/memory.h"
+
+#include <stdlib.h>
+#include <assert.h>
+#include <errno.h>
+
+#define DEFAULT_CAPACITY	16
+
+/* Number of old table slots that are moved to the new table per put */
+#define MIGRATE_BATCH		16
+
+static const char tombstone;
+
+#define TOMBSTONE		((const void *) &tombstone)
+
+static struct concurrent_hash_map_table *alloc_table(unsigned long capacity)
+{
+	struct concurrent_hash_map_table *table;
+
+	table = calloc(1, sizeof(*table) + capacity * sizeof(table->entries[0]));
+	if (!table)
+		return NULL;
+
+	table->mask = capacity - 1;
+
+	return table;
+}
+
+static unsigned long table_capacity(struct concurrent_hash_map_table *table)
+{
+	return table->mask + 1;
+}
+
+struct concurrent_hash_map *alloc_concurrent_hash_map(struct key_operations *key_ops)
+{
+	return alloc_concurrent_hash_map_with_size(DEFAULT_CAPACITY, key_ops);
+}
+
+struct concurrent_hash_map *
+alloc_concurrent_hash_map_with_size(unsigned long initial_size, struct key_operations *key_ops)
+{
+	struct concurrent_hash_map *map;
+	unsigned long capacity;
+
+	capacity = DEFAULT_CAPACITY;
+	while (capacity < initial_size)
+		capacity <<= 1;
+
+	map = malloc(sizeof(*map));
+	if (!map)
+		return NULL;
+
+	map->table = alloc_table(capacity);
+	if (!map->table) {
+		free(map);
+		return NULL;
+	}
+
+	map->key_ops	= *key_ops;
+	map->size	= 0;
+	map->retired	= NULL;
+	pthread_mutex_init(&map->mutex, NULL);
+
+	return map;
+}
+
+bool concurrent_hash_map_entry_is_used(const struct concurrent_hash_map_entry *entry)
+{
+	const void *key = entry->key;
+
+	return key != NULL && key != TOMBSTONE;
+}
+
+static void migrate_entries(struct concurrent_hash_map *map, unsigned long nr);
+
+void free_concurrent_hash_map(struct concurrent_hash_map *map)
+{
+	struct concurrent_hash_map_entry *entry;
+	struct concurrent_hash_map_table *table, *next;
+
+	/* Don't visit entries that are in both tables twice.  */
+	migrate_entries(map, ~0UL);
+
+	if (map->key_ops.final_process) {
+		concurrent_hash_map_for_each_entry(entry, map)
+			map->key_ops.final_process(entry->value);
+	}
+
+	for (table = map->retired; table; table = next) {
+		next = table->retired_next;
+		free(table);
+	}
+
+	free(map->table);
+	pthread_mutex_destroy(&map->mutex);
+	free(map);
+}
+
+/*
+ * The hash functions of the keys are not good at spreading entries over the
+ * low bits, especially for pointers, so the hash is mixed before it is used
+ * as an index.
+ */
+static inline unsigned long hash_index(unsigned long hash, unsigned long mask)
+{
+	hash ^= hash >> 16;
+	hash *= 0x45d9f3b;
+	hash ^= hash >> 16;
+
+	return hash & mask;
+}
+
+static struct concurrent_hash_map_entry *
+lookup_entry(struct concurrent_hash_map *map, struct concurrent_hash_map_table *table,
+	     const void *key, unsigned long hash)
+{
+	unsigned long i;
+
+	for (i = hash_index(hash, table->mask);; i = (i + 1) & table->mask) {
+		struct concurrent_hash_map_entry *entry = &table->entries[i];
+		const void *entry_key = entry->key;
+
+		if (!entry_key)
+			return NULL;
+
+		if (entry_key == TOMBSTONE)
+			continue;
+
+		if (entry->hash == hash && map->key_ops.equals(entry_key, key))
+			return entry;
+	}
+}
+
+/*
+ * Looks up @key in @table and, if that is still being resized, in the table
+ * that it replaces. @from must be read after @table: an entry is inserted
+ * into the new table before the resize is marked finished.
+ */
+static struct concurrent_hash_map_entry *
+lookup_entry_resizing(struct concurrent_hash_map *map, struct concurrent_hash_map_table *table,
+		      struct concurrent_hash_map_table *from, const void *key, unsigned long hash)
+{
+	struct concurrent_hash_map_entry *entry;
+
+	entry = lookup_entry(map, table, key, hash);
+	if (entry || !from)
+		return entry;
+
+	return lookup_entry(map, from, key, hash);
+}
+
+/*
+ * Returns the value that is mapped to @key or NULL if there is none. This
+ * never blocks.
+ */
+void *concurrent_hash_map_get(struct concurrent_hash_map *map, const void *key)
+{
+	struct concurrent_hash_map_table *table, *from;
+	struct concurrent_hash_map_entry *entry;
+
+	table = map->table;
+	barrier();
+	from = table->from;
+	barrier();
+
+	entry = lookup_entry_resizing(map, table, from, key, map->key_ops.hash(key));
+	if (!entry)
+		return NULL;
+
+	return entry->value;
+}
+
+static void table_insert(struct concurrent_hash_map_table *table, const void *key,
+			 void *value, unsigned long hash)
+{
+	unsigned long i;
+
+	for (i = hash_index(hash, table->mask);; i = (i + 1) & table->mask) {
+		struct concurrent_hash_map_entry *entry = &table->entries[i];
+
+		if (entry->key)
+			continue;
+
+		entry->value	= value;
+		entry->hash	= hash;
+		barrier();
+		entry->key	= key;
+		table->nr_used++;
+		return;
+	}
+}
+
+/*
+ * Moves up to @nr slots of the table that is being replaced to the current
+ * table. The old table is retired when all of its slots have been moved.
+ * Must be called with the map mutex held.
+ */
+static void migrate_entries(struct concurrent_hash_map *map, unsigned long nr)
+{
+	struct concurrent_hash_map_table *table = map->table;
+	struct concurrent_hash_map_table *from = table->from;
+
+	if (!from)
+		return;
+
+	while (nr-- && from->migrated <= from->mask) {
+		struct concurrent_hash_map_entry *entry = &from->entries[from->migrated];
+
+		if (concurrent_hash_map_entry_is_used(entry))
+			table_insert(table, entry->key, entry->value, entry->hash);
+
+		barrier();
+		from->migrated++;
+	}
+
+	if (from->migrated <= from->mask)
+		return;
+
+	barrier();
+	table->from = NULL;
+
+	from->retired_next	= map->retired;
+	map->retired		= from;
+}
+
+/*
+ * Makes room for one more entry. The table is kept at most three quarters
+ * full, counting tombstones, so that there always is an empty slot that ends
+ * a probe. The new table is at least twice as large as the live entries and
+ * at least as large as the old table so a resize normally finishes long
+ * before the new table fills up. Must be called with the map mutex held.
+ */
+static int reserve_entry(struct concurrent_hash_map *map)
+{
+	struct concurrent_hash_map_table *old_table;
+	struct concurrent_hash_map_table *new_table;
+	unsigned long capacity;
+
+	migrate_entries(map, MIGRATE_BATCH);
+
+	old_table = map->table;
+
+	capacity = table_capacity(old_table);
+	if ((old_table->nr_used + 1) * 4 <= capacity * 3)
+		return 0;
+
+	/* Only one resize can be in progress at a time.  */
+	migrate_entries(map, ~0UL);
+
+	if ((old_table->nr_used + 1) * 4 <= capacity * 3)
+		return 0;
+
+	while ((map->size + 1) * 2 > capacity)
+		capacity <<= 1;
+
+	new_table = alloc_table(capacity);
+	if (!new_table)
+		return -ENOMEM;
+
+	new_table->from = old_table;
+
+	barrier();
+	map->table = new_table;
+
+	return 0;
+}
+
+static int __concurrent_hash_map_put(struct concurrent_hash_map *map, const void *key,
+				     void *value, bool replace, void **old_value_p)
+{
+	struct concurrent_hash_map_table *table;
+	struct concurrent_hash_map_entry *entry;
+	unsigned long hash;
+	int err = 0;
+
+	assert(key != NULL);
+
+	hash = map->key_ops.hash(key);
+
+	pthread_mutex_lock(&map->mutex);
+
+	table = map->table;
+
+	entry = lookup_entry_resizing(map, table, table->from, key, hash);
+	if (entry) {
+		if (old_value_p)
+			*old_value_p = entry->value;
+
+		if (replace) {
+			entry->value = value;
+
+			/* Keep the old table in sync until the resize is done.  */
+			if (table->from) {
+				entry = lookup_entry(map, table->from, key, hash);
+				if (entry)
+					entry->value = value;
+			}
+		}
+
+		goto out_unlock;
+	}
+
+	if (old_value_p)
+		*old_value_p = NULL;
+
+	err = reserve_entry(map);
+	if (err)
+		goto out_unlock;
+
+	table_insert(map->table, key, value, hash);
+	map->size++;
+
+ out_unlock:
+	pthread_mutex_unlock(&map->mutex);
+
+	return err;
+}
+
+int concurrent_hash_map_put(struct concurrent_hash_map *map, const void *key, void *value)
+{
+	return __concurrent_hash_map_put(map, key, value, true, NULL);
+}
+
+/*
+ * Maps @key to @value unless @key is already in the map. The value that was
+ * in the map before, or NULL if there was none, is stored to @old_value_p.
+ */
+int concurrent_hash_map_put_if_absent(struct concurrent_hash_map *map, const void *key,
+				      void *value, void **old_value_p)
+{
+	return __concurrent_hash_map_put(map, key, value, false, old_value_p);
+}
+
+int concurrent_hash_map_remove(struct concurrent_hash_map *map, const void *key)
+{
+	struct concurrent_hash_map_entry *entry, *old_entry = NULL;
+	struct concurrent_hash_map_table *table;
+	unsigned long hash;
+	void *value;
+
+	hash = map->key_ops.hash(key);
+
+	pthread_mutex_lock(&map->mutex);
+
+	table = map->table;
+
+	entry = lookup_entry(map, table, key, hash);
+	if (table->from)
+		old_entry = lookup_entry(map, table->from, key, hash);
+
+	if (!entry && !old_entry) {
+		pthread_mutex_unlock(&map->mutex);
+		return -1;
+	}
+
+	value = entry ? entry->value : old_entry->value;
+
+	/*
+	 * Remove the key from the new table first so that a reader that
+	 * misses it there can't find it in the old table afterwards.
+	 */
+	if (entry) {
+		entry->key = TOMBSTONE;
+		barrier();
+	}
+
+	if (old_entry)
+		old_entry->key = TOMBSTONE;
+
+	map->size--;
+
+	pthread_mutex_unlock(&map->mutex);
+
+	if (map->key_ops.final_process)
+		map->key_ops.final_process(value);
+
+	return 0;
+}
+
+unsigned long concurrent_hash_map_size(struct concurrent_hash_map *map)
+{
+	return map->size;
+}
+
+static struct concurrent_hash_map_entry *
+next_used_entry(struct concurrent_hash_map_iterator *iter)
+{
+	for (;;) {
+		struct concurrent_hash_map_table *table = iter->table;
+
+		while (iter->index <= table->mask) {
+			struct concurrent_hash_map_entry *entry = &table->entries[iter->index++];
+
+			if (concurrent_hash_map_entry_is_used(entry))
+				return entry;
+		}
+
+		if (!iter->from)
+			return NULL;
+
+		iter->table	= iter->from;
+		iter->index	= iter->from_index;
+		iter->from	= NULL;
+	}
+}
+
+/*
+ * Starts an iteration over @map. If the table is being resized, the slots of
+ * the old table that had not been moved when the iteration started are
+ * visited after the new table. Slots that were moved before that are in the
+ * new table.
+ */
+struct concurrent_hash_map_entry *
+concurrent_hash_map_first_entry(struct concurrent_hash_map *map, struct concurrent_hash_map_iterator *iter)
+{
+	iter->table	= map->table;
+	barrier();
+	iter->from	= iter->table->from;
+	barrier();
+	iter->from_index = iter->from ? iter->from->migrated : 0;
+	barrier();
+	iter->index	= 0;
+
+	return next_used_entry(iter);
+}
+
+struct concurrent_hash_map_entry *
+concurrent_hash_map_next_entry(struct concurrent_hash_map_iterator *iter)
+{
+	return next_used_entry(iter);
+}
@@ -7,11 +7,11 @@
 
 #include "lib/string.h"
 
+#include "lib/concurrent-hash-map.h"
 #include "lib/hash-map.h"
 
 #include "vm/die.h"
 
-#include <pthread.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
@@ -20,8 +20,11 @@
 
 #define INITIAL_CAPACITY 100
 
-static struct hash_map		*literals;
-static pthread_mutex_t		literals_mutex = PTHREAD_MUTEX_INITIALIZER;
+/*
+ * Interned strings are looked up on every class load so the table is a
+ * concurrent hash map that can be read without locking.
+ */
+static struct concurrent_hash_map *literals;
 
 struct string *alloc_str(void)
 {
@@ -69,30 +72,33 @@ struct string *string_from_cstr_dup(const char *s)
 
 struct string *string_intern_cstr(const char *s)
 {
-        struct string *result;
+	struct string *result, *old;
 
-        pthread_mutex_lock(&literals_mutex);
+	result = concurrent_hash_map_get(literals, s);
+	if (result)
+		return result;
 
-        if (!hash_map_get(literals, s, (void **) &result))
-		goto out;
+	result = string_from_cstr_dup(s);
+	if (!result)
+		return NULL;
 
-        result = string_from_cstr_dup(s);
-        if (!result)
-                goto out;
+	if (concurrent_hash_map_put_if_absent(literals, result->value, result, (void **) &old)) {
+		free_str(result);
+		return NULL;
+	}
 
-        if (hash_map_put(literals, result->value, result)) {
+	/* Another thread interned the same string first. */
+	if (old) {
 		free_str(result);
-		result = NULL;
+		return old;
 	}
- out:
-        pthread_mutex_unlock(&literals_mutex);
 
-        return result;
+	return result;
 }
 
 void init_string_intern(void)
 {
-	literals = alloc_hash_map(&string_key);
+	literals = alloc_concurrent_hash_map(&string_key);
 	if (!literals)
 		die("Unable to initialize string literal hash map");
 }
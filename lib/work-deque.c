@@ -0,0 +1,145 @@
+/*
+ * Work-stealing deque
+ *
+ * This file is released under the 2-clause BSD license. Please refer to the
+ * file LICENSE for details.
+ *
+ * This is the deque from the paper "Dynamic Circular Work-Stealing Deque" by
+ * Chase and Lev without the resizing: a push to a full deque fails and the
+ * caller has to keep the element somewhere else. Only the owner of a deque
+ * may push and pop. Any thread may steal.
+ *
+ * The owner and the thieves only contend for the last element, which is
+ * resolved with a compare-and-swap on the top index. The indices grow
+ * without bound and are masked to get the position in the element array.
+ * Loads and stores are not reordered with other loads and stores on x86
+ * except for a store followed by a load which is why pop needs a full
+ * barrier.
+ */
+
+#include "lib/work-deque.h"
+
+#include "arch/cmpxchg.h"
+#include "arch/memory.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+/*
+ * Allocates a deque that holds up to @capacity elements. The capacity must
+ * be a power of two.
+ */
+struct work_deque *alloc_work_deque(unsigned long capacity)
+{
+	struct work_deque *deque;
+
+	assert(capacity && (capacity & (capacity - 1)) == 0);
+
+	deque = malloc(sizeof *deque);
+	if (!deque)
+		return NULL;
+
+	deque->elements = malloc(capacity * sizeof(void *));
+	if (!deque->elements) {
+		free(deque);
+		return NULL;
+	}
+
+	deque->top	= 0;
+	deque->bottom	= 0;
+	deque->mask	= capacity - 1;
+
+	return deque;
+}
+
+void free_work_deque(struct work_deque *deque)
+{
+	free(deque->elements);
+	free(deque);
+}
+
+static bool cas_top(struct work_deque *deque, long old, long new)
+{
+	return cmpxchg_ptr((void *) &deque->top, (void *) old, (void *) new) == (void *) old;
+}
+
+/*
+ * Pushes @element to the bottom of the deque. Returns false if the deque is
+ * full.
+ */
+bool work_deque_push(struct work_deque *deque, void *element)
+{
+	long bottom = deque->bottom;
+
+	if (bottom - deque->top > (long) deque->mask)
+		return false;
+
+	deque->elements[bottom & deque->mask] = element;
+
+	/* The element must be visible before thieves can see it. */
+	barrier();
+
+	deque->bottom = bottom + 1;
+
+	return true;
+}
+
+/*
+ * Pops the element at the bottom of the deque. Returns NULL if the deque is
+ * empty or if the last element was stolen.
+ */
+void *work_deque_pop(struct work_deque *deque)
+{
+	long bottom = deque->bottom - 1;
+	void *element;
+	long top;
+
+	deque->bottom = bottom;
+
+	/* Thieves must see the new bottom before the top is read. */
+	mb();
+
+	top = deque->top;
+
+	if (top > bottom) {
+		deque->bottom = top;
+		return NULL;
+	}
+
+	element = deque->elements[bottom & deque->mask];
+
+	if (top < bottom)
+		return element;
+
+	/* This is the last element so race with the thieves for it. */
+	if (!cas_top(deque, top, top + 1))
+		element = NULL;
+
+	deque->bottom = top + 1;
+
+	return element;
+}
+
+/*
+ * Steals the element at the top of the deque. Returns NULL if the deque is
+ * empty or if another thread got the element first.
+ */
+void *work_deque_steal(struct work_deque *deque)
+{
+	void *element;
+	long top, bottom;
+
+	top = deque->top;
+	barrier();
+	bottom = deque->bottom;
+
+	if (top >= bottom)
+		return NULL;
+
+	element = deque->elements[top & deque->mask];
+
+	if (!cas_top(deque, top, top + 1))
+		return NULL;
+
+	return element;
+}
@@ -3,6 +3,20 @@
  *
  * This file is released under the 2-clause BSD license. Please refer to the
  * file LICENSE for details.
+ *
+ * ZIP and JAR file reader
+ *
+ * The file is mapped to memory and the central directory is read when the
+ * file is opened. Stored entries are read directly from the mapping and
+ * deflated entries are inflated with a z_stream that every thread keeps
+ * around between entries.
+ *
+ * If a cache directory is set with zip_set_cache_dir(), the inflated class
+ * files of every ZIP file are written to a cache file the first time it is
+ * opened. The cache file is keyed by the path, size and modification time of
+ * the ZIP file and the data is checked against the CRC of each entry when
+ * the cache file is written. When the cache file is found, class files are
+ * read directly from its mapping without inflating them.
  */
 
 #include "lib/zip.h"
@@ -17,9 +31,13 @@
 #include <sys/types.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdio.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <zlib.h>
@@ -90,11 +108,33 @@ struct zip_eocdr {
 	uint16_t		comment_len;
 } __attribute__((packed));
 
+/*
+ *	Cache file
+ */
+#define ZIP_CACHE_MAGIC		0x31435a4a	/* "JZC1" */
+
+struct zip_cache_header {
+	uint32_t		magic;
+	uint32_t		nr_entries;
+	uint64_t		zip_size;
+	uint64_t		zip_mtime;
+	/* Followed by the cache offset of each entry */
+};
+
+static const char *zip_cache_dir;
+
 static inline const char *cdfh_filename(struct zip_cdfh *cdfh)
 {
 	return (void *) cdfh + sizeof *cdfh;
 }
 
+static bool is_class_file(const char *filename, size_t len)
+{
+	size_t suffix_len = strlen(".class");
+
+	return len > suffix_len && !strncmp(filename + len - suffix_len, ".class", suffix_len);
+}
+
 static struct zip *zip_new(void)
 {
 	return calloc(1, sizeof(struct zip));
@@ -115,6 +155,9 @@ static void zip_delete(struct zip *zip)
 	if (zip->class_cache)
 		free_hash_map(zip->class_cache);
 
+	if (zip->cache_mmap)
+		munmap(zip->cache_mmap, zip->cache_len);
+
 	free(zip->entries);
 	free(zip);
 }
@@ -161,6 +204,8 @@ static int zip_eocdr_traverse(struct zip *zip, struct zip_eocdr *eocdr)
 	nr_entries = le16_to_cpu(eocdr->total_entries);
 
 	zip->entries = calloc(nr_entries, sizeof(struct zip_entry));
+	if (!zip->entries)
+		goto error;
 
 	p = zip->mmap + le32_to_cpu(eocdr->offset);
 
@@ -187,6 +232,7 @@ static int zip_eocdr_traverse(struct zip *zip, struct zip_eocdr *eocdr)
 		entry = &zip->entries[nr++];
 
 		entry->filename		= s;
+		entry->crc32		= le32_to_cpu(cdfh->crc32);
 		entry->comp_size	= le32_to_cpu(cdfh->comp_size);
 		entry->uncomp_size	= le32_to_cpu(cdfh->uncomp_size);
 		entry->lh_offset	= le32_to_cpu(cdfh->lh_offset);
@@ -194,7 +240,7 @@ static int zip_eocdr_traverse(struct zip *zip, struct zip_eocdr *eocdr)
 
 		hash_map_put(zip->entry_cache, s, entry);
 
-		if (!strncmp(s + filename_len - strlen(".class"), ".class", strlen(".class"))) {
+		if (is_class_file(s, filename_len)) {
 			struct string *class_name;
 			char *dup;
 
@@ -223,24 +269,40 @@ error:
 	return -1;
 }
 
+/*
+ * The end of central directory record is at the end of the file, followed
+ * only by a comment that is at most 64 KB long, so there's no need to look
+ * further than that.
+ */
 static struct zip_eocdr *zip_eocdr_find(struct zip *zip)
 {
-	void *p;
+	void *p, *start;
+
+	if (zip->len < sizeof(struct zip_eocdr))
+		return NULL;
+
+	p = zip->mmap + zip->len - sizeof(struct zip_eocdr);
+
+	start = zip->mmap;
+	if (p - start > UINT16_MAX)
+		start = p - UINT16_MAX;
+
+	for (; p >= start; p--) {
+		struct zip_eocdr *eocdr = p;
 
-	for (p = zip->mmap + zip->len - sizeof(uint32_t); p >= zip->mmap; p--) {
-		uint32_t *sig = p;
+		if (*(uint8_t *) p != (ZIP_EOCDR_SIGNATURE & 0xff))
+			continue;
 
-		if (le32_to_cpu(*sig) == ZIP_EOCDR_SIGNATURE)
-			return p;
+		if (le32_to_cpu(eocdr->signature) == ZIP_EOCDR_SIGNATURE)
+			return eocdr;
 	}
 
 	return NULL;
 }
 
-static struct zip *zip_do_open(const char *pathname)
+static struct zip *zip_do_open(const char *pathname, struct stat *st)
 {
 	struct zip *zip;
-	struct stat st;
 
 	zip = zip_new();
 	if (!zip)
@@ -250,10 +312,10 @@ static struct zip *zip_do_open(const char *pathname)
 	if (zip->fd < 0)
 		goto error_free;
 
-	if (fstat(zip->fd, &st) < 0)
+	if (fstat(zip->fd, st) < 0)
 		goto error_free;
 
-	zip->len = st.st_size;
+	zip->len = st->st_size;
 
 	zip->mmap = mmap(NULL, zip->len, PROT_READ, MAP_SHARED, zip->fd, 0);
 	if (zip->mmap == MAP_FAILED)
@@ -270,72 +332,132 @@ error_free:
 	return NULL;
 }
 
-struct zip *zip_open(const char *pathname)
+/*
+ * Returns the data of @entry in the ZIP file or NULL if the local header or
+ * the data is not within the file.
+ */
+static const void *zip_entry_input(struct zip *zip, struct zip_entry *entry)
 {
-	struct zip_eocdr *eocdr;
-	uint32_t *lfh_sig;
-	struct zip *zip;
+	struct zip_lfh *lfh;
+	uint64_t offset;
 
-	zip = zip_do_open(pathname);
-	if (!zip)
+	if ((uint64_t) entry->lh_offset + sizeof *lfh > zip->len)
 		return NULL;
 
-	lfh_sig = zip->mmap;
+	lfh = zip->mmap + entry->lh_offset;
 
-	if (le32_to_cpu(*lfh_sig) != ZIP_LFH_SIGNATURE)
-		goto error;
+	if (le32_to_cpu(lfh->signature) != ZIP_LFH_SIGNATURE)
+		return NULL;
 
-	eocdr = zip_eocdr_find(zip);
-	if (!eocdr)
-		goto error;
+	offset = (uint64_t) entry->lh_offset + zip_lfh_size(lfh);
+	if (offset + entry->comp_size > zip->len)
+		return NULL;
 
-	if (zip_eocdr_traverse(zip, eocdr) < 0)
-		goto error;
+	if (entry->compression == 0 && entry->comp_size != entry->uncomp_size)
+		return NULL;
 
-	return zip;
+	return zip->mmap + offset;
+}
 
-error:
-	zip_close(zip);
+static pthread_once_t zip_inflate_once = PTHREAD_ONCE_INIT;
+static pthread_key_t zip_inflate_key;
 
-	return NULL;
+static __thread z_stream *zip_inflate_stream;
+
+static void zip_inflate_stream_free(void *arg)
+{
+	z_stream *zs = arg;
+
+	inflateEnd(zs);
+	free(zs);
 }
 
-void *zip_entry_data(struct zip *zip, struct zip_entry *entry)
+static void zip_inflate_key_init(void)
 {
-	struct zip_lfh *lfh;
-	void *output;
-	void *input;
+	pthread_key_create(&zip_inflate_key, zip_inflate_stream_free);
+}
 
-	lfh = zip->mmap + entry->lh_offset;
+/*
+ * Returns the inflate stream of the current thread. The stream is set up
+ * once per thread and reset for every entry.
+ */
+static z_stream *zip_inflate_stream_get(void)
+{
+	z_stream *zs = zip_inflate_stream;
 
-	input = zip->mmap + entry->lh_offset + zip_lfh_size(lfh);
+	if (zs) {
+		if (inflateReset(zs) != Z_OK)
+			return NULL;
 
-	output = malloc(entry->uncomp_size);
-	if (!output)
+		return zs;
+	}
+
+	pthread_once(&zip_inflate_once, zip_inflate_key_init);
+
+	zs = calloc(1, sizeof *zs);
+	if (!zs)
 		return NULL;
 
-	switch (entry->compression) {
-	case Z_DEFLATED: {
-		z_stream zs;
-		int err;
+	zs->zalloc	= Z_NULL;
+	zs->zfree	= Z_NULL;
+	zs->opaque	= Z_NULL;
 
-		zs.next_in	= input;
-		zs.avail_in	= entry->comp_size;
-		zs.next_out	= output;
-		zs.avail_out	= entry->uncomp_size;
+	if (inflateInit2(zs, -MAX_WBITS) != Z_OK) {
+		free(zs);
+		return NULL;
+	}
 
-		zs.zalloc	= Z_NULL;
-		zs.zfree	= Z_NULL;
-		zs.opaque	= Z_NULL;
+	pthread_setspecific(zip_inflate_key, zs);
+	zip_inflate_stream = zs;
 
-		if (inflateInit2(&zs, -MAX_WBITS) != Z_OK)
-			goto error;
+	return zs;
+}
 
-		err = inflate(&zs, Z_SYNC_FLUSH);
-		if ((err != Z_STREAM_END) && (err != Z_OK))
-			goto error;
+static int zip_inflate(struct zip_entry *entry, const void *input, void *output)
+{
+	z_stream *zs;
+	int err;
 
-		if (inflateEnd(&zs) != Z_OK)
+	zs = zip_inflate_stream_get();
+	if (!zs)
+		return -1;
+
+	zs->next_in	= (void *) input;
+	zs->avail_in	= entry->comp_size;
+	zs->next_out	= output;
+	zs->avail_out	= entry->uncomp_size;
+
+	err = inflate(zs, Z_FINISH);
+	if (err != Z_STREAM_END && err != Z_OK && err != Z_BUF_ERROR)
+		return -1;
+
+	if (zs->total_out != entry->uncomp_size)
+		return -1;
+
+	return 0;
+}
+
+void *zip_entry_data(struct zip *zip, struct zip_entry *entry)
+{
+	const void *input;
+	void *output;
+
+	output = malloc(entry->uncomp_size);
+	if (!output)
+		return NULL;
+
+	if (entry->cache_offset) {
+		memcpy(output, zip->cache_mmap + entry->cache_offset, entry->uncomp_size);
+		return output;
+	}
+
+	input = zip_entry_input(zip, entry);
+	if (!input)
+		goto error;
+
+	switch (entry->compression) {
+	case Z_DEFLATED: {
+		if (zip_inflate(entry, input, output))
 			goto error;
 
 		break;
@@ -354,6 +476,287 @@ error:
 	return NULL;
 }
 
+/*
+ * Returns the uncompressed data of @entry. If the entry is stored or in the
+ * cache file, the data is not copied. The data must be released with
+ * zip_entry_unmap().
+ */
+const void *zip_entry_map(struct zip *zip, struct zip_entry *entry)
+{
+	if (entry->cache_offset)
+		return zip->cache_mmap + entry->cache_offset;
+
+	if (entry->compression == 0)
+		return zip_entry_input(zip, entry);
+
+	return zip_entry_data(zip, entry);
+}
+
+void zip_entry_unmap(struct zip *zip, const void *data)
+{
+	if (data >= zip->mmap && data < zip->mmap + zip->len)
+		return;
+
+	if (data >= zip->cache_mmap && data < zip->cache_mmap + zip->cache_len)
+		return;
+
+	free((void *) data);
+}
+
+void zip_set_cache_dir(const char *dir)
+{
+	zip_cache_dir = dir;
+}
+
+static char *zip_cache_path(const char *pathname)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	char *real, *path, *base;
+
+	real = realpath(pathname, NULL);
+	if (!real)
+		return NULL;
+
+	/* FNV-1a */
+	for (const char *p = real; *p; p++) {
+		hash ^= (unsigned char) *p;
+		hash *= 1099511628211ULL;
+	}
+
+	base = strrchr(real, '/');
+	base = base ? base + 1 : real;
+
+	if (asprintf(&path, "%s/%s-%016" PRIx64 ".cache", zip_cache_dir, base, hash) < 0)
+		path = NULL;
+
+	free(real);
+
+	return path;
+}
+
+static int zip_cache_map(struct zip *zip, int fd, const struct stat *st)
+{
+	struct zip_cache_header *header;
+	struct zip_entry *entry;
+	struct stat cache_st;
+	unsigned int idx;
+	uint32_t *offsets;
+	size_t len;
+	void *p;
+
+	if (fstat(fd, &cache_st) < 0)
+		return -1;
+
+	len = cache_st.st_size;
+	if (len < sizeof *header + zip->nr_entries * sizeof *offsets)
+		return -1;
+
+	p = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED)
+		return -1;
+
+	header	= p;
+	offsets	= p + sizeof *header;
+
+	if (header->magic != ZIP_CACHE_MAGIC
+	    || header->nr_entries != zip->nr_entries
+	    || header->zip_size != (uint64_t) st->st_size
+	    || header->zip_mtime != (uint64_t) st->st_mtime)
+		goto error;
+
+	zip_for_each_entry(idx, entry, zip) {
+		if (offsets[idx] && (uint64_t) offsets[idx] + entry->uncomp_size > len)
+			goto error;
+	}
+
+	zip_for_each_entry(idx, entry, zip) {
+		entry->cache_offset = offsets[idx];
+	}
+
+	zip->cache_mmap	= p;
+	zip->cache_len	= len;
+
+	return 0;
+
+error:
+	munmap(p, len);
+	return -1;
+}
+
+static int write_all(int fd, const void *buf, size_t count, off_t offset)
+{
+	while (count) {
+		ssize_t ret = pwrite(fd, buf, count, offset);
+
+		if (ret <= 0)
+			return -1;
+
+		buf	+= ret;
+		count	-= ret;
+		offset	+= ret;
+	}
+
+	return 0;
+}
+
+/*
+ * Writes the inflated class files of @zip to a new cache file. The file is
+ * written under a temporary name and renamed so that other VMs never see a
+ * partially written cache file.
+ */
+static int zip_cache_write(struct zip *zip, const char *cache_path, const struct stat *st)
+{
+	struct zip_cache_header header;
+	struct zip_entry *entry;
+	uint32_t *offsets;
+	unsigned int idx;
+	char *tmp_path;
+	uint64_t pos;
+	int err = -1;
+	int fd;
+
+	offsets = calloc(zip->nr_entries, sizeof *offsets);
+	if (!offsets && zip->nr_entries)
+		return -1;
+
+	if (asprintf(&tmp_path, "%s.%d", cache_path, getpid()) < 0)
+		goto out_free_offsets;
+
+	fd = open(tmp_path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+	if (fd < 0)
+		goto out_free_path;
+
+	pos = sizeof header + zip->nr_entries * sizeof *offsets;
+
+	zip_for_each_entry(idx, entry, zip) {
+		void *data;
+
+		/* Stored entries are read directly from the ZIP file. */
+		if (entry->compression != Z_DEFLATED)
+			continue;
+
+		if (!is_class_file(entry->filename, strlen(entry->filename)))
+			continue;
+
+		if (pos + entry->uncomp_size > UINT32_MAX)
+			break;
+
+		data = zip_entry_data(zip, entry);
+		if (!data)
+			continue;
+
+		if (crc32(0, data, entry->uncomp_size) != entry->crc32) {
+			free(data);
+			continue;
+		}
+
+		if (write_all(fd, data, entry->uncomp_size, pos)) {
+			free(data);
+			goto out_unlink;
+		}
+
+		free(data);
+
+		offsets[idx]	= pos;
+		pos		+= entry->uncomp_size;
+	}
+
+	header.magic		= ZIP_CACHE_MAGIC;
+	header.nr_entries	= zip->nr_entries;
+	header.zip_size		= st->st_size;
+	header.zip_mtime	= st->st_mtime;
+
+	if (write_all(fd, &header, sizeof header, 0))
+		goto out_unlink;
+
+	if (write_all(fd, offsets, zip->nr_entries * sizeof *offsets, sizeof header))
+		goto out_unlink;
+
+	if (rename(tmp_path, cache_path) < 0)
+		goto out_unlink;
+
+	err = 0;
+	goto out_close;
+
+out_unlink:
+	unlink(tmp_path);
+out_close:
+	close(fd);
+out_free_path:
+	free(tmp_path);
+out_free_offsets:
+	free(offsets);
+
+	return err;
+}
+
+static void zip_cache_open(struct zip *zip, const char *pathname, const struct stat *st)
+{
+	char *cache_path;
+	int fd;
+
+	cache_path = zip_cache_path(pathname);
+	if (!cache_path)
+		return;
+
+	fd = open(cache_path, O_RDONLY);
+	if (fd >= 0 && !zip_cache_map(zip, fd, st))
+		goto out;
+
+	if (fd >= 0)
+		close(fd);
+
+	if (zip_cache_write(zip, cache_path, st))
+		goto out_free;
+
+	fd = open(cache_path, O_RDONLY);
+	if (fd < 0)
+		goto out_free;
+
+	zip_cache_map(zip, fd, st);
+out:
+	close(fd);
+out_free:
+	free(cache_path);
+}
+
+struct zip *zip_open(const char *pathname)
+{
+	struct zip_eocdr *eocdr;
+	uint32_t *lfh_sig;
+	struct zip *zip;
+	struct stat st;
+
+	zip = zip_do_open(pathname, &st);
+	if (!zip)
+		return NULL;
+
+	if (zip->len < sizeof *lfh_sig)
+		goto error;
+
+	lfh_sig = zip->mmap;
+
+	if (le32_to_cpu(*lfh_sig) != ZIP_LFH_SIGNATURE)
+		goto error;
+
+	eocdr = zip_eocdr_find(zip);
+	if (!eocdr)
+		goto error;
+
+	if (zip_eocdr_traverse(zip, eocdr) < 0)
+		goto error;
+
+	if (zip_cache_dir)
+		zip_cache_open(zip, pathname, &st);
+
+	return zip;
+
+error:
+	zip_close(zip);
+
+	return NULL;
+}
+
 struct zip_entry *zip_entry_find(struct zip *zip, const char *pathname)
 {
 	void *entry;
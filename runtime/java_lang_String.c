@@ -0,0 +1,134 @@
+/*
+ * This file is released under the 2-clause BSD license. Please refer to the
+ * file LICENSE for details.
+ *
+ * VM implementations of the hottest java/lang/String methods. They replace
+ * the bytecode versions when intrinsics are enabled (see vm/preload.c) and
+ * must behave exactly like them.
+ */
+
+#include "runtime/java_lang_String.h"
+
+#include "vm/preload.h"
+#include "vm/object.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static inline const jchar *string_chars(jobject str)
+{
+	jobject array = field_get_object(str, vm_java_lang_String_value);
+	jint offset = field_get_int(str, vm_java_lang_String_offset);
+
+	return (const jchar *) vm_array_elems(array) + offset;
+}
+
+jboolean java_lang_String_equals(jobject this, jobject other)
+{
+	jint count;
+
+	if (this == other)
+		return true;
+
+	if (!other || other->class != vm_java_lang_String)
+		return false;
+
+	count = field_get_int(this, vm_java_lang_String_count);
+	if (count != field_get_int(other, vm_java_lang_String_count))
+		return false;
+
+	return memcmp(string_chars(this), string_chars(other), count * sizeof(jchar)) == 0;
+}
+
+jint java_lang_String_hashCode(jobject this)
+{
+	const jchar *chars;
+	uint32_t hash;
+	jint count, i;
+
+	hash = field_get_int(this, vm_java_lang_String_cachedHashCode);
+	if (hash)
+		return hash;
+
+	count = field_get_int(this, vm_java_lang_String_count);
+	chars = string_chars(this);
+
+	/*
+	 * Four characters per step with precomputed powers of 31 so that the
+	 * multiplications don't depend on each other.
+	 */
+	for (i = 0; i + 4 <= count; i += 4) {
+		hash = hash * (31 * 31 * 31 * 31)
+			+ chars[i + 0] * (31 * 31 * 31)
+			+ chars[i + 1] * (31 * 31)
+			+ chars[i + 2] * 31
+			+ chars[i + 3];
+	}
+
+	for (; i < count; i++)
+		hash = hash * 31 + chars[i];
+
+	field_set_int(this, vm_java_lang_String_cachedHashCode, hash);
+
+	return hash;
+}
+
+static jint find_char(const jchar *chars, jint from, jint count, jchar ch)
+{
+	jint i = from;
+
+#ifdef __SSE2__
+	__m128i needle = _mm_set1_epi16(ch);
+
+	for (; i + 8 <= count; i += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i *) &chars[i]);
+		int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(v, needle));
+
+		if (mask)
+			return i + __builtin_ctz(mask) / 2;
+	}
+#endif
+	for (; i < count; i++) {
+		if (chars[i] == ch)
+			return i;
+	}
+
+	return -1;
+}
+
+jint java_lang_String_indexOf(jobject this, jint ch, jint from_index)
+{
+	const jchar *chars;
+	jchar high, low;
+	jint count, i;
+
+	count = field_get_int(this, vm_java_lang_String_count);
+	chars = string_chars(this);
+
+	if (from_index < 0)
+		from_index = 0;
+
+	if (from_index >= count)
+		return -1;
+
+	if ((uint32_t) ch <= 0xffff)
+		return find_char(chars, from_index, count, ch);
+
+	if ((uint32_t) ch > 0x10ffff)
+		return -1;
+
+	/* Supplementary code points are stored as a surrogate pair.  */
+	high = 0xd800 + ((ch - 0x10000) >> 10);
+	low = 0xdc00 + ((ch - 0x10000) & 0x3ff);
+
+	for (i = from_index; (i = find_char(chars, i, count - 1, high)) >= 0; i++) {
+		if (chars[i + 1] == low)
+			return i;
+	}
+
+	return -1;
+}
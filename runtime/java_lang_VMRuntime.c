@@ -49,7 +49,7 @@ int native_vmruntime_available_processors(void)
 
 void native_vmruntime_gc(void)
 {
-	/* Nothing to do */
+	gc_collect();
 }
 
 void native_vmruntime_exit(int status)
@@ -6,10 +6,35 @@
 #include "vm/object.h"
 #include "vm/class.h"
 
+static inline bool array_range_is_valid(jobject array, jint start, jint len)
+{
+	return start >= 0 && len <= vm_array_length(array) - start;
+}
+
+/*
+ * Copies references one by one between arrays whose element classes are not
+ * assignment compatible. Elements are stored until the first one that does
+ * not fit @dest.
+ */
+static void arraycopy_checked(jobject src, jint src_start, jobject dest, jint dest_start,
+			      jint len, struct vm_class *dest_elem_class)
+{
+	for (jint i = 0; i < len; i++) {
+		jobject obj = array_get_field_object(src, src_start + i);
+
+		if (obj && !vm_object_is_instance_of(obj, dest_elem_class)) {
+			signal_new_exception(vm_java_lang_ArrayStoreException, NULL);
+			return;
+		}
+
+		array_set_field_object(dest, dest_start + i, obj);
+	}
+}
+
 void java_lang_VMSystem_arraycopy(jobject src, jint src_start, jobject dest, jint dest_start, jint len)
 {
-	const struct vm_class *src_elem_class;
-	const struct vm_class *dest_elem_class;
+	struct vm_class *src_elem_class;
+	struct vm_class *dest_elem_class;
 	enum vm_type elem_type;
 	int elem_size;
 
@@ -24,11 +49,19 @@ void java_lang_VMSystem_arraycopy(jobject src, jint src_start, jobject dest, jin
 		return;
 	}
 
-	src_elem_class = vm_class_get_array_element_class(src->class);
-	dest_elem_class = vm_class_get_array_element_class(dest->class);
-	if (!src_elem_class || !dest_elem_class) {
-		signal_new_exception(vm_java_lang_NullPointerException, NULL);
-		return;
+	/*
+	 * Copies between arrays of the same class are the common case and
+	 * need no element type checks.
+	 */
+	if (src->class == dest->class) {
+		src_elem_class = dest_elem_class = src->class->array_element_class;
+	} else {
+		src_elem_class = vm_class_get_array_element_class(src->class);
+		dest_elem_class = vm_class_get_array_element_class(dest->class);
+		if (!src_elem_class || !dest_elem_class) {
+			signal_new_exception(vm_java_lang_NullPointerException, NULL);
+			return;
+		}
 	}
 
 	elem_type = vm_class_get_storage_vmtype(src_elem_class);
@@ -38,18 +71,27 @@ void java_lang_VMSystem_arraycopy(jobject src, jint src_start, jobject dest, jin
 	}
 
 	if (len < 0 ||
-	    src_start < 0 || src_start + len > vm_array_length(src) ||
-	    dest_start < 0 || dest_start + len > vm_array_length(dest)) {
+	    !array_range_is_valid(src, src_start, len) ||
+	    !array_range_is_valid(dest, dest_start, len)) {
 		signal_new_exception(
 			vm_java_lang_ArrayIndexOutOfBoundsException, NULL);
 		return;
 	}
 
+	if (elem_type == J_REFERENCE && src_elem_class != dest_elem_class &&
+	    !vm_class_is_assignable_from(dest_elem_class, src_elem_class)) {
+		arraycopy_checked(src, src_start, dest, dest_start, len, dest_elem_class);
+		return;
+	}
+
 	elem_size = vmtype_get_size(elem_type);
 	memmove(vm_array_elems(dest) + dest_start * elem_size,
 		vm_array_elems(src) + src_start * elem_size,
 		len * elem_size);
 
+	if (elem_type == J_REFERENCE)
+		gc_write_barrier_range(vm_array_elems(dest) + dest_start * elem_size, len * elem_size);
+
 	return;
 }
 
@@ -20,8 +20,14 @@
 #include "vm/call.h"
 #include "vm/die.h"
 
+#include "arch/cmpxchg.h"
+
+#include <stdlib.h>
+
 static int marshall_call_arguments(struct vm_method *vmm, unsigned long *args,
 				   struct vm_object *args_array);
+static int reflection_marshall_call_arguments(struct vm_method *vmm, unsigned long *args,
+					      struct vm_object *args_array);
 
 struct vm_class *vm_object_to_vm_class(struct vm_object *object)
 {
@@ -410,7 +416,7 @@ native_constructor_construct_native(struct vm_object *this,
 	unsigned long args[vmm->args_count];
 
 	args[0] = (unsigned long) result;
-	if (marshall_call_arguments(vmm, args + 1, args_array))
+	if (reflection_marshall_call_arguments(vmm, args + 1, args_array))
 		return NULL;
 
 	vm_call_method_a(vmm, args, NULL);
@@ -436,6 +442,7 @@ int object_to_jvalue(void *field_ptr, enum vm_type type, struct vm_object *value
 	switch (type) {
 	case J_REFERENCE:
 		*(jobject *) field_ptr = value;
+		gc_write_barrier(field_ptr);
 		return 0;
 	case J_BOOLEAN:
 		vm_call_method_this_a(vm_java_lang_Boolean_booleanValue, value, args, &result);
@@ -603,6 +610,217 @@ static int marshall_call_arguments(struct vm_method *vmm, unsigned long *args,
 	return 0;
 }
 
+/*
+ * Reflection stubs
+ *
+ * Marshalling the arguments of a reflective call walks the argument list of
+ * the method and unboxes every primitive argument by calling its
+ * xxxValue() method. Once a method has been called reflectively
+ * REFLECTION_STUB_THRESHOLD times, it gets a stub that has the type and the
+ * argument slot of every parameter precomputed. The stub also reads the
+ * value of boxed arguments directly from the wrapper object when the
+ * wrapper is of the exact type of the parameter. Other arguments, which
+ * need a widening conversion or are of the wrong type, go through
+ * object_to_jvalue().
+ */
+#define REFLECTION_STUB_THRESHOLD	16
+
+bool opt_reflection_stubs = true;
+
+struct reflection_stub_arg {
+	enum vm_type		vm_type;
+	unsigned int		slot;
+
+	/* Wrapper class whose value can be read directly */
+	struct vm_class		*box_class;
+	struct vm_field		*box_value;
+};
+
+struct reflection_stub {
+	unsigned int			nr_args;
+	struct reflection_stub_arg	args[];
+};
+
+static void box_class_and_value(enum vm_type vm_type, struct vm_class **class, struct vm_field **value)
+{
+	switch (vm_type) {
+	case J_BOOLEAN:
+		*class	= vm_java_lang_Boolean;
+		*value	= vm_java_lang_Boolean_value;
+		break;
+	case J_BYTE:
+		*class	= vm_java_lang_Byte;
+		*value	= vm_java_lang_Byte_value;
+		break;
+	case J_CHAR:
+		*class	= vm_java_lang_Character;
+		*value	= vm_java_lang_Character_value;
+		break;
+	case J_SHORT:
+		*class	= vm_java_lang_Short;
+		*value	= vm_java_lang_Short_value;
+		break;
+	case J_INT:
+		*class	= vm_java_lang_Integer;
+		*value	= vm_java_lang_Integer_value;
+		break;
+	case J_LONG:
+		*class	= vm_java_lang_Long;
+		*value	= vm_java_lang_Long_value;
+		break;
+	case J_FLOAT:
+		*class	= vm_java_lang_Float;
+		*value	= vm_java_lang_Float_value;
+		break;
+	case J_DOUBLE:
+		*class	= vm_java_lang_Double;
+		*value	= vm_java_lang_Double_value;
+		break;
+	default:
+		*class	= NULL;
+		*value	= NULL;
+		break;
+	}
+
+	if (!*value)
+		*class = NULL;
+}
+
+static struct reflection_stub *reflection_stub_alloc(struct vm_method *vmm)
+{
+	struct reflection_stub *stub;
+	struct vm_method_arg *arg;
+	unsigned int nr_args = 0;
+	unsigned int slot = 0;
+
+	list_for_each_entry(arg, &vmm->args, list_node)
+		nr_args++;
+
+	stub = malloc(sizeof(*stub) + nr_args * sizeof(stub->args[0]));
+	if (!stub)
+		return NULL;
+
+	stub->nr_args = nr_args;
+	nr_args = 0;
+
+	list_for_each_entry(arg, &vmm->args, list_node) {
+		struct reflection_stub_arg *a = &stub->args[nr_args++];
+
+		a->vm_type	= arg->type_info.vm_type;
+		a->slot		= slot;
+
+		box_class_and_value(a->vm_type, &a->box_class, &a->box_value);
+
+		slot += get_arg_size(a->vm_type);
+	}
+
+	return stub;
+}
+
+/*
+ * Returns the reflection stub of @vmm or NULL if the method has not been
+ * called reflectively often enough to have one.
+ */
+static struct reflection_stub *reflection_stub_get(struct vm_method *vmm)
+{
+	struct reflection_stub *stub, *old;
+
+	stub = vmm->reflection_stub;
+	if (stub)
+		return stub;
+
+	if (!opt_reflection_stubs || ++vmm->reflection_count < REFLECTION_STUB_THRESHOLD)
+		return NULL;
+
+	stub = reflection_stub_alloc(vmm);
+	if (!stub)
+		return NULL;
+
+	old = cmpxchg_ptr(&vmm->reflection_stub, NULL, stub);
+	if (old) {
+		free(stub);
+		return old;
+	}
+
+	return stub;
+}
+
+static int unbox_argument(struct reflection_stub_arg *a, unsigned long *args, struct vm_object *obj)
+{
+	void *p = &args[a->slot];
+
+	if (a->vm_type == J_REFERENCE) {
+		*(jobject *) p = obj;
+		return 0;
+	}
+
+	if (!obj || obj->class != a->box_class)
+		return object_to_jvalue(p, a->vm_type, obj);
+
+	switch (a->vm_type) {
+	case J_BOOLEAN:
+		*(long *) p = field_get_boolean(obj, a->box_value);
+		break;
+	case J_BYTE:
+		*(long *) p = field_get_byte(obj, a->box_value);
+		break;
+	case J_CHAR:
+		*(long *) p = field_get_char(obj, a->box_value);
+		break;
+	case J_SHORT:
+		*(long *) p = field_get_short(obj, a->box_value);
+		break;
+	case J_INT:
+		*(long *) p = field_get_int(obj, a->box_value);
+		break;
+	case J_LONG:
+		*(jlong *) p = field_get_long(obj, a->box_value);
+		break;
+	case J_FLOAT:
+		*(jfloat *) p = field_get_float(obj, a->box_value);
+		break;
+	case J_DOUBLE:
+		*(jdouble *) p = field_get_double(obj, a->box_value);
+		break;
+	default:
+		error("unexpected type");
+	}
+
+	return 0;
+}
+
+static int stub_marshall_call_arguments(struct reflection_stub *stub, unsigned long *args,
+					struct vm_object *args_array)
+{
+	unsigned int nr_args = args_array ? vm_array_length(args_array) : 0;
+
+	if (nr_args != stub->nr_args) {
+		signal_new_exception(vm_java_lang_IllegalArgumentException, NULL);
+		return -1;
+	}
+
+	for (unsigned int i = 0; i < nr_args; i++) {
+		struct vm_object *arg_obj = array_get_field_ptr(args_array, i);
+
+		if (unbox_argument(&stub->args[i], args, arg_obj))
+			return -1;
+	}
+
+	return 0;
+}
+
+static int reflection_marshall_call_arguments(struct vm_method *vmm, unsigned long *args,
+					      struct vm_object *args_array)
+{
+	struct reflection_stub *stub;
+
+	stub = reflection_stub_get(vmm);
+	if (stub)
+		return stub_marshall_call_arguments(stub, args, args_array);
+
+	return marshall_call_arguments(vmm, args, args_array);
+}
+
 static struct vm_object *
 call_virtual_method(struct vm_method *vmm, struct vm_object *o,
 		    struct vm_object *args_array)
@@ -611,7 +829,7 @@ call_virtual_method(struct vm_method *vmm, struct vm_object *o,
 	union jvalue result;
 
 	args[0] = (unsigned long) o;
-	if (marshall_call_arguments(vmm, args + 1, args_array))
+	if (reflection_marshall_call_arguments(vmm, args + 1, args_array))
 		return NULL;
 
 	vm_call_method_this_a(vmm, o, args, &result);
@@ -624,7 +842,7 @@ call_static_method(struct vm_method *vmm, struct vm_object *args_array)
 	unsigned long args[vmm->args_count];
 	union jvalue result;
 
-	if (marshall_call_arguments(vmm, args, args_array))
+	if (reflection_marshall_call_arguments(vmm, args, args_array))
 		return NULL;
 
 	vm_call_method_a(vmm, args, &result);
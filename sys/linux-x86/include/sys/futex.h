@@ -0,0 +1,32 @@
+#ifndef SYS_FUTEX_H
+#define SYS_FUTEX_H
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <time.h>
+
+/*
+ * Blocks until *@addr is woken up with futex_wake() if it still contains
+ * @val. A NULL @timeout waits forever, otherwise it's relative to now.
+ */
+static inline int futex_wait(int *addr, int val, const struct timespec *timeout)
+{
+	return syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, timeout, NULL, 0);
+}
+
+/*
+ * Same as futex_wait() but @deadline is an absolute CLOCK_REALTIME time.
+ */
+static inline int futex_wait_until(int *addr, int val, const struct timespec *deadline)
+{
+	return syscall(SYS_futex, addr, FUTEX_WAIT_BITSET_PRIVATE | FUTEX_CLOCK_REALTIME,
+		       val, deadline, NULL, FUTEX_BITSET_MATCH_ANY);
+}
+
+static inline int futex_wake(int *addr, int nr)
+{
+	return syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, nr, NULL, NULL, 0);
+}
+
+#endif /* SYS_FUTEX_H */
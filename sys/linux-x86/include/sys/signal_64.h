@@ -29,6 +29,8 @@ save_signal_registers(struct register_state *regs, mcontext_t *mcontext)
         regs->r13	= gregs[REG_R13];
         regs->r14	= gregs[REG_R14];
         regs->r15	= gregs[REG_R15];
+	regs->sp	= gregs[REG_RSP];
+	regs->bp	= gregs[REG_RBP];
 }
 
 #endif /* X86_SIGNAL_64_H */
@@ -0,0 +1,63 @@
+package jni;
+
+/**
+ * Measures the cost of handing a large primitive array to native code with
+ * Get<Type>ArrayElements() and GetPrimitiveArrayCritical().
+ */
+public class JNIArrayBench {
+  static {
+    System.load("./test/functional/jni/libjnitest.so");
+  }
+
+  private static final int NUM_CALLS = 1000;
+  private static final int[] ARRAY_SIZES = { 1024, 64 * 1024, 4 * 1024 * 1024 };
+
+  native static int checksumElements(byte[] array);
+  native static int checksumCritical(byte[] array);
+
+  private static long start, stop;
+
+  private static void report(String name, int size, long count) {
+    long nanos = stop - start;
+
+    System.out.println(name + "(" + size + " bytes) = " + nanos / count + "ns/call");
+  }
+
+  private static void profileElements(byte[] array) {
+    int sum = 0;
+
+    start = System.nanoTime();
+    for (int i = 0; i < NUM_CALLS; i++) {
+      sum += checksumElements(array);
+    }
+    stop = System.nanoTime();
+    if (sum != NUM_CALLS * checksumElements(array))
+      throw new RuntimeException();
+    report("GetByteArrayElements", array.length, NUM_CALLS);
+  }
+
+  private static void profileCritical(byte[] array) {
+    int sum = 0;
+
+    start = System.nanoTime();
+    for (int i = 0; i < NUM_CALLS; i++) {
+      sum += checksumCritical(array);
+    }
+    stop = System.nanoTime();
+    if (sum != NUM_CALLS * checksumCritical(array))
+      throw new RuntimeException();
+    report("GetPrimitiveArrayCritical", array.length, NUM_CALLS);
+  }
+
+  public static void main(String[] args) {
+    for (int i = 0; i < ARRAY_SIZES.length; i++) {
+      byte[] array = new byte[ARRAY_SIZES[i]];
+
+      for (int j = 0; j < array.length; j++)
+        array[j] = (byte) j;
+
+      profileElements(array);
+      profileCritical(array);
+    }
+  }
+}
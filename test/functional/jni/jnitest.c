@@ -791,3 +791,114 @@ JNIEXPORT jboolean JNICALL Java_test_java_lang_JNITest_testMethodID(JNIEnv *env,
 
 	return true;
 }
+
+/*
+ * Class:     test_java_lang_JNITest
+ * Method:    sumByteArrayElements
+ * Signature: ([B)I
+ */
+JNIEXPORT jint JNICALL Java_test_java_lang_JNITest_sumByteArrayElements(JNIEnv *env, jclass clazz, jbyteArray array)
+{
+	jsize length = (*env)->GetArrayLength(env, array);
+	jbyte *elems;
+	jint sum = 0;
+
+	elems = (*env)->GetByteArrayElements(env, array, NULL);
+	if (elems == NULL)
+		return -1;
+
+	for (jsize i = 0; i < length; i++)
+		sum += elems[i];
+
+	(*env)->ReleaseByteArrayElements(env, array, elems, JNI_ABORT);
+
+	return sum;
+}
+
+/*
+ * Class:     test_java_lang_JNITest
+ * Method:    fillIntArrayCritical
+ * Signature: ([II)V
+ */
+JNIEXPORT void JNICALL Java_test_java_lang_JNITest_fillIntArrayCritical(JNIEnv *env, jclass clazz, jintArray array, jint value)
+{
+	jsize length = (*env)->GetArrayLength(env, array);
+	jint *elems;
+
+	elems = (*env)->GetPrimitiveArrayCritical(env, array, NULL);
+	if (elems == NULL)
+		return;
+
+	for (jsize i = 0; i < length; i++)
+		elems[i] = value;
+
+	(*env)->ReleasePrimitiveArrayCritical(env, array, elems, 0);
+}
+
+/*
+ * Class:     test_java_lang_JNITest
+ * Method:    testArrayElementsAreNotCopied
+ * Signature: ([I)Z
+ */
+JNIEXPORT jboolean JNICALL Java_test_java_lang_JNITest_testArrayElementsAreNotCopied(JNIEnv *env, jclass clazz, jintArray array)
+{
+	jboolean is_copy = JNI_TRUE;
+	jint *elems;
+
+	elems = (*env)->GetIntArrayElements(env, array, &is_copy);
+	if (elems == NULL)
+		return false;
+
+	/* The change is visible to Java even before the elements are released. */
+	elems[0]++;
+
+	(*env)->ReleaseIntArrayElements(env, array, elems, 0);
+
+	return is_copy == JNI_FALSE;
+}
+
+/*
+ * Class:     jni_JNIArrayBench
+ * Method:    checksumElements
+ * Signature: ([B)I
+ */
+JNIEXPORT jint JNICALL Java_jni_JNIArrayBench_checksumElements(JNIEnv *env, jclass clazz, jbyteArray array)
+{
+	jsize length = (*env)->GetArrayLength(env, array);
+	jbyte *elems;
+	jint sum = 0;
+
+	elems = (*env)->GetByteArrayElements(env, array, NULL);
+	if (elems == NULL)
+		return 0;
+
+	for (jsize i = 0; i < length; i += 4096)
+		sum += elems[i];
+
+	(*env)->ReleaseByteArrayElements(env, array, elems, JNI_ABORT);
+
+	return sum;
+}
+
+/*
+ * Class:     jni_JNIArrayBench
+ * Method:    checksumCritical
+ * Signature: ([B)I
+ */
+JNIEXPORT jint JNICALL Java_jni_JNIArrayBench_checksumCritical(JNIEnv *env, jclass clazz, jbyteArray array)
+{
+	jsize length = (*env)->GetArrayLength(env, array);
+	jbyte *elems;
+	jint sum = 0;
+
+	elems = (*env)->GetPrimitiveArrayCritical(env, array, NULL);
+	if (elems == NULL)
+		return 0;
+
+	for (jsize i = 0; i < length; i += 4096)
+		sum += elems[i];
+
+	(*env)->ReleasePrimitiveArrayCritical(env, array, elems, JNI_ABORT);
+
+	return sum;
+}
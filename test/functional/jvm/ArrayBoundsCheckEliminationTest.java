@@ -0,0 +1,134 @@
+/*
+ * This file is released under the 2-clause BSD license. Please refer to the
+ * file LICENSE for details.
+ */
+package jvm;
+
+/**
+ * Tests that array bounds check elimination for loops keeps the checks that
+ * are actually needed. The methods that access arrays do not have exception
+ * handlers of their own because the optimization skips such methods.
+ */
+public class ArrayBoundsCheckEliminationTest extends TestCase {
+    private static int sum(int[] a) {
+        int sum = 0;
+        for (int i = 0; i < a.length; i++)
+            sum += a[i];
+        return sum;
+    }
+
+    private static void fill(int[] a) {
+        int i = 0;
+        while (a.length > i) {
+            a[i] = i;
+            i = i + 1;
+        }
+    }
+
+    private static int sumInclusive(int[] a) {
+        int sum = 0;
+        for (int i = 0; i <= a.length; i++)
+            sum += a[i];
+        return sum;
+    }
+
+    private static int sumFromNegative(int[] a) {
+        int sum = 0;
+        for (int i = -1; i < a.length; i++)
+            sum += a[i];
+        return sum;
+    }
+
+    private static int sumDownwards(int[] a) {
+        int sum = 0;
+        for (int i = 0; i < a.length; i--)
+            sum += a[i];
+        return sum;
+    }
+
+    private static int sumSwitchArray(int[] a, int[] b) {
+        int sum = 0;
+        for (int i = 0; i < a.length; i++) {
+            sum += a[i];
+            a = b;
+        }
+        return sum;
+    }
+
+    private static int sumOtherArray(int[] a, int[] b) {
+        int sum = 0;
+        for (int i = 0; i < a.length; i++)
+            sum += b[i];
+        return sum;
+    }
+
+    private static boolean sumInclusiveThrows(int[] a) {
+        try {
+            sumInclusive(a);
+        } catch (ArrayIndexOutOfBoundsException e) {
+            return true;
+        }
+        return false;
+    }
+
+    private static boolean sumFromNegativeThrows(int[] a) {
+        try {
+            sumFromNegative(a);
+        } catch (ArrayIndexOutOfBoundsException e) {
+            return true;
+        }
+        return false;
+    }
+
+    private static boolean sumDownwardsThrows(int[] a) {
+        try {
+            sumDownwards(a);
+        } catch (ArrayIndexOutOfBoundsException e) {
+            return true;
+        }
+        return false;
+    }
+
+    private static boolean sumSwitchArrayThrows(int[] a, int[] b) {
+        try {
+            sumSwitchArray(a, b);
+        } catch (ArrayIndexOutOfBoundsException e) {
+            return true;
+        }
+        return false;
+    }
+
+    private static boolean sumOtherArrayThrows(int[] a, int[] b) {
+        try {
+            sumOtherArray(a, b);
+        } catch (ArrayIndexOutOfBoundsException e) {
+            return true;
+        }
+        return false;
+    }
+
+    public static void testLoopWithRedundantChecks() {
+        int[] a = new int[10];
+
+        fill(a);
+
+        assertEquals(45, sum(a));
+        assertEquals(0, sum(new int[0]));
+    }
+
+    public static void testLoopWithNeededChecks() {
+        int[] a = new int[10];
+        int[] b = new int[1];
+
+        assertTrue(sumInclusiveThrows(a));
+        assertTrue(sumFromNegativeThrows(a));
+        assertTrue(sumDownwardsThrows(a));
+        assertTrue(sumSwitchArrayThrows(a, b));
+        assertTrue(sumOtherArrayThrows(a, b));
+    }
+
+    public static void main(String[] args) {
+        testLoopWithRedundantChecks();
+        testLoopWithNeededChecks();
+    }
+}
@@ -0,0 +1,198 @@
+/*
+ * This file is released under the 2-clause BSD license. Please refer to the
+ * file LICENSE for details.
+ */
+package jvm;
+
+/**
+ * Tests that reachable objects survive garbage collection. The tests
+ * allocate many times the size of the heap they are run with so that the
+ * collector runs while references are held in locals, fields and arrays.
+ */
+public class GcTest extends TestCase {
+    private static final int NR_ITERATIONS = 200;
+
+    private static Node staticList;
+
+    public static class Node {
+        public Node next;
+        public int value;
+        public long[] payload;
+
+        public Node(Node next, int value) {
+            this.next = next;
+            this.value = value;
+            this.payload = new long[32];
+            this.payload[31] = value;
+        }
+    }
+
+    private static Node makeList(int length) {
+        Node list = null;
+
+        for (int i = 0; i < length; i++)
+            list = new Node(list, i);
+
+        return list;
+    }
+
+    private static void checkList(Node list, int length) {
+        for (int i = length - 1; i >= 0; i--) {
+            assertNotNull(list);
+            assertEquals(i, list.value);
+            assertEquals(i, (int) list.payload[31]);
+            list = list.next;
+        }
+        assertNull(list);
+    }
+
+    public static void testLocalsSurvive() {
+        Node list = makeList(100);
+
+        for (int i = 0; i < NR_ITERATIONS; i++) {
+            makeList(100);
+            checkList(list, 100);
+        }
+    }
+
+    public static void testStaticFieldsSurvive() {
+        staticList = makeList(100);
+
+        for (int i = 0; i < NR_ITERATIONS; i++)
+            makeList(100);
+
+        checkList(staticList, 100);
+        staticList = null;
+    }
+
+    public static void testArraysSurvive() {
+        Object[] array = new Object[1000];
+
+        for (int i = 0; i < array.length; i++)
+            array[i] = new Integer(i);
+
+        for (int i = 0; i < NR_ITERATIONS; i++)
+            makeList(100);
+
+        for (int i = 0; i < array.length; i++)
+            assertEquals(i, ((Integer) array[i]).intValue());
+    }
+
+    public static void testLargeObjects() {
+        int[] large = new int[100000];
+
+        large[large.length - 1] = 42;
+
+        for (int i = 0; i < NR_ITERATIONS / 10; i++) {
+            int[] garbage = new int[100000];
+            garbage[0] = i;
+        }
+
+        assertEquals(42, large[large.length - 1]);
+    }
+
+    public static void testStrings() {
+        String s = "";
+
+        for (int i = 0; i < 1000; i++)
+            s = s + (i % 10);
+
+        for (int i = 0; i < NR_ITERATIONS; i++)
+            makeList(100);
+
+        assertEquals(1000, s.length());
+        assertEquals('9', s.charAt(999));
+    }
+
+    public static void testOldToYoungReferences() {
+        Object[] array = new Object[5000];
+        Node node = new Node(null, -1);
+
+        /* Make the array and the node old. */
+        Runtime.getRuntime().gc();
+
+        for (int i = 0; i < NR_ITERATIONS; i++) {
+            array[i] = new Integer(i);
+            array[array.length - 1 - i] = new Node(null, i);
+            node.next = new Node(node.next, i);
+            makeList(100);
+        }
+
+        Object[] young = new Object[NR_ITERATIONS];
+        for (int i = 0; i < young.length; i++)
+            young[i] = new Integer(i);
+        System.arraycopy(young, 0, array, NR_ITERATIONS, young.length);
+        young = null;
+
+        for (int i = 0; i < NR_ITERATIONS; i++)
+            makeList(100);
+
+        for (int i = 0; i < NR_ITERATIONS; i++) {
+            assertEquals(i, ((Integer) array[i]).intValue());
+            assertEquals(i, ((Integer) array[NR_ITERATIONS + i]).intValue());
+            assertEquals(i, ((Node) array[array.length - 1 - i]).value);
+        }
+        checkList(node.next, NR_ITERATIONS);
+    }
+
+    /*
+     * Objects of every small size class are allocated from thread-local
+     * allocation buffers. Only some of each class are kept and collections
+     * run while the rest of the buffers are still free, so an object that is
+     * handed out twice overwrites one that is kept.
+     */
+    public static void testTlabSizeClasses() {
+        long[][] kept = new long[NR_ITERATIONS][];
+
+        for (int i = 0; i < kept.length; i++) {
+            kept[i] = new long[i % 32];
+            for (int j = 0; j < kept[i].length; j++)
+                kept[i][j] = i;
+
+            for (int j = 0; j < 32; j++) {
+                long[] garbage = new long[j];
+                for (int k = 0; k < garbage.length; k++)
+                    garbage[k] = -1;
+            }
+
+            if (i % 20 == 0)
+                Runtime.getRuntime().gc();
+        }
+
+        for (int i = 0; i < NR_ITERATIONS; i++)
+            makeList(100);
+
+        for (int i = 0; i < kept.length; i++) {
+            assertEquals(i % 32, kept[i].length);
+            for (int j = 0; j < kept[i].length; j++)
+                assertEquals(i, kept[i][j]);
+        }
+    }
+
+    public static void testThreads() throws InterruptedException {
+        Thread[] threads = new Thread[4];
+
+        for (int i = 0; i < threads.length; i++) {
+            threads[i] = new Thread() {
+                public void run() {
+                    testLocalsSurvive();
+                }
+            };
+            threads[i].start();
+        }
+
+        for (int i = 0; i < threads.length; i++)
+            threads[i].join();
+    }
+
+    public static void main(String[] args) throws InterruptedException {
+        testLocalsSurvive();
+        testStaticFieldsSurvive();
+        testArraysSurvive();
+        testLargeObjects();
+        testStrings();
+        testOldToYoungReferences();
+        testTlabSizeClasses();
+        testThreads();
+    }
+}
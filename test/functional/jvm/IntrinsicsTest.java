@@ -0,0 +1,178 @@
+/*
+ * This file is released under the 2-clause BSD license. Please refer to the
+ * file LICENSE for details.
+ */
+package jvm;
+
+/**
+ * Tests for methods that the JIT replaces with intrinsics. The same tests
+ * are run with -XX:-UseIntrinsics to check that both versions agree.
+ */
+public class IntrinsicsTest extends TestCase {
+    public static void testMathAbs() {
+        assertEquals(0, Math.abs(0));
+        assertEquals(1, Math.abs(-1));
+        assertEquals(Integer.MAX_VALUE, Math.abs(-Integer.MAX_VALUE));
+        assertEquals(Integer.MIN_VALUE, Math.abs(Integer.MIN_VALUE));
+
+        assertEquals(1L, Math.abs(-1L));
+        assertEquals(Long.MAX_VALUE, Math.abs(Long.MAX_VALUE));
+        assertEquals(Long.MIN_VALUE, Math.abs(Long.MIN_VALUE));
+
+        assertEquals(1.5f, Math.abs(-1.5f));
+        assertEquals(0, Float.floatToRawIntBits(Math.abs(-0.0f)));
+        assertTrue(Float.isNaN(Math.abs(Float.NaN)));
+        assertEquals(Float.POSITIVE_INFINITY, Math.abs(Float.NEGATIVE_INFINITY));
+
+        assertEquals(2.5, Math.abs(-2.5));
+        assertEquals(0L, Double.doubleToRawLongBits(Math.abs(-0.0)));
+        assertTrue(Double.isNaN(Math.abs(Double.NaN)));
+        assertEquals(Double.POSITIVE_INFINITY, Math.abs(Double.NEGATIVE_INFINITY));
+    }
+
+    public static void testMathMinMax() {
+        assertEquals(-1, Math.min(-1, 1));
+        assertEquals(-1, Math.min(1, -1));
+        assertEquals(1, Math.max(-1, 1));
+        assertEquals(1, Math.max(1, -1));
+        assertEquals(Integer.MIN_VALUE, Math.min(Integer.MIN_VALUE, Integer.MAX_VALUE));
+        assertEquals(Integer.MAX_VALUE, Math.max(Integer.MIN_VALUE, Integer.MAX_VALUE));
+
+        assertEquals(Long.MIN_VALUE, Math.min(Long.MIN_VALUE, 0L));
+        assertEquals(Long.MAX_VALUE, Math.max(0L, Long.MAX_VALUE));
+        assertEquals(0x100000000L, Math.max(0x100000000L, 1L));
+    }
+
+    public static void testMathSqrt() {
+        assertEquals(3.0, Math.sqrt(9.0));
+        assertEquals(Math.PI, Math.sqrt(Math.PI * Math.PI));
+        assertTrue(Double.isNaN(Math.sqrt(-1.0)));
+        assertTrue(Double.isNaN(Math.sqrt(Double.NaN)));
+        assertEquals(Double.POSITIVE_INFINITY, Math.sqrt(Double.POSITIVE_INFINITY));
+        assertEquals(0x8000000000000000L, Double.doubleToRawLongBits(Math.sqrt(-0.0)));
+    }
+
+    public static void testArraycopy() {
+        int[] src = { 1, 2, 3, 4, 5 };
+        int[] dest = new int[5];
+
+        System.arraycopy(src, 1, dest, 0, 3);
+        assertArrayEquals(new int[] { 2, 3, 4, 0, 0 }, dest);
+
+        System.arraycopy(src, 0, src, 1, 4);
+        assertArrayEquals(new int[] { 1, 1, 2, 3, 4 }, src);
+
+        System.arraycopy(src, 1, src, 0, 4);
+        assertArrayEquals(new int[] { 1, 2, 3, 4, 4 }, src);
+
+        String[] strings = { "a", "b" };
+        Object[] objects = new Object[2];
+        System.arraycopy(strings, 0, objects, 0, 2);
+        assertSame(strings[0], objects[0]);
+        assertSame(strings[1], objects[1]);
+    }
+
+    public static void testArraycopyExceptions() {
+        int[] array = new int[4];
+
+        try {
+            System.arraycopy(null, 0, array, 0, 1);
+            fail();
+        } catch (NullPointerException e) {
+        }
+
+        try {
+            System.arraycopy(array, 0, new long[4], 0, 1);
+            fail();
+        } catch (ArrayStoreException e) {
+        }
+
+        try {
+            System.arraycopy(array, 2, array, 0, 3);
+            fail();
+        } catch (ArrayIndexOutOfBoundsException e) {
+        }
+
+        try {
+            System.arraycopy(array, 1, array, 0, Integer.MAX_VALUE);
+            fail();
+        } catch (ArrayIndexOutOfBoundsException e) {
+        }
+
+        try {
+            System.arraycopy(array, 0, array, 0, -1);
+            fail();
+        } catch (ArrayIndexOutOfBoundsException e) {
+        }
+
+        Object[] objects = { "a", "b", new Object(), "d" };
+        String[] strings = new String[4];
+        try {
+            System.arraycopy(objects, 0, strings, 0, 4);
+            fail();
+        } catch (ArrayStoreException e) {
+        }
+        assertEquals("a", strings[0]);
+        assertEquals("b", strings[1]);
+        assertNull(strings[2]);
+    }
+
+    public static void testStringEquals() {
+        String s = "hello, world";
+
+        assertTrue(s.equals(s));
+        assertTrue(s.equals(new String("hello, world")));
+        assertTrue(s.substring(7).equals("world"));
+        assertFalse(s.equals("hello, World"));
+        assertFalse(s.equals("hello"));
+        assertFalse(s.equals(null));
+        assertFalse(s.equals(new Object()));
+        assertTrue("".equals(s.substring(12)));
+    }
+
+    private static int slowHashCode(String s) {
+        int hash = 0;
+
+        for (int i = 0; i < s.length(); i++)
+            hash = 31 * hash + s.charAt(i);
+
+        return hash;
+    }
+
+    public static void testStringHashCode() {
+        String s = "The quick brown fox jumps over the lazy dog";
+
+        for (int i = 0; i <= s.length(); i++)
+            assertEquals(slowHashCode(s.substring(i)), s.substring(i).hashCode());
+
+        assertEquals(0, "".hashCode());
+        assertEquals(s.hashCode(), s.hashCode());
+    }
+
+    public static void testStringIndexOf() {
+        String s = "abcdefghijklmnopqrstuvwxyz-abcdefghijklmnopqrstuvwxyz";
+
+        assertEquals(0, s.indexOf('a'));
+        assertEquals(25, s.indexOf('z'));
+        assertEquals(26, s.indexOf('-'));
+        assertEquals(27, s.indexOf('a', 1));
+        assertEquals(52, s.indexOf('z', 26));
+        assertEquals(-1, s.indexOf('z', 53));
+        assertEquals(-1, s.indexOf('A'));
+        assertEquals(0, s.indexOf('a', -5));
+        assertEquals(-1, s.indexOf('a', Integer.MAX_VALUE));
+        assertEquals(1, s.substring(26).indexOf('a'));
+        assertEquals(-1, "".indexOf('a'));
+    }
+
+    public static void main(String[] args) {
+        testMathAbs();
+        testMathMinMax();
+        testMathSqrt();
+        testArraycopy();
+        testArraycopyExceptions();
+        testStringEquals();
+        testStringHashCode();
+        testStringIndexOf();
+    }
+}
@@ -0,0 +1,136 @@
+/*
+ * This file is released under the 2-clause BSD license. Please refer to the
+ * file LICENSE for details.
+ */
+package jvm;
+
+/**
+ * Tests for allocation from thread-local allocation buffers. The loops
+ * allocate more objects than fit in one batch so that the free lists are
+ * refilled in the middle of them.
+ */
+public class TLABTest extends TestCase {
+    private static final int NR_OBJECTS = 10000;
+
+    public static class Small {
+        public int x;
+    }
+
+    public static class Medium {
+        public long a, b, c;
+        public Object d;
+    }
+
+    public static class Large {
+        public long a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p;
+        public long q, r, s, t, u, v, w, x, y, z;
+    }
+
+    public static void testObjectsAreCleared() {
+        for (int i = 0; i < NR_OBJECTS; i++) {
+            Small small = new Small();
+            assertEquals(0, small.x);
+            small.x = i;
+
+            Medium medium = new Medium();
+            assertEquals(0, medium.a);
+            assertEquals(0, medium.b);
+            assertEquals(0, medium.c);
+            assertNull(medium.d);
+            medium.d = small;
+            medium.c = -1;
+
+            Large large = new Large();
+            assertEquals(0, large.a);
+            assertEquals(0, large.z);
+        }
+    }
+
+    public static void testObjectsAreDistinct() {
+        Small[] objects = new Small[NR_OBJECTS];
+
+        for (int i = 0; i < objects.length; i++) {
+            objects[i] = new Small();
+            objects[i].x = i;
+        }
+
+        for (int i = 0; i < objects.length; i++) {
+            assertEquals(i, objects[i].x);
+            assertTrue(objects[i].getClass() == Small.class);
+        }
+    }
+
+    public static void testConstantSizeArrays() {
+        for (int i = 0; i < NR_OBJECTS; i++) {
+            boolean[] z = new boolean[3];
+            assertEquals(3, z.length);
+            assertFalse(z[2]);
+
+            byte[] b = new byte[7];
+            assertEquals(7, b.length);
+            assertEquals(0, b[6]);
+            b[6] = 1;
+
+            char[] c = new char[0];
+            assertEquals(0, c.length);
+
+            short[] s = new short[9];
+            assertEquals(9, s.length);
+            assertEquals(0, s[8]);
+
+            int[] n = new int[16];
+            assertEquals(16, n.length);
+            assertEquals(0, n[15]);
+            n[15] = -1;
+
+            long[] j = new long[4];
+            assertEquals(4, j.length);
+            assertEquals(0, j[3]);
+
+            float[] f = new float[2];
+            assertEquals(2, f.length);
+
+            double[] d = new double[1000];
+            assertEquals(1000, d.length);
+        }
+    }
+
+    public static void testArrayClasses() {
+        assertTrue(new int[1].getClass() == int[].class);
+        assertTrue(new byte[1].getClass() == byte[].class);
+        assertTrue(new double[1].getClass() == double[].class);
+    }
+
+    public static void testNegativeConstantSize() {
+        try {
+            int[] array = new int[-1];
+            fail();
+        } catch (NegativeArraySizeException e) {
+        }
+    }
+
+    public static void testThreads() throws InterruptedException {
+        Thread[] threads = new Thread[4];
+
+        for (int i = 0; i < threads.length; i++) {
+            threads[i] = new Thread() {
+                public void run() {
+                    testObjectsAreDistinct();
+                }
+            };
+            threads[i].start();
+        }
+
+        for (int i = 0; i < threads.length; i++)
+            threads[i].join();
+    }
+
+    public static void main(String[] args) throws InterruptedException {
+        testObjectsAreCleared();
+        testObjectsAreDistinct();
+        testConstantSizeArrays();
+        testArrayClasses();
+        testNegativeConstantSize();
+        testThreads();
+    }
+}
@@ -0,0 +1,129 @@
+/*
+ * This file is released under the 2-clause BSD license. Please refer to the
+ * file LICENSE for details.
+ */
+package jvm;
+
+/**
+ * Tests instanceof and checkcast against classes that are checked inline with
+ * the supertype display and against interfaces, arrays and classes that are
+ * too deep in the hierarchy for the display.
+ */
+public class TypeCheckTest extends TestCase {
+    public static interface Shape { }
+    public static interface Polygon extends Shape { }
+
+    public static class A { }
+    public static class B extends A implements Polygon { }
+    public static class C extends B { }
+    public static class D extends C { }
+    public static class E extends D { }
+    public static class F extends E { }
+    public static class G extends F { }
+    public static class H extends G { }
+    public static class I extends H { }
+    public static class J extends I { }
+
+    public static void testInstanceofClass() {
+        Object a = new A();
+        Object c = new C();
+
+        assertTrue(a instanceof A);
+        assertFalse(a instanceof B);
+        assertTrue(c instanceof A);
+        assertTrue(c instanceof B);
+        assertTrue(c instanceof C);
+        assertFalse(c instanceof D);
+        assertFalse(new Object() instanceof A);
+        assertFalse(null instanceof A);
+    }
+
+    public static void testInstanceofDeepClass() {
+        Object j = new J();
+        Object h = new H();
+
+        assertTrue(j instanceof A);
+        assertTrue(j instanceof G);
+        assertTrue(j instanceof H);
+        assertTrue(j instanceof I);
+        assertTrue(j instanceof J);
+        assertTrue(h instanceof H);
+        assertFalse(h instanceof I);
+        assertFalse(h instanceof J);
+        assertFalse(null instanceof J);
+    }
+
+    public static void testInstanceofInterface() {
+        Object a = new A();
+        Object j = new J();
+
+        assertFalse(a instanceof Shape);
+        assertTrue(j instanceof Shape);
+        assertTrue(j instanceof Polygon);
+        assertTrue(j instanceof Shape);
+        assertFalse(null instanceof Shape);
+    }
+
+    public static void testInstanceofArray() {
+        Object cs = new C[1];
+        Object ints = new int[1];
+
+        assertTrue(cs instanceof Object[]);
+        assertTrue(cs instanceof A[]);
+        assertTrue(cs instanceof Shape[]);
+        assertFalse(cs instanceof D[]);
+        assertTrue(cs instanceof Cloneable);
+        assertTrue(ints instanceof int[]);
+        assertFalse(ints instanceof long[]);
+        assertFalse(ints instanceof Object[]);
+        assertTrue(new C[1][1] instanceof Object[][]);
+        assertTrue(new int[1][1] instanceof Object[]);
+    }
+
+    private static boolean castFails(Object obj, int type) {
+        try {
+            switch (type) {
+            case 0:
+                takeObject((C) obj);
+                break;
+            case 1:
+                takeObject((I) obj);
+                break;
+            case 2:
+                takeObject((Polygon) obj);
+                break;
+            case 3:
+                takeObject((A[]) obj);
+                break;
+            }
+        } catch (ClassCastException e) {
+            return true;
+        }
+        return false;
+    }
+
+    public static void testCheckcast() {
+        assertFalse(castFails(new C(), 0));
+        assertFalse(castFails(new J(), 0));
+        assertFalse(castFails(null, 0));
+        assertTrue(castFails(new B(), 0));
+        assertTrue(castFails("C", 0));
+
+        assertFalse(castFails(new J(), 1));
+        assertTrue(castFails(new H(), 1));
+
+        assertFalse(castFails(new B(), 2));
+        assertTrue(castFails(new A(), 2));
+
+        assertFalse(castFails(new D[1], 3));
+        assertTrue(castFails(new Object[1], 3));
+    }
+
+    public static void main(String[] args) {
+        testInstanceofClass();
+        testInstanceofDeepClass();
+        testInstanceofInterface();
+        testInstanceofArray();
+        testCheckcast();
+    }
+}
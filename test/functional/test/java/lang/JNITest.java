@@ -82,6 +82,9 @@ public class JNITest extends TestCase {
   native static public Class<?> testGetObjectClass(Object obj);
   native static public boolean isInstanceOf(Object obj, Class<?> clazz);
   native static public boolean testMethodID(Class<?> clazz, String methodName, String signature);
+  native static public int sumByteArrayElements(byte[] array);
+  native static public void fillIntArrayCritical(int[] array, int value);
+  native static public boolean testArrayElementsAreNotCopied(int[] array);
 
   private static JNITest jniTest = new JNITest();
 
@@ -380,6 +383,20 @@ public class JNITest extends TestCase {
     }, NoSuchMethodError.class);
   }
 
+  public static void testArrayElements() {
+    assertEquals(10, sumByteArrayElements(new byte[]{1, 2, 3, 4}));
+    assertEquals(0, sumByteArrayElements(new byte[0]));
+
+    int[] array = new int[16];
+    fillIntArrayCritical(array, 42);
+    for (int i = 0; i < array.length; i++)
+      assertEquals(42, array[i]);
+
+    array = new int[]{1, 2, 3};
+    assertTrue(testArrayElementsAreNotCopied(array));
+    assertEquals(2, array[0]);
+  }
+
   public static void main(String[] args) {
     testReturnPassedString();
     testReturnPassedInt();
@@ -410,5 +427,6 @@ public class JNITest extends TestCase {
     testGetObjectClass();
     testIsInstanceOf();
     testMethodID();
+    testArrayElements();
   }
 }
@@ -0,0 +1,602 @@
+/*
+ * Measures how long the JIT takes to compile large methods. Each method in
+ * the corpus is timed on its first call, which includes compilation, and on
+ * its second call, and the difference is reported as compile time. The
+ * methods have many basic blocks, many live variables and deep loop nests,
+ * which is where the data flow passes of the compiler spend their time.
+ */
+public class CompileTime {
+  private static long start, stop;
+
+  private interface Method {
+    int run(int x);
+  }
+
+  private static int bigSwitch(int x) {
+    int a = x, b = x + 1, c = x + 2, d = x + 3;
+    for (int i = 0; i < 4; i++) {
+      switch ((x + i) & 127) {
+      case 0: a = b - 1; b = c | d; break;
+      case 1: a = b + 2; b = c * d; break;
+      case 2: a = b + 3; b = c ^ d; break;
+      case 3: a = b ^ 4; b = c ^ d; break;
+      case 4: a = b & 5; b = c ^ d; break;
+      case 5: a = b - 6; b = c + d; break;
+      case 6: a = b ^ 7; b = c + d; break;
+      case 7: a = b ^ 8; b = c ^ d; break;
+      case 8: a = b | 9; b = c + d; break;
+      case 9: a = b & 10; b = c ^ d; break;
+      case 10: a = b * 11; b = c & d; break;
+      case 11: a = b - 12; b = c | d; break;
+      case 12: a = b + 13; b = c * d; break;
+      case 13: a = b + 14; b = c + d; break;
+      case 14: a = b + 15; b = c & d; break;
+      case 15: a = b | 16; b = c + d; break;
+      case 16: a = b ^ 17; b = c & d; break;
+      case 17: a = b - 18; b = c ^ d; break;
+      case 18: a = b & 19; b = c + d; break;
+      case 19: a = b | 20; b = c - d; break;
+      case 20: a = b ^ 21; b = c ^ d; break;
+      case 21: a = b | 22; b = c - d; break;
+      case 22: a = b * 23; b = c - d; break;
+      case 23: a = b & 24; b = c - d; break;
+      case 24: a = b ^ 25; b = c * d; break;
+      case 25: a = b + 26; b = c ^ d; break;
+      case 26: a = b | 27; b = c & d; break;
+      case 27: a = b + 28; b = c - d; break;
+      case 28: a = b & 29; b = c & d; break;
+      case 29: a = b * 30; b = c + d; break;
+      case 30: a = b & 31; b = c * d; break;
+      case 31: a = b & 32; b = c & d; break;
+      case 32: a = b | 33; b = c ^ d; break;
+      case 33: a = b | 34; b = c & d; break;
+      case 34: a = b - 35; b = c * d; break;
+      case 35: a = b * 36; b = c | d; break;
+      case 36: a = b ^ 37; b = c | d; break;
+      case 37: a = b ^ 38; b = c | d; break;
+      case 38: a = b + 39; b = c ^ d; break;
+      case 39: a = b - 40; b = c & d; break;
+      case 40: a = b ^ 41; b = c ^ d; break;
+      case 41: a = b & 42; b = c - d; break;
+      case 42: a = b * 43; b = c | d; break;
+      case 43: a = b & 44; b = c & d; break;
+      case 44: a = b & 45; b = c * d; break;
+      case 45: a = b + 46; b = c ^ d; break;
+      case 46: a = b & 47; b = c | d; break;
+      case 47: a = b + 48; b = c - d; break;
+      case 48: a = b | 49; b = c ^ d; break;
+      case 49: a = b * 50; b = c ^ d; break;
+      case 50: a = b & 51; b = c + d; break;
+      case 51: a = b ^ 52; b = c + d; break;
+      case 52: a = b * 53; b = c & d; break;
+      case 53: a = b | 54; b = c | d; break;
+      case 54: a = b | 55; b = c ^ d; break;
+      case 55: a = b & 56; b = c - d; break;
+      case 56: a = b - 57; b = c | d; break;
+      case 57: a = b - 58; b = c + d; break;
+      case 58: a = b - 59; b = c | d; break;
+      case 59: a = b | 60; b = c - d; break;
+      case 60: a = b ^ 61; b = c | d; break;
+      case 61: a = b * 62; b = c | d; break;
+      case 62: a = b * 63; b = c ^ d; break;
+      case 63: a = b * 64; b = c & d; break;
+      case 64: a = b | 65; b = c | d; break;
+      case 65: a = b & 66; b = c + d; break;
+      case 66: a = b ^ 67; b = c & d; break;
+      case 67: a = b | 68; b = c - d; break;
+      case 68: a = b | 69; b = c | d; break;
+      case 69: a = b - 70; b = c ^ d; break;
+      case 70: a = b + 71; b = c ^ d; break;
+      case 71: a = b * 72; b = c | d; break;
+      case 72: a = b | 73; b = c - d; break;
+      case 73: a = b | 74; b = c ^ d; break;
+      case 74: a = b ^ 75; b = c * d; break;
+      case 75: a = b ^ 76; b = c * d; break;
+      case 76: a = b + 77; b = c | d; break;
+      case 77: a = b | 78; b = c | d; break;
+      case 78: a = b | 79; b = c * d; break;
+      case 79: a = b ^ 80; b = c | d; break;
+      case 80: a = b + 81; b = c - d; break;
+      case 81: a = b & 82; b = c - d; break;
+      case 82: a = b | 83; b = c | d; break;
+      case 83: a = b - 84; b = c + d; break;
+      case 84: a = b | 85; b = c * d; break;
+      case 85: a = b + 86; b = c & d; break;
+      case 86: a = b + 87; b = c + d; break;
+      case 87: a = b + 88; b = c ^ d; break;
+      case 88: a = b + 89; b = c * d; break;
+      case 89: a = b - 90; b = c * d; break;
+      case 90: a = b + 91; b = c | d; break;
+      case 91: a = b - 92; b = c * d; break;
+      case 92: a = b * 93; b = c + d; break;
+      case 93: a = b - 94; b = c - d; break;
+      case 94: a = b * 95; b = c | d; break;
+      case 95: a = b - 96; b = c & d; break;
+      case 96: a = b * 97; b = c & d; break;
+      case 97: a = b & 98; b = c * d; break;
+      case 98: a = b ^ 99; b = c & d; break;
+      case 99: a = b * 100; b = c ^ d; break;
+      case 100: a = b ^ 101; b = c + d; break;
+      case 101: a = b + 102; b = c * d; break;
+      case 102: a = b ^ 103; b = c * d; break;
+      case 103: a = b ^ 104; b = c - d; break;
+      case 104: a = b * 105; b = c + d; break;
+      case 105: a = b * 106; b = c & d; break;
+      case 106: a = b | 107; b = c - d; break;
+      case 107: a = b | 108; b = c ^ d; break;
+      case 108: a = b + 109; b = c - d; break;
+      case 109: a = b + 110; b = c ^ d; break;
+      case 110: a = b - 111; b = c + d; break;
+      case 111: a = b & 112; b = c - d; break;
+      case 112: a = b ^ 113; b = c & d; break;
+      case 113: a = b | 114; b = c & d; break;
+      case 114: a = b ^ 115; b = c | d; break;
+      case 115: a = b - 116; b = c & d; break;
+      case 116: a = b & 117; b = c | d; break;
+      case 117: a = b ^ 118; b = c - d; break;
+      case 118: a = b | 119; b = c & d; break;
+      case 119: a = b + 120; b = c ^ d; break;
+      case 120: a = b & 121; b = c | d; break;
+      case 121: a = b * 122; b = c & d; break;
+      case 122: a = b & 123; b = c ^ d; break;
+      case 123: a = b + 124; b = c & d; break;
+      case 124: a = b * 125; b = c - d; break;
+      case 125: a = b - 126; b = c + d; break;
+      case 126: a = b * 127; b = c + d; break;
+      case 127: a = b + 128; b = c * d; break;
+      }
+      c += a;
+      d ^= b;
+    }
+    return a + b + c + d;
+  }
+
+  private static int manyLocals(int x) {
+    int v0 = x;
+    int v1 = v0 - 1;
+    int v2 = v1 ^ 2;
+    int v3 = v0 + 3;
+    int v4 = v0 - 4;
+    int v5 = v4 * 5;
+    int v6 = v1 + 6;
+    int v7 = v3 - 7;
+    int v8 = v5 + 8;
+    int v9 = v3 * 9;
+    int v10 = v9 - 10;
+    int v11 = v7 + 11;
+    int v12 = v10 * 12;
+    int v13 = v4 * 13;
+    int v14 = v0 ^ 14;
+    int v15 = v9 * 15;
+    int v16 = v9 + 16;
+    int v17 = v5 - 17;
+    int v18 = v10 - 18;
+    int v19 = v10 * 19;
+    int v20 = v6 ^ 20;
+    int v21 = v3 * 21;
+    int v22 = v17 ^ 22;
+    int v23 = v21 * 23;
+    int v24 = v17 - 24;
+    int v25 = v2 + 25;
+    int v26 = v2 - 26;
+    int v27 = v5 - 27;
+    int v28 = v17 - 28;
+    int v29 = v8 ^ 29;
+    int v30 = v19 ^ 30;
+    int v31 = v11 ^ 31;
+    int v32 = v21 + 32;
+    int v33 = v18 - 33;
+    int v34 = v31 - 34;
+    int v35 = v6 ^ 35;
+    int v36 = v2 * 36;
+    int v37 = v4 * 37;
+    int v38 = v9 - 38;
+    int v39 = v21 + 39;
+    int v40 = v39 * 40;
+    int v41 = v4 - 41;
+    int v42 = v36 + 42;
+    int v43 = v17 ^ 43;
+    int v44 = v18 + 44;
+    int v45 = v29 ^ 45;
+    int v46 = v6 + 46;
+    int v47 = v18 + 47;
+    int v48 = v39 + 48;
+    int v49 = v5 * 49;
+    int v50 = v7 + 50;
+    int v51 = v12 - 51;
+    int v52 = v50 * 52;
+    int v53 = v10 + 53;
+    int v54 = v28 - 54;
+    int v55 = v43 - 55;
+    int v56 = v10 + 56;
+    int v57 = v27 * 57;
+    int v58 = v51 ^ 58;
+    int v59 = v35 ^ 59;
+    int v60 = v45 * 60;
+    int v61 = v20 + 61;
+    int v62 = v13 ^ 62;
+    int v63 = v2 + 63;
+    v0 = v1 ^ v37;
+    v1 = v40 - v57;
+    v2 = v40 + v51;
+    v3 = v8 ^ v40;
+    v4 = v58 - v14;
+    v5 = v27 ^ v60;
+    v6 = v45 + v33;
+    v7 = v26 + v39;
+    v8 = v31 + v46;
+    v9 = v35 - v11;
+    v10 = v11 + v43;
+    v11 = v49 + v39;
+    v12 = v41 - v23;
+    v13 = v38 - v31;
+    v14 = v12 + v11;
+    v15 = v28 + v2;
+    v16 = v51 - v9;
+    v17 = v9 + v9;
+    v18 = v1 - v37;
+    v19 = v63 + v60;
+    v20 = v12 + v41;
+    v21 = v22 + v22;
+    v22 = v18 - v40;
+    v23 = v13 + v37;
+    v24 = v26 ^ v18;
+    v25 = v4 ^ v40;
+    v26 = v26 - v22;
+    v27 = v55 + v20;
+    v28 = v31 + v32;
+    v29 = v57 ^ v55;
+    v30 = v32 ^ v56;
+    v31 = v58 - v1;
+    v32 = v43 - v21;
+    v33 = v62 ^ v3;
+    v34 = v53 + v2;
+    v35 = v45 ^ v17;
+    v36 = v16 - v17;
+    v37 = v35 ^ v50;
+    v38 = v51 ^ v22;
+    v39 = v11 - v29;
+    v40 = v0 ^ v22;
+    v41 = v40 ^ v56;
+    v42 = v28 - v30;
+    v43 = v63 + v61;
+    v44 = v52 ^ v43;
+    v45 = v35 + v28;
+    v46 = v9 + v47;
+    v47 = v26 - v39;
+    v48 = v38 + v47;
+    v49 = v59 + v10;
+    v50 = v48 + v22;
+    v51 = v32 + v54;
+    v52 = v6 ^ v63;
+    v53 = v50 - v44;
+    v54 = v21 ^ v5;
+    v55 = v11 ^ v32;
+    v56 = v12 ^ v34;
+    v57 = v10 ^ v17;
+    v58 = v10 + v56;
+    v59 = v48 - v55;
+    v60 = v21 - v41;
+    v61 = v16 + v62;
+    v62 = v15 ^ v55;
+    v63 = v52 ^ v15;
+    v0 = v37 + v35;
+    v1 = v48 + v0;
+    v2 = v56 + v2;
+    v3 = v31 + v33;
+    v4 = v22 + v36;
+    v5 = v25 - v34;
+    v6 = v32 + v57;
+    v7 = v45 - v62;
+    v8 = v15 ^ v26;
+    v9 = v49 - v26;
+    v10 = v13 + v3;
+    v11 = v1 ^ v37;
+    v12 = v17 ^ v9;
+    v13 = v47 - v39;
+    v14 = v45 + v41;
+    v15 = v15 ^ v56;
+    v16 = v57 - v44;
+    v17 = v51 ^ v43;
+    v18 = v63 ^ v14;
+    v19 = v48 + v48;
+    v20 = v0 ^ v35;
+    v21 = v25 ^ v59;
+    v22 = v52 ^ v39;
+    v23 = v21 ^ v57;
+    v24 = v25 ^ v46;
+    v25 = v0 ^ v49;
+    v26 = v54 - v51;
+    v27 = v8 ^ v63;
+    v28 = v31 ^ v37;
+    v29 = v2 ^ v52;
+    v30 = v19 - v50;
+    v31 = v22 ^ v9;
+    v32 = v1 - v44;
+    v33 = v52 + v38;
+    v34 = v59 - v33;
+    v35 = v21 ^ v59;
+    v36 = v5 ^ v34;
+    v37 = v12 + v54;
+    v38 = v45 ^ v8;
+    v39 = v56 + v2;
+    v40 = v20 - v11;
+    v41 = v35 + v38;
+    v42 = v26 - v30;
+    v43 = v34 + v8;
+    v44 = v47 ^ v59;
+    v45 = v6 - v21;
+    v46 = v34 ^ v45;
+    v47 = v29 ^ v50;
+    v48 = v51 - v22;
+    v49 = v33 ^ v42;
+    v50 = v28 ^ v33;
+    v51 = v31 ^ v3;
+    v52 = v51 - v40;
+    v53 = v31 + v34;
+    v54 = v9 ^ v21;
+    v55 = v56 ^ v18;
+    v56 = v33 ^ v58;
+    v57 = v20 + v17;
+    v58 = v56 - v46;
+    v59 = v51 + v30;
+    v60 = v26 + v39;
+    v61 = v13 - v29;
+    v62 = v41 + v63;
+    v63 = v23 + v5;
+    v0 = v2 ^ v27;
+    v1 = v4 ^ v63;
+    v2 = v56 ^ v43;
+    v3 = v35 ^ v15;
+    v4 = v22 + v12;
+    v5 = v51 - v29;
+    v6 = v57 + v48;
+    v7 = v29 - v30;
+    v8 = v59 + v49;
+    v9 = v57 - v33;
+    v10 = v63 + v14;
+    v11 = v10 + v5;
+    v12 = v0 - v61;
+    v13 = v49 + v36;
+    v14 = v51 ^ v20;
+    v15 = v19 + v3;
+    v16 = v49 ^ v18;
+    v17 = v7 - v48;
+    v18 = v16 - v10;
+    v19 = v38 + v1;
+    v20 = v7 + v16;
+    v21 = v35 - v15;
+    v22 = v11 + v24;
+    v23 = v63 ^ v16;
+    v24 = v35 ^ v24;
+    v25 = v57 - v49;
+    v26 = v34 ^ v33;
+    v27 = v31 + v31;
+    v28 = v22 - v44;
+    v29 = v7 ^ v45;
+    v30 = v52 ^ v25;
+    v31 = v54 ^ v8;
+    v32 = v34 - v9;
+    v33 = v22 + v12;
+    v34 = v7 - v26;
+    v35 = v5 ^ v6;
+    v36 = v11 ^ v60;
+    v37 = v47 - v12;
+    v38 = v5 ^ v16;
+    v39 = v4 ^ v56;
+    v40 = v16 ^ v50;
+    v41 = v57 ^ v3;
+    v42 = v34 - v11;
+    v43 = v41 - v10;
+    v44 = v4 + v49;
+    v45 = v33 ^ v40;
+    v46 = v16 - v33;
+    v47 = v14 + v38;
+    v48 = v54 ^ v31;
+    v49 = v26 - v42;
+    v50 = v50 + v61;
+    v51 = v16 ^ v57;
+    v52 = v3 ^ v37;
+    v53 = v20 - v25;
+    v54 = v49 + v41;
+    v55 = v52 + v44;
+    v56 = v8 - v5;
+    v57 = v40 - v53;
+    v58 = v40 - v45;
+    v59 = v41 ^ v1;
+    v60 = v15 - v19;
+    v61 = v41 ^ v41;
+    v62 = v8 - v57;
+    v63 = v61 - v58;
+    v0 = v48 ^ v10;
+    v1 = v7 + v17;
+    v2 = v62 + v32;
+    v3 = v43 ^ v46;
+    v4 = v47 - v51;
+    v5 = v59 ^ v43;
+    v6 = v21 + v3;
+    v7 = v32 ^ v28;
+    v8 = v17 + v14;
+    v9 = v52 + v6;
+    v10 = v34 + v13;
+    v11 = v33 ^ v8;
+    v12 = v10 + v9;
+    v13 = v22 + v55;
+    v14 = v47 ^ v62;
+    v15 = v36 + v28;
+    v16 = v63 - v30;
+    v17 = v57 ^ v46;
+    v18 = v24 ^ v61;
+    v19 = v9 - v32;
+    v20 = v25 ^ v1;
+    v21 = v48 + v62;
+    v22 = v51 + v54;
+    v23 = v45 + v58;
+    v24 = v24 ^ v38;
+    v25 = v0 - v15;
+    v26 = v40 ^ v36;
+    v27 = v52 ^ v52;
+    v28 = v39 - v57;
+    v29 = v16 ^ v56;
+    v30 = v17 - v20;
+    v31 = v1 ^ v54;
+    v32 = v4 - v47;
+    v33 = v51 ^ v36;
+    v34 = v2 + v11;
+    v35 = v0 - v49;
+    v36 = v59 - v34;
+    v37 = v61 - v43;
+    v38 = v58 - v14;
+    v39 = v45 - v18;
+    v40 = v18 + v2;
+    v41 = v33 + v47;
+    v42 = v36 - v52;
+    v43 = v36 ^ v53;
+    v44 = v35 - v55;
+    v45 = v62 ^ v27;
+    v46 = v62 ^ v51;
+    v47 = v54 + v11;
+    v48 = v16 + v26;
+    v49 = v29 + v3;
+    v50 = v32 - v19;
+    v51 = v12 ^ v51;
+    v52 = v23 + v0;
+    v53 = v54 ^ v6;
+    v54 = v27 - v54;
+    v55 = v6 ^ v13;
+    v56 = v53 - v15;
+    v57 = v35 - v22;
+    v58 = v6 ^ v27;
+    v59 = v11 + v49;
+    v60 = v57 ^ v37;
+    v61 = v63 + v50;
+    v62 = v61 + v13;
+    v63 = v49 + v25;
+    return v0 + v8 + v16 + v24 + v32 + v40 + v48 + v56;
+  }
+
+  private static int loopNest(int x) {
+    int s0 = x, s1 = 1, s2 = 2, s3 = 3, s4 = 4, s5 = 5, s6 = 6, s7 = 7;
+    for (int i0 = 0; i0 < 2; i0++) {
+      if ((s4 & 1) == 0)
+        s6 += s4 ^ i0;
+      else
+        s7 -= i0;
+      if ((s3 & 2) == 0)
+        s5 += s7 ^ i0;
+      else
+        s1 -= i0;
+      if ((s0 & 4) == 0)
+        s5 += s4 ^ i0;
+      else
+        s0 -= i0;
+      for (int i1 = 0; i1 < 2; i1++) {
+        if ((s7 & 1) == 0)
+          s4 += s1 ^ i1;
+        else
+          s3 -= i1;
+        if ((s4 & 2) == 0)
+          s4 += s3 ^ i1;
+        else
+          s6 -= i1;
+        if ((s2 & 4) == 0)
+          s2 += s4 ^ i1;
+        else
+          s3 -= i1;
+        for (int i2 = 0; i2 < 2; i2++) {
+          if ((s6 & 1) == 0)
+            s0 += s2 ^ i2;
+          else
+            s6 -= i2;
+          if ((s4 & 2) == 0)
+            s4 += s7 ^ i2;
+          else
+            s4 -= i2;
+          if ((s4 & 4) == 0)
+            s7 += s3 ^ i2;
+          else
+            s7 -= i2;
+          for (int i3 = 0; i3 < 2; i3++) {
+            if ((s5 & 1) == 0)
+              s7 += s3 ^ i3;
+            else
+              s5 -= i3;
+            if ((s2 & 2) == 0)
+              s2 += s7 ^ i3;
+            else
+              s2 -= i3;
+            if ((s0 & 4) == 0)
+              s5 += s2 ^ i3;
+            else
+              s3 -= i3;
+            for (int i4 = 0; i4 < 2; i4++) {
+              if ((s5 & 1) == 0)
+                s7 += s7 ^ i4;
+              else
+                s5 -= i4;
+              if ((s1 & 2) == 0)
+                s2 += s2 ^ i4;
+              else
+                s4 -= i4;
+              if ((s3 & 4) == 0)
+                s1 += s0 ^ i4;
+              else
+                s2 -= i4;
+              for (int i5 = 0; i5 < 2; i5++) {
+                if ((s1 & 1) == 0)
+                  s3 += s3 ^ i5;
+                else
+                  s4 -= i5;
+                if ((s6 & 2) == 0)
+                  s5 += s0 ^ i5;
+                else
+                  s0 -= i5;
+                if ((s4 & 4) == 0)
+                  s3 += s1 ^ i5;
+                else
+                  s3 -= i5;
+                s4 = s5 * 31 + s4;
+              }
+              s6 = s0 * 31 + s1;
+            }
+            s5 = s5 * 31 + s2;
+          }
+          s1 = s4 * 31 + s2;
+        }
+        s0 = s5 * 31 + s1;
+      }
+      s1 = s1 * 31 + s4;
+    }
+    return s0 + s1 + s2 + s3 + s4 + s5 + s6 + s7;
+  }
+
+  private static void profile(String name, Method method) {
+    start = System.nanoTime();
+    method.run(1);
+    stop = System.nanoTime();
+    long first = stop - start;
+
+    start = System.nanoTime();
+    method.run(2);
+    stop = System.nanoTime();
+    long second = stop - start;
+
+    System.out.println("CompileTime." + name + " = " + (first - second) / 1000 + "us");
+  }
+
+  public static void main(String[] args) {
+    long total = System.nanoTime();
+
+    profile("bigSwitch", new Method() {
+      public int run(int x) { return bigSwitch(x); }
+    });
+    profile("manyLocals", new Method() {
+      public int run(int x) { return manyLocals(x); }
+    });
+    profile("loopNest", new Method() {
+      public int run(int x) { return loopNest(x); }
+    });
+
+    System.out.println("CompileTime = " + (System.nanoTime() - total) / 1000 + "us");
+  }
+}
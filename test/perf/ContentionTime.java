@@ -0,0 +1,104 @@
+import java.util.Arrays;
+import java.util.concurrent.locks.LockSupport;
+
+public class ContentionTime {
+  private static final int NUM_ACQUIRES = 200000;
+  private static final int NUM_PARKS = 20000;
+
+  private static final Object lock = new Object();
+  private static long counter;
+
+  private static long start, stop;
+
+  private static void criticalSection() {
+    // Short enough that spinning should pay off
+    for(int i = 0; i < 20; ++i) {
+      counter++;
+    }
+  }
+
+  private static void profileContended(int nr_threads) throws InterruptedException {
+    final int acquires_per_thread = NUM_ACQUIRES / nr_threads;
+    final long[][] latencies = new long[nr_threads][acquires_per_thread];
+    Thread[] threads = new Thread[nr_threads];
+
+    for(int i = 0; i < nr_threads; ++i) {
+      final long[] samples = latencies[i];
+
+      threads[i] = new Thread() {
+        public void run() {
+          for(int j = 0; j < samples.length; ++j) {
+            long before = System.nanoTime();
+            synchronized (lock) {
+              samples[j] = System.nanoTime() - before;
+              criticalSection();
+            }
+          }
+        }
+      };
+    }
+
+    start = System.nanoTime();
+    for(int i = 0; i < nr_threads; ++i) {
+      threads[i].start();
+    }
+    for(int i = 0; i < nr_threads; ++i) {
+      threads[i].join();
+    }
+    stop = System.nanoTime();
+
+    long[] all = new long[nr_threads * acquires_per_thread];
+    for(int i = 0; i < nr_threads; ++i) {
+      System.arraycopy(latencies[i], 0, all, i * acquires_per_thread, acquires_per_thread);
+    }
+    Arrays.sort(all);
+
+    long total = (long) nr_threads * acquires_per_thread;
+    System.out.println("Contended" + nr_threads + " throughput = "
+                       + (total * 1000000000L) / (stop - start) + " acquires/s, p50 = "
+                       + all[all.length / 2] + "ns, p99 = "
+                       + all[(int) (all.length * 0.99)] + "ns");
+  }
+
+  private static volatile boolean ping;
+
+  private static void profileParkUnpark() throws InterruptedException {
+    final Thread main = Thread.currentThread();
+
+    Thread other = new Thread() {
+      public void run() {
+        for(int i = 0; i < NUM_PARKS; ++i) {
+          while (!ping) {
+            LockSupport.park();
+          }
+          ping = false;
+          LockSupport.unpark(main);
+        }
+      }
+    };
+
+    other.start();
+
+    start = System.nanoTime();
+    for(int i = 0; i < NUM_PARKS; ++i) {
+      ping = true;
+      LockSupport.unpark(other);
+      while (ping) {
+        LockSupport.park();
+      }
+    }
+    stop = System.nanoTime();
+
+    other.join();
+
+    System.out.println("ParkUnparkRoundTrip = " + (stop - start)/NUM_PARKS + "ns");
+  }
+
+  public static void main(String[] args) throws Exception {
+    profileContended(2);
+    profileContended(4);
+    profileContended(8);
+    profileContended(32);
+    profileParkUnpark();
+  }
+}
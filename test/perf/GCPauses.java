@@ -0,0 +1,60 @@
+public class GCPauses {
+  private static final int NUM_ITERATIONS = 2000000;
+  private static final int NUM_RETAINED = 200000;
+
+  // Histogram buckets are powers of two microseconds
+  private static final int NUM_BUCKETS = 20;
+
+  private static class Node {
+    Node next;
+    long[] payload;
+
+    Node(Node next) {
+      this.next = next;
+      this.payload = new long[4];
+    }
+  }
+
+  // Measures the time each allocation takes. Allocations that trigger a
+  // collection take as long as the pause, everything else is much faster
+  // so the tail of the distribution is the collector pauses.
+  public static void main(String[] args) {
+    Node[] retained = new Node[NUM_RETAINED];
+    long[] buckets = new long[NUM_BUCKETS];
+    long max = 0, total = 0, slow = 0;
+
+    for (int i = 0; i < NUM_ITERATIONS; i++) {
+      long start = System.nanoTime();
+      Node n = new Node(null);
+      long micros = (System.nanoTime() - start) / 1000;
+
+      // Keep a sliding window of objects alive so that there is an old
+      // generation and old-to-young references.
+      retained[i % NUM_RETAINED] = n;
+      if (i % 7 == 0)
+        n.next = retained[(i / 7) % NUM_RETAINED];
+
+      total += micros;
+      if (micros > max)
+        max = micros;
+
+      if (micros < 100)
+        continue;
+
+      slow++;
+
+      int bucket = 0;
+      while (bucket < NUM_BUCKETS - 1 && (1L << (bucket + 1)) <= micros)
+        bucket++;
+      buckets[bucket]++;
+    }
+
+    System.out.println("Pauses >= 100us = " + slow);
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+      if (buckets[i] != 0)
+        System.out.println("  " + (1L << i) + "us-" + (1L << (i + 1)) + "us = " + buckets[i]);
+    }
+    System.out.println("MaxPause = " + max + "us");
+    System.out.println("TotalAllocTime = " + total / 1000 + "ms");
+  }
+}
@@ -0,0 +1,70 @@
+public class GCThroughput {
+  private static final int NUM_ALLOCS = 5000000;
+  private static final int NUM_RETAINED = 100000;
+
+  private static class Node {
+    Node next;
+    int value;
+
+    Node(Node next, int value) {
+      this.next = next;
+      this.value = value;
+    }
+  }
+
+  private static long start, stop;
+
+  private static void report(String name, long count) {
+    long nanos = stop - start;
+
+    System.out.println(name + " = " + nanos / count + "ns/alloc, "
+        + (count * 1000 / (nanos / 1000000 + 1)) + " allocs/s");
+  }
+
+  private static void profileShortLived() {
+    Node n = null;
+
+    start = System.nanoTime();
+    for (int i = 0; i < NUM_ALLOCS; i++) {
+      n = new Node(null, i);
+    }
+    stop = System.nanoTime();
+    if (n.value != NUM_ALLOCS - 1)
+      throw new RuntimeException();
+    report("ShortLived", NUM_ALLOCS);
+  }
+
+  private static void profileSmallArrays() {
+    int[] a = null;
+
+    start = System.nanoTime();
+    for (int i = 0; i < NUM_ALLOCS; i++) {
+      a = new int[4];
+      a[0] = i;
+    }
+    stop = System.nanoTime();
+    if (a[0] != NUM_ALLOCS - 1)
+      throw new RuntimeException();
+    report("SmallArrays", NUM_ALLOCS);
+  }
+
+  // Stores young objects into an old array, which exercises the write barrier
+  private static void profileOldToYoung() {
+    Object[] old = new Object[NUM_RETAINED];
+
+    Runtime.getRuntime().gc();
+
+    start = System.nanoTime();
+    for (int i = 0; i < NUM_ALLOCS; i++) {
+      old[i % NUM_RETAINED] = new Node(null, i);
+    }
+    stop = System.nanoTime();
+    report("OldToYoung", NUM_ALLOCS);
+  }
+
+  public static void main(String[] args) {
+    profileShortLived();
+    profileSmallArrays();
+    profileOldToYoung();
+  }
+}
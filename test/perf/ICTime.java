@@ -1,6 +1,5 @@
 public class ICTime {
-  private static final int NUM_HITS = 10000;
-  private static final int NUM_MISS = 10000;
+  private static final int NUM_CALLS = 10000;
 
   public static class Fruit {
     public String name() { return "Fruit"; }
@@ -11,6 +10,21 @@ public class ICTime {
   public static class Orange extends Fruit {
     public String name() { return "Orange"; }
   }
+  public static class Banana extends Fruit {
+    public String name() { return "Banana"; }
+  }
+  public static class Cherry extends Fruit {
+    public String name() { return "Cherry"; }
+  }
+  public static class Grape extends Fruit {
+    public String name() { return "Grape"; }
+  }
+  public static class Lemon extends Fruit {
+    public String name() { return "Lemon"; }
+  }
+  public static class Plum extends Fruit {
+    public String name() { return "Plum"; }
+  }
 
   private static long start, stop;
 
@@ -22,6 +36,16 @@ public class ICTime {
     f.name();
     f = new Orange();
     f.name();
+    f = new Banana();
+    f.name();
+    f = new Cherry();
+    f.name();
+    f = new Grape();
+    f.name();
+    f = new Lemon();
+    f.name();
+    f = new Plum();
+    f.name();
   }
   private static void profileICSetup() {
     Fruit f = new Apple();
@@ -1058,38 +1082,68 @@ public class ICTime {
     System.out.println("ICSetup = " + (stop - start)/1024 + "ns");
   }
 
-  private static String wrapper(Fruit f) {
+  // Every state has a call site of its own.
+  private static String monomorphicSite(Fruit f) {
+    return f.name();
+  }
+
+  private static String polymorphicSite(Fruit f) {
     return f.name();
   }
 
-  private static void profileICHit() {
+  private static String megamorphicSite(Fruit f) {
+    return f.name();
+  }
+
+  private static void profileMonomorphic() {
     Apple a = new Apple();
-    wrapper(a);
+    monomorphicSite(a);
 
     start = System.nanoTime();
-    for(int i = 0; i < NUM_HITS; ++i) {
-      wrapper(a);
+    for(int i = 0; i < NUM_CALLS; ++i) {
+      monomorphicSite(a);
     }
     stop = System.nanoTime();
-    System.out.println("ICHit = " + (stop - start)/NUM_HITS + "ns");
+    System.out.println("ICMonomorphic = " + (stop - start)/NUM_CALLS + "ns");
   }
 
-  private static void profileICMiss() {
-    Orange o = new Orange();
-    wrapper(o);
+  private static void profilePolymorphic() {
+    Fruit[] fruits = { new Apple(), new Orange(), new Banana() };
+
+    for(int i = 0; i < fruits.length; ++i) {
+      polymorphicSite(fruits[i]);
+    }
+
+    start = System.nanoTime();
+    for(int i = 0; i < NUM_CALLS; ++i) {
+      polymorphicSite(fruits[i % fruits.length]);
+    }
+    stop = System.nanoTime();
+    System.out.println("ICPolymorphic = " + (stop - start)/NUM_CALLS + "ns");
+  }
+
+  private static void profileMegamorphic() {
+    Fruit[] fruits = { new Apple(), new Orange(), new Banana(), new Cherry(),
+                       new Grape(), new Lemon(), new Plum(), new Fruit() };
+
+    // Miss often enough for the call site to give up on the stub
+    for(int i = 0; i < 100; ++i) {
+      megamorphicSite(fruits[i % fruits.length]);
+    }
 
     start = System.nanoTime();
-    for(int i = 0; i < NUM_MISS; ++i) {
-      wrapper(o);
+    for(int i = 0; i < NUM_CALLS; ++i) {
+      megamorphicSite(fruits[i % fruits.length]);
     }
     stop = System.nanoTime();
-    System.out.println("ICMiss = " + (stop - start)/NUM_MISS + "ns");
+    System.out.println("ICMegamorphic = " + (stop - start)/NUM_CALLS + "ns");
   }
 
   public static void main(String[] args) {
     warmup();
     profileICSetup();
-    profileICHit();
-    profileICMiss();
+    profileMonomorphic();
+    profilePolymorphic();
+    profileMegamorphic();
   }
 }
@@ -0,0 +1,104 @@
+public class LockTime {
+  private static final int NUM_LOCKS = 1000000;
+  private static final int NUM_CONTENDED_LOCKS = 100000;
+
+  private static long start, stop;
+
+  private static final Object lock = new Object();
+  private static int counter;
+
+  private static synchronized void syncMethod() {
+    counter++;
+  }
+
+  private static void syncBlock() {
+    synchronized (lock) {
+      counter++;
+    }
+  }
+
+  private static void recursiveBlock() {
+    synchronized (lock) {
+      synchronized (lock) {
+        synchronized (lock) {
+          counter++;
+        }
+      }
+    }
+  }
+
+  private static void profileUncontended() {
+    for(int i = 0; i < 1000; ++i) {
+      syncBlock();
+      syncMethod();
+    }
+
+    start = System.nanoTime();
+    for(int i = 0; i < NUM_LOCKS; ++i) {
+      syncBlock();
+    }
+    stop = System.nanoTime();
+    System.out.println("LockUncontended = " + (stop - start)/NUM_LOCKS + "ns");
+
+    start = System.nanoTime();
+    for(int i = 0; i < NUM_LOCKS; ++i) {
+      syncMethod();
+    }
+    stop = System.nanoTime();
+    System.out.println("LockSynchronizedMethod = " + (stop - start)/NUM_LOCKS + "ns");
+  }
+
+  private static void profileRecursive() {
+    for(int i = 0; i < 1000; ++i) {
+      recursiveBlock();
+    }
+
+    start = System.nanoTime();
+    for(int i = 0; i < NUM_LOCKS; ++i) {
+      recursiveBlock();
+    }
+    stop = System.nanoTime();
+    System.out.println("LockRecursive = " + (stop - start)/NUM_LOCKS + "ns");
+  }
+
+  private static void profileContended(int nr_threads) throws InterruptedException {
+    Thread[] threads = new Thread[nr_threads];
+    final int locks_per_thread = NUM_CONTENDED_LOCKS / nr_threads;
+
+    counter = 0;
+
+    for(int i = 0; i < nr_threads; ++i) {
+      threads[i] = new Thread() {
+        public void run() {
+          for(int j = 0; j < locks_per_thread; ++j) {
+            syncBlock();
+          }
+        }
+      };
+    }
+
+    start = System.nanoTime();
+    for(int i = 0; i < nr_threads; ++i) {
+      threads[i].start();
+    }
+    for(int i = 0; i < nr_threads; ++i) {
+      threads[i].join();
+    }
+    stop = System.nanoTime();
+
+    if (counter != locks_per_thread * nr_threads) {
+      System.out.println("LockContended" + nr_threads + " FAILED: counter = " + counter);
+      System.exit(1);
+    }
+
+    System.out.println("LockContended" + nr_threads + " = " + (stop - start)/(locks_per_thread * nr_threads) + "ns");
+  }
+
+  public static void main(String[] args) throws Exception {
+    profileUncontended();
+    profileRecursive();
+    profileContended(2);
+    profileContended(8);
+    profileContended(32);
+  }
+}
@@ -0,0 +1,81 @@
+import java.lang.reflect.Constructor;
+import java.lang.reflect.Method;
+
+public class ReflectionTime {
+  private static final int NUM_CALLS = 100000;
+
+  public static class Point {
+    private int x, y;
+
+    public Point(int x, int y) {
+      this.x = x;
+      this.y = y;
+    }
+
+    public int dot(int x, int y) {
+      return this.x * x + this.y * y;
+    }
+
+    public static long add(int a, long b, double c) {
+      return a + b + (long) c;
+    }
+  }
+
+  private static long start, stop;
+
+  private static void profileStatic() throws Exception {
+    Method m = Point.class.getMethod("add", int.class, long.class, double.class);
+    Object[] args = { Integer.valueOf(1), Long.valueOf(2), Double.valueOf(3.0) };
+
+    // Call often enough for the method to get its invocation stub
+    for(int i = 0; i < 100; ++i) {
+      m.invoke(null, args);
+    }
+
+    start = System.nanoTime();
+    for(int i = 0; i < NUM_CALLS; ++i) {
+      m.invoke(null, args);
+    }
+    stop = System.nanoTime();
+    System.out.println("InvokeStatic = " + (stop - start)/NUM_CALLS + "ns");
+  }
+
+  private static void profileVirtual() throws Exception {
+    Method m = Point.class.getMethod("dot", int.class, int.class);
+    Object[] args = { Integer.valueOf(3), Integer.valueOf(4) };
+    Point p = new Point(1, 2);
+
+    for(int i = 0; i < 100; ++i) {
+      m.invoke(p, args);
+    }
+
+    start = System.nanoTime();
+    for(int i = 0; i < NUM_CALLS; ++i) {
+      m.invoke(p, args);
+    }
+    stop = System.nanoTime();
+    System.out.println("InvokeVirtual = " + (stop - start)/NUM_CALLS + "ns");
+  }
+
+  private static void profileNewInstance() throws Exception {
+    Constructor<Point> c = Point.class.getConstructor(int.class, int.class);
+    Object[] args = { Integer.valueOf(1), Integer.valueOf(2) };
+
+    for(int i = 0; i < 100; ++i) {
+      c.newInstance(args);
+    }
+
+    start = System.nanoTime();
+    for(int i = 0; i < NUM_CALLS; ++i) {
+      c.newInstance(args);
+    }
+    stop = System.nanoTime();
+    System.out.println("NewInstance = " + (stop - start)/NUM_CALLS + "ns");
+  }
+
+  public static void main(String[] args) throws Exception {
+    profileStatic();
+    profileVirtual();
+    profileNewInstance();
+  }
+}
@@ -0,0 +1,81 @@
+/*
+ * Measures the cost of running code that executes only a few times, which
+ * is what dominates application startup, and of running a hot loop. Run it
+ * with -Xint, -Xtiered and in the default JIT-only mode to compare the
+ * execution modes (see the 'check-startup' make target).
+ */
+public class StartupTime {
+  private static final int NUM_HOT = 100000;
+
+  private static long start, stop;
+
+  public static class Point {
+    private final int x, y;
+
+    public Point(int x, int y) { this.x = x; this.y = y; }
+
+    public int x() { return x; }
+    public int y() { return y; }
+  }
+
+  private static int cold0(int i) { return i + 1; }
+  private static int cold1(int i) { return cold0(i) * 2; }
+  private static int cold2(int i) { return cold1(i) - 3; }
+  private static int cold3(int i) { return cold2(i) ^ 4; }
+  private static int cold4(int i) { return cold3(i) | 5; }
+  private static int cold5(int i) { return cold4(i) & 0xffff; }
+  private static int cold6(int i) { return cold5(i) % 7; }
+  private static int cold7(int i) { return cold6(i) << 1; }
+  private static int cold8(int i) { return cold7(i) >> 1; }
+  private static int cold9(int i) { return cold8(i) + cold0(i); }
+
+  private static String coldString(int i) {
+    StringBuilder sb = new StringBuilder();
+    sb.append("point-");
+    sb.append(i);
+    return sb.toString();
+  }
+
+  private static int coldArray(int n) {
+    int[] a = new int[n];
+    for (int i = 0; i < a.length; i++)
+      a[i] = i;
+    int sum = 0;
+    for (int i = 0; i < a.length; i++)
+      sum += a[i];
+    return sum;
+  }
+
+  private static void profileCold() {
+    start = System.nanoTime();
+    int result = cold9(1) + coldArray(16) + coldString(2).length();
+    Point p = new Point(result, result);
+    result = p.x() + p.y();
+    stop = System.nanoTime();
+    System.out.println("Cold = " + (stop - start) / 1000 + "us (" + result + ")");
+  }
+
+  private static int hot(Point p, int i) {
+    return p.x() * i + p.y();
+  }
+
+  private static void profileHot() {
+    Point p = new Point(1, 2);
+    int sum = 0;
+
+    start = System.nanoTime();
+    for (int i = 0; i < NUM_HOT; ++i)
+      sum += hot(p, i);
+    stop = System.nanoTime();
+    System.out.println("Hot = " + (stop - start) / NUM_HOT + "ns (" + sum + ")");
+  }
+
+  public static void main(String[] args) {
+    long total = System.nanoTime();
+
+    profileCold();
+    profileHot();
+
+    System.out.println("Total = " + (System.nanoTime() - total) / 1000 + "us");
+  }
+}
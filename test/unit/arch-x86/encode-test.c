@@ -754,6 +754,50 @@ void test_encoding_xmm_xmm_high(void)
 #endif
 }
 
+void test_encoding_sqrtsd_xmm_xmm(void)
+{
+	uint8_t encoding[] = { 0xf2, 0x0f, 0x51, 0xfe };
+	struct insn insn = { };
+
+	setup();
+
+	/* sqrtsd %xmm6,%xmm7 */
+	insn.type			= INSN_SQRTSD_XMM_XMM;
+	insn.src.reg.interval		= &reg_xmm6;
+	insn.src.type			= OPERAND_REG;
+	insn.dest.reg.interval		= &reg_xmm7;
+	insn.dest.type			= OPERAND_REG;
+
+	insn_encode(&insn, buffer, NULL);
+
+	assert_int_equals(ARRAY_SIZE(encoding), buffer_offset(buffer));
+	assert_mem_equals(encoding, buffer_ptr(buffer), ARRAY_SIZE(encoding));
+
+	teardown();
+}
+
+void test_encoding_andpd_xmm_xmm(void)
+{
+	uint8_t encoding[] = { 0x66, 0x0f, 0x54, 0xfe };
+	struct insn insn = { };
+
+	setup();
+
+	/* andpd  %xmm6,%xmm7 */
+	insn.type			= INSN_ANDPD_XMM_XMM;
+	insn.src.reg.interval		= &reg_xmm6;
+	insn.src.type			= OPERAND_REG;
+	insn.dest.reg.interval		= &reg_xmm7;
+	insn.dest.type			= OPERAND_REG;
+
+	insn_encode(&insn, buffer, NULL);
+
+	assert_int_equals(ARRAY_SIZE(encoding), buffer_offset(buffer));
+	assert_mem_equals(encoding, buffer_ptr(buffer), ARRAY_SIZE(encoding));
+
+	teardown();
+}
+
 void test_encoding_reg_membase_xmm(void)
 {
 	uint8_t encoding[] = { 0xf3, 0x0f, 0x11, 0x3c, 0x24 };
@@ -917,6 +961,30 @@ void test_encoding_rex_reg_reg_high_high(void)
 #endif
 }
 
+void test_encoding_rex_cmov_reg_reg(void)
+{
+#ifdef CONFIG_X86_64
+	uint8_t encoding[] = { 0x4d, 0x0f, 0x4c, 0xec };
+	struct insn insn = { };
+
+	setup();
+
+	/* cmovl  %r12,%r13 */
+	insn.type			= INSN_CMOVL_REG_REG;
+	insn.src.type			= OPERAND_REG;
+	insn.src.reg.interval		= &reg_r12;
+	insn.dest.type			= OPERAND_REG;
+	insn.dest.reg.interval		= &reg_r13;
+
+	insn_encode(&insn, buffer, NULL);
+
+	assert_int_equals(ARRAY_SIZE(encoding), buffer_offset(buffer));
+	assert_mem_equals(encoding, buffer_ptr(buffer), ARRAY_SIZE(encoding));
+
+	teardown();
+#endif
+}
+
 void test_encoding_reg(void)
 {
 	uint8_t encoding[] = { 0xf7, 0xdb };
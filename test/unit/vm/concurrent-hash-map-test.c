@@ -0,0 +1,177 @@
+#include "lib/concurrent-hash-map.h"
+
+#include <libharness.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+void test_concurrent_hash_map_put_and_get(void)
+{
+	struct concurrent_hash_map *map = alloc_concurrent_hash_map(&pointer_key);
+
+	assert_int_equals(0, concurrent_hash_map_put(map, (void *) 1, (void *) 10));
+	assert_int_equals(0, concurrent_hash_map_put(map, (void *) 2, (void *) 20));
+
+	assert_ptr_equals((void *) 10, concurrent_hash_map_get(map, (void *) 1));
+	assert_ptr_equals((void *) 20, concurrent_hash_map_get(map, (void *) 2));
+	assert_ptr_equals(NULL, concurrent_hash_map_get(map, (void *) 3));
+
+	assert_int_equals(0, concurrent_hash_map_put(map, (void *) 1, (void *) 11));
+	assert_ptr_equals((void *) 11, concurrent_hash_map_get(map, (void *) 1));
+	assert_int_equals(2, concurrent_hash_map_size(map));
+
+	free_concurrent_hash_map(map);
+}
+
+void test_concurrent_hash_map_put_if_absent_keeps_old_value(void)
+{
+	struct concurrent_hash_map *map = alloc_concurrent_hash_map(&pointer_key);
+	void *old;
+
+	assert_int_equals(0, concurrent_hash_map_put_if_absent(map, (void *) 1, (void *) 10, &old));
+	assert_ptr_equals(NULL, old);
+
+	assert_int_equals(0, concurrent_hash_map_put_if_absent(map, (void *) 1, (void *) 11, &old));
+	assert_ptr_equals((void *) 10, old);
+	assert_ptr_equals((void *) 10, concurrent_hash_map_get(map, (void *) 1));
+
+	free_concurrent_hash_map(map);
+}
+
+void test_concurrent_hash_map_remove(void)
+{
+	struct concurrent_hash_map *map = alloc_concurrent_hash_map(&pointer_key);
+
+	concurrent_hash_map_put(map, (void *) 1, (void *) 10);
+	concurrent_hash_map_put(map, (void *) 2, (void *) 20);
+
+	assert_int_equals(0, concurrent_hash_map_remove(map, (void *) 1));
+	assert_int_equals(-1, concurrent_hash_map_remove(map, (void *) 1));
+
+	assert_ptr_equals(NULL, concurrent_hash_map_get(map, (void *) 1));
+	assert_ptr_equals((void *) 20, concurrent_hash_map_get(map, (void *) 2));
+	assert_int_equals(1, concurrent_hash_map_size(map));
+
+	free_concurrent_hash_map(map);
+}
+
+void test_concurrent_hash_map_grows(void)
+{
+	struct concurrent_hash_map *map = alloc_concurrent_hash_map(&pointer_key);
+	struct concurrent_hash_map_entry *entry;
+	unsigned long count = 0;
+
+	for (unsigned long i = 1; i <= 1000; i++)
+		concurrent_hash_map_put(map, (void *) i, (void *) (i * 2));
+
+	for (unsigned long i = 1; i <= 1000; i += 2)
+		concurrent_hash_map_remove(map, (void *) i);
+
+	for (unsigned long i = 1; i <= 1000; i++) {
+		void *expected = (i % 2) ? NULL : (void *) (i * 2);
+
+		assert_ptr_equals(expected, concurrent_hash_map_get(map, (void *) i));
+	}
+
+	concurrent_hash_map_for_each_entry(entry, map)
+		count++;
+
+	assert_int_equals(500, count);
+
+	free_concurrent_hash_map(map);
+}
+
+void test_concurrent_hash_map_remove_while_resizing(void)
+{
+	struct concurrent_hash_map *map = alloc_concurrent_hash_map(&pointer_key);
+	unsigned long i;
+
+	/* Stop right after a resize has started.  */
+	for (i = 1; map->table->from == NULL; i++)
+		concurrent_hash_map_put(map, (void *) i, (void *) (i * 2));
+
+	concurrent_hash_map_remove(map, (void *) 1);
+	concurrent_hash_map_put(map, (void *) 2, (void *) 3);
+
+	for (; map->table->from; i++)
+		concurrent_hash_map_put(map, (void *) i, (void *) (i * 2));
+
+	assert_ptr_equals(NULL, concurrent_hash_map_get(map, (void *) 1));
+	assert_ptr_equals((void *) 3, concurrent_hash_map_get(map, (void *) 2));
+	assert_int_equals(i - 2, concurrent_hash_map_size(map));
+
+	free_concurrent_hash_map(map);
+}
+
+#define NR_READERS		4
+#define NR_FIXED_KEYS		64
+#define NR_WRITER_KEYS		100000
+
+struct resize_test {
+	struct concurrent_hash_map	*map;
+	volatile bool			done;
+	unsigned long			nr_errors[NR_READERS];
+};
+
+struct resize_reader {
+	struct resize_test		*test;
+	unsigned int			id;
+};
+
+/*
+ * Keys are small integers and every value is twice its key so a torn entry
+ * shows up as a value that does not match the key it was found with.
+ */
+static void *resize_reader(void *arg)
+{
+	struct resize_reader *reader = arg;
+	struct resize_test *test = reader->test;
+
+	while (!test->done) {
+		for (unsigned long key = 1; key <= NR_FIXED_KEYS; key++) {
+			void *value = concurrent_hash_map_get(test->map, (void *) key);
+
+			if (value != (void *) (key * 2))
+				test->nr_errors[reader->id]++;
+		}
+	}
+
+	return NULL;
+}
+
+void test_concurrent_hash_map_readers_see_keys_during_resize(void)
+{
+	struct resize_reader readers[NR_READERS];
+	pthread_t threads[NR_READERS];
+	struct resize_test test;
+
+	test.map	= alloc_concurrent_hash_map(&pointer_key);
+	test.done	= false;
+
+	for (unsigned long key = 1; key <= NR_FIXED_KEYS; key++)
+		concurrent_hash_map_put(test.map, (void *) key, (void *) (key * 2));
+
+	for (unsigned int i = 0; i < NR_READERS; i++) {
+		readers[i].test		= &test;
+		readers[i].id		= i;
+		test.nr_errors[i]	= 0;
+
+		pthread_create(&threads[i], NULL, resize_reader, &readers[i]);
+	}
+
+	/* Forces a resize every time the table doubles.  */
+	for (unsigned long key = NR_FIXED_KEYS + 1; key <= NR_FIXED_KEYS + NR_WRITER_KEYS; key++) {
+		concurrent_hash_map_put(test.map, (void *) key, (void *) (key * 2));
+
+		if (key % 3 == 0)
+			concurrent_hash_map_remove(test.map, (void *) key);
+	}
+
+	test.done = true;
+
+	for (unsigned int i = 0; i < NR_READERS; i++) {
+		pthread_join(threads[i], NULL);
+		assert_int_equals(0, test.nr_errors[i]);
+	}
+
+	free_concurrent_hash_map(test.map);
+}
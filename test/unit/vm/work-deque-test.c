@@ -0,0 +1,53 @@
+#include "lib/work-deque.h"
+
+#include <libharness.h>
+#include <stdlib.h>
+
+void test_work_deque_pop_is_lifo(void)
+{
+	struct work_deque *deque = alloc_work_deque(4);
+
+	assert_true(work_deque_is_empty(deque));
+
+	work_deque_push(deque, (void *) 1);
+	work_deque_push(deque, (void *) 2);
+
+	assert_false(work_deque_is_empty(deque));
+	assert_ptr_equals((void *) 2, work_deque_pop(deque));
+	assert_ptr_equals((void *) 1, work_deque_pop(deque));
+	assert_ptr_equals(NULL, work_deque_pop(deque));
+	assert_true(work_deque_is_empty(deque));
+
+	free_work_deque(deque);
+}
+
+void test_work_deque_steal_is_fifo(void)
+{
+	struct work_deque *deque = alloc_work_deque(4);
+
+	work_deque_push(deque, (void *) 1);
+	work_deque_push(deque, (void *) 2);
+
+	assert_ptr_equals((void *) 1, work_deque_steal(deque));
+	assert_ptr_equals((void *) 2, work_deque_pop(deque));
+	assert_ptr_equals(NULL, work_deque_steal(deque));
+
+	free_work_deque(deque);
+}
+
+void test_work_deque_push_fails_when_full(void)
+{
+	struct work_deque *deque = alloc_work_deque(2);
+
+	assert_true(work_deque_push(deque, (void *) 1));
+	assert_true(work_deque_push(deque, (void *) 2));
+	assert_false(work_deque_push(deque, (void *) 3));
+
+	assert_ptr_equals((void *) 1, work_deque_steal(deque));
+	assert_true(work_deque_push(deque, (void *) 3));
+
+	assert_ptr_equals((void *) 3, work_deque_pop(deque));
+	assert_ptr_equals((void *) 2, work_deque_pop(deque));
+
+	free_work_deque(deque);
+}
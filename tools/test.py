@@ -32,11 +32,23 @@ TESTS = [
   # ========================== ====  =======================  =============
   ( "jvm/EntryTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "jvm/EntryTest", 0, NO_SYSTEM_CLASSLOADER + [ "-Xint" ], [ "i386", "x86_64" ] )
+, ( "jvm/EntryTest", 0, NO_SYSTEM_CLASSLOADER + [ "-Xtiered" ], [ "i386", "x86_64" ] )
+, ( "jvm.IntegerArithmeticTest", 0, NO_SYSTEM_CLASSLOADER + [ "-Xint" ], [ "i386", "x86_64" ] )
+, ( "jvm.LongArithmeticTest", 0, NO_SYSTEM_CLASSLOADER + [ "-Xint" ], [ "i386", "x86_64" ] )
+, ( "jvm.InvokeTest", 0, NO_SYSTEM_CLASSLOADER + [ "-Xint" ], [ "i386", "x86_64" ] )
+, ( "jvm.DupTest", 0, NO_SYSTEM_CLASSLOADER + [ "-Xint" ], [ "i386", "x86_64" ] )
+, ( "jvm.SubroutineTest", 0, NO_SYSTEM_CLASSLOADER + [ "-Xint" ], [ "i386", "x86_64" ] )
+, ( "jvm.WideTest", 0, NO_SYSTEM_CLASSLOADER + [ "-Xint" ], [ "i386", "x86_64" ] )
+, ( "jvm.ExceptionsTest", 0, NO_SYSTEM_CLASSLOADER + [ "-Xint" ], [ "i386", "x86_64" ] )
+, ( "jvm.FibonacciTest", 0, NO_SYSTEM_CLASSLOADER + [ "-Xtiered", "-XX:CompileThreshold=10" ], [ "i386", "x86_64" ] )
+, ( "jvm.FibonacciTest", 0, NO_SYSTEM_CLASSLOADER + [ "-Xtiered", "-XX:+BackgroundCompilation", "-XX:CompileThreshold=10" ], [ "i386", "x86_64" ] )
 , ( "jvm/EntryTest", 0, NO_SYSTEM_CLASSLOADER + [ "-Xssa" ], [ "i386" ] )
 , ( "jvm/EntryTest", 0, NO_SYSTEM_CLASSLOADER + [ "-Xnewgc" ], [ "i386", "x86_64" ] )
+, ( "jvm/EntryTest", 0, NO_SYSTEM_CLASSLOADER + [ "-Xjit:stats" ], [ "i386", "x86_64" ] )
 , ( "jvm/ExitStatusIsZeroTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "jvm/ExitStatusIsOneTest", 1, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "jvm/ArgsTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
+, ( "jvm.ArrayBoundsCheckEliminationTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "jvm.ArrayExceptionsTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "jvm.ArrayMemberTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "jvm.ArrayTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
@@ -53,16 +65,23 @@ TESTS = [
 , ( "jvm.DupTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "jvm.ExceptionsTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "jvm.ExceptionHandlerTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
+, ( "jvm.MonitorExitTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "jvm.FibonacciTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "jvm.FinallyTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "jvm.FloatArithmeticTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "jvm.FloatConversionTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
+, ( "jvm.GcTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
+, ( "jvm.GcTest", 0, NO_SYSTEM_CLASSLOADER + [ "-Xnewgc", "-Xmx16m" ], [ "i386", "x86_64" ] )
+, ( "jvm.GcTest", 0, NO_SYSTEM_CLASSLOADER + [ "-Xnewgc", "-Xmx16m", "-Xmn256k" ], [ "i386", "x86_64" ] )
 , ( "jvm.GcTortureTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
+, ( "jvm.GcTortureTest", 0, NO_SYSTEM_CLASSLOADER + [ "-Xnewgc" ], [ "i386", "x86_64" ] )
 , ( "jvm.GetstaticPatchingTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "jvm.IntegerArithmeticExceptionsTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "jvm.IntegerArithmeticTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "jvm.InterfaceFieldInheritanceTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "jvm.InterfaceInheritanceTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
+, ( "jvm.IntrinsicsTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
+, ( "jvm.IntrinsicsTest", 0, NO_SYSTEM_CLASSLOADER + [ "-XX:-UseIntrinsics" ], [ "i386", "x86_64" ] )
 , ( "jvm.InvokeinterfaceTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "jvm.InvokeResultTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "jvm.InvokeTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
@@ -94,7 +113,10 @@ TESTS = [
 , ( "jvm.SwitchTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "jvm.SynchronizationExceptionsTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "jvm.SynchronizationTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
+, ( "jvm.TLABTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
+, ( "jvm.TLABTest", 0, NO_SYSTEM_CLASSLOADER + [ "-XX:-UseTLAB" ], [ "i386", "x86_64" ] )
 , ( "jvm.TrampolineBackpatchingTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
+, ( "jvm.TypeCheckTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "jvm.VirtualAbstractInterfaceMethodTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "jvm.WideTest", 0, NO_SYSTEM_CLASSLOADER, [ "i386", "x86_64" ] )
 , ( "test.java.lang.ClassTest", 0, [ ], [ "i386", "x86_64" ] )
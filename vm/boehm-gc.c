@@ -26,17 +26,18 @@ do_gc_register_finalizer(struct vm_object *object, finalizer_fn finalizer)
 	return 0;
 }
 
+/*
+ * GC_malloc() and GC_malloc_uncollectable() return cleared memory so there's
+ * no need to memset() it here. GC_malloc_atomic() doesn't.
+ */
 static void *do_gc_malloc(size_t size)
 {
-	void *p;
-
-	p = GC_malloc(size);
-	if (!p)
-		return NULL;
-
-	memset(p, 0, size);
+	return GC_malloc(size);
+}
 
-	return p;
+static void *do_gc_malloc_many(size_t size)
+{
+	return GC_malloc_many(size);
 }
 
 static void *do_gc_malloc_noscan(size_t size)
@@ -54,15 +55,7 @@ static void *do_gc_malloc_noscan(size_t size)
 
 static void *do_gc_malloc_uncollectable(size_t size)
 {
-	void *p;
-
-	p = GC_malloc_uncollectable(size);
-	if (!p)
-		return NULL;
-
-	memset(p, 0, size);
-
-	return p;
+	return GC_malloc_uncollectable(size);
 }
 
 static void do_gc_free(void *ptr)
@@ -75,6 +68,7 @@ void gc_setup_boehm(void)
 	gc_ops		= (struct gc_operations) {
 		.gc_alloc		= do_gc_malloc,
 		.gc_alloc_noscan	= do_gc_malloc_noscan,
+		.gc_alloc_many		= do_gc_malloc_many,
 		.vm_alloc		= do_gc_malloc_uncollectable,
 		.vm_free		= do_gc_free,
 		.gc_register_finalizer	= do_gc_register_finalizer
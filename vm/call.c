@@ -13,6 +13,7 @@
 
 #include "vm/call.h"
 #include "vm/class.h"
+#include "vm/interp.h"
 #include "vm/method.h"
 #include "vm/object.h"
 #include "vm/stack-trace.h"
@@ -32,7 +33,10 @@ call_method_a(struct vm_method *method, void *target, unsigned long *args,
 	exception = exception_occurred();
 	clear_exception();
 
-	native_call(method, target, args, result);
+	if (vm_method_use_interp(method))
+		vm_interp_method_a(method, args, result);
+	else
+		native_call(method, target, args, result);
 
 	if (!exception_occurred() && exception)
 		signal_exception(exception);
@@ -65,6 +69,16 @@ void vm_call_method_this_a(struct vm_method *method,
 		struct vm_method *vmm
 			= vm_class_get_method_recursive(this->class, method->name, method->type);
 		target = vm_method_call_ptr(vmm);
+
+		if (vm_interp_enabled())
+			method = vmm;
+	} else if (vm_interp_enabled()) {
+		/*
+		 * The interpreter needs the target method itself so we can not
+		 * use the vtable entry point here.
+		 */
+		method = vm_class_get_virtual_method(this->class, method);
+		target = vm_method_call_ptr(method);
 	} else {
 		target = this->class->vtable.native_ptr[method->virtual_index];
 	}
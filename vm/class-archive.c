@@ -0,0 +1,633 @@
+/*
+ * Shared class archive
+ *
+ * This file is released under the 2-clause BSD license. Please refer to the
+ * file LICENSE for details.
+ *
+ * With -Xshare:dump, the parsed class files of all classes that the bootstrap
+ * class loader loaded are written to an archive at exit. With -Xshare:on, the
+ * archive is mapped at startup and classes that are found in it are linked
+ * from the archived cafebabe_class without reading or parsing the class file.
+ *
+ * The archive is laid out for the address that is stored in its header and
+ * the VM tries to map it there. If that succeeds, the pages are never written
+ * to and are shared with every other VM that maps the same archive. Nothing
+ * may write to an archived cafebabe_class after it is mapped: per-process
+ * state such as the VM native override of bytecode methods is kept in
+ * struct vm_method. If the
+ * address is taken, the archive is mapped elsewhere and the pointers in it
+ * are relocated with the relocation table at the end of the file.
+ *
+ * Only the parsed class files are archived. Linked classes point to JIT code,
+ * to objects in the garbage collected heap and to other things that are
+ * different in every process so classes are still linked at run time.
+ *
+ * The archive is only used if the boot class path is the same as when the
+ * archive was written (see classloader_classpath_fingerprint()).
+ */
+
+#include "vm/class-archive.h"
+
+#include "cafebabe/attribute_array.h"
+#include "cafebabe/attribute_info.h"
+#include "cafebabe/constant_pool.h"
+#include "cafebabe/field_info.h"
+#include "cafebabe/method_info.h"
+#include "cafebabe/class.h"
+
+#include "arch/atomic.h"
+
+#include "vm/classloader.h"
+#include "vm/class.h"
+#include "vm/die.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <stdio.h>
+
+#define CLASS_ARCHIVE_MAGIC	"JATOJSA"
+#define CLASS_ARCHIVE_VERSION	1
+
+/* The address that archives are laid out for */
+#ifdef CONFIG_32_BIT
+#define CLASS_ARCHIVE_BASE	0x50000000UL
+#else
+#define CLASS_ARCHIVE_BASE	0x600000000000UL
+#endif
+
+#ifdef MAP_FIXED_NOREPLACE
+#define CLASS_ARCHIVE_MAP_FLAGS	MAP_FIXED_NOREPLACE
+#else
+#define CLASS_ARCHIVE_MAP_FLAGS	0
+#endif
+
+struct class_archive_entry {
+	const char		*name;
+	struct cafebabe_class	*class;
+};
+
+struct class_archive_header {
+	char			magic[8];
+	uint32_t		version;
+	uint32_t		layout;
+	uint64_t		fingerprint;
+	unsigned long		base;
+	unsigned long		size;
+
+	/* Sorted by class name */
+	unsigned long		nr_classes;
+	struct class_archive_entry *entries;
+
+	/* Offsets of the pointers in the archive */
+	unsigned long		relocs_offset;
+	unsigned long		nr_relocs;
+};
+
+enum class_archive_mode class_archive_mode = CLASS_ARCHIVE_OFF;
+const char *class_archive_path;
+
+static struct class_archive_header *archive;
+static atomic_t nr_archive_hits;
+
+/* Classes that are written to the archive with -Xshare:dump */
+static struct vm_class **dump_classes;
+static unsigned long nr_dump_classes;
+static pthread_mutex_t dump_classes_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Changes whenever the layout of the archived structures changes so that an
+ * archive written by a different build is not used.
+ */
+static uint32_t class_archive_layout(void)
+{
+	return sizeof(void *)
+		^ sizeof(struct cafebabe_class) << 4
+		^ sizeof(struct cafebabe_constant_pool) << 12
+		^ sizeof(struct cafebabe_field_info) << 18
+		^ sizeof(struct cafebabe_method_info) << 22
+		^ sizeof(struct cafebabe_attribute_info) << 26;
+}
+
+/*
+ * The archive is mapped and the pointers in it are used as they are, so the
+ * default archive is kept in the private cache directory of the user instead
+ * of a shared directory like /tmp. Returns NULL if there is no cache
+ * directory.
+ */
+static const char *archive_path(void)
+{
+	static char path[PATH_MAX];
+	const char *dir;
+	int len;
+
+	if (class_archive_path)
+		return class_archive_path;
+
+	dir = getenv("XDG_CACHE_HOME");
+	if (dir && dir[0] == '/')
+		len = snprintf(path, sizeof(path), "%s/jato/classes.jsa", dir);
+	else if ((dir = getenv("HOME")) && dir[0] == '/')
+		len = snprintf(path, sizeof(path), "%s/.cache/jato/classes.jsa", dir);
+	else
+		return NULL;
+
+	if (len < 0 || len >= (int) sizeof(path))
+		return NULL;
+
+	return path;
+}
+
+/*
+ * Creates the directories of the default archive path that don't exist yet.
+ * They are only accessible by the user.
+ */
+static void archive_mkdirs(const char *path)
+{
+	char *dir, *p;
+
+	dir = strdup(path);
+	if (!dir)
+		return;
+
+	for (p = strchr(dir + 1, '/'); p != NULL; p = strchr(p + 1, '/')) {
+		*p = '\0';
+		mkdir(dir, 0700);
+		*p = '/';
+	}
+
+	free(dir);
+}
+
+/*
+ * Another user who can write to the archive could make the VM run arbitrary
+ * code, so only archives that are owned by the user and that nobody else can
+ * write to are used.
+ */
+static bool archive_is_trusted(const struct stat *st)
+{
+	return S_ISREG(st->st_mode) && st->st_uid == geteuid() &&
+		!(st->st_mode & (S_IWGRP | S_IWOTH));
+}
+
+static int archive_relocate(void *p, const struct class_archive_header *header)
+{
+	unsigned long delta = (unsigned long) p - header->base;
+	const unsigned long *relocs;
+
+	if (header->relocs_offset > header->size ||
+	    header->nr_relocs > (header->size - header->relocs_offset) / sizeof(*relocs))
+		return -1;
+
+	relocs = p + header->relocs_offset;
+
+	for (unsigned long i = 0; i < header->nr_relocs; i++) {
+		if (relocs[i] > header->relocs_offset - sizeof(unsigned long))
+			return -1;
+
+		*(unsigned long *) (p + relocs[i]) += delta;
+	}
+
+	return 0;
+}
+
+/*
+ * Maps the archive. Returns zero if the archive can be used.
+ */
+int class_archive_open(void)
+{
+	struct class_archive_header header;
+	const char *path;
+	struct stat st;
+	void *p;
+	int fd;
+
+	path = archive_path();
+	if (!path)
+		return -1;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+
+	if (fstat(fd, &st) < 0)
+		goto out_close;
+
+	if (!archive_is_trusted(&st)) {
+		warn("class archive %s is not a file that only you can write to, ignoring it", path);
+		goto out_close;
+	}
+
+	if (pread(fd, &header, sizeof(header), 0) != sizeof(header))
+		goto out_close;
+
+	if (memcmp(header.magic, CLASS_ARCHIVE_MAGIC, sizeof(header.magic)) ||
+	    header.version != CLASS_ARCHIVE_VERSION ||
+	    header.layout != class_archive_layout() ||
+	    header.size != (unsigned long) st.st_size ||
+	    header.fingerprint != classloader_classpath_fingerprint())
+		goto out_close;
+
+	p = mmap((void *) header.base, header.size, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | CLASS_ARCHIVE_MAP_FLAGS, fd, 0);
+	if (p == MAP_FAILED && CLASS_ARCHIVE_MAP_FLAGS)
+		p = mmap(NULL, header.size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	if (p == MAP_FAILED)
+		goto out_close;
+
+	close(fd);
+
+	if ((unsigned long) p != header.base && archive_relocate(p, &header)) {
+		munmap(p, header.size);
+		return -1;
+	}
+
+	archive = p;
+
+	return 0;
+
+out_close:
+	close(fd);
+	return -1;
+}
+
+static int archive_entry_compare(const void *key, const void *p)
+{
+	const struct class_archive_entry *entry = p;
+
+	return strcmp(key, entry->name);
+}
+
+/*
+ * Returns the archived class file of @class_name or NULL if the class is not
+ * in the archive.
+ */
+struct cafebabe_class *class_archive_find(const char *class_name)
+{
+	struct class_archive_entry *entry;
+
+	if (!archive)
+		return NULL;
+
+	entry = bsearch(class_name, archive->entries, archive->nr_classes,
+			sizeof(*entry), archive_entry_compare);
+	if (!entry)
+		return NULL;
+
+	atomic_inc(&nr_archive_hits);
+
+	return entry->class;
+}
+
+void class_archive_add(struct vm_class *vmc)
+{
+	struct vm_class **new_array;
+
+	pthread_mutex_lock(&dump_classes_mutex);
+
+	new_array = realloc(dump_classes, sizeof(*dump_classes) * (nr_dump_classes + 1));
+	if (new_array) {
+		dump_classes = new_array;
+		dump_classes[nr_dump_classes++] = vmc;
+	}
+
+	pthread_mutex_unlock(&dump_classes_mutex);
+}
+
+/*
+ * The archive is built in a buffer that grows as things are added to it so
+ * the parts of the archive are referred to by their offset while it is being
+ * written.
+ */
+struct archive_writer {
+	char			*buf;
+	unsigned long		size;
+	unsigned long		capacity;
+
+	unsigned long		*relocs;
+	unsigned long		nr_relocs;
+	unsigned long		relocs_capacity;
+
+	bool			failed;
+};
+
+static unsigned long writer_alloc(struct archive_writer *w, unsigned long size,
+				  unsigned long align)
+{
+	unsigned long offset = ALIGN(w->size, align);
+
+	if (w->failed)
+		return 0;
+
+	if (offset + size > w->capacity) {
+		unsigned long capacity = w->capacity ? w->capacity : 1024 * 1024;
+		char *buf;
+
+		while (offset + size > capacity)
+			capacity *= 2;
+
+		buf = realloc(w->buf, capacity);
+		if (!buf) {
+			w->failed = true;
+			return 0;
+		}
+
+		w->buf		= buf;
+		w->capacity	= capacity;
+	}
+
+	memset(w->buf + w->size, 0, offset + size - w->size);
+	w->size = offset + size;
+
+	return offset;
+}
+
+static unsigned long writer_copy(struct archive_writer *w, const void *src,
+				 unsigned long size, unsigned long align)
+{
+	unsigned long offset = writer_alloc(w, size, align);
+
+	if (!w->failed)
+		memcpy(w->buf + offset, src, size);
+
+	return offset;
+}
+
+/*
+ * Points the pointer at @offset to @target and records it for relocation.
+ */
+static void writer_set_ptr(struct archive_writer *w, unsigned long offset, unsigned long target)
+{
+	if (w->failed)
+		return;
+
+	if (w->nr_relocs == w->relocs_capacity) {
+		unsigned long capacity = w->relocs_capacity ? w->relocs_capacity * 2 : 4096;
+		unsigned long *relocs;
+
+		relocs = realloc(w->relocs, capacity * sizeof(*relocs));
+		if (!relocs) {
+			w->failed = true;
+			return;
+		}
+
+		w->relocs		= relocs;
+		w->relocs_capacity	= capacity;
+	}
+
+	*(unsigned long *) (w->buf + offset) = CLASS_ARCHIVE_BASE + target;
+	w->relocs[w->nr_relocs++] = offset;
+}
+
+static void write_attributes(struct archive_writer *w, unsigned long offset,
+			     const struct cafebabe_attribute_array *attributes)
+{
+	unsigned long array;
+
+	array = writer_copy(w, attributes->array, attributes->count * sizeof(attributes->array[0]),
+			sizeof(unsigned long));
+	writer_set_ptr(w, offset + offsetof(struct cafebabe_attribute_array, array), array);
+
+	for (unsigned int i = 0; i < attributes->count; i++) {
+		const struct cafebabe_attribute_info *a = &attributes->array[i];
+		unsigned long info;
+
+		info = writer_copy(w, a->info, a->attribute_length, 1);
+		writer_set_ptr(w, array + i * sizeof(*a) + offsetof(struct cafebabe_attribute_info, info), info);
+	}
+}
+
+static unsigned long write_class(struct archive_writer *w, const struct vm_class *vmc)
+{
+	const struct cafebabe_class *c = vmc->class;
+	unsigned long class, cp, p;
+
+	class = writer_copy(w, c, sizeof(*c), sizeof(unsigned long));
+
+	cp = writer_copy(w, c->constant_pool, c->constant_pool_count * sizeof(c->constant_pool[0]),
+			sizeof(unsigned long));
+	writer_set_ptr(w, class + offsetof(struct cafebabe_class, constant_pool), cp);
+
+	for (unsigned int i = 1; i < c->constant_pool_count; i++) {
+		const struct cafebabe_constant_pool *entry = &c->constant_pool[i];
+		unsigned long bytes;
+
+		switch (entry->tag) {
+		case CAFEBABE_CONSTANT_TAG_UTF8:
+			bytes = writer_copy(w, entry->utf8.bytes, entry->utf8.length, 1);
+			writer_set_ptr(w, cp + i * sizeof(*entry)
+				       + offsetof(struct cafebabe_constant_pool, utf8.bytes), bytes);
+			break;
+		case CAFEBABE_CONSTANT_TAG_LONG:
+		case CAFEBABE_CONSTANT_TAG_DOUBLE:
+			++i;
+			break;
+		default:
+			break;
+		}
+	}
+
+	p = writer_copy(w, c->interfaces, c->interfaces_count * sizeof(c->interfaces[0]),
+			sizeof(c->interfaces[0]));
+	writer_set_ptr(w, class + offsetof(struct cafebabe_class, interfaces), p);
+
+	p = writer_copy(w, c->fields, c->fields_count * sizeof(c->fields[0]),
+			sizeof(unsigned long));
+	writer_set_ptr(w, class + offsetof(struct cafebabe_class, fields), p);
+
+	for (unsigned int i = 0; i < c->fields_count; i++) {
+		write_attributes(w, p + i * sizeof(c->fields[0])
+				 + offsetof(struct cafebabe_field_info, attributes),
+				 &c->fields[i].attributes);
+	}
+
+	p = writer_copy(w, c->methods, c->methods_count * sizeof(c->methods[0]),
+			sizeof(unsigned long));
+	writer_set_ptr(w, class + offsetof(struct cafebabe_class, methods), p);
+
+	for (unsigned int i = 0; i < c->methods_count; i++) {
+		write_attributes(w, p + i * sizeof(c->methods[0])
+				 + offsetof(struct cafebabe_method_info, attributes),
+				 &c->methods[i].attributes);
+	}
+
+	write_attributes(w, class + offsetof(struct cafebabe_class, attributes), &c->attributes);
+
+	return class;
+}
+
+static int vm_class_name_compare(const void *a, const void *b)
+{
+	const struct vm_class *class_a = *(const struct vm_class **) a;
+	const struct vm_class *class_b = *(const struct vm_class **) b;
+
+	return strcmp(class_a->name, class_b->name);
+}
+
+static int write_file(const char *path, const void *buf, unsigned long size)
+{
+	char *tmp_path;
+	int fd, err = -1;
+
+	if (asprintf(&tmp_path, "%s.%d", path, getpid()) < 0)
+		return -1;
+
+	fd = open(tmp_path, O_WRONLY | O_CREAT | O_EXCL, 0600);
+	if (fd < 0)
+		goto out_free;
+
+	if (write(fd, buf, size) != (ssize_t) size) {
+		close(fd);
+		unlink(tmp_path);
+		goto out_free;
+	}
+
+	close(fd);
+
+	err = rename(tmp_path, path);
+	if (err)
+		unlink(tmp_path);
+
+out_free:
+	free(tmp_path);
+	return err;
+}
+
+/*
+ * Writes the classes that have been recorded with class_archive_add() to the
+ * archive. The archive is written to a temporary file that is renamed in
+ * place so that other VMs never see an archive that is half written.
+ */
+int class_archive_dump(void)
+{
+	struct archive_writer w = { NULL, };
+	struct class_archive_header *header;
+	unsigned long entries, relocs;
+	const char *path;
+	int err;
+
+	path = archive_path();
+	if (!path) {
+		warn("unable to write class archive: no cache directory, use -XX:SharedArchiveFile");
+		return -1;
+	}
+
+	pthread_mutex_lock(&dump_classes_mutex);
+
+	qsort(dump_classes, nr_dump_classes, sizeof(*dump_classes), vm_class_name_compare);
+
+	writer_alloc(&w, sizeof(*header), sizeof(unsigned long));
+
+	entries = writer_alloc(&w, nr_dump_classes * sizeof(struct class_archive_entry),
+			       sizeof(unsigned long));
+	writer_set_ptr(&w, offsetof(struct class_archive_header, entries), entries);
+
+	for (unsigned long i = 0; i < nr_dump_classes; i++) {
+		struct vm_class *vmc = dump_classes[i];
+		unsigned long entry = entries + i * sizeof(struct class_archive_entry);
+
+		writer_set_ptr(&w, entry + offsetof(struct class_archive_entry, name),
+			       writer_copy(&w, vmc->name, strlen(vmc->name) + 1, 1));
+		writer_set_ptr(&w, entry + offsetof(struct class_archive_entry, class),
+			       write_class(&w, vmc));
+	}
+
+	relocs = writer_copy(&w, w.relocs, w.nr_relocs * sizeof(w.relocs[0]),
+			sizeof(unsigned long));
+
+	if (w.failed) {
+		err = -1;
+		goto out_unlock;
+	}
+
+	header = (void *) w.buf;
+	memcpy(header->magic, CLASS_ARCHIVE_MAGIC, sizeof(header->magic));
+	header->version		= CLASS_ARCHIVE_VERSION;
+	header->layout		= class_archive_layout();
+	header->fingerprint	= classloader_classpath_fingerprint();
+	header->base		= CLASS_ARCHIVE_BASE;
+	header->size		= w.size;
+	header->nr_classes	= nr_dump_classes;
+	header->relocs_offset	= relocs;
+	header->nr_relocs	= w.nr_relocs;
+
+	if (!class_archive_path)
+		archive_mkdirs(path);
+
+	err = write_file(path, w.buf, w.size);
+
+out_unlock:
+	pthread_mutex_unlock(&dump_classes_mutex);
+
+	if (err)
+		warn("unable to write class archive %s", path);
+
+	free(w.relocs);
+	free(w.buf);
+
+	return err;
+}
+
+/*
+ * Reads the resident and shared size of the archive mapping in kilobytes
+ * from /proc/self/smaps.
+ */
+static void archive_rss(unsigned long *rss, unsigned long *shared)
+{
+	unsigned long start, end, value;
+	bool in_archive = false;
+	char line[256];
+	FILE *f;
+
+	*rss = *shared = 0;
+
+	f = fopen("/proc/self/smaps", "r");
+	if (!f)
+		return;
+
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+			in_archive = start < (unsigned long) archive + archive->size
+				&& end > (unsigned long) archive;
+			continue;
+		}
+
+		if (!in_archive)
+			continue;
+
+		if (sscanf(line, "Rss: %lu kB", &value) == 1)
+			*rss += value;
+		else if (sscanf(line, "Shared_Clean: %lu kB", &value) == 1)
+			*shared += value;
+		else if (sscanf(line, "Shared_Dirty: %lu kB", &value) == 1)
+			*shared += value;
+	}
+
+	fclose(f);
+}
+
+void class_archive_print_stats(void)
+{
+	unsigned long rss, shared;
+
+	if (!archive) {
+		fprintf(stderr, "Class archive: not mapped\n");
+		return;
+	}
+
+	archive_rss(&rss, &shared);
+
+	fprintf(stderr, "Class archive: %d of %lu classes loaded from %s%s\n",
+		atomic_read(&nr_archive_hits), archive->nr_classes, archive_path(),
+		(unsigned long) archive == archive->base ? "" : " (relocated)");
+	fprintf(stderr, "  %8lu KB mapped %8lu KB resident %8lu KB shared\n",
+		archive->size / 1024, rss, shared);
+}
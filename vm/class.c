@@ -41,6 +41,8 @@
 #include "lib/string.h"
 #include "lib/array.h"
 
+#include "arch/atomic.h"
+
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
@@ -195,6 +197,37 @@ static void bucket_order_fields(struct field_bucket *bucket,
 	*offset = tmp_offset;
 }
 
+/*
+ * Records the offsets of all instance fields of reference type, including the
+ * ones inherited from superclasses, for the garbage collector. @refs is the
+ * bucket of the reference fields declared by @vmc.
+ */
+static int vm_class_init_ref_offsets(struct vm_class *vmc, struct field_bucket *refs)
+{
+	unsigned int nr_super = 0;
+
+	if (vmc->super)
+		nr_super = vmc->super->nr_ref_offsets;
+
+	vmc->nr_ref_offsets = nr_super + refs->nr;
+	if (!vmc->nr_ref_offsets) {
+		vmc->ref_offsets = NULL;
+		return 0;
+	}
+
+	vmc->ref_offsets = malloc(vmc->nr_ref_offsets * sizeof(*vmc->ref_offsets));
+	if (!vmc->ref_offsets)
+		return -ENOMEM;
+
+	if (nr_super)
+		memcpy(vmc->ref_offsets, vmc->super->ref_offsets, nr_super * sizeof(*vmc->ref_offsets));
+
+	for (unsigned int i = 0; i < refs->nr; ++i)
+		vmc->ref_offsets[nr_super + i] = refs->fields[i]->offset;
+
+	return 0;
+}
+
 static void buckets_order_fields(struct field_bucket buckets[VM_TYPE_MAX],
 	unsigned int *ref_size, unsigned int *size)
 {
@@ -272,6 +305,170 @@ static void free_buckets(int rows, int cols, struct field_bucket field_buckets[r
 	}
 }
 
+/*
+ * Adds @super to the secondary supertypes of @vmc unless it's already there.
+ */
+static void add_secondary_super(struct vm_class *vmc, struct vm_class *super)
+{
+	for (unsigned int i = 0; i < vmc->nr_secondary_supers; ++i) {
+		if (vmc->secondary_supers[i] == super)
+			return;
+	}
+
+	vmc->secondary_supers[vmc->nr_secondary_supers++] = super;
+}
+
+/*
+ * Sets up the supertype display and the secondary supertypes of @vmc. The
+ * superclass and the interfaces of @vmc must have been set up already.
+ */
+static int vm_class_init_supers(struct vm_class *vmc)
+{
+	struct vm_class *super = vmc->super;
+	unsigned int max_secondary;
+	bool primary;
+
+	if (super) {
+		vmc->depth = super->depth + 1;
+		memcpy(vmc->display, super->display, sizeof(vmc->display));
+	} else {
+		vmc->depth = 0;
+		memset(vmc->display, 0, sizeof(vmc->display));
+	}
+
+	if (vmc->depth < VM_CLASS_DISPLAY_SIZE)
+		vmc->display[vmc->depth] = vmc;
+
+	max_secondary = 0;
+	if (super)
+		max_secondary += super->nr_secondary_supers + 1;
+
+	for (unsigned int i = 0; i < vmc->nr_interfaces; ++i)
+		max_secondary += vmc->interfaces[i]->nr_secondary_supers + 1;
+
+	vmc->nr_secondary_supers = 0;
+	vmc->secondary_supers = NULL;
+
+	if (max_secondary) {
+		vmc->secondary_supers = malloc(max_secondary * sizeof(*vmc->secondary_supers));
+		if (!vmc->secondary_supers)
+			return -ENOMEM;
+	}
+
+	if (super) {
+		for (unsigned int i = 0; i < super->nr_secondary_supers; ++i)
+			add_secondary_super(vmc, super->secondary_supers[i]);
+
+		if (super->depth >= VM_CLASS_DISPLAY_SIZE)
+			add_secondary_super(vmc, super);
+	}
+
+	for (unsigned int i = 0; i < vmc->nr_interfaces; ++i) {
+		struct vm_class *vmi = vmc->interfaces[i];
+
+		add_secondary_super(vmc, vmi);
+
+		for (unsigned int j = 0; j < vmi->nr_secondary_supers; ++j)
+			add_secondary_super(vmc, vmi->secondary_supers[j]);
+	}
+
+	primary = vmc->depth < VM_CLASS_DISPLAY_SIZE
+		&& !vm_class_is_interface(vmc) && !vm_class_is_array_class(vmc);
+
+	if (primary)
+		vmc->super_check_offset = offsetof(struct vm_class, display[vmc->depth]);
+	else
+		vmc->super_check_offset = offsetof(struct vm_class, secondary_super_cache);
+
+	vmc->secondary_super_cache = NULL;
+
+	return 0;
+}
+
+/*
+ * Hashes the name and the type of a method or a field (FNV-1a).
+ */
+static uint32_t vm_member_hash(const char *name, const char *type)
+{
+	uint32_t hash = 2166136261u;
+
+	for (; *name; name++)
+		hash = (hash ^ (unsigned char) *name) * 16777619u;
+
+	/* Keep "ab" + "c" apart from "a" + "bc". */
+	hash = (hash ^ 0xff) * 16777619u;
+
+	for (; *type; type++)
+		hash = (hash ^ (unsigned char) *type) * 16777619u;
+
+	return hash;
+}
+
+/*
+ * Builds an open-addressed hash index of @nr members. The name and the type
+ * of the member at index i are returned by @get. The table is kept at most
+ * half full so that probe sequences stay short.
+ */
+static int vm_member_index_init(struct vm_member_slot **index_p, unsigned int *mask_p,
+				unsigned int nr, void *members,
+				void (*get)(void *, unsigned int, const char **, const char **))
+{
+	struct vm_member_slot *index;
+	unsigned int size;
+
+	*index_p = NULL;
+	*mask_p = 0;
+
+	if (!nr)
+		return 0;
+
+	for (size = 4; size < 2 * nr; size <<= 1)
+		;
+
+	index = malloc(size * sizeof(*index));
+	if (!index)
+		return -ENOMEM;
+
+	for (unsigned int i = 0; i < size; ++i)
+		index[i].index = VM_MEMBER_SLOT_EMPTY;
+
+	for (unsigned int i = 0; i < nr; ++i) {
+		const char *name, *type;
+		unsigned int slot;
+		uint32_t hash;
+
+		get(members, i, &name, &type);
+		hash = vm_member_hash(name, type);
+
+		for (slot = hash & (size - 1); index[slot].index != VM_MEMBER_SLOT_EMPTY; slot = (slot + 1) & (size - 1))
+			;
+
+		index[slot].hash = hash;
+		index[slot].index = i;
+	}
+
+	*index_p = index;
+	*mask_p = size - 1;
+
+	return 0;
+}
+
+static void get_method_name_type(void *members, unsigned int i, const char **name, const char **type)
+{
+	struct vm_method *vmm = &((struct vm_method *) members)[i];
+
+	*name = vmm->name;
+	*type = vmm->type;
+}
+
+static void get_field_name_type(void *members, unsigned int i, const char **name, const char **type)
+{
+	struct vm_field *vmf = &((struct vm_field *) members)[i];
+
+	*name = vmf->name;
+	*type = vmf->type;
+}
+
 int vm_class_link(struct vm_class *vmc, const struct cafebabe_class *class)
 {
 	const struct cafebabe_constant_info_class *constant_class;
@@ -292,6 +489,10 @@ int vm_class_link(struct vm_class *vmc, const struct cafebabe_class *class)
 
 	vmc->name = strndup((char *) name->bytes, name->length);
 
+	vmc->resolved = calloc(class->constant_pool_count, sizeof(*vmc->resolved));
+	if (!vmc->resolved)
+		goto error_free_name;
+
 	vmc->access_flags = class->access_flags;
 
 	vmc->source_file_name = cafebabe_class_get_source_file_name(class);
@@ -301,10 +502,10 @@ int vm_class_link(struct vm_class *vmc, const struct cafebabe_class *class)
 		const struct cafebabe_constant_info_utf8 *super_name;
 
 		if (cafebabe_class_constant_get_class(class, class->super_class, &constant_super))
-			goto error_free_name;
+			goto error_free_resolved;
 
 		if (cafebabe_class_constant_get_utf8(class, constant_super->name_index, &super_name))
-			goto error_free_name;
+			goto error_free_resolved;
 
 		char *super_name_str = strndup((char *) super_name->bytes, super_name->length);
 
@@ -313,10 +514,10 @@ int vm_class_link(struct vm_class *vmc, const struct cafebabe_class *class)
 		free(super_name_str);
 
 		if (!vmc->super)
-			goto error_free_name;
+			goto error_free_resolved;
 	} else {
 		if (!strcmp(vmc->name, "java.lang.Object"))
-			goto error_free_name;
+			goto error_free_resolved;
 
 		vmc->super = NULL;
 	}
@@ -324,7 +525,7 @@ int vm_class_link(struct vm_class *vmc, const struct cafebabe_class *class)
 	vmc->nr_interfaces = class->interfaces_count;
 	vmc->interfaces = malloc(sizeof(*vmc->interfaces) * vmc->nr_interfaces);
 	if (!vmc->interfaces)
-		goto error_free_name;
+		goto error_free_resolved;
 
 	for (unsigned int i = 0; i < class->interfaces_count; ++i) {
 		const struct cafebabe_constant_info_class *interface;
@@ -349,10 +550,13 @@ int vm_class_link(struct vm_class *vmc, const struct cafebabe_class *class)
 		vmc->interfaces[i] = vmi;
 	}
 
+	if (vm_class_init_supers(vmc))
+		goto error_free_interfaces;
+
 	vmc->nr_fields = class->fields_count;
 	vmc->fields = vm_alloc(sizeof(*vmc->fields) * class->fields_count);
 	if (!vmc->fields)
-		goto error_free_interfaces;
+		goto error_free_supers;
 
 	for (uint16_t i = 0; i < vmc->nr_fields; ++i) {
 		struct vm_field *vmf = &vmc->fields[i];
@@ -361,6 +565,10 @@ int vm_class_link(struct vm_class *vmc, const struct cafebabe_class *class)
 			goto error_free_fields;
 	}
 
+	if (vm_member_index_init(&vmc->field_index, &vmc->field_index_mask,
+				 vmc->nr_fields, vmc->fields, get_field_name_type))
+		goto error_free_fields;
+
 	if (vmc->super) {
 		vmc->static_size = vmc->super->static_size;
 		vmc->object_size = vmc->super->object_size;
@@ -409,10 +617,13 @@ int vm_class_link(struct vm_class *vmc, const struct cafebabe_class *class)
 	buckets_order_fields(field_buckets[0], &tmp, &vmc->static_size);
 	buckets_order_fields(field_buckets[1], &tmp, &vmc->object_size);
 
+	if (vm_class_init_ref_offsets(vmc, &field_buckets[1][J_REFERENCE]))
+		goto error_free_buckets;
+
 	/* XXX: only static fields, right size, etc. */
 	vmc->static_values = vm_zalloc(vmc->static_size);
 	if (!vmc->static_values)
-		goto error_free_buckets;
+		goto error_free_ref_offsets;
 
 	for (uint16_t i = 0; i < vmc->nr_fields; ++i) {
 		struct vm_field *vmf = &vmc->fields[i];
@@ -477,6 +688,10 @@ int vm_class_link(struct vm_class *vmc, const struct cafebabe_class *class)
 			goto error_free_methods;
 	}
 
+	if (vm_member_index_init(&vmc->method_index, &vmc->method_index_mask,
+				 vmc->nr_methods, vmc->methods, get_method_name_type))
+		goto error_free_methods;
+
 	for (uint16_t i = 0; i < vmc->nr_methods; ++i) {
 		struct vm_method *vmm = &vmc->methods[i];
 
@@ -563,17 +778,25 @@ error_free_annotations:
 	}
 	vm_free(vmc->annotations);
 error_free_methods:
+	free(vmc->method_index);
 	vm_free(vmc->methods);
 error_free_inner_classes:
 	vm_free(vmc->inner_classes);
 error_free_static_values:
 	vm_free(vmc->static_values);
+error_free_ref_offsets:
+	free(vmc->ref_offsets);
 error_free_buckets:
 	free_buckets(2, VM_TYPE_MAX, field_buckets);
 error_free_fields:
+	free(vmc->field_index);
 	vm_free(vmc->fields);
+error_free_supers:
+	free(vmc->secondary_supers);
 error_free_interfaces:
 	free(vmc->interfaces);
+error_free_resolved:
+	free(vmc->resolved);
 error_free_name:
 	free(vmc->name);
 
@@ -604,6 +827,10 @@ int vm_class_link_primitive_class(struct vm_class *vmc, const char *class_name)
 	vmc->fields = NULL;
 	vmc->methods = NULL;
 
+	err = vm_class_init_supers(vmc);
+	if (err)
+		return err;
+
 	vmc->object_size = 0;
 	vmc->static_size = 0;
 
@@ -642,6 +869,10 @@ int vm_class_link_array_class(struct vm_class *vmc, struct vm_class *elem_class,
 	vmc->fields = NULL;
 	vmc->methods = NULL;
 
+	err = vm_class_init_supers(vmc);
+	if (err)
+		return err;
+
 	vmc->object_size = 0;
 	vmc->static_size = 0;
 
@@ -759,7 +990,62 @@ int vm_class_init(struct vm_class *vmc)
 	return -1;
 }
 
-struct vm_class *vm_class_resolve_class(const struct vm_class *vmc, uint16_t i)
+bool opt_print_resolve_stats;
+
+static atomic_t nr_resolve_hits;
+static atomic_t nr_resolve_misses;
+
+/*
+ * Returns what constant pool entry @i of @vmc has been resolved to or NULL if
+ * it hasn't been resolved yet.
+ */
+static void *vm_class_get_resolved(const struct vm_class *vmc, uint16_t i)
+{
+	void *p;
+
+	if (!vmc->resolved || i >= vmc->class->constant_pool_count)
+		return NULL;
+
+	p = vmc->resolved[i];
+
+	if (opt_print_resolve_stats)
+		atomic_inc(p ? &nr_resolve_hits : &nr_resolve_misses);
+
+	return p;
+}
+
+/*
+ * Remembers that constant pool entry @i of @vmc resolves to @p. Threads that
+ * resolve the same entry at the same time all get the pointer that was
+ * stored first.
+ */
+static void *vm_class_set_resolved(const struct vm_class *vmc, uint16_t i, void *p)
+{
+	void *old;
+
+	if (!p || !vmc->resolved || i >= vmc->class->constant_pool_count)
+		return p;
+
+	old = cmpxchg_ptr(&vmc->resolved[i], NULL, p);
+	if (old)
+		return old;
+
+	return p;
+}
+
+void vm_class_print_resolve_stats(void)
+{
+	unsigned int hits = atomic_read(&nr_resolve_hits);
+	unsigned int misses = atomic_read(&nr_resolve_misses);
+
+	fprintf(stderr, "Constant pool resolution:\n");
+	fprintf(stderr, "  hits:     %u\n", hits);
+	fprintf(stderr, "  misses:   %u\n", misses);
+	fprintf(stderr, "  hit rate: %.1f%%\n",
+		hits + misses ? 100.0 * hits / (hits + misses) : 0.0);
+}
+
+static struct vm_class *__vm_class_resolve_class(const struct vm_class *vmc, uint16_t i)
 {
 	const struct cafebabe_constant_info_class *constant_class;
 
@@ -792,6 +1078,17 @@ out:
 	return class;
 }
 
+struct vm_class *vm_class_resolve_class(const struct vm_class *vmc, uint16_t i)
+{
+	struct vm_class *class;
+
+	class = vm_class_get_resolved(vmc, i);
+	if (class)
+		return class;
+
+	return vm_class_set_resolved(vmc, i, __vm_class_resolve_class(vmc, i));
+}
+
 int vm_class_resolve_field(const struct vm_class *vmc, uint16_t i,
 	struct vm_class **r_vmc, char **r_name, char **r_type)
 {
@@ -850,31 +1147,61 @@ int vm_class_resolve_field(const struct vm_class *vmc, uint16_t i,
 	return 0;
 }
 
-struct vm_field *vm_class_get_field(const struct vm_class *vmc,
-	const char *name, const char *type)
+static uint32_t vm_member_index_lookup(struct vm_member_slot *index, unsigned int mask,
+				       uint32_t hash, void *members, const char *name, const char *type,
+				       void (*get)(void *, unsigned int, const char **, const char **))
+{
+	if (!index)
+		return VM_MEMBER_SLOT_EMPTY;
+
+	for (unsigned int slot = hash & mask; index[slot].index != VM_MEMBER_SLOT_EMPTY; slot = (slot + 1) & mask) {
+		const char *m_name, *m_type;
+
+		if (index[slot].hash != hash)
+			continue;
+
+		get(members, index[slot].index, &m_name, &m_type);
+		if (!strcmp(m_name, name) && !strcmp(m_type, type))
+			return index[slot].index;
+	}
+
+	return VM_MEMBER_SLOT_EMPTY;
+}
+
+static struct vm_field *__vm_class_get_field(const struct vm_class *vmc,
+	const char *name, const char *type, uint32_t hash)
 {
+	uint32_t i;
+
 	if (vmc->kind != VM_CLASS_KIND_REGULAR)
 		return NULL;
 
-	unsigned int index = 0;
-	if (!cafebabe_class_get_field(vmc->class, name, type, &index))
-		return &vmc->fields[index];
+	i = vm_member_index_lookup(vmc->field_index, vmc->field_index_mask, hash,
+				   vmc->fields, name, type, get_field_name_type);
+	if (i == VM_MEMBER_SLOT_EMPTY)
+		return NULL;
 
-	return NULL;
+	return &vmc->fields[i];
 }
 
-struct vm_field *vm_class_get_field_recursive(const struct vm_class *vmc,
+struct vm_field *vm_class_get_field(const struct vm_class *vmc,
 	const char *name, const char *type)
+{
+	return __vm_class_get_field(vmc, name, type, vm_member_hash(name, type));
+}
+
+static struct vm_field *__vm_class_get_field_recursive(const struct vm_class *vmc,
+	const char *name, const char *type, uint32_t hash)
 {
 	/* See JVM Spec, 2nd ed., 5.4.3.2 "Field Resolution" */
 	do {
-		struct vm_field *vmf = vm_class_get_field(vmc, name, type);
+		struct vm_field *vmf = __vm_class_get_field(vmc, name, type, hash);
 		if (vmf)
 			return vmf;
 
 		for (unsigned int i = 0; i < vmc->nr_interfaces; ++i) {
-			vmf = vm_class_get_field_recursive(
-				vmc->interfaces[i], name, type);
+			vmf = __vm_class_get_field_recursive(
+				vmc->interfaces[i], name, type, hash);
 			if (vmf)
 				return vmf;
 		}
@@ -885,6 +1212,12 @@ struct vm_field *vm_class_get_field_recursive(const struct vm_class *vmc,
 	return NULL;
 }
 
+struct vm_field *vm_class_get_field_recursive(const struct vm_class *vmc,
+	const char *name, const char *type)
+{
+	return __vm_class_get_field_recursive(vmc, name, type, vm_member_hash(name, type));
+}
+
 struct vm_field *
 vm_class_resolve_field_recursive(const struct vm_class *vmc, uint16_t i)
 {
@@ -893,6 +1226,10 @@ vm_class_resolve_field_recursive(const struct vm_class *vmc, uint16_t i)
 	char *type;
 	struct vm_field *result;
 
+	result = vm_class_get_resolved(vmc, i);
+	if (result)
+		return result;
+
 	if (vm_class_resolve_field(vmc, i, &class, &name, &type)) {
 		NOT_IMPLEMENTED;
 		return NULL;
@@ -902,7 +1239,7 @@ vm_class_resolve_field_recursive(const struct vm_class *vmc, uint16_t i)
 
 	free(name);
 	free(type);
-	return result;
+	return vm_class_set_resolved(vmc, i, result);
 }
 
 static int vm_class_resolve_name_and_type(const struct vm_class *vmc, uint16_t index, char **r_name, char **r_type)
@@ -968,27 +1305,35 @@ int vm_class_resolve_method(const struct vm_class *vmc, uint16_t i,
 	return 0;
 }
 
-struct vm_method *vm_class_get_method(const struct vm_class *vmc,
-	const char *name, const char *type)
+static struct vm_method *__vm_class_get_method(const struct vm_class *vmc,
+	const char *name, const char *type, uint32_t hash)
 {
+	uint32_t i;
+
 	if (vmc->kind != VM_CLASS_KIND_REGULAR)
 		return NULL;
 
-	for (unsigned int i = 0; i < vmc->nr_methods; ++i) {
-		struct vm_method *vmm = &vmc->methods[i];
+	i = vm_member_index_lookup(vmc->method_index, vmc->method_index_mask, hash,
+				   vmc->methods, name, type, get_method_name_type);
+	if (i == VM_MEMBER_SLOT_EMPTY)
+		return NULL;
 
-		if (!strcmp(vmm->name, name) && !strcmp(vmm->type, type))
-			return vmm;
-	}
+	return &vmc->methods[i];
+}
 
-	return NULL;
+struct vm_method *vm_class_get_method(const struct vm_class *vmc,
+	const char *name, const char *type)
+{
+	return __vm_class_get_method(vmc, name, type, vm_member_hash(name, type));
 }
 
 struct vm_method *vm_class_get_method_recursive(const struct vm_class *vmc,
 	const char *name, const char *type)
 {
+	uint32_t hash = vm_member_hash(name, type);
+
 	do {
-		struct vm_method *vmf = vm_class_get_method(vmc, name, type);
+		struct vm_method *vmf = __vm_class_get_method(vmc, name, type, hash);
 		if (vmf)
 			return vmf;
 
@@ -998,6 +1343,31 @@ struct vm_method *vm_class_get_method_recursive(const struct vm_class *vmc,
 	return NULL;
 }
 
+/*
+ * Returns the method that a virtual call to @vmm dispatches to for an object
+ * of class @vmc. This is the slow path equivalent of a vtable lookup and is
+ * used by code that needs the target method rather than its entry point.
+ */
+struct vm_method *vm_class_get_virtual_method(const struct vm_class *vmc,
+	const struct vm_method *vmm)
+{
+	if (vm_class_is_interface(vmm->class))
+		return vm_class_get_method_recursive(vmc, vmm->name, vmm->type);
+
+	do {
+		for (unsigned int i = 0; i < vmc->nr_methods; ++i) {
+			struct vm_method *m = &vmc->methods[i];
+
+			if (m->virtual_index == vmm->virtual_index && !vm_method_is_static(m))
+				return m;
+		}
+
+		vmc = vmc->super;
+	} while (vmc);
+
+	return NULL;
+}
+
 static struct vm_method *vm_class_get_interface_method_recursive(
 	const struct vm_class *vmc, const char *name, const char *type)
 {
@@ -1128,6 +1498,10 @@ vm_class_resolve_method_recursive(const struct vm_class *vmc, uint16_t i, uint16
 	char *name;
 	char *type;
 
+	result = vm_class_get_resolved(vmc, i);
+	if (result)
+		return result;
+
 	if (vm_class_resolve_method(vmc, i, &class, &name, &type)) {
 		NOT_IMPLEMENTED;
 		return NULL;
@@ -1140,7 +1514,7 @@ vm_class_resolve_method_recursive(const struct vm_class *vmc, uint16_t i, uint16
 	free(name);
 	free(type);
 
-	return result;
+	return vm_class_set_resolved(vmc, i, result);
 }
 
 struct vm_method *
@@ -1152,6 +1526,10 @@ vm_class_resolve_interface_method_recursive(const struct vm_class *vmc,
 	char *type;
 	struct vm_method *result;
 
+	result = vm_class_get_resolved(vmc, i);
+	if (result)
+		return result;
+
 	if (vm_class_resolve_interface_method(vmc, i, &class, &name, &type)) {
 		NOT_IMPLEMENTED;
 		return NULL;
@@ -1161,7 +1539,7 @@ vm_class_resolve_interface_method_recursive(const struct vm_class *vmc,
 
 	free(name);
 	free(type);
-	return result;
+	return vm_class_set_resolved(vmc, i, result);
 }
 
 static bool is_numeric(const char *s)
@@ -1214,29 +1592,6 @@ bool vm_class_is_anonymous(const struct vm_class *vmc)
 	return is_numeric(separator + 1);
 }
 
-static void supertype_cache_update(struct vm_class *vmc, const struct vm_class *super)
-{
-	unsigned int ndx = vmc->supertype_cache_ndx++ % SUPERTYPE_CACHE_SIZE;
-
-	vmc->supertype_cache[ndx]       = super;
-}
-
-static bool vm_class_is_subclass_of(const struct vm_class *vmc, const struct vm_class *from)
-{
-	struct vm_class *super = from->super;
-
-	while (super) {
-		if (vmc == super)
-			return true;
-
-		super = super->super;
-	}
-
-	return false;
-}
-
-static bool vm_class_is_assignable_from_nocache(const struct vm_class *vmc, const struct vm_class *from);
-
 static bool vm_class_is_instance_of_array(const struct vm_class *vmc, const struct vm_class *from)
 {
 	if (!vm_class_is_array_class(from))
@@ -1244,49 +1599,45 @@ static bool vm_class_is_instance_of_array(const struct vm_class *vmc, const stru
 
 	struct vm_class *vmc_el = vm_class_get_array_element_class(vmc);
 
-	struct vm_class *from_el = vm_class_get_array_element_class(vmc);
+	struct vm_class *from_el = vm_class_get_array_element_class(from);
 
-	return vm_class_is_assignable_from_nocache(vmc_el, from_el);
-}
+	if (vm_class_is_primitive_class(vmc_el) || vm_class_is_primitive_class(from_el))
+		return vmc_el == from_el;
 
-static bool vm_class_implements(const struct vm_class *vmc, const struct vm_class *from)
-{
-	for (unsigned int i = 0; i < from->nr_interfaces; ++i) {
-		if (vmc == from->interfaces[i] || vm_class_implements(vmc, from->interfaces[i]))
-			return true;
-	}
-
-	if (from->super)
-		return vm_class_implements(vmc, from->super);
-
-	return false;
+	return vm_class_is_assignable_from(vmc_el, from_el);
 }
 
-static bool vm_class_is_assignable_from_nocache(const struct vm_class *vmc, const struct vm_class *from)
+/*
+ * Called when the check against the supertype display of @from is not
+ * enough to tell whether @from is a subtype of @vmc. That's the case for
+ * interfaces, arrays and classes that are deeper in the hierarchy than the
+ * display.
+ *
+ * Reference: http://download.oracle.com/javase/1.5.0/docs/api/java/lang/Class.html#isAssignableFrom(java.lang.Class)
+ */
+bool vm_class_is_assignable_from_slow(struct vm_class *vmc, const struct vm_class *from)
 {
+	struct vm_class *mutable_from = (struct vm_class *) from;
+
 	if (vmc == from)
 		return true;
 
-	if (vm_class_is_interface(vmc))
-		return vm_class_implements(vmc, from);
-
-	if (vm_class_is_array_class(vmc))
-		return vm_class_is_instance_of_array(vmc, from);
-
-	return vm_class_is_subclass_of(vmc, from);
-}
-
-/* Reference: http://download.oracle.com/javase/1.5.0/docs/api/java/lang/Class.html#isAssignableFrom(java.lang.Class) */
-bool vm_class_is_assignable_from_slow(struct vm_class *vmc, const struct vm_class *from)
-{
-	bool ret;
+	if (vm_class_is_array_class(vmc)) {
+		if (!vm_class_is_instance_of_array(vmc, from))
+			return false;
 
-	ret = vm_class_is_assignable_from_nocache(vmc, from);
+		mutable_from->secondary_super_cache = vmc;
+		return true;
+	}
 
-	if (ret)
-		supertype_cache_update(vmc, from);
+	for (unsigned int i = 0; i < from->nr_secondary_supers; ++i) {
+		if (from->secondary_supers[i] == vmc) {
+			mutable_from->secondary_super_cache = vmc;
+			return true;
+		}
+	}
 
-	return ret;
+	return false;
 }
 
 char *vm_class_get_array_element_class_name(const char *class_name)
@@ -5,6 +5,7 @@
 
 #include "jit/exception.h"
 
+#include "vm/class-archive.h"
 #include "vm/reflection.h"
 #include "vm/backtrace.h"
 #include "vm/preload.h"
@@ -16,19 +17,23 @@
 #include "vm/call.h"
 #include "vm/die.h"
 
-#include "lib/hash-map.h"
+#include "arch/memory.h"
+
+#include "lib/concurrent-hash-map.h"
 #include "lib/string.h"
 #include "lib/zip.h"
 
+#include <sys/stat.h>
 #include <assert.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <stdio.h>
+#include <time.h>
 
 bool opt_trace_classloader;
+bool opt_print_classpath_stats;
 
 static pthread_mutex_t classloader_mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t classloader_cond = PTHREAD_COND_INITIALIZER;
 
 static inline void trace_push(struct vm_object *loader, const char *class_name)
 {
@@ -61,11 +66,78 @@ struct classpath {
 
 	const char *path;
 	struct zip *zip;
+
+	/* Statistics for -Xclasspath:stats */
+	unsigned long open_usecs;
+	unsigned long load_usecs;
+	unsigned long nr_classes;
 };
 
 /* These are the directories we search for classes */
 struct list_head classpaths = LIST_HEAD_INIT(classpaths);
 
+static pthread_mutex_t classpath_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t classpath_time_usecs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void classloader_print_classpath_stats(void)
+{
+	unsigned long total_usecs = 0;
+	struct classpath *cp;
+
+	fprintf(stderr, "Classpath statistics:\n");
+
+	list_for_each_entry(cp, &classpaths, node) {
+		fprintf(stderr, "  %8lu us open %8lu us load %6lu classes  %s\n",
+			cp->open_usecs, cp->load_usecs, cp->nr_classes, cp->path);
+
+		total_usecs += cp->open_usecs + cp->load_usecs;
+	}
+
+	fprintf(stderr, "  %8lu us total\n", total_usecs);
+}
+
+/*
+ * Returns a hash of the paths, sizes and modification times of the classpath
+ * entries. The shared class archive is only used with the same classpath as
+ * the one it was written with.
+ */
+uint64_t classloader_classpath_fingerprint(void)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	struct classpath *cp;
+
+	list_for_each_entry(cp, &classpaths, node) {
+		uint64_t values[2] = { 0, 0 };
+		struct stat st;
+
+		if (!stat(cp->path, &st)) {
+			values[0] = st.st_size;
+			values[1] = st.st_mtime;
+		}
+
+		/* FNV-1a */
+		for (const char *p = cp->path; *p; p++) {
+			hash ^= (unsigned char) *p;
+			hash *= 1099511628211ULL;
+		}
+
+		for (unsigned int i = 0; i < ARRAY_SIZE(values); i++) {
+			hash ^= values[i];
+			hash *= 1099511628211ULL;
+		}
+	}
+
+	return hash;
+}
+
 void classloader_destroy(void)
 {
 	struct classpath *cp, *next;
@@ -82,7 +154,7 @@ void classloader_destroy(void)
 
 static int add_dir_to_classpath(const char *dir)
 {
-	struct classpath *cp = malloc(sizeof *cp);
+	struct classpath *cp = calloc(1, sizeof *cp);
 	if (!cp)
 		return -ENOMEM;
 
@@ -99,9 +171,10 @@ static int add_dir_to_classpath(const char *dir)
 
 static int add_zip_to_classpath(const char *zip)
 {
+	uint64_t start;
 	int err;
 
-	struct classpath *cp = malloc(sizeof *cp);
+	struct classpath *cp = calloc(1, sizeof *cp);
 	if (!cp)
 		return -ENOMEM;
 
@@ -112,12 +185,16 @@ static int add_zip_to_classpath(const char *zip)
 		goto error_free_cp;
 	}
 
+	start = classpath_time_usecs();
+
 	cp->zip = zip_open(zip);
 	if (!cp->zip) {
 		err = -1;
 		goto error_free_path;
 	}
 
+	cp->open_usecs = classpath_time_usecs() - start;
+
 	list_add_tail(&cp->node, &classpaths);
 	return 0;
 
@@ -198,15 +275,42 @@ struct classloader_class {
 	enum class_load_status status;
 	struct vm_class *class;
 
+	/* Next entry in the list of entries that can be reused. */
+	struct classloader_class *next_free;
+
 	/* number of threads waiting for a class. */
 	unsigned long nr_waiting;
-	struct vm_thread *loading_thread;
+
+	/*
+	 * Signalled when the class has been loaded or was not found. Only
+	 * the threads that wait for this class are woken up so classes with
+	 * different names are loaded in parallel.
+	 */
+	pthread_cond_t cond;
+
+	/*
+	 * The execution environment of the thread that loads the class. This
+	 * is not the vm_thread because the threads that preload classes don't
+	 * have one.
+	 */
+	struct vm_exec_env *loading_env;
 	struct vm_object *classloader;
 
 	struct classes_key key;
 };
 
-static struct hash_map *classes;
+/*
+ * The table of classes is looked up without classloader_mutex when the class
+ * has already been loaded. Entries are modified with classloader_mutex held.
+ * An entry is marked loaded after its class has been set and stays that way
+ * so once a lookup sees CLASS_LOADED, the entry doesn't change any more.
+ *
+ * Entries of classes that were not found are removed from the table but a
+ * lookup might still be reading them so they are not freed. Instead they are
+ * put on a list and reused for the next class that is loaded.
+ */
+static struct concurrent_hash_map *classes;
+static struct classloader_class *free_classes;
 
 static unsigned long classes_key_hash(const void *key)
 {
@@ -233,7 +337,7 @@ static struct key_operations classes_key_ops = {
 
 void classloader_init(void)
 {
-	classes = alloc_hash_map(&classes_key_ops);
+	classes = alloc_concurrent_hash_map(&classes_key_ops);
 	if (!classes)
 		error("failed to initialize class loader");
 }
@@ -241,18 +345,60 @@ void classloader_init(void)
 static struct classloader_class *
 lookup_class(struct vm_object *loader, struct string *class_name)
 {
-	void *class;
 	struct classes_key key;
 
 	key.class_name  = class_name;
 	key.classloader = loader;
 
-	if (hash_map_get(classes, &key, &class))
+	return concurrent_hash_map_get(classes, &key);
+}
+
+/*
+ * Returns the class if it has been loaded. This doesn't take any locks and
+ * doesn't wait for a class that is being loaded.
+ */
+static struct vm_class *
+lookup_loaded_class(struct vm_object *loader, struct string *class_name)
+{
+	struct classloader_class *class;
+
+	class = lookup_class(loader, class_name);
+	if (!class || class->status != CLASS_LOADED)
 		return NULL;
 
+	barrier();
+
+	/* The entry might have been reused for another class. */
+	if (class->key.class_name != class_name || class->key.classloader != loader)
+		return NULL;
+
+	return class->class;
+}
+
+static struct classloader_class *alloc_classloader_class(void)
+{
+	struct classloader_class *class = free_classes;
+
+	if (!class) {
+		class = vm_zalloc(sizeof(*class));
+		if (class)
+			pthread_cond_init(&class->cond, NULL);
+
+		return class;
+	}
+
+	free_classes = class->next_free;
+	class->next_free = NULL;
+
 	return class;
 }
 
+static void free_classloader_class(struct classloader_class *class)
+{
+	class->next_free = free_classes;
+	free_classes = class;
+}
+
 static void remove_class(struct vm_object *loader, struct string *class_name)
 {
 	struct classes_key key;
@@ -260,7 +406,7 @@ static void remove_class(struct vm_object *loader, struct string *class_name)
 	key.class_name  = class_name;
 	key.classloader = loader;
 
-	hash_map_remove(classes, &key);
+	concurrent_hash_map_remove(classes, &key);
 }
 
 static char *class_name_to_file_name(const char *class_name)
@@ -273,21 +419,33 @@ static char *class_name_to_file_name(const char *class_name)
 	return filename;
 }
 
-static struct vm_class *load_class_from_file(const char *filename)
+/*
+ * Reads and parses a class file. The class is linked by the caller so that
+ * -Xclasspath:stats doesn't charge the superclass and interfaces that linking
+ * loads to this class.
+ */
+static struct cafebabe_class *read_class_from_file(const char *filename)
 {
 	struct cafebabe_stream stream;
 	struct cafebabe_class *class;
-	struct vm_class *result = NULL;
 
 	if (cafebabe_stream_open(&stream, filename))
-		goto out;
+		return NULL;
 
 	class = malloc(sizeof *class);
-	if (!class)
-		goto error_close_stream;
+	if (class && cafebabe_class_init(class, &stream)) {
+		free(class);
+		class = NULL;
+	}
 
-	if (cafebabe_class_init(class, &stream))
-		goto error_free_class;
+	cafebabe_stream_close(&stream);
+
+	return class;
+}
+
+static struct vm_class *link_class(struct cafebabe_class *class)
+{
+	struct vm_class *result;
 
 	result = vm_zalloc(sizeof *result);
 	if (!result)
@@ -296,21 +454,35 @@ static struct vm_class *load_class_from_file(const char *filename)
 	if (vm_class_link(result, class))
 		goto error_free_class;
 
-	cafebabe_stream_close(&stream);
-
 	return result;
 
 error_free_class:
 	free(class);
-error_close_stream:
-	cafebabe_stream_close(&stream);
-out:
 	return NULL;
 }
 
-static struct vm_class *load_class_from_dir(const char *dir, const char *class_name)
+static struct vm_class *load_class_from_archive(struct string *class_name)
 {
-	struct vm_class *vmc;
+	struct cafebabe_class *class;
+	struct vm_class *result;
+
+	class = class_archive_find(class_name->value);
+	if (!class)
+		return NULL;
+
+	result = vm_zalloc(sizeof *result);
+	if (!result)
+		return NULL;
+
+	if (vm_class_link(result, class))
+		return NULL;
+
+	return result;
+}
+
+static struct cafebabe_class *read_class_from_dir(const char *dir, const char *class_name)
+{
+	struct cafebabe_class *class;
 	char *full_filename;
 	char *filename;
 
@@ -318,65 +490,57 @@ static struct vm_class *load_class_from_dir(const char *dir, const char *class_n
 	if (!filename)
 		return NULL;
 
-	if (asprintf(&full_filename, "%s/%s", dir, filename) == -1)
+	if (asprintf(&full_filename, "%s/%s", dir, filename) == -1) {
+		free(filename);
 		return NULL;
+	}
 
 	free(filename);
 
-	vmc = load_class_from_file(full_filename);
+	class = read_class_from_file(full_filename);
 	free(full_filename);
-	return vmc;
+	return class;
 }
 
-static struct vm_class *load_class_from_zip(struct zip *zip, struct string *class_name)
+static struct cafebabe_class *read_class_from_zip(struct zip *zip, struct string *class_name)
 {
 	struct cafebabe_stream stream;
 	struct cafebabe_class *class;
-	struct vm_class *result = NULL;
 	struct zip_entry *zip_entry;
-	void *zip_file_buf;
+	const void *zip_file_buf;
 
 	zip_entry = zip_entry_find_class(zip, class_name);
 	if (!zip_entry)
 		return NULL;
 
-	zip_file_buf = zip_entry_data(zip, zip_entry);
+	zip_file_buf = zip_entry_map(zip, zip_entry);
 	if (!zip_file_buf)
 		return NULL;
 
-	cafebabe_stream_open_buffer(&stream, zip_file_buf, zip_entry->uncomp_size);
+	/* The buffer is only read from even though the type says otherwise. */
+	cafebabe_stream_open_buffer(&stream, (uint8_t *) zip_file_buf, zip_entry->uncomp_size);
 
 	class = malloc(sizeof *class);
-	if (cafebabe_class_init(class, &stream))
-		goto error_free_buf;
-
-	cafebabe_stream_close_buffer(&stream);
-
-	result = vm_zalloc(sizeof *result);
-	if (result) {
-		if (vm_class_link(result, class))
-			goto error_free_class;
+	if (class && cafebabe_class_init(class, &stream)) {
+		free(class);
+		class = NULL;
 	}
 
-	free(zip_file_buf);
-	return result;
+	cafebabe_stream_close_buffer(&stream);
 
-error_free_class:
-	free(class);
-error_free_buf:
-	free(zip_file_buf);
+	zip_entry_unmap(zip, zip_file_buf);
 
-	return NULL;
+	return class;
 }
 
-static struct vm_class *
-load_class_from_classpath_file(const struct classpath *cp, struct string *class_name)
+static struct cafebabe_class *
+read_class_from_classpath_file(const struct classpath *cp, struct string *class_name)
 {
 	switch (cp->type) {
 	case CLASSPATH_DIR:
-		return load_class_from_dir(cp->path, class_name->value);
+		return read_class_from_dir(cp->path, class_name->value);
 	case CLASSPATH_ZIP:
-		return load_class_from_zip(cp->zip, class_name);
+		return read_class_from_zip(cp->zip, class_name);
 	default:
 		/* Should never reach this. */
 		return NULL;
@@ -514,15 +678,45 @@ load_class_with(struct vm_object *loader, const char *name)
  */
 static struct vm_class *load_class(struct string *class_name)
 {
-	struct vm_class *result = NULL;
+	struct vm_class *result;
 	struct classpath *cp;
 
+	result = load_class_from_archive(class_name);
+	if (result)
+		goto out;
+
 	list_for_each_entry(cp, &classpaths, node) {
-		result = load_class_from_classpath_file(cp, class_name);
+		struct cafebabe_class *class;
+		uint64_t start = 0;
+
+		if (opt_print_classpath_stats)
+			start = classpath_time_usecs();
+
+		class = read_class_from_classpath_file(cp, class_name);
+
+		if (opt_print_classpath_stats) {
+			pthread_mutex_lock(&classpath_stats_mutex);
+			cp->load_usecs += classpath_time_usecs() - start;
+			if (class)
+				cp->nr_classes++;
+			pthread_mutex_unlock(&classpath_stats_mutex);
+		}
+
+		if (!class)
+			continue;
+
+		result = link_class(class);
 		if (result)
 			break;
 	}
 
+	/*
+	 * Classes in directories can change without the fingerprint of the
+	 * classpath changing so they are not archived.
+	 */
+	if (result && class_archive_mode == CLASS_ARCHIVE_DUMP && cp->type == CLASSPATH_ZIP)
+		class_archive_add(result);
+ out:
 	if (result)
 		result->classloader = NULL;
 
@@ -543,7 +737,7 @@ find_class(struct vm_object *loader, struct string *class_name)
 		 * loaders which might query the VM before loading.
 		 */
 		if (class->status == CLASS_LOADING &&
-		    class->loading_thread == vm_thread_self())
+		    class->loading_env == vm_get_exec_env())
 			return NULL;
 
 		/*
@@ -553,12 +747,12 @@ find_class(struct vm_object *loader, struct string *class_name)
 
 		++class->nr_waiting;
 		while (class->status == CLASS_LOADING)
-			pthread_cond_wait(&classloader_cond, &classloader_mutex);
+			pthread_cond_wait(&class->cond, &classloader_mutex);
 		--class->nr_waiting;
 
 		if (class->status == CLASS_NOT_FOUND && !class->nr_waiting) {
 			remove_class(loader, class_name);
-			vm_free(class);
+			free_classloader_class(class);
 			class = NULL;
 		}
 	}
@@ -641,6 +835,10 @@ classloader_load(struct vm_object *loader, const char *klass_name)
 		loader = elem_class->classloader;
 	}
 
+	vmc = lookup_loaded_class(loader, class_name);
+	if (vmc)
+		goto out;
+
 	pthread_mutex_lock(&classloader_mutex);
 
 	class = find_class(loader, class_name);
@@ -651,15 +849,19 @@ classloader_load(struct vm_object *loader, const char *klass_name)
 		goto out_unlock;
 	}
 
-	class = vm_zalloc(sizeof(*class));
+	class = alloc_classloader_class();
+	if (!class)
+		goto out_unlock;
+
 	class->status = CLASS_LOADING;
+	class->class = NULL;
 	class->nr_waiting = 0;
-	class->loading_thread = vm_thread_self();
+	class->loading_env = vm_get_exec_env();
 	class->key.classloader = loader;
 	class->key.class_name = class_name;
 
-	if (hash_map_put(classes, &class->key, class)) {
-		vmc = NULL;
+	if (concurrent_hash_map_put(classes, &class->key, class)) {
+		free_classloader_class(class);
 		goto out_unlock;
 	}
 
@@ -685,16 +887,19 @@ classloader_load(struct vm_object *loader, const char *klass_name)
 		 */
 		if (class->nr_waiting == 0) {
 			remove_class(loader, class_name);
-			vm_free(class);
+			free_classloader_class(class);
 		} else {
 			class->status = CLASS_NOT_FOUND;
+			pthread_cond_broadcast(&class->cond);
 		}
 	} else {
 		class->class = vmc;
+		barrier();
 		class->status = CLASS_LOADED;
-	}
 
-	pthread_cond_broadcast(&classloader_cond);
+		if (class->nr_waiting)
+			pthread_cond_broadcast(&class->cond);
+	}
 
  out_unlock:
 	pthread_mutex_unlock(&classloader_mutex);
@@ -723,14 +928,18 @@ classloader_find_class(struct vm_object *loader, const char *name)
 
 	class_name = string_intern_cstr(slash_class_name);
 
+	free(slash_class_name);
+
+	vmc = lookup_loaded_class(loader, class_name);
+	if (vmc)
+		return vmc;
+
 	pthread_mutex_lock(&classloader_mutex);
 
 	class = find_class(loader, class_name);
 	if (class && class->status == CLASS_LOADED)
 		vmc = class->class;
 
-	free(slash_class_name);
-
 	pthread_mutex_unlock(&classloader_mutex);
 	return vmc;
 }
@@ -746,13 +955,13 @@ int classloader_add_to_cache(struct vm_object *loader, struct vm_class *vmc)
 	class->class = vmc;
 	class->status = CLASS_LOADED;
 	class->nr_waiting = 0;
-	class->loading_thread = vm_thread_self();
+	class->loading_env = vm_get_exec_env();
 	class->key.classloader = loader;
 	class->key.class_name = string_intern_cstr(vmc->name);
 
 	pthread_mutex_lock(&classloader_mutex);
 
-	if (hash_map_put(classes, &class->key, class)) {
+	if (concurrent_hash_map_put(classes, &class->key, class)) {
 		pthread_mutex_unlock(&classloader_mutex);
 		vm_free(class);
 		return -ENOMEM;
@@ -0,0 +1,751 @@
+/*
+ * Heap of the exact garbage collector
+ *
+ * This file is released under the 2-clause BSD license. Please refer to the
+ * file LICENSE for details.
+ *
+ * The heap is a contiguous range of address space that is reserved when the
+ * VM starts and divided into blocks of GC_BLOCK_SIZE bytes. Every block has a
+ * descriptor that tells what the block is used for:
+ *
+ *   - A small block is carved into objects of one size class. Free objects
+ *     are kept on a free list that is linked through their first word.
+ *
+ *   - A large object occupies a run of blocks. The descriptor of the first
+ *     block has the length of the run and the descriptors of the other
+ *     blocks have the distance to the first one.
+ *
+ * Objects start at a granule boundary so the mark and allocation bits are
+ * kept in bitmaps with one bit per granule. The allocation bits make it
+ * possible to find the object that an arbitrary address points into which is
+ * what the collector needs to validate conservative roots.
+ *
+ * Memory is always handed out zeroed. Freed objects are cleared by the sweep
+ * and blocks that become completely free are given back to the kernel with
+ * madvise() which also clears them.
+ *
+ * The heap is generational but objects are never moved because roots are
+ * found conservatively. Instead, mark bits are sticky: an object that has
+ * survived a collection keeps its mark bit set and is old from then on.
+ * Blocks that objects have been allocated from since the last collection
+ * form the nursery and a minor collection sweeps only those. The size of
+ * the nursery is bounded so that minor collections run often and have
+ * little to do.
+ *
+ * Old objects are not traced by a minor collection so references from old
+ * objects to young ones are found through the card table. The heap is
+ * divided into cards of GC_CARD_SIZE bytes and the write barrier dirties the
+ * card of every slot a reference is stored to. A minor collection traces
+ * the old objects on dirty cards and clears the cards. A full collection
+ * clears all mark bits and cards first and traces the whole heap.
+ *
+ * The collector marks with several threads so setting a mark bit is atomic.
+ * Everything else is only done by one thread at a time.
+ */
+
+#include "vm/gc-heap.h"
+
+#include "lib/bitset.h"
+
+#include "arch/cmpxchg.h"
+
+#include "vm/system.h"
+#include "vm/die.h"
+
+#include <sys/mman.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+enum gc_block_state {
+	GC_BLOCK_FREE,
+	GC_BLOCK_SMALL,
+	GC_BLOCK_LARGE,
+	GC_BLOCK_LARGE_TAIL,
+};
+
+struct gc_block {
+	uint8_t			state;
+	uint8_t			size_class;
+
+	/* Objects have been allocated from the block since the last collection */
+	uint8_t			young;
+	uint32_t		object_size;
+	uint32_t		nr_objects;
+	uint32_t		nr_free;
+
+	/*
+	 * The length of the run for GC_BLOCK_LARGE and the distance to the
+	 * first block of the run for GC_BLOCK_LARGE_TAIL.
+	 */
+	uint32_t		nr_blocks;
+
+	void			*free_list;
+
+	/* Next block with free objects in the same size class */
+	struct gc_block		*next;
+};
+
+/* A full collection is never done before the heap has grown to this size. */
+#define GC_MIN_HEAP_SIZE	(4UL * 1024 * 1024)
+
+static const unsigned int size_class_sizes[] = {
+	  16,   32,   48,   64,   80,   96,  112,  128,
+	 144,  160,  176,  192,  208,  224,  240,  256,
+	 320,  384,  448,  512,  640,  768,  896, 1024,
+	1280, 1536, 1792, 2048, 2560, 3072, 3584, 4096,
+	5120, 6144, 7168, 8192,
+};
+
+#define GC_NR_SIZE_CLASSES	ARRAY_SIZE(size_class_sizes)
+
+static uint8_t size_classes[GC_MAX_SMALL_SIZE / GC_GRANULE];
+
+static struct gc_block *partial_blocks[GC_NR_SIZE_CLASSES];
+
+static unsigned long heap_start;
+static struct gc_block *blocks;
+static unsigned long nr_blocks;
+
+/* Blocks at and above this index have never been used. */
+static unsigned long heap_top;
+
+/* No block below this index is free. */
+static unsigned long free_hint;
+
+static unsigned long nr_used_blocks;
+static unsigned long gc_threshold;
+
+static unsigned long nr_young_blocks;
+static unsigned long nursery_blocks;
+
+static unsigned long *mark_bits;
+static unsigned long *alloc_bits;
+
+static uint8_t *card_table;
+
+unsigned long gc_card_table_bias;
+unsigned long gc_heap_base;
+unsigned long gc_heap_reserved;
+
+static void *map_zeroed(unsigned long size)
+{
+	void *p;
+
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (p == MAP_FAILED)
+		return NULL;
+
+	return p;
+}
+
+static inline unsigned long block_addr(unsigned long idx)
+{
+	return heap_start + (idx << GC_BLOCK_SHIFT);
+}
+
+static inline unsigned long block_index(unsigned long addr)
+{
+	return (addr - heap_start) >> GC_BLOCK_SHIFT;
+}
+
+static inline unsigned long granule_index(void *obj)
+{
+	return ((unsigned long) obj - heap_start) / GC_GRANULE;
+}
+
+static unsigned int size_class(size_t size)
+{
+	return size_classes[(size - 1) / GC_GRANULE];
+}
+
+static unsigned long full_threshold(unsigned long nr_live_blocks)
+{
+	unsigned long threshold;
+
+	threshold = max(GC_MIN_HEAP_SIZE >> GC_BLOCK_SHIFT, 2 * nr_live_blocks);
+
+	return min(threshold + nursery_blocks, nr_blocks);
+}
+
+int gc_heap_init(unsigned long max_size, unsigned long nursery_size)
+{
+	unsigned long size, nr_granules, bitmap_size;
+	unsigned int i, j, start;
+	void *p;
+
+	size = ALIGN(max_size, GC_BLOCK_SIZE);
+	if (size < GC_BLOCK_SIZE)
+		size = GC_BLOCK_SIZE;
+
+	/* Reserve an extra block so that the heap can be aligned. */
+	p = map_zeroed(size + GC_BLOCK_SIZE);
+	if (!p)
+		return -1;
+
+	heap_start	= ALIGN((unsigned long) p, GC_BLOCK_SIZE);
+	nr_blocks	= size >> GC_BLOCK_SHIFT;
+
+	blocks = map_zeroed(nr_blocks * sizeof(struct gc_block));
+	if (!blocks)
+		return -1;
+
+	nr_granules	= size / GC_GRANULE;
+	bitmap_size	= DIV_ROUND_UP(nr_granules, BITS_PER_LONG) * sizeof(unsigned long);
+
+	mark_bits = map_zeroed(bitmap_size);
+	alloc_bits = map_zeroed(bitmap_size);
+	if (!mark_bits || !alloc_bits)
+		return -1;
+
+	card_table = map_zeroed(size >> GC_CARD_SHIFT);
+	if (!card_table)
+		return -1;
+
+	gc_card_table_bias	= (unsigned long) card_table - (heap_start >> GC_CARD_SHIFT);
+	gc_heap_base		= heap_start;
+	gc_heap_reserved	= size;
+
+	for (i = 0, start = 0; i < GC_NR_SIZE_CLASSES; i++) {
+		for (j = start; j < size_class_sizes[i] / GC_GRANULE; j++)
+			size_classes[j] = i;
+
+		start = j;
+	}
+
+	nursery_blocks = min(nursery_size >> GC_BLOCK_SHIFT, nr_blocks / 2);
+	if (!nursery_blocks)
+		nursery_blocks = 1;
+
+	gc_threshold = full_threshold(0);
+
+	return 0;
+}
+
+/*
+ * Returns the index of the first run of @count free blocks or -1 if there
+ * is none.
+ */
+static long find_free_blocks(unsigned long count)
+{
+	unsigned long i, j;
+
+	i = free_hint;
+
+	while (i + count <= nr_blocks) {
+		if (blocks[i].state != GC_BLOCK_FREE) {
+			i++;
+			continue;
+		}
+
+		for (j = i; j < i + count; j++) {
+			if (blocks[j].state != GC_BLOCK_FREE)
+				break;
+		}
+
+		if (j == i + count)
+			return i;
+
+		i = j;
+	}
+
+	return -1;
+}
+
+/*
+ * Allocates a run of @count blocks. The heap grows past the collection
+ * threshold only if @grow is true.
+ */
+static long alloc_blocks(unsigned long count, bool grow)
+{
+	long idx;
+
+	if (!grow && nr_used_blocks + count > gc_threshold)
+		return -1;
+
+	idx = find_free_blocks(count);
+	if (idx < 0)
+		return -1;
+
+	if ((unsigned long) idx == free_hint)
+		free_hint = idx + count;
+
+	nr_used_blocks += count;
+
+	if (idx + count > heap_top)
+		heap_top = idx + count;
+
+	return idx;
+}
+
+static void free_blocks(unsigned long idx, unsigned long count)
+{
+	unsigned long i;
+
+	/* The kernel hands out zeroed pages when the blocks are touched again. */
+	madvise((void *) block_addr(idx), count << GC_BLOCK_SHIFT, MADV_DONTNEED);
+
+	for (i = idx; i < idx + count; i++)
+		memset(&blocks[i], 0, sizeof(struct gc_block));
+
+	nr_used_blocks -= count;
+
+	if (idx < free_hint)
+		free_hint = idx;
+}
+
+/*
+ * Builds the free list of a small block from objects whose allocation bit is
+ * clear. The list is built backwards so that objects are handed out in
+ * address order.
+ */
+static void build_free_list(struct gc_block *b, unsigned long addr)
+{
+	unsigned long i;
+
+	b->free_list	= NULL;
+	b->nr_free	= 0;
+
+	for (i = b->nr_objects; i-- > 0; ) {
+		void **obj = (void **) (addr + i * b->object_size);
+
+		if (test_bit(alloc_bits, granule_index(obj)))
+			continue;
+
+		*obj = b->free_list;
+		b->free_list = obj;
+		b->nr_free++;
+	}
+}
+
+/*
+ * Adds the block of @b to the nursery. Fails if the nursery is full and
+ * @grow is false. Large objects are accounted with all of their blocks.
+ */
+static bool nursery_add(struct gc_block *b, unsigned long count, bool grow)
+{
+	if (b->young)
+		return true;
+
+	if (!grow && nr_young_blocks + count > nursery_blocks)
+		return false;
+
+	b->young = true;
+	nr_young_blocks += count;
+
+	return true;
+}
+
+static struct gc_block *new_small_block(unsigned int class, bool grow)
+{
+	struct gc_block *b;
+	long idx;
+
+	idx = alloc_blocks(1, grow);
+	if (idx < 0)
+		return NULL;
+
+	b = &blocks[idx];
+	b->state	= GC_BLOCK_SMALL;
+	b->size_class	= class;
+	b->object_size	= size_class_sizes[class];
+	b->nr_objects	= GC_BLOCK_SIZE / b->object_size;
+
+	build_free_list(b, block_addr(idx));
+
+	b->next = partial_blocks[class];
+	partial_blocks[class] = b;
+
+	return b;
+}
+
+static struct gc_block *get_partial_block(size_t size, bool grow)
+{
+	unsigned int class = size_class(size);
+
+	if (partial_blocks[class])
+		return partial_blocks[class];
+
+	return new_small_block(class, grow);
+}
+
+static void *alloc_large(size_t size, bool grow)
+{
+	unsigned long count, i;
+	long idx;
+
+	count = DIV_ROUND_UP(size, GC_BLOCK_SIZE);
+
+	if (!grow && nr_young_blocks + count > nursery_blocks)
+		return NULL;
+
+	idx = alloc_blocks(count, grow);
+	if (idx < 0)
+		return NULL;
+
+	nursery_add(&blocks[idx], count, true);
+
+	blocks[idx].state	= GC_BLOCK_LARGE;
+	blocks[idx].nr_blocks	= count;
+
+	for (i = 1; i < count; i++) {
+		blocks[idx + i].state		= GC_BLOCK_LARGE_TAIL;
+		blocks[idx + i].nr_blocks	= i;
+	}
+
+	set_bit(alloc_bits, granule_index((void *) block_addr(idx)));
+
+	return (void *) block_addr(idx);
+}
+
+/*
+ * Allocates a zeroed object of @size bytes. Returns NULL if the heap is
+ * exhausted or if a new block is needed and @grow is false. A block that is
+ * not in the nursery counts as new.
+ */
+void *gc_heap_alloc(size_t size, bool grow)
+{
+	struct gc_block *b;
+	void **obj;
+
+	if (size == 0)
+		size = 1;
+
+	if (size > GC_MAX_SMALL_SIZE)
+		return alloc_large(size, grow);
+
+	b = get_partial_block(size, grow);
+	if (!b || !nursery_add(b, 1, grow))
+		return NULL;
+
+	obj = b->free_list;
+	b->free_list = *obj;
+	*obj = NULL;
+
+	if (--b->nr_free == 0)
+		partial_blocks[b->size_class] = b->next;
+
+	set_bit(alloc_bits, granule_index(obj));
+
+	return obj;
+}
+
+/*
+ * Allocates all free objects of a block of the size class of @size at once.
+ * The objects are linked through their first word like free lists are and
+ * are otherwise zeroed.
+ */
+void *gc_heap_alloc_many(size_t size, bool grow)
+{
+	struct gc_block *b;
+	void **obj, *list;
+
+	assert(size > 0 && size <= GC_MAX_SMALL_SIZE);
+
+	b = get_partial_block(size, grow);
+	if (!b || !nursery_add(b, 1, grow))
+		return NULL;
+
+	list = b->free_list;
+
+	for (obj = list; obj != NULL; obj = *obj)
+		set_bit(alloc_bits, granule_index(obj));
+
+	b->free_list	= NULL;
+	b->nr_free	= 0;
+
+	partial_blocks[b->size_class] = b->next;
+
+	return list;
+}
+
+/*
+ * Returns the start of the allocated object that @addr points into or NULL if
+ * @addr does not point into an object.
+ */
+void *gc_heap_find_object(unsigned long addr)
+{
+	unsigned long idx, offset, obj;
+	struct gc_block *b;
+
+	if (addr < heap_start || addr >= block_addr(heap_top))
+		return NULL;
+
+	idx = block_index(addr);
+	b = &blocks[idx];
+
+	switch (b->state) {
+	case GC_BLOCK_SMALL:
+		offset = addr - block_addr(idx);
+		if (offset / b->object_size >= b->nr_objects)
+			return NULL;
+
+		obj = block_addr(idx) + offset / b->object_size * b->object_size;
+		break;
+	case GC_BLOCK_LARGE_TAIL:
+		obj = block_addr(idx - b->nr_blocks);
+		break;
+	case GC_BLOCK_LARGE:
+		obj = block_addr(idx);
+		break;
+	case GC_BLOCK_FREE:
+	default:
+		return NULL;
+	}
+
+	if (!test_bit(alloc_bits, granule_index((void *) obj)))
+		return NULL;
+
+	return (void *) obj;
+}
+
+size_t gc_heap_object_size(void *obj)
+{
+	struct gc_block *b = &blocks[block_index((unsigned long) obj)];
+
+	if (b->state == GC_BLOCK_SMALL)
+		return b->object_size;
+
+	return (size_t) b->nr_blocks << GC_BLOCK_SHIFT;
+}
+
+/*
+ * Sets the mark bit of @obj. Returns true if this call set it, which means
+ * that exactly one of the threads that mark an object at the same time gets
+ * to trace it.
+ */
+bool gc_heap_mark(void *obj)
+{
+	unsigned long idx = granule_index(obj);
+	unsigned long *word = &mark_bits[idx / BITS_PER_LONG];
+	unsigned long mask = bit_mask(idx);
+	unsigned long old;
+
+	do {
+		old = *word;
+		if (old & mask)
+			return false;
+	} while (cmpxchg_ptr(word, (void *) old, (void *) (old | mask)) != (void *) old);
+
+	return true;
+}
+
+bool gc_heap_is_marked(void *obj)
+{
+	return test_bit(mark_bits, granule_index(obj));
+}
+
+static void sweep_small_block(unsigned long idx, struct gc_heap_stats *stats)
+{
+	struct gc_block *b = &blocks[idx];
+	unsigned long addr = block_addr(idx);
+	unsigned long i, nr_live = 0;
+
+	for (i = 0; i < b->nr_objects; i++) {
+		void *obj = (void *) (addr + i * b->object_size);
+		unsigned long g = granule_index(obj);
+
+		if (!test_bit(alloc_bits, g))
+			continue;
+
+		if (test_bit(mark_bits, g)) {
+			nr_live++;
+			continue;
+		}
+
+		memset(obj, 0, b->object_size);
+		clear_bit(alloc_bits, g);
+
+		stats->nr_freed_objects++;
+		stats->freed_bytes += b->object_size;
+	}
+
+	stats->nr_live_objects += nr_live;
+	stats->live_bytes += nr_live * b->object_size;
+
+	b->young = false;
+
+	if (!nr_live) {
+		free_blocks(idx, 1);
+		return;
+	}
+
+	build_free_list(b, addr);
+
+	if (b->nr_free) {
+		b->next = partial_blocks[b->size_class];
+		partial_blocks[b->size_class] = b;
+	}
+}
+
+static void sweep_large_object(unsigned long idx, struct gc_heap_stats *stats)
+{
+	unsigned long count = blocks[idx].nr_blocks;
+	unsigned long g = granule_index((void *) block_addr(idx));
+
+	if (test_bit(mark_bits, g)) {
+		blocks[idx].young = false;
+		stats->nr_live_objects++;
+		stats->live_bytes += count << GC_BLOCK_SHIFT;
+		return;
+	}
+
+	clear_bit(alloc_bits, g);
+	free_blocks(idx, count);
+
+	stats->nr_freed_objects++;
+	stats->freed_bytes += count << GC_BLOCK_SHIFT;
+}
+
+/*
+ * Clears all mark bits and cards before a full collection.
+ */
+void gc_heap_clear_marks(void)
+{
+	unsigned long nr_granules = (heap_top << GC_BLOCK_SHIFT) / GC_GRANULE;
+
+	memset(mark_bits, 0, DIV_ROUND_UP(nr_granules, BITS_PER_LONG) * sizeof(unsigned long));
+	memset(card_table, 0, heap_top << (GC_BLOCK_SHIFT - GC_CARD_SHIFT));
+}
+
+static void scan_small_card(unsigned long idx, unsigned long start, unsigned long end,
+			    gc_card_scan_fn scan)
+{
+	struct gc_block *b = &blocks[idx];
+	unsigned long addr = block_addr(idx);
+	unsigned long i, last;
+
+	i = (start - addr) / b->object_size;
+	last = (end - 1 - addr) / b->object_size;
+
+	if (last >= b->nr_objects)
+		last = b->nr_objects - 1;
+
+	for (; i <= last; i++) {
+		unsigned long obj = addr + i * b->object_size;
+
+		/* Only allocated objects are ever marked. */
+		if (!test_bit(mark_bits, granule_index((void *) obj)))
+			continue;
+
+		scan((void *) obj, max(start, obj), min(end, obj + b->object_size));
+	}
+}
+
+static void scan_card(unsigned long card, gc_card_scan_fn scan)
+{
+	unsigned long start = heap_start + (card << GC_CARD_SHIFT);
+	unsigned long idx = block_index(start);
+	struct gc_block *b = &blocks[idx];
+
+	switch (b->state) {
+	case GC_BLOCK_SMALL:
+		scan_small_card(idx, start, start + GC_CARD_SIZE, scan);
+		break;
+	case GC_BLOCK_LARGE_TAIL:
+		idx -= b->nr_blocks;
+		/* fall through */
+	case GC_BLOCK_LARGE:
+		if (test_bit(mark_bits, granule_index((void *) block_addr(idx))))
+			scan((void *) block_addr(idx), start, start + GC_CARD_SIZE);
+		break;
+	case GC_BLOCK_FREE:
+	default:
+		break;
+	}
+}
+
+/*
+ * Calls @scan for every marked object on a dirty card with the part of the
+ * object that is on the card and clears the cards. This is done at the
+ * start of a minor collection when only old objects are marked.
+ */
+void gc_heap_scan_cards(gc_card_scan_fn scan)
+{
+	unsigned long card, nr_cards;
+
+	nr_cards = heap_top << (GC_BLOCK_SHIFT - GC_CARD_SHIFT);
+
+	for (card = 0; card < nr_cards; card++) {
+		/* Most cards are clean so skip them a word at a time. */
+		if (card % sizeof(unsigned long) == 0 &&
+		    card + sizeof(unsigned long) <= nr_cards &&
+		    *(unsigned long *) &card_table[card] == 0) {
+			card += sizeof(unsigned long) - 1;
+			continue;
+		}
+
+		if (card_table[card] != GC_CARD_DIRTY)
+			continue;
+
+		card_table[card] = 0;
+
+		scan_card(card, scan);
+	}
+}
+
+/*
+ * Returns true if the next collection must be a full one because the old
+ * objects and a full nursery would not fit under the collection threshold.
+ */
+bool gc_heap_needs_full(void)
+{
+	return nr_used_blocks - nr_young_blocks + nursery_blocks > gc_threshold;
+}
+
+/*
+ * Frees all allocated objects that are not marked. A minor collection
+ * sweeps only the nursery because everything else is old and marked. Mark
+ * bits are left set so that the survivors are old at the next collection.
+ * After a full collection, the next one is due when the heap has grown to
+ * twice the size of the blocks that are still in use plus the nursery.
+ */
+void gc_heap_sweep(struct gc_heap_stats *stats, bool full)
+{
+	unsigned long idx;
+
+	memset(stats, 0, sizeof(*stats));
+	memset(partial_blocks, 0, sizeof(partial_blocks));
+
+	/* Blocks are visited backwards so that partial lists are in address order. */
+	for (idx = heap_top; idx-- > 0; ) {
+		struct gc_block *b = &blocks[idx];
+
+		switch (b->state) {
+		case GC_BLOCK_SMALL:
+			if (full || b->young) {
+				sweep_small_block(idx, stats);
+			} else if (b->nr_free) {
+				b->next = partial_blocks[b->size_class];
+				partial_blocks[b->size_class] = b;
+			}
+			break;
+		case GC_BLOCK_LARGE:
+			if (full || b->young)
+				sweep_large_object(idx, stats);
+			break;
+		case GC_BLOCK_LARGE_TAIL:
+		case GC_BLOCK_FREE:
+		default:
+			break;
+		}
+	}
+
+	while (heap_top > 0 && blocks[heap_top - 1].state == GC_BLOCK_FREE)
+		heap_top--;
+
+	nr_young_blocks = 0;
+
+	if (full)
+		gc_threshold = full_threshold(nr_used_blocks);
+}
+
+/*
+ * Returns the number of bytes in blocks that are in use.
+ */
+unsigned long gc_heap_size(void)
+{
+	return nr_used_blocks << GC_BLOCK_SHIFT;
+}
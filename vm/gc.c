@@ -9,18 +9,58 @@
  * The stop-the-world algorith is based on the following paper:
  *
  *   "GC Points in a Threaded Environment", Agesen.
+ *
+ * The collector is a non-moving mark-sweep collector. The heap is managed by
+ * vm/gc-heap.c and objects are traced with the reference field offsets of
+ * their class so only roots are ever treated conservatively:
+ *
+ *   - Frames of JIT compiled methods that are stopped at a safepoint are
+ *     scanned with the GC maps that are generated during code emission (see
+ *     jit/gc-map.c). Only the locals area of such frames is exact. Outgoing
+ *     arguments and saved registers are still scanned conservatively.
+ *
+ *   - Frames of VM code, registers, static data and regions that are
+ *     allocated with vm_alloc() are scanned conservatively. Every candidate
+ *     is validated against the allocation bitmap of the heap.
+ *
+ * Collections are generational without moving objects (see vm/gc-heap.c). A
+ * minor collection traces only objects that have been allocated since the
+ * last collection, starting from the roots and from old objects on cards
+ * that the write barrier has dirtied. A full collection is done when the old
+ * objects fill the heap up to the collection threshold and when one is
+ * requested with Runtime.gc().
+ *
+ * Marking is done in parallel by the GC thread and a pool of helper threads.
+ * Every marking thread has a work-stealing deque of grey objects (see
+ * lib/work-deque.c). The GC thread scans the roots and the dirty cards and
+ * the helpers steal the objects it finds. A thread that runs out of work
+ * steals from the others until every thread is out of work. Sweeping is
+ * done by the GC thread alone.
+ *
+ * Threads that are stopped in JIT code outside of a safepoint are restarted
+ * until they hit a safepoint poll. A thread that does not get to a poll in
+ * time, for example because it blocks in VM code, is stopped where it is and
+ * its top frame is scanned conservatively.
  */
 
 #include "arch/registers.h"
 #include "arch/memory.h"
+#include "arch/atomic.h"
 
 #include "sys/signal.h"
 
 #include "jit/compilation-unit.h"
 #include "jit/cu-mapping.h"
+#include "jit/gc-map.h"
+#include "jit/text.h"
 
 #include "lib/guard-page.h"
+#include "lib/work-deque.h"
+#include "lib/hash-map.h"
+#include "lib/bitset.h"
+#include "lib/buffer.h"
 #include "lib/string.h"
+#include "lib/list.h"
 
 #include "vm/stdlib.h"
 #include "vm/thread.h"
@@ -29,12 +69,20 @@
 #include "vm/trace.h"
 #include "vm/die.h"
 #include "vm/gc.h"
+#include "vm/gc-heap.h"
+
+#include <sys/mman.h>
 
 #include <inttypes.h>
+#include <limits.h>
 #include <pthread.h>
+#include <unistd.h>
+#include <sched.h>
 #include <stdbool.h>
 #include <assert.h>
+#include <errno.h>
 #include <stdio.h>
+#include <time.h>
 
 void *gc_safepoint_page;
 
@@ -50,7 +98,24 @@ static int nr_threads;
 
 static pthread_t gc_thread_id;
 
+/* Set while the GC thread is stopping the world */
+static volatile sig_atomic_t gc_stopping;
+
+/* Set when threads must stop where they are instead of at a safepoint */
+static volatile sig_atomic_t gc_force_stop;
+
+/* How long restarted threads get to reach a safepoint poll */
+#define GC_SAFEPOINT_TIMEOUT_MS	10
+
+/* Default maximum number of marking threads */
+#define GC_MAX_DEFAULT_THREADS	8
+
+/* Number of grey objects a marking thread can hand out for stealing */
+#define GC_DEQUE_SIZE		4096
+
 unsigned long max_heap_size	= 128 * 1024 * 1024;	/* 128 MB */
+unsigned long nursery_size	= 8 * 1024 * 1024;	/* 8 MB */
+unsigned int gc_nr_threads;				/* 0 is one per CPU */
 
 bool				newgc_enabled;
 bool				verbose_gc;
@@ -58,6 +123,88 @@ int				dont_gc;
 
 struct gc_operations		gc_ops;
 
+/*
+ * Protects the heap, the list of vm_alloc() regions and the finalizer table.
+ * The GC thread holds it for the whole collection.
+ */
+static pthread_mutex_t		gc_heap_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Header of regions that are allocated with vm_alloc() */
+struct gc_root_region {
+	struct list_head	node;
+	size_t			size;
+} __attribute__((aligned(16)));
+
+static struct list_head		gc_root_regions = LIST_HEAD_INIT(gc_root_regions);
+
+/* Set when the next collection must be a full one. Protected by gc_heap_mutex. */
+static bool			gc_full_requested;
+
+struct gc_finalizer {
+	struct vm_object	*object;
+	finalizer_fn		finalizer;
+	bool			pending;
+	struct gc_finalizer	*next;
+};
+
+/* Finalizers of objects that are still reachable, keyed by object */
+static struct hash_map		*gc_finalizers;
+
+/* Finalizers of unreachable objects that have not been run yet */
+static struct gc_finalizer	*gc_pending_finalizers;
+static bool			gc_finalizers_running;
+
+/*
+ * A marking thread. Grey objects that don't fit in the deque go to the
+ * overflow stack which is not visible to other threads. The overflow stack
+ * is mapped with mmap() because the collector must not call malloc() while
+ * the world is stopped.
+ */
+struct gc_worker {
+	unsigned int		id;
+	pthread_t		thread;
+	struct work_deque	*deque;
+	void			**overflow;
+	unsigned long		overflow_size;
+	unsigned long		overflow_top;
+	unsigned long		seed;
+};
+
+static struct gc_worker		*gc_workers;
+static unsigned int		gc_nr_workers;
+
+/* The marking thread that the current thread is, if any */
+static __thread struct gc_worker *gc_self;
+
+/* Number of marking threads that may still produce grey objects */
+static atomic_t			gc_nr_active;
+
+/*
+ * Helpers are started by bumping the generation and tell the GC thread that
+ * they are done with the finished count.
+ */
+static pthread_mutex_t		gc_workers_mutex	= PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t		gc_workers_cond		= PTHREAD_COND_INITIALIZER;
+static pthread_cond_t		gc_workers_done_cond	= PTHREAD_COND_INITIALIZER;
+static unsigned long		gc_workers_generation;
+static unsigned int		gc_nr_finished_workers;
+
+/* Set for the roots phase of a full collection */
+static bool			gc_full_collection;
+
+struct gc_phase_times {
+	uint64_t		stop;
+	uint64_t		mark;
+	uint64_t		finalize;
+	uint64_t		resume;
+	uint64_t		sweep;
+};
+
+extern char __executable_start[];
+extern char etext[];
+extern char __data_start[];
+extern char _end[];
+
 static void hide_safepoint_guard_page(void)
 {
 	hide_guard_page(gc_safepoint_page);
@@ -68,6 +215,18 @@ static void unhide_safepoint_guard_page(void)
 	unhide_guard_page(gc_safepoint_page);
 }
 
+static void gc_heap_lock(void)
+{
+	if (pthread_mutex_lock(&gc_heap_mutex) != 0)
+		die("pthread_mutex_lock");
+}
+
+static void gc_heap_unlock(void)
+{
+	if (pthread_mutex_unlock(&gc_heap_mutex) != 0)
+		die("pthread_mutex_unlock");
+}
+
 static void suspend_self(void)
 {
 	sigset_t mask;
@@ -86,6 +245,42 @@ static void suspend_self(void)
 		die("wrong signal");
 }
 
+/*
+ * Same as suspend_self() but gives up after @msecs milliseconds. Returns
+ * false on timeout.
+ */
+static bool suspend_self_timeout(long msecs)
+{
+	struct timespec timeout;
+	sigset_t mask;
+	int sig;
+
+	if (sigemptyset(&mask) != 0)
+		die("sigemptyset");
+
+	if (sigaddset(&mask, SIGUSR2) != 0)
+		die("sigaddset");
+
+	timeout.tv_sec	= msecs / 1000;
+	timeout.tv_nsec	= (msecs % 1000) * 1000000;
+
+	do {
+		sig = sigtimedwait(&mask, NULL, &timeout);
+	} while (sig < 0 && errno == EINTR);
+
+	if (sig < 0) {
+		if (errno == EAGAIN)
+			return false;
+
+		die("sigtimedwait");
+	}
+
+	if (sig != SIGUSR2)
+		die("wrong signal");
+
+	return true;
+}
+
 static void suspend_thread(pthread_t thread_id)
 {
 	if (pthread_kill(thread_id, SIGUSR1) != 0)
@@ -98,13 +293,20 @@ static void resume_thread(pthread_t thread_id)
 		die("pthread_kill");
 }
 
+/*
+ * Threads that have just been created might not have an execution
+ * environment yet. They can't hold references so they are only counted.
+ */
 static bool do_exit_safepoint(void)
 {
+	struct vm_exec_env *ee = vm_get_exec_env();
 	bool ret = false;
 
-	assert(vm_get_exec_env()->in_safepoint);
+	if (ee) {
+		assert(ee->in_safepoint);
 
-	vm_get_exec_env()->in_safepoint = false;
+		ee->in_safepoint = false;
+	}
 
 	if (pthread_spin_lock(&gc_spinlock) != 0)
 		die("pthread_spin_lock");
@@ -128,9 +330,13 @@ static void exit_safepoint(void)
 
 static void enter_safepoint(void)
 {
-	assert(!vm_get_exec_env()->in_safepoint);
+	struct vm_exec_env *ee = vm_get_exec_env();
+
+	if (ee) {
+		assert(!ee->in_safepoint);
 
-	vm_get_exec_env()->in_safepoint = true;
+		ee->in_safepoint = true;
+	}
 
 	if (pthread_spin_lock(&gc_spinlock) != 0)
 		die("pthread_spin_lock");
@@ -144,38 +350,703 @@ static void enter_safepoint(void)
 		die("pthread_spin_unlock");
 }
 
-static void do_gc_reclaim(void)
+static void overflow_grow(struct gc_worker *w)
 {
-	if (verbose_gc)
-		fprintf(stderr, "[GC]\n");
+	unsigned long new_size;
+	void **new_stack;
+
+	new_size = w->overflow_size ? w->overflow_size * 2 : 4096;
 
-	/* TODO: Do main GC work here. */
+	new_stack = mmap(NULL, new_size * sizeof(void *), PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (new_stack == MAP_FAILED)
+		die("out of memory for GC mark stack");
+
+	if (w->overflow) {
+		memcpy(new_stack, w->overflow, w->overflow_top * sizeof(void *));
+		munmap(w->overflow, w->overflow_size * sizeof(void *));
+	}
+
+	w->overflow		= new_stack;
+	w->overflow_size	= new_size;
 }
 
-static void gc_scan_rootset(struct register_state *regs)
+static void gc_push(struct gc_worker *w, void *obj)
+{
+	if (work_deque_push(w->deque, obj))
+		return;
+
+	if (w->overflow_top == w->overflow_size)
+		overflow_grow(w);
+
+	w->overflow[w->overflow_top++] = obj;
+}
+
+/*
+ * Returns the next grey object of @w. Objects are moved from the overflow
+ * stack to the deque when it runs empty so that other threads can steal them.
+ */
+static void *gc_pop(struct gc_worker *w)
+{
+	void *obj;
+
+	obj = work_deque_pop(w->deque);
+	if (obj)
+		return obj;
+
+	while (w->overflow_top > 0) {
+		if (!work_deque_push(w->deque, w->overflow[w->overflow_top - 1]))
+			break;
+
+		w->overflow_top--;
+	}
+
+	return work_deque_pop(w->deque);
+}
+
+static void gc_mark_object(void *obj)
+{
+	if (!gc_heap_mark(obj))
+		return;
+
+	gc_push(gc_self, obj);
+}
+
+/*
+ * Marks the object that @word points into if there is one.
+ */
+static void gc_mark_word(unsigned long word)
+{
+	void *obj;
+
+	obj = gc_heap_find_object(word);
+	if (obj)
+		gc_mark_object(obj);
+}
+
+static void gc_scan_range(void *start, void *end)
+{
+	unsigned long *p;
+
+	p = (unsigned long *) ALIGN((unsigned long) start, sizeof(unsigned long));
+
+	for (; (void *) (p + 1) <= end; p++)
+		gc_mark_word(*p);
+}
+
+/*
+ * Traces the elements of @array that are in [@lo, @hi).
+ */
+static void gc_trace_array(struct vm_object *array, unsigned long lo, unsigned long hi)
+{
+	struct vm_class *elem_class = array->class->array_element_class;
+	unsigned long nr_elems, max_elems;
+	struct vm_object **elems, **p, **end;
+
+	if (elem_class && vm_class_is_primitive_class(elem_class))
+		return;
+
+	elems = vm_array_elems(array);
+	nr_elems = vm_array_length(array);
+
+	max_elems = (gc_heap_object_size(array) - VM_ARRAY_ELEMS_OFFSET) / sizeof(*elems);
+	if (nr_elems > max_elems)
+		nr_elems = max_elems;
+
+	p = elems;
+	end = elems + nr_elems;
+
+	if (lo > (unsigned long) p)
+		p = (struct vm_object **) ALIGN(lo, sizeof(*p));
+
+	if (hi < (unsigned long) end)
+		end = (struct vm_object **) hi;
+
+	for (; p < end; p++)
+		gc_mark_word((unsigned long) *p);
+}
+
+static void gc_trace_object(struct vm_object *obj)
+{
+	struct vm_class *vmc = obj->class;
+	uint8_t *fields;
+	unsigned int i;
+
+	/*
+	 * Objects that are still being set up and free lists of thread-local
+	 * allocation buffers don't have a class yet.
+	 */
+	if (!vmc) {
+		gc_scan_range(obj, (void *) obj + gc_heap_object_size(obj));
+		return;
+	}
+
+	if (vm_class_is_array_class(vmc)) {
+		gc_trace_array(obj, 0, ULONG_MAX);
+		return;
+	}
+
+	fields = vm_object_fields(obj);
+
+	for (i = 0; i < vmc->nr_ref_offsets; i++)
+		gc_mark_word(*(unsigned long *) (fields + vmc->ref_offsets[i]));
+}
+
+static void *gc_steal(struct gc_worker *w)
+{
+	unsigned int i, victim;
+	void *obj;
+
+	/* xorshift */
+	w->seed ^= w->seed << 13;
+	w->seed ^= w->seed >> 7;
+	w->seed ^= w->seed << 17;
+
+	victim = w->seed % gc_nr_workers;
+
+	for (i = 0; i < gc_nr_workers; i++, victim++) {
+		if (victim == gc_nr_workers)
+			victim = 0;
+
+		if (victim == w->id)
+			continue;
+
+		obj = work_deque_steal(gc_workers[victim].deque);
+		if (obj)
+			return obj;
+	}
+
+	return NULL;
+}
+
+static bool gc_work_available(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < gc_nr_workers; i++) {
+		if (!work_deque_is_empty(gc_workers[i].deque))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Traces grey objects until every marking thread is out of work. A thread
+ * only goes idle when its deque and overflow stack are empty and idle
+ * threads don't produce work so marking is done when all of them are idle.
+ */
+static void gc_trace_until_done(struct gc_worker *w)
+{
+	void *obj;
+
+	for (;;) {
+		while ((obj = gc_pop(w)) != NULL)
+			gc_trace_object(obj);
+
+		obj = gc_steal(w);
+		if (obj) {
+			gc_trace_object(obj);
+			continue;
+		}
+
+		atomic_dec(&gc_nr_active);
+
+		for (;;) {
+			if (atomic_read(&gc_nr_active) == 0)
+				return;
+
+			if (gc_work_available()) {
+				atomic_inc(&gc_nr_active);
+				break;
+			}
+
+			sched_yield();
+		}
+	}
+}
+
+/*
+ * Runs a marking phase. The GC thread marks the objects that @roots finds
+ * while the helpers steal them and then everybody traces until the marking
+ * is done.
+ */
+static void gc_run_parallel(void (*roots)(void))
+{
+	atomic_set(&gc_nr_active, gc_nr_workers);
+
+	if (gc_nr_workers > 1) {
+		pthread_mutex_lock(&gc_workers_mutex);
+		gc_nr_finished_workers = 0;
+		gc_workers_generation++;
+		pthread_cond_broadcast(&gc_workers_cond);
+		pthread_mutex_unlock(&gc_workers_mutex);
+	}
+
+	roots();
+
+	gc_trace_until_done(gc_self);
+
+	if (gc_nr_workers > 1) {
+		pthread_mutex_lock(&gc_workers_mutex);
+		while (gc_nr_finished_workers != gc_nr_workers - 1)
+			pthread_cond_wait(&gc_workers_done_cond, &gc_workers_mutex);
+		pthread_mutex_unlock(&gc_workers_mutex);
+	}
+}
+
+static void *gc_worker_thread(void *arg)
+{
+	struct gc_worker *w = arg;
+	unsigned long generation = 0;
+
+	gc_self = w;
+
+	for (;;) {
+		pthread_mutex_lock(&gc_workers_mutex);
+		while (gc_workers_generation == generation)
+			pthread_cond_wait(&gc_workers_cond, &gc_workers_mutex);
+		generation = gc_workers_generation;
+		pthread_mutex_unlock(&gc_workers_mutex);
+
+		gc_trace_until_done(w);
+
+		pthread_mutex_lock(&gc_workers_mutex);
+		if (++gc_nr_finished_workers == gc_nr_workers - 1)
+			pthread_cond_signal(&gc_workers_done_cond);
+		pthread_mutex_unlock(&gc_workers_mutex);
+	}
+
+	return NULL;
+}
+
+/*
+ * The first word of an object on a free list of a thread-local allocation
+ * buffer links the list instead of pointing to the class of the object. The
+ * links are tagged with this bit for the duration of a collection.
+ */
+#define TLAB_FREE_TAG		1UL
+
+/*
+ * Marks the objects on the free lists of thread-local allocation buffers.
+ * Only the heads of the lists are reachable from the roots and the objects
+ * must not be traced because they don't have a class, so all of them are
+ * marked without being pushed before anything else is scanned. Tracing then
+ * never gets to them because they are already marked and the links are
+ * tagged so that gc_scan_card() skips free objects on dirty cards.
+ */
+static void gc_mark_tlabs(void)
+{
+	struct vm_thread *thread;
+	unsigned int i;
+
+	vm_thread_for_each(thread) {
+		struct vm_exec_env *ee = thread->ee;
+
+		if (!ee)
+			continue;
+
+		for (i = 0; i < TLAB_NR_SIZE_CLASSES; i++) {
+			void **obj, **next;
+
+			for (obj = ee->tlab.free_list[i]; obj != NULL; obj = next) {
+				next = *obj;
+
+				gc_heap_mark(obj);
+				*obj = (void *) ((unsigned long) next | TLAB_FREE_TAG);
+			}
+		}
+	}
+}
+
+/*
+ * Traces the references of old object @obj that are on a dirty card. Only
+ * arrays are traced by card because a large array can span many cards.
+ */
+static void gc_scan_card(void *obj, unsigned long start, unsigned long end)
+{
+	struct vm_object *object = obj;
+
+	/* Free objects of thread-local allocation buffers, see gc_mark_tlabs() */
+	if ((unsigned long) object->class & TLAB_FREE_TAG)
+		return;
+
+	if (object->class && vm_class_is_array_class(object->class)) {
+		gc_trace_array(object, start, end);
+		return;
+	}
+
+	gc_trace_object(object);
+}
+
+/*
+ * Objects on the free lists of thread-local allocation buffers are marked
+ * by gc_mark_tlabs() and become old. They are initialized without the write
+ * barrier after they have been handed out, so their cards are dirtied to
+ * get them traced by the next minor collection. The tags that
+ * gc_mark_tlabs() put on the links are removed here.
+ */
+static void gc_dirty_tlab_cards(void)
+{
+	struct vm_thread *thread;
+	unsigned int i;
+
+	vm_thread_for_each(thread) {
+		struct vm_exec_env *ee = thread->ee;
+
+		if (!ee)
+			continue;
+
+		for (i = 0; i < TLAB_NR_SIZE_CLASSES; i++) {
+			void **obj;
+
+			for (obj = ee->tlab.free_list[i]; obj != NULL; obj = *obj) {
+				*obj = (void *) ((unsigned long) *obj & ~TLAB_FREE_TAG);
+				gc_write_barrier(obj);
+			}
+		}
+	}
+}
+
+static bool is_vm_text(unsigned long addr)
+{
+	return addr >= (unsigned long) __executable_start && addr < (unsigned long) etext;
+}
+
+/*
+ * Returns the compilation unit whose method code contains @ip or NULL if @ip
+ * is not in method code. Trampolines are mapped to the compilation unit too
+ * so the address has to be checked against the code buffer.
+ */
+static struct compilation_unit *gc_lookup_cu(unsigned long ip)
 {
 	struct compilation_unit *cu;
+	unsigned long start;
+
+	if (!is_jit_text((void *) ip))
+		return NULL;
+
+	cu = __jit_lookup_cu(ip);
+	if (!cu || !cu->objcode)
+		return NULL;
+
+	start = (unsigned long) buffer_ptr(cu->objcode);
+	if (ip < start || ip >= start + buffer_offset(cu->objcode))
+		return NULL;
+
+	return cu;
+}
 
-	cu = jit_lookup_cu(regs->ip);
-	if (!cu) {
-		warn("safepoint at unknown IP %" PRIx64, regs->ip);
+static struct gc_map *gc_lookup_map(unsigned long ip, enum gc_map_type type,
+				    struct compilation_unit **cu_p)
+{
+	struct compilation_unit *cu;
+
+	cu = gc_lookup_cu(ip);
+	if (!cu)
+		return NULL;
+
+	*cu_p = cu;
+
+	return gc_map_lookup(cu, ip - (unsigned long) buffer_ptr(cu->objcode), type);
+}
+
+/*
+ * Scans the frame at @bp which extends down to @lo with GC map @map.
+ */
+static void gc_scan_exact_frame(struct compilation_unit *cu, struct gc_map *map,
+				unsigned long bp, unsigned long lo)
+{
+	unsigned long nr_slots = cu->gc_maps->nr_slots;
+	unsigned long locals = bp - nr_slots * sizeof(unsigned long);
+	unsigned long slot;
+
+	if (lo < locals)
+		gc_scan_range((void *) lo, (void *) locals);
+
+	for (slot = 0; slot < nr_slots; slot++) {
+		if (test_bit(map->slot_map, slot))
+			gc_mark_word(*(unsigned long *) (bp - gc_map_slot_offset(slot)));
+	}
+}
+
+/*
+ * Scans the native stack of a stopped thread. Frames are walked through the
+ * frame pointer chain starting from a frame that is known to be valid: the
+ * frame of the JIT method the thread is stopped in or the frame of
+ * gc_start() if the thread is waiting for a collection. Frames of JIT
+ * methods that have a GC map for their return address are scanned exactly.
+ * When the chain leaves JIT and VM code, for example in a JNI library, the
+ * rest of the stack is scanned conservatively.
+ */
+static void gc_scan_stack(struct vm_exec_env *ee, struct register_state *regs)
+{
+	struct compilation_unit *cu = NULL;
+	unsigned long lo, bp, end;
+	struct gc_map *map;
+
+	end = (unsigned long) ee->stack_end;
+	lo = regs->sp;
+
+	map = gc_lookup_map(regs->ip, GC_MAP_POLL, &cu);
+	if (map) {
+		bp = regs->bp;
+	} else if (gc_lookup_cu(regs->ip)) {
+		/* JIT code always keeps a frame pointer. */
+		bp = regs->bp;
+	} else if (ee->gc_frame) {
+		bp = (unsigned long) ee->gc_frame;
+	} else {
+		gc_scan_range((void *) lo, (void *) end);
+		return;
+	}
+
+	for (;;) {
+		unsigned long *frame = (unsigned long *) bp;
+		unsigned long ret;
+
+		if (bp < lo || bp + 2 * sizeof(unsigned long) > end || bp % sizeof(unsigned long))
+			break;
+
+		if (map)
+			gc_scan_exact_frame(cu, map, bp, lo);
+		else
+			gc_scan_range((void *) lo, (void *) bp);
+
+		/* Skip the saved frame pointer and the return address. */
+		lo = bp + 2 * sizeof(unsigned long);
+
+		ret = frame[1];
+
+		if (frame[0] <= bp)
+			break;
+
+		map = gc_lookup_map(ret, GC_MAP_CALL, &cu);
+		if (!map && !is_jit_text((void *) ret) && !is_vm_text(ret))
+			break;
+
+		bp = frame[0];
+	}
+
+	gc_scan_range((void *) lo, (void *) end);
+}
+
+static void gc_scan_thread(struct vm_thread *thread)
+{
+	struct vm_exec_env *ee = thread->ee;
+	struct register_state *regs;
+	unsigned int i;
+
+	if (!ee || !ee->gc_regs)
+		return;
+
+	regs = ee->gc_regs;
+
+	/*
+	 * Registers are always scanned conservatively because arguments of
+	 * calls are passed in fixed registers that are not in the GC maps.
+	 */
+	for (i = 0; i < NR_GP_REGISTERS; i++)
+		gc_mark_word(register_state_get(regs, i));
+
+	gc_mark_word(regs->bp);
+
+	/* Nothing can be printed here because the world is stopped. */
+	if (!ee->stack_end)
+		return;
+
+	gc_scan_stack(ee, regs);
+}
+
+static void gc_mark_roots(void)
+{
+	struct gc_root_region *region;
+	struct gc_finalizer *f;
+	struct vm_thread *thread;
+
+	gc_scan_range(__data_start, _end);
+
+	list_for_each_entry(region, &gc_root_regions, node)
+		gc_scan_range(region + 1, (void *) (region + 1) + region->size);
+
+	for (f = gc_pending_finalizers; f != NULL; f = f->next)
+		gc_mark_object(f->object);
+
+	vm_thread_for_each(thread)
+		gc_scan_thread(thread);
+}
+
+/*
+ * Old objects on dirty cards are traced before the roots so that the
+ * objects that are marked by this collection are not scanned twice.
+ */
+static void gc_mark_cards_and_roots(void)
+{
+	gc_mark_tlabs();
+
+	if (!gc_full_collection)
+		gc_heap_scan_cards(gc_scan_card);
+
+	gc_mark_roots();
+}
+
+static void gc_mark_pending_finalizers(void)
+{
+	struct hash_map_entry *entry;
+
+	hash_map_for_each_entry(entry, gc_finalizers) {
+		struct gc_finalizer *f = entry->value;
+
+		if (f->pending)
+			gc_mark_object(f->object);
+	}
+}
+
+/*
+ * Objects with finalizers that are no longer reachable are kept alive until
+ * their finalizers have been run. Finalizers are run in no particular order
+ * so everything that is reachable from such objects is kept alive too.
+ */
+static void gc_mark_finalizable(void)
+{
+	struct hash_map_entry *entry;
+
+	hash_map_for_each_entry(entry, gc_finalizers) {
+		struct gc_finalizer *f = entry->value;
+
+		if (gc_heap_is_marked(f->object))
+			continue;
+
+		f->pending = true;
+	}
+
+	gc_run_parallel(gc_mark_pending_finalizers);
+}
+
+/*
+ * Moves finalizers that were found pending to the pending list. This
+ * allocates memory so it must be done after the world has been restarted.
+ */
+static void gc_queue_finalizers(void)
+{
+	struct gc_finalizer *queue = NULL, *f;
+	struct hash_map_entry *entry;
+
+	hash_map_for_each_entry(entry, gc_finalizers) {
+		f = entry->value;
+
+		if (f->pending) {
+			f->next = queue;
+			queue = f;
+		}
+	}
+
+	while (queue) {
+		f = queue;
+		queue = f->next;
+
+		hash_map_remove(gc_finalizers, f->object);
+
+		f->pending	= false;
+		f->next		= gc_pending_finalizers;
+		gc_pending_finalizers = f;
+	}
+}
+
+/*
+ * Runs finalizers of objects that have been found unreachable. This is done
+ * by threads that have been waiting for a collection and never by more than
+ * one thread at a time.
+ */
+static void gc_run_finalizers(void)
+{
+	gc_heap_lock();
+
+	if (gc_finalizers_running) {
+		gc_heap_unlock();
 		return;
 	}
 
-	if (verbose_gc)
-		fprintf(stderr, "[GC at %s.%s]\n", cu->method->class->name, cu->method->name);
+	gc_finalizers_running = true;
+
+	for (;;) {
+		struct vm_object *object;
+		finalizer_fn finalizer;
+		struct gc_finalizer *f;
+
+		f = gc_pending_finalizers;
+		if (!f)
+			break;
+
+		gc_pending_finalizers = f->next;
+
+		gc_heap_unlock();
+
+		object = f->object;
+		finalizer = f->finalizer;
+		free(f);
+
+		finalizer(object);
+
+		gc_heap_lock();
+	}
+
+	gc_finalizers_running = false;
+
+	gc_heap_unlock();
+}
+
+static uint64_t gc_time_usecs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void do_gc_reclaim(bool full, struct gc_phase_times *times)
+{
+	uint64_t start = gc_time_usecs(), end;
+
+	if (full)
+		gc_heap_clear_marks();
+
+	gc_full_collection = full;
+	gc_run_parallel(gc_mark_cards_and_roots);
+
+	end = gc_time_usecs();
+	times->mark = end - start;
+	start = end;
+
+	gc_mark_finalizable();
+	gc_dirty_tlab_cards();
+
+	times->finalize = gc_time_usecs() - start;
+}
+
+static void gc_scan_rootset(struct register_state *regs)
+{
+	struct vm_exec_env *ee = vm_get_exec_env();
 
-	/* TODO: get live references from this thread. */
+	/* Thread stacks are scanned by the GC thread while the world is stopped. */
+	if (ee)
+		ee->gc_regs = regs;
 }
 
 void gc_safepoint(struct register_state *regs)
 {
+	struct vm_exec_env *ee = vm_get_exec_env();
+
 	gc_scan_rootset(regs);
 
 	enter_safepoint();
 
 	suspend_self();
 
+	if (ee)
+		ee->gc_regs = NULL;
+
 	exit_safepoint();
 }
 
@@ -183,7 +1054,11 @@ void suspend_handler(int sig, siginfo_t *si, void *ctx)
 {
 	struct vm_thread *self = vm_thread_self();
 
-	if (signal_from_native(ctx)) {
+	/* The signal arrived after the thread had already stopped. */
+	if (!gc_stopping)
+		return;
+
+	if (signal_from_native(ctx) || gc_force_stop) {
 		struct register_state thread_register_state;
 		ucontext_t *uc = ctx;
 
@@ -191,12 +1066,12 @@ void suspend_handler(int sig, siginfo_t *si, void *ctx)
 		 * Fresh threads might return NULL from vm_thread_self().
 		 */
 		if (self)
-			vm_thread_set_state(self, VM_THREAD_STATE_CONSISTENT);
+			self->thread_state = VM_THREAD_STATE_CONSISTENT;
 
 		save_signal_registers(&thread_register_state, &uc->uc_mcontext);
 		gc_safepoint(&thread_register_state);
 	} else {
-		vm_thread_set_state(self, VM_THREAD_STATE_CONSISTENT);
+		self->thread_state = VM_THREAD_STATE_INCONSISTENT;
 
 		enter_safepoint();
 
@@ -240,6 +1115,28 @@ static void gc_resume_rest(void)
 		die("pthread_spin_unlock");
 }
 
+/*
+ * Stops restarted threads that did not reach a safepoint in time where they
+ * are. The signal is blocked while a thread is entering a safepoint through
+ * the guard page so a thread never enters twice.
+ */
+static void gc_force_stop_rest(void)
+{
+	struct vm_thread *thread;
+
+	gc_force_stop = true;
+
+	vm_thread_for_each(thread) {
+		if (thread->thread_state != VM_THREAD_STATE_INCONSISTENT)
+			continue;
+
+		if (thread->ee && thread->ee->in_safepoint)
+			continue;
+
+		suspend_thread(thread->posix_id);
+	}
+}
+
 static void gc_suspend_rest(void)
 {
 	unsigned long nr_restarted = 0;
@@ -254,6 +1151,8 @@ static void gc_suspend_rest(void)
 	if (pthread_spin_unlock(&gc_spinlock) != 0)
 		die("pthread_spin_unlock");
 
+	gc_stopping = true;
+
 	vm_thread_for_each(thread) {
 		assert(thread->posix_id != pthread_self());
 
@@ -272,15 +1171,17 @@ static void gc_suspend_rest(void)
 	vm_thread_for_each(thread) {
 		assert(thread->posix_id != pthread_self());
 
-		if (vm_thread_get_state(thread) == VM_THREAD_STATE_INCONSISTENT) {
+		if (thread->thread_state == VM_THREAD_STATE_INCONSISTENT) {
 			resume_thread(thread->posix_id);
 			nr_restarted++;
 		}
 	}
 
 	/* Wait for restarted threads to enter a safepoint.  */
-	if (nr_restarted)
+	if (nr_restarted && !suspend_self_timeout(GC_SAFEPOINT_TIMEOUT_MS)) {
+		gc_force_stop_rest();
 		suspend_self();
+	}
 
 	if (pthread_spin_lock(&gc_spinlock) != 0)
 		die("pthread_spin_lock");
@@ -291,10 +1192,19 @@ static void gc_suspend_rest(void)
 		die("pthread_spin_unlock");
 
 	unhide_safepoint_guard_page();
+
+	gc_force_stop = false;
+	gc_stopping = false;
 }
 
 static void do_gc(void)
 {
+	struct gc_phase_times times;
+	struct gc_heap_stats stats;
+	uint64_t start, now, pause;
+	bool collected = false;
+	bool full = false;
+
 	vm_lock_thread_count();
 
 	if (pthread_spin_lock(&gc_spinlock) != 0)
@@ -312,9 +1222,43 @@ static void do_gc(void)
 	if (pthread_spin_unlock(&gc_spinlock) != 0)
 		die("pthread_spin_unlock");
 
+	gc_heap_lock();
+
+	full = gc_full_requested || gc_heap_needs_full();
+	gc_full_requested = false;
+
+	/*
+	 * Take the lock of the compilation unit mapping before the world is
+	 * stopped so that no thread is stopped while it is updating it.
+	 */
+	cu_mapping_read_lock();
+
+	start = gc_time_usecs();
+
 	gc_suspend_rest();
-	do_gc_reclaim();
+
+	now = gc_time_usecs();
+	times.stop = now - start;
+
+	do_gc_reclaim(full, &times);
+
+	now = gc_time_usecs();
 	gc_resume_rest();
+	times.resume = gc_time_usecs() - now;
+
+	pause = gc_time_usecs() - start;
+
+	cu_mapping_read_unlock();
+
+	gc_queue_finalizers();
+
+	now = gc_time_usecs();
+	gc_heap_sweep(&stats, full);
+	times.sweep = gc_time_usecs() - now;
+
+	gc_heap_unlock();
+
+	collected = true;
 out:
 	if (pthread_spin_lock(&gc_spinlock) != 0)
 		die("pthread_spin_lock");
@@ -326,6 +1270,17 @@ out:
 
 	vm_unlock_thread_count();
 
+	if (collected && verbose_gc) {
+		fprintf(stderr, "[GC %s %lu KB live, %lu KB freed, heap %lu KB, pause %" PRIu64 " us: "
+			"stop %" PRIu64 " us, mark %" PRIu64 " us, finalize %" PRIu64 " us, "
+			"resume %" PRIu64 " us; sweep %" PRIu64 " us; %u threads]\n",
+			full ? "full" : "minor",
+			stats.live_bytes / 1024, stats.freed_bytes / 1024,
+			gc_heap_size() / 1024, pause,
+			times.stop, times.mark, times.finalize, times.resume,
+			times.sweep, gc_nr_workers);
+	}
+
 	if (pthread_mutex_lock(&gc_reclaim_mutex) != 0)
 		die("pthread_mutex_lock");
 
@@ -341,6 +1296,8 @@ static void *gc_thread(void *arg)
 	struct sigaction sa;
 	sigset_t sigset;
 
+	gc_self = arg;
+
 	sigemptyset(&sa.sa_mask);
 	sa.sa_flags	= SA_RESTART | SA_SIGINFO;
 
@@ -370,6 +1327,15 @@ static void *gc_thread(void *arg)
  */
 static void gc_start(void)
 {
+	struct vm_exec_env *ee = vm_get_exec_env();
+
+	/*
+	 * The stack of this thread is walked from here while it waits for
+	 * the collection.
+	 */
+	if (ee)
+		ee->gc_frame = __builtin_frame_address(0);
+
 	if (pthread_mutex_lock(&gc_reclaim_mutex) != 0)
 		die("pthread_mutex_lock");
 
@@ -394,25 +1360,76 @@ wait_for_reclaim:
 
 	if (pthread_mutex_unlock(&gc_reclaim_mutex) != 0)
 		die("pthread_mutex_unlock");
+
+	if (ee)
+		ee->gc_frame = NULL;
 }
 
-static void *do_gc_alloc(size_t size)
+static void do_gc_collect(void)
 {
-	void *p;
-
 	gc_start();
+	gc_run_finalizers();
+}
+
+static void do_gc_collect_full(void)
+{
+	gc_heap_lock();
+	gc_full_requested = true;
+	gc_heap_unlock();
+
+	do_gc_collect();
+}
+
+/*
+ * Allocates from the heap and collects garbage first if the heap has grown
+ * past the collection threshold.
+ */
+static void *gc_alloc_collect(void *(*alloc)(size_t, bool), size_t size)
+{
+	void *p;
 
-	p	= malloc(size);
+	gc_heap_lock();
+	p = alloc(size, dont_gc);
+	gc_heap_unlock();
 
 	if (p)
-		memset(p, 0, size);
+		return p;
+
+	if (!dont_gc)
+		do_gc_collect();
+
+	gc_heap_lock();
+	p = alloc(size, true);
+	gc_heap_unlock();
 
 	return p;
 }
 
+static void *do_gc_alloc(size_t size)
+{
+	return gc_alloc_collect(gc_heap_alloc, size);
+}
+
+static void *do_gc_alloc_many(size_t size)
+{
+	return gc_alloc_collect(gc_heap_alloc_many, size);
+}
+
 static void *do_vm_alloc(size_t size)
 {
-	return malloc(size);
+	struct gc_root_region *region;
+
+	region = malloc(sizeof(*region) + size);
+	if (!region)
+		return NULL;
+
+	region->size = size;
+
+	gc_heap_lock();
+	list_add(&region->node, &gc_root_regions);
+	gc_heap_unlock();
+
+	return region + 1;
 }
 
 void *vm_zalloc(size_t size)
@@ -428,14 +1445,135 @@ void *vm_zalloc(size_t size)
 	return ret;
 }
 
+/*
+ * Native code that holds a direct pointer into an object pins the object
+ * until it lets go of the pointer. Neither collector moves objects so a
+ * pinned object only needs to be kept alive. Every pinned object has a
+ * record that is allocated with vm_alloc() which makes the object a root
+ * for both collectors even if native code keeps nothing but an interior
+ * pointer to it somewhere that is not scanned.
+ */
+struct gc_pin {
+	struct vm_object	*object;
+	unsigned long		count;
+};
+
+static pthread_mutex_t		gc_pin_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Pins of objects, keyed by object. Protected by gc_pin_mutex. */
+static struct hash_map		*gc_pins;
+
+int gc_pin_object(struct vm_object *object)
+{
+	struct gc_pin *pin;
+	void *value;
+	int err = 0;
+
+	pthread_mutex_lock(&gc_pin_mutex);
+
+	if (!gc_pins) {
+		gc_pins = alloc_hash_map(&pointer_key);
+		if (!gc_pins) {
+			err = -ENOMEM;
+			goto out_unlock;
+		}
+	}
+
+	if (hash_map_get(gc_pins, object, &value) == 0) {
+		pin = value;
+		pin->count++;
+		goto out_unlock;
+	}
+
+	pin = vm_alloc(sizeof(*pin));
+	if (!pin) {
+		err = -ENOMEM;
+		goto out_unlock;
+	}
+
+	pin->object	= object;
+	pin->count	= 1;
+
+	err = hash_map_put(gc_pins, object, pin);
+	if (err)
+		vm_free(pin);
+
+out_unlock:
+	pthread_mutex_unlock(&gc_pin_mutex);
+
+	return err;
+}
+
+void gc_unpin_object(struct vm_object *object)
+{
+	struct gc_pin *pin;
+	void *value;
+
+	pthread_mutex_lock(&gc_pin_mutex);
+
+	if (!gc_pins || hash_map_get(gc_pins, object, &value))
+		goto out_unlock;
+
+	pin = value;
+	if (--pin->count)
+		goto out_unlock;
+
+	hash_map_remove(gc_pins, object);
+	vm_free(pin);
+
+out_unlock:
+	pthread_mutex_unlock(&gc_pin_mutex);
+}
+
 static void do_vm_free(void *p)
 {
-	free(p);
+	struct gc_root_region *region;
+
+	if (!p)
+		return;
+
+	region = (struct gc_root_region *) p - 1;
+
+	gc_heap_lock();
+	list_del(&region->node);
+	gc_heap_unlock();
+
+	free(region);
 }
 
 static int do_gc_register_finalizer(struct vm_object *object, finalizer_fn finalizer)
 {
-	return 0;
+	struct gc_finalizer *f;
+	void *value;
+	int err = 0;
+
+	gc_heap_lock();
+
+	if (hash_map_get(gc_finalizers, object, &value) == 0) {
+		f = value;
+		f->finalizer = finalizer;
+		goto out_unlock;
+	}
+
+	f = malloc(sizeof(*f));
+	if (!f) {
+		err = -ENOMEM;
+		goto out_unlock;
+	}
+
+	f->object	= object;
+	f->finalizer	= finalizer;
+	f->pending	= false;
+	f->next		= NULL;
+
+	err = hash_map_put(gc_finalizers, object, f);
+	if (err)
+		free(f);
+
+out_unlock:
+	gc_heap_unlock();
+
+	return err;
 }
 
 static void do_gc_setup_signals(void)
@@ -464,21 +1602,84 @@ static void do_gc_setup_signals(void)
 	pthread_sigmask(SIG_BLOCK, &sigset, NULL);
 }
 
+static unsigned int gc_default_nr_threads(void)
+{
+	long nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (nr_cpus < 1)
+		return 1;
+
+	if (nr_cpus > GC_MAX_DEFAULT_THREADS)
+		return GC_MAX_DEFAULT_THREADS;
+
+	return nr_cpus;
+}
+
+/*
+ * Worker 0 is the GC thread. The others are helper threads that block all
+ * signals so that they are never mistaken for threads to be stopped.
+ */
+static void gc_setup_workers(void)
+{
+	sigset_t sigset, old_sigset;
+	unsigned int i;
+
+	gc_nr_workers = gc_nr_threads ? gc_nr_threads : gc_default_nr_threads();
+
+	gc_workers = calloc(gc_nr_workers, sizeof(*gc_workers));
+	if (!gc_workers)
+		die("out of memory");
+
+	for (i = 0; i < gc_nr_workers; i++) {
+		struct gc_worker *w = &gc_workers[i];
+
+		w->id	= i;
+		w->seed	= i + 1;
+
+		w->deque = alloc_work_deque(GC_DEQUE_SIZE);
+		if (!w->deque)
+			die("out of memory");
+	}
+
+	sigfillset(&sigset);
+	pthread_sigmask(SIG_BLOCK, &sigset, &old_sigset);
+
+	for (i = 1; i < gc_nr_workers; i++) {
+		struct gc_worker *w = &gc_workers[i];
+
+		if (pthread_create(&w->thread, NULL, &gc_worker_thread, w))
+			die("Couldn't create GC worker thread");
+	}
+
+	pthread_sigmask(SIG_SETMASK, &old_sigset, NULL);
+}
+
 static void gc_setup(void)
 {
+	if (gc_heap_init(max_heap_size, nursery_size))
+		die("Couldn't reserve %lu bytes for the heap", max_heap_size);
+
+	gc_finalizers = alloc_hash_map(&pointer_key);
+	if (!gc_finalizers)
+		die("out of memory");
+
 	gc_ops		= (struct gc_operations) {
 		.gc_alloc		= do_gc_alloc,
 		.gc_alloc_noscan	= do_gc_alloc,
+		.gc_alloc_many		= do_gc_alloc_many,
 		.vm_alloc		= do_vm_alloc,
 		.vm_free		= do_vm_free,
 		.gc_register_finalizer	= do_gc_register_finalizer,
 		.gc_setup_signals	= do_gc_setup_signals,
+		.gc_collect		= do_gc_collect_full,
 	};
 
 	if (pthread_spin_init(&gc_spinlock, PTHREAD_PROCESS_SHARED) != 0)
 		die("pthread_spin_init");
 
-	if (pthread_create(&gc_thread_id, NULL, &gc_thread, NULL))
+	gc_setup_workers();
+
+	if (pthread_create(&gc_thread_id, NULL, &gc_thread, &gc_workers[0]))
 		die("Couldn't create GC thread");
 }
 
@@ -3,246 +3,1532 @@
  *
  * This file is released under the 2-clause BSD license. Please refer to the
  * file LICENSE for details.
+ *
+ * This file contains a bytecode interpreter that is used for -Xint and for
+ * the first tier of mixed-mode execution (-Xtiered). Dispatch is threaded
+ * using GCC's labels as values extension: every handler jumps directly to
+ * the handler of the next instruction, which avoids the bounds check and
+ * the shared indirect branch of a switch statement.
+ *
+ * Local variables and the operand stack are arrays of JVM slots. Values of
+ * type long and double occupy two slots and are stored in memory order so
+ * that a frame can be passed to native_call() as an argument array as-is.
  */
 
 #include "vm/interp.h"
 
 #include "cafebabe/code_attribute.h"
+#include "cafebabe/constant_pool.h"
+
+#include "jit/emulate.h"
+#include "jit/exception.h"
+
+#include "vm/bytecode.h"
+#include "vm/call.h"
+#include "vm/class.h"
+#include "vm/errors.h"
 #include "vm/method.h"
+#include "vm/monitor.h"
+#include "vm/object.h"
+#include "vm/opcodes.h"
+#include "vm/preload.h"
+#include "vm/types.h"
 
 #include <assert.h>
-#include <stdio.h>
-
-enum interp_status {
-	INTERP_CONTINUE,
-	INTERP_RETURN,
-};
-
-static enum interp_status interp(uint8_t opc)
-{
-	switch (opc) {
-	case OPC_NOP:
-		 break;
-	case OPC_ACONST_NULL:	assert(!"OPC_ACONST_NULL"); break;
-	case OPC_ICONST_M1:	assert(!"OPC_ICONST_M1"); break;
-	case OPC_ICONST_0:	assert(!"OPC_ICONST_0"); break;
-	case OPC_ICONST_1:	assert(!"OPC_ICONST_1"); break;
-	case OPC_ICONST_2:	assert(!"OPC_ICONST_2"); break;
-	case OPC_ICONST_3:	assert(!"OPC_ICONST_3"); break;
-	case OPC_ICONST_4:	assert(!"OPC_ICONST_4"); break;
-	case OPC_ICONST_5:	assert(!"OPC_ICONST_5"); break;
-	case OPC_LCONST_0:	assert(!"OPC_LCONST_0"); break;
-	case OPC_LCONST_1:	assert(!"OPC_LCONST_1"); break;
-	case OPC_FCONST_0:	assert(!"OPC_FCONST_0"); break;
-	case OPC_FCONST_1:	assert(!"OPC_FCONST_1"); break;
-	case OPC_FCONST_2:	assert(!"OPC_FCONST_2"); break;
-	case OPC_DCONST_0:	assert(!"OPC_DCONST_0"); break;
-	case OPC_DCONST_1:	assert(!"OPC_DCONST_1"); break;
-	case OPC_BIPUSH:	assert(!"OPC_BIPUSH"); break;
-	case OPC_SIPUSH:	assert(!"OPC_SIPUSH"); break;
-	case OPC_LDC:	assert(!"OPC_LDC"); break;
-	case OPC_LDC_W:	assert(!"OPC_LDC_W"); break;
-	case OPC_LDC2_W:	assert(!"OPC_LDC2_W"); break;
-	case OPC_ILOAD:	assert(!"OPC_ILOAD"); break;
-	case OPC_LLOAD:	assert(!"OPC_LLOAD"); break;
-	case OPC_FLOAD:	assert(!"OPC_FLOAD"); break;
-	case OPC_DLOAD:	assert(!"OPC_DLOAD"); break;
-	case OPC_ALOAD:	assert(!"OPC_ALOAD"); break;
-	case OPC_ILOAD_0:	assert(!"OPC_ILOAD_0"); break;
-	case OPC_ILOAD_1:	assert(!"OPC_ILOAD_1"); break;
-	case OPC_ILOAD_2:	assert(!"OPC_ILOAD_2"); break;
-	case OPC_ILOAD_3:	assert(!"OPC_ILOAD_3"); break;
-	case OPC_LLOAD_0:	assert(!"OPC_LLOAD_0"); break;
-	case OPC_LLOAD_1:	assert(!"OPC_LLOAD_1"); break;
-	case OPC_LLOAD_2:	assert(!"OPC_LLOAD_2"); break;
-	case OPC_LLOAD_3:	assert(!"OPC_LLOAD_3"); break;
-	case OPC_FLOAD_0:	assert(!"OPC_FLOAD_0"); break;
-	case OPC_FLOAD_1:	assert(!"OPC_FLOAD_1"); break;
-	case OPC_FLOAD_2:	assert(!"OPC_FLOAD_2"); break;
-	case OPC_FLOAD_3:	assert(!"OPC_FLOAD_3"); break;
-	case OPC_DLOAD_0:	assert(!"OPC_DLOAD_0"); break;
-	case OPC_DLOAD_1:	assert(!"OPC_DLOAD_1"); break;
-	case OPC_DLOAD_2:	assert(!"OPC_DLOAD_2"); break;
-	case OPC_DLOAD_3:	assert(!"OPC_DLOAD_3"); break;
-	case OPC_ALOAD_0:	assert(!"OPC_ALOAD_0"); break;
-	case OPC_ALOAD_1:	assert(!"OPC_ALOAD_1"); break;
-	case OPC_ALOAD_2:	assert(!"OPC_ALOAD_2"); break;
-	case OPC_ALOAD_3:	assert(!"OPC_ALOAD_3"); break;
-	case OPC_IALOAD:	assert(!"OPC_IALOAD"); break;
-	case OPC_LALOAD:	assert(!"OPC_LALOAD"); break;
-	case OPC_FALOAD:	assert(!"OPC_FALOAD"); break;
-	case OPC_DALOAD:	assert(!"OPC_DALOAD"); break;
-	case OPC_AALOAD:	assert(!"OPC_AALOAD"); break;
-	case OPC_BALOAD:	assert(!"OPC_BALOAD"); break;
-	case OPC_CALOAD:	assert(!"OPC_CALOAD"); break;
-	case OPC_SALOAD:	assert(!"OPC_SALOAD"); break;
-	case OPC_ISTORE:	assert(!"OPC_ISTORE"); break;
-	case OPC_LSTORE:	assert(!"OPC_LSTORE"); break;
-	case OPC_FSTORE:	assert(!"OPC_FSTORE"); break;
-	case OPC_DSTORE:	assert(!"OPC_DSTORE"); break;
-	case OPC_ASTORE:	assert(!"OPC_ASTORE"); break;
-	case OPC_ISTORE_0:	assert(!"OPC_ISTORE_0"); break;
-	case OPC_ISTORE_1:	assert(!"OPC_ISTORE_1"); break;
-	case OPC_ISTORE_2:	assert(!"OPC_ISTORE_2"); break;
-	case OPC_ISTORE_3:	assert(!"OPC_ISTORE_3"); break;
-	case OPC_LSTORE_0:	assert(!"OPC_LSTORE_0"); break;
-	case OPC_LSTORE_1:	assert(!"OPC_LSTORE_1"); break;
-	case OPC_LSTORE_2:	assert(!"OPC_LSTORE_2"); break;
-	case OPC_LSTORE_3:	assert(!"OPC_LSTORE_3"); break;
-	case OPC_FSTORE_0:	assert(!"OPC_FSTORE_0"); break;
-	case OPC_FSTORE_1:	assert(!"OPC_FSTORE_1"); break;
-	case OPC_FSTORE_2:	assert(!"OPC_FSTORE_2"); break;
-	case OPC_FSTORE_3:	assert(!"OPC_FSTORE_3"); break;
-	case OPC_DSTORE_0:	assert(!"OPC_DSTORE_0"); break;
-	case OPC_DSTORE_1:	assert(!"OPC_DSTORE_1"); break;
-	case OPC_DSTORE_2:	assert(!"OPC_DSTORE_2"); break;
-	case OPC_DSTORE_3:	assert(!"OPC_DSTORE_3"); break;
-	case OPC_ASTORE_0:	assert(!"OPC_ASTORE_0"); break;
-	case OPC_ASTORE_1:	assert(!"OPC_ASTORE_1"); break;
-	case OPC_ASTORE_2:	assert(!"OPC_ASTORE_2"); break;
-	case OPC_ASTORE_3:	assert(!"OPC_ASTORE_3"); break;
-	case OPC_IASTORE:	assert(!"OPC_IASTORE"); break;
-	case OPC_LASTORE:	assert(!"OPC_LASTORE"); break;
-	case OPC_FASTORE:	assert(!"OPC_FASTORE"); break;
-	case OPC_DASTORE:	assert(!"OPC_DASTORE"); break;
-	case OPC_AASTORE:	assert(!"OPC_AASTORE"); break;
-	case OPC_BASTORE:	assert(!"OPC_BASTORE"); break;
-	case OPC_CASTORE:	assert(!"OPC_CASTORE"); break;
-	case OPC_SASTORE:	assert(!"OPC_SASTORE"); break;
-	case OPC_POP:	assert(!"OPC_POP"); break;
-	case OPC_POP2:	assert(!"OPC_POP2"); break;
-	case OPC_DUP:	assert(!"OPC_DUP"); break;
-	case OPC_DUP_X1:	assert(!"OPC_DUP_X1"); break;
-	case OPC_DUP_X2:	assert(!"OPC_DUP_X2"); break;
-	case OPC_DUP2:	assert(!"OPC_DUP2"); break;
-	case OPC_DUP2_X1:	assert(!"OPC_DUP2_X1"); break;
-	case OPC_DUP2_X2:	assert(!"OPC_DUP2_X2"); break;
-	case OPC_SWAP:	assert(!"OPC_SWAP"); break;
-	case OPC_IADD:	assert(!"OPC_IADD"); break;
-	case OPC_LADD:	assert(!"OPC_LADD"); break;
-	case OPC_FADD:	assert(!"OPC_FADD"); break;
-	case OPC_DADD:	assert(!"OPC_DADD"); break;
-	case OPC_ISUB:	assert(!"OPC_ISUB"); break;
-	case OPC_LSUB:	assert(!"OPC_LSUB"); break;
-	case OPC_FSUB:	assert(!"OPC_FSUB"); break;
-	case OPC_DSUB:	assert(!"OPC_DSUB"); break;
-	case OPC_IMUL:	assert(!"OPC_IMUL"); break;
-	case OPC_LMUL:	assert(!"OPC_LMUL"); break;
-	case OPC_FMUL:	assert(!"OPC_FMUL"); break;
-	case OPC_DMUL:	assert(!"OPC_DMUL"); break;
-	case OPC_IDIV:	assert(!"OPC_IDIV"); break;
-	case OPC_LDIV:	assert(!"OPC_LDIV"); break;
-	case OPC_FDIV:	assert(!"OPC_FDIV"); break;
-	case OPC_DDIV:	assert(!"OPC_DDIV"); break;
-	case OPC_IREM:	assert(!"OPC_IREM"); break;
-	case OPC_LREM:	assert(!"OPC_LREM"); break;
-	case OPC_FREM:	assert(!"OPC_FREM"); break;
-	case OPC_DREM:	assert(!"OPC_DREM"); break;
-	case OPC_INEG:	assert(!"OPC_INEG"); break;
-	case OPC_LNEG:	assert(!"OPC_LNEG"); break;
-	case OPC_FNEG:	assert(!"OPC_FNEG"); break;
-	case OPC_DNEG:	assert(!"OPC_DNEG"); break;
-	case OPC_ISHL:	assert(!"OPC_ISHL"); break;
-	case OPC_LSHL:	assert(!"OPC_LSHL"); break;
-	case OPC_ISHR:	assert(!"OPC_ISHR"); break;
-	case OPC_LSHR:	assert(!"OPC_LSHR"); break;
-	case OPC_IUSHR:	assert(!"OPC_IUSHR"); break;
-	case OPC_LUSHR:	assert(!"OPC_LUSHR"); break;
-	case OPC_IAND:	assert(!"OPC_IAND"); break;
-	case OPC_LAND:	assert(!"OPC_LAND"); break;
-	case OPC_IOR:	assert(!"OPC_IOR"); break;
-	case OPC_LOR:	assert(!"OPC_LOR"); break;
-	case OPC_IXOR:	assert(!"OPC_IXOR"); break;
-	case OPC_LXOR:	assert(!"OPC_LXOR"); break;
-	case OPC_IINC:	assert(!"OPC_IINC"); break;
-	case OPC_I2L:	assert(!"OPC_I2L"); break;
-	case OPC_I2F:	assert(!"OPC_I2F"); break;
-	case OPC_I2D:	assert(!"OPC_I2D"); break;
-	case OPC_L2I:	assert(!"OPC_L2I"); break;
-	case OPC_L2F:	assert(!"OPC_L2F"); break;
-	case OPC_L2D:	assert(!"OPC_L2D"); break;
-	case OPC_F2I:	assert(!"OPC_F2I"); break;
-	case OPC_F2L:	assert(!"OPC_F2L"); break;
-	case OPC_F2D:	assert(!"OPC_F2D"); break;
-	case OPC_D2I:	assert(!"OPC_D2I"); break;
-	case OPC_D2L:	assert(!"OPC_D2L"); break;
-	case OPC_D2F:	assert(!"OPC_D2F"); break;
-	case OPC_I2B:	assert(!"OPC_I2B"); break;
-	case OPC_I2C:	assert(!"OPC_I2C"); break;
-	case OPC_I2S:	assert(!"OPC_I2S"); break;
-	case OPC_LCMP:	assert(!"OPC_LCMP"); break;
-	case OPC_FCMPL:	assert(!"OPC_FCMPL"); break;
-	case OPC_FCMPG:	assert(!"OPC_FCMPG"); break;
-	case OPC_DCMPL:	assert(!"OPC_DCMPL"); break;
-	case OPC_DCMPG:	assert(!"OPC_DCMPG"); break;
-	case OPC_IFEQ:	assert(!"OPC_IFEQ"); break;
-	case OPC_IFNE:	assert(!"OPC_IFNE"); break;
-	case OPC_IFLT:	assert(!"OPC_IFLT"); break;
-	case OPC_IFGE:	assert(!"OPC_IFGE"); break;
-	case OPC_IFGT:	assert(!"OPC_IFGT"); break;
-	case OPC_IFLE:	assert(!"OPC_IFLE"); break;
-	case OPC_IF_ICMPEQ:	assert(!"OPC_IF_ICMPEQ"); break;
-	case OPC_IF_ICMPNE:	assert(!"OPC_IF_ICMPNE"); break;
-	case OPC_IF_ICMPLT:	assert(!"OPC_IF_ICMPLT"); break;
-	case OPC_IF_ICMPGE:	assert(!"OPC_IF_ICMPGE"); break;
-	case OPC_IF_ICMPGT:	assert(!"OPC_IF_ICMPGT"); break;
-	case OPC_IF_ICMPLE:	assert(!"OPC_IF_ICMPLE"); break;
-	case OPC_IF_ACMPEQ:	assert(!"OPC_IF_ACMPEQ"); break;
-	case OPC_IF_ACMPNE:	assert(!"OPC_IF_ACMPNE"); break;
-	case OPC_GOTO:	assert(!"OPC_GOTO"); break;
-	case OPC_JSR:	assert(!"OPC_JSR"); break;
-	case OPC_RET:	assert(!"OPC_RET"); break;
-	case OPC_TABLESWITCH:	assert(!"OPC_TABLESWITCH"); break;
-	case OPC_LOOKUPSWITCH:	assert(!"OPC_LOOKUPSWITCH"); break;
-	case OPC_IRETURN:	assert(!"OPC_IRETURN"); break;
-	case OPC_LRETURN:	assert(!"OPC_LRETURN"); break;
-	case OPC_FRETURN:	assert(!"OPC_FRETURN"); break;
-	case OPC_DRETURN:	assert(!"OPC_DRETURN"); break;
-	case OPC_ARETURN:	assert(!"OPC_ARETURN"); break;
-	case OPC_RETURN:
-		return INTERP_RETURN;
-	case OPC_GETSTATIC:	assert(!"OPC_GETSTATIC"); break;
-	case OPC_PUTSTATIC:	assert(!"OPC_PUTSTATIC"); break;
-	case OPC_GETFIELD:	assert(!"OPC_GETFIELD"); break;
-	case OPC_PUTFIELD:	assert(!"OPC_PUTFIELD"); break;
-	case OPC_INVOKEVIRTUAL:	assert(!"OPC_INVOKEVIRTUAL"); break;
-	case OPC_INVOKESPECIAL:	assert(!"OPC_INVOKESPECIAL"); break;
-	case OPC_INVOKESTATIC:	assert(!"OPC_INVOKESTATIC"); break;
-	case OPC_INVOKEINTERFACE:	assert(!"OPC_INVOKEINTERFACE"); break;
-	case OPC_NEW:	assert(!"OPC_NEW"); break;
-	case OPC_NEWARRAY:	assert(!"OPC_NEWARRAY"); break;
-	case OPC_ANEWARRAY:	assert(!"OPC_ANEWARRAY"); break;
-	case OPC_ARRAYLENGTH:	assert(!"OPC_ARRAYLENGTH"); break;
-	case OPC_ATHROW:	assert(!"OPC_ATHROW"); break;
-	case OPC_CHECKCAST:	assert(!"OPC_CHECKCAST"); break;
-	case OPC_INSTANCEOF:	assert(!"OPC_INSTANCEOF"); break;
-	case OPC_MONITORENTER:	assert(!"OPC_MONITORENTER"); break;
-	case OPC_MONITOREXIT:	assert(!"OPC_MONITOREXIT"); break;
-	case OPC_WIDE:	assert(!"OPC_WIDE"); break;
-	case OPC_MULTIANEWARRAY:	assert(!"OPC_MULTIANEWARRAY"); break;
-	case OPC_IFNULL:	assert(!"OPC_IFNULL"); break;
-	case OPC_IFNONNULL:	assert(!"OPC_IFNONNULL"); break;
-	case OPC_GOTO_W:	assert(!"OPC_GOTO_W"); break;
-	case OPC_JSR_W:	assert(!"OPC_JSR_W"); break;
-	case OPC_BREAKPOINT:	assert(!"OPC_BREAKPOINT"); break;
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+bool opt_interp_only;
+bool opt_tiered;
+unsigned long opt_compile_threshold	= 1500;
+unsigned long opt_backedge_threshold	= 10000;
+
+static inline jint slot_get_int(const unsigned long *slot)
+{
+	return (jint) *slot;
+}
+
+static inline void slot_set_int(unsigned long *slot, jint value)
+{
+	*slot = (long) value;
+}
+
+static inline jlong slot_get_long(const unsigned long *slot)
+{
+	jlong value;
+
+	memcpy(&value, slot, sizeof(value));
+
+	return value;
+}
+
+static inline void slot_set_long(unsigned long *slot, jlong value)
+{
+	memcpy(slot, &value, sizeof(value));
+}
+
+static inline jfloat slot_get_float(const unsigned long *slot)
+{
+	jfloat value;
+
+	memcpy(&value, slot, sizeof(value));
+
+	return value;
+}
+
+static inline void slot_set_float(unsigned long *slot, jfloat value)
+{
+	*slot = 0;
+	memcpy(slot, &value, sizeof(value));
+}
+
+static inline jdouble slot_get_double(const unsigned long *slot)
+{
+	jdouble value;
+
+	memcpy(&value, slot, sizeof(value));
+
+	return value;
+}
+
+static inline void slot_set_double(unsigned long *slot, jdouble value)
+{
+	memcpy(slot, &value, sizeof(value));
+}
+
+static inline struct vm_object *slot_get_ref(const unsigned long *slot)
+{
+	return (struct vm_object *) *slot;
+}
+
+static inline void slot_set_ref(unsigned long *slot, struct vm_object *value)
+{
+	*slot = (unsigned long) value;
+}
+
+/*
+ * Loads a field value of @type from @p to the operand stack and returns the
+ * number of slots it occupies.
+ */
+static unsigned int interp_load(unsigned long *sp, enum vm_type type, const uint8_t *p)
+{
+	switch (type) {
+	case J_BYTE:
+		slot_set_int(sp, *(const jbyte *) p);
+		return 1;
+	case J_BOOLEAN:
+		slot_set_int(sp, *(const jboolean *) p);
+		return 1;
+	case J_CHAR:
+		slot_set_int(sp, *(const jchar *) p);
+		return 1;
+	case J_SHORT:
+		slot_set_int(sp, *(const jshort *) p);
+		return 1;
+	case J_INT:
+		slot_set_int(sp, *(const jint *) p);
+		return 1;
+	case J_FLOAT:
+		slot_set_float(sp, *(const jfloat *) p);
+		return 1;
+	case J_LONG:
+		slot_set_long(sp, *(const jlong *) p);
+		return 2;
+	case J_DOUBLE:
+		slot_set_double(sp, *(const jdouble *) p);
+		return 2;
+	case J_REFERENCE:
+		slot_set_ref(sp, *(struct vm_object * const *) p);
+		return 1;
 	default:
-		assert(!"unknown bytecode");
+		assert(!"invalid field type");
 	}
 
-	return INTERP_CONTINUE;
+	return 1;
 }
 
-void vm_interp_method_v(struct vm_method *method, va_list args, union jvalue *result)
+/*
+ * Stores a field value of @type from the operand stack to @p. Types smaller
+ * than a machine word are stored as whole words just like the setters in
+ * "vm/object.h" do.
+ */
+static void interp_store(uint8_t *p, enum vm_type type, const unsigned long *sp)
+{
+	switch (type) {
+	case J_BYTE:
+		*(long *) p = (jbyte) slot_get_int(sp);
+		break;
+	case J_BOOLEAN:
+		*(unsigned long *) p = (jboolean) slot_get_int(sp);
+		break;
+	case J_CHAR:
+		*(unsigned long *) p = (jchar) slot_get_int(sp);
+		break;
+	case J_SHORT:
+		*(long *) p = (jshort) slot_get_int(sp);
+		break;
+	case J_INT:
+		*(jint *) p = slot_get_int(sp);
+		break;
+	case J_FLOAT:
+		*(jfloat *) p = slot_get_float(sp);
+		break;
+	case J_LONG:
+		*(jlong *) p = slot_get_long(sp);
+		break;
+	case J_DOUBLE:
+		*(jdouble *) p = slot_get_double(sp);
+		break;
+	case J_REFERENCE:
+		*(struct vm_object **) p = slot_get_ref(sp);
+		gc_write_barrier(p);
+		break;
+	default:
+		assert(!"invalid field type");
+	}
+}
+
+/*
+ * Pushes the return value of a method invocation to the operand stack and
+ * returns the number of slots it occupies.
+ */
+static unsigned int
+interp_push_result(unsigned long *sp, enum vm_type type, union jvalue *result)
+{
+	switch (type) {
+	case J_VOID:
+		return 0;
+	case J_BYTE:
+		slot_set_int(sp, result->b);
+		return 1;
+	case J_BOOLEAN:
+		slot_set_int(sp, result->z);
+		return 1;
+	case J_CHAR:
+		slot_set_int(sp, result->c);
+		return 1;
+	case J_SHORT:
+		slot_set_int(sp, result->s);
+		return 1;
+	case J_INT:
+		slot_set_int(sp, result->i);
+		return 1;
+	case J_FLOAT:
+		slot_set_float(sp, result->f);
+		return 1;
+	case J_LONG:
+		slot_set_long(sp, result->j);
+		return 2;
+	case J_DOUBLE:
+		slot_set_double(sp, result->d);
+		return 2;
+	case J_REFERENCE:
+		slot_set_ref(sp, result->l);
+		return 1;
+	default:
+		assert(!"invalid return type");
+	}
+
+	return 0;
+}
+
+static bool interp_check_array(struct vm_object *array, jint index)
+{
+	if (!array) {
+		throw_npe();
+		return false;
+	}
+
+	if ((uint32_t) index < (uint32_t) vm_array_length(array))
+		return true;
+
+	vm_object_check_array(array, index);
+
+	return false;
+}
+
+static void interp_signal_error(struct vm_class *vmc)
+{
+	if (!exception_occurred())
+		signal_new_exception(vmc, NULL);
+}
+
+static int interp_ldc(struct vm_class *vmc, uint16_t idx, unsigned long *sp)
+{
+	const struct cafebabe_constant_info_utf8 *utf8;
+	struct cafebabe_constant_pool *cp;
+	struct vm_object *string;
+	struct vm_class *ret;
+
+	cp = &vmc->class->constant_pool[idx];
+
+	switch (cp->tag) {
+	case CAFEBABE_CONSTANT_TAG_INTEGER:
+		slot_set_int(sp, cafebabe_constant_pool_get_integer(cp));
+		break;
+	case CAFEBABE_CONSTANT_TAG_FLOAT:
+		slot_set_float(sp, cafebabe_constant_pool_get_float(cp));
+		break;
+	case CAFEBABE_CONSTANT_TAG_LONG:
+		slot_set_long(sp, cafebabe_constant_pool_get_long(cp));
+		break;
+	case CAFEBABE_CONSTANT_TAG_DOUBLE:
+		slot_set_double(sp, cafebabe_constant_pool_get_double(cp));
+		break;
+	case CAFEBABE_CONSTANT_TAG_STRING:
+		if (cafebabe_class_constant_get_utf8(vmc->class, cp->string.string_index, &utf8)) {
+			throw_internal_error();
+			return -1;
+		}
+
+		string = vm_object_alloc_string_from_utf8(utf8->bytes, utf8->length);
+		if (!string)
+			return -1;
+
+		slot_set_ref(sp, string);
+		break;
+	case CAFEBABE_CONSTANT_TAG_CLASS:
+		ret = vm_class_resolve_class(vmc, idx);
+		if (!ret) {
+			interp_signal_error(vm_java_lang_NoClassDefFoundError);
+			return -1;
+		}
+
+		if (vm_class_ensure_object(ret))
+			return -1;
+
+		slot_set_ref(sp, ret->object);
+		break;
+	default:
+		throw_internal_error();
+		return -1;
+	}
+
+	return 0;
+}
+
+static long interp_find_handler(struct vm_method *method, unsigned long pc,
+				struct vm_object *exception)
+{
+	struct cafebabe_code_attribute_exception *eh;
+	unsigned int i;
+
+	for (i = 0; i < method->code_attribute.exception_table_length; i++) {
+		struct vm_class *catch_class;
+
+		eh = &method->code_attribute.exception_table[i];
+		if (!exception_covers(eh, pc))
+			continue;
+
+		/* This matches to everything. */
+		if (eh->catch_type == 0)
+			return eh->handler_pc;
+
+		catch_class = vm_class_resolve_class(method->class, eh->catch_type);
+		if (!catch_class)
+			continue;
+
+		if (vm_class_is_assignable_from(catch_class, exception->class))
+			return eh->handler_pc;
+	}
+
+	return -1;
+}
+
+static bool interp_invoke(struct vm_method *vmm, unsigned long *args, union jvalue *result)
 {
-	uint32_t pc;
+	if (vm_method_is_abstract(vmm)) {
+		signal_new_exception(vm_java_lang_AbstractMethodError, vmm->name);
+		return false;
+	}
+
+	vm_call_method_a(vmm, args, result);
+
+	return !exception_occurred();
+}
+
+#define PUSH_INT(value)		do { slot_set_int(sp, (value)); sp++; } while (0)
+#define PUSH_LONG(value)	do { slot_set_long(sp, (value)); sp += 2; } while (0)
+#define PUSH_FLOAT(value)	do { slot_set_float(sp, (value)); sp++; } while (0)
+#define PUSH_DOUBLE(value)	do { slot_set_double(sp, (value)); sp += 2; } while (0)
+#define PUSH_REF(value)		do { slot_set_ref(sp, (value)); sp++; } while (0)
+
+#define POP_INT()		(sp--, slot_get_int(sp))
+#define POP_LONG()		(sp -= 2, slot_get_long(sp))
+#define POP_FLOAT()		(sp--, slot_get_float(sp))
+#define POP_DOUBLE()		(sp -= 2, slot_get_double(sp))
+#define POP_REF()		(sp--, slot_get_ref(sp))
+
+#define DISPATCH()		goto *dispatch_table[code[pc]]
+
+#define NEXT(len)		do { pc += (len); DISPATCH(); } while (0)
+
+/*
+ * Backward branches are counted so that methods with hot loops get compiled
+ * on their next invocation even if they are not called often.
+ */
+#define BRANCH(offset)						\
+	do {							\
+		int32_t __offset = (offset);			\
+								\
+		if (__offset <= 0)				\
+			method->backedge_count++;		\
+								\
+		pc += __offset;					\
+		DISPATCH();					\
+	} while (0)
+
+#define THROW()			goto exception
+
+static void interp(struct vm_method *method, unsigned long *locals,
+		   unsigned long *stack, union jvalue *result)
+{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Woverride-init"
+	static const void *const dispatch_table[256] = {
+		[0 ... 255] = &&op_invalid,
+#define BYTECODE(opc, name, size, type) [opc] = &&op_##name,
+#  include "vm/bytecode-def.h"
+#undef BYTECODE
+	};
+#pragma GCC diagnostic pop
+	const uint8_t *code = method->code_attribute.code;
+	struct vm_class *class = method->class;
+	unsigned long *sp = stack;
+	struct tableswitch_info ts;
+	struct lookupswitch_info ls;
+	struct vm_object *obj, *obj2;
+	struct vm_method *target;
+	struct vm_field *field;
+	struct vm_class *vmc;
+	unsigned long pc = 0;
+	union jvalue ret;
+	unsigned int idx;
+	unsigned int n;
+	jint a, b;
+	jlong la, lb;
+	jfloat fa, fb;
+	jdouble da, db;
+	long handler;
+
+	DISPATCH();
+
+op_nop:
+	NEXT(1);
+
+op_aconst_null:
+	PUSH_REF(NULL);
+	NEXT(1);
+
+op_iconst_n:
+	PUSH_INT(code[pc] - OPC_ICONST_0);
+	NEXT(1);
+
+op_lconst_n:
+	PUSH_LONG(code[pc] - OPC_LCONST_0);
+	NEXT(1);
+
+op_fconst_n:
+	PUSH_FLOAT(code[pc] - OPC_FCONST_0);
+	NEXT(1);
+
+op_dconst_n:
+	PUSH_DOUBLE(code[pc] - OPC_DCONST_0);
+	NEXT(1);
+
+op_bipush:
+	PUSH_INT((int8_t) code[pc + 1]);
+	NEXT(2);
+
+op_sipush:
+	PUSH_INT(read_s16(&code[pc + 1]));
+	NEXT(3);
+
+op_ldc:
+	idx = code[pc + 1];
+	goto ldc;
+
+op_ldc_w:
+op_ldc2_w:
+	idx = read_u16(&code[pc + 1]);
+ldc:
+	if (interp_ldc(class, idx, sp))
+		THROW();
+
+	sp += code[pc] == OPC_LDC2_W ? 2 : 1;
+	NEXT(code[pc] == OPC_LDC ? 2 : 3);
+
+op_iload:
+op_fload:
+op_aload:
+	*sp++ = locals[code[pc + 1]];
+	NEXT(2);
+
+op_lload:
+op_dload:
+	idx = code[pc + 1];
+	sp[0] = locals[idx];
+	sp[1] = locals[idx + 1];
+	sp += 2;
+	NEXT(2);
+
+op_iload_n:
+	*sp++ = locals[code[pc] - OPC_ILOAD_0];
+	NEXT(1);
+
+op_fload_n:
+	*sp++ = locals[code[pc] - OPC_FLOAD_0];
+	NEXT(1);
+
+op_aload_n:
+	*sp++ = locals[code[pc] - OPC_ALOAD_0];
+	NEXT(1);
+
+op_lload_n:
+	idx = code[pc] - OPC_LLOAD_0;
+	goto load_pair;
+
+op_dload_n:
+	idx = code[pc] - OPC_DLOAD_0;
+load_pair:
+	sp[0] = locals[idx];
+	sp[1] = locals[idx + 1];
+	sp += 2;
+	NEXT(1);
+
+op_istore:
+op_fstore:
+op_astore:
+	locals[code[pc + 1]] = *--sp;
+	NEXT(2);
+
+op_lstore:
+op_dstore:
+	idx = code[pc + 1];
+	sp -= 2;
+	locals[idx] = sp[0];
+	locals[idx + 1] = sp[1];
+	NEXT(2);
+
+op_istore_n:
+	locals[code[pc] - OPC_ISTORE_0] = *--sp;
+	NEXT(1);
+
+op_fstore_n:
+	locals[code[pc] - OPC_FSTORE_0] = *--sp;
+	NEXT(1);
+
+op_astore_n:
+	locals[code[pc] - OPC_ASTORE_0] = *--sp;
+	NEXT(1);
+
+op_lstore_n:
+	idx = code[pc] - OPC_LSTORE_0;
+	goto store_pair;
+
+op_dstore_n:
+	idx = code[pc] - OPC_DSTORE_0;
+store_pair:
+	sp -= 2;
+	locals[idx] = sp[0];
+	locals[idx + 1] = sp[1];
+	NEXT(1);
+
+op_iaload:
+	a = POP_INT();
+	obj = POP_REF();
+	if (!interp_check_array(obj, a))
+		THROW();
+	PUSH_INT(array_get_field_int(obj, a));
+	NEXT(1);
+
+op_laload:
+	a = POP_INT();
+	obj = POP_REF();
+	if (!interp_check_array(obj, a))
+		THROW();
+	PUSH_LONG(array_get_field_long(obj, a));
+	NEXT(1);
+
+op_faload:
+	a = POP_INT();
+	obj = POP_REF();
+	if (!interp_check_array(obj, a))
+		THROW();
+	PUSH_FLOAT(array_get_field_float(obj, a));
+	NEXT(1);
+
+op_daload:
+	a = POP_INT();
+	obj = POP_REF();
+	if (!interp_check_array(obj, a))
+		THROW();
+	PUSH_DOUBLE(array_get_field_double(obj, a));
+	NEXT(1);
+
+op_aaload:
+	a = POP_INT();
+	obj = POP_REF();
+	if (!interp_check_array(obj, a))
+		THROW();
+	PUSH_REF(array_get_field_object(obj, a));
+	NEXT(1);
+
+op_baload:
+	a = POP_INT();
+	obj = POP_REF();
+	if (!interp_check_array(obj, a))
+		THROW();
+	PUSH_INT(array_get_field_byte(obj, a));
+	NEXT(1);
+
+op_caload:
+	a = POP_INT();
+	obj = POP_REF();
+	if (!interp_check_array(obj, a))
+		THROW();
+	PUSH_INT(array_get_field_char(obj, a));
+	NEXT(1);
+
+op_saload:
+	a = POP_INT();
+	obj = POP_REF();
+	if (!interp_check_array(obj, a))
+		THROW();
+	PUSH_INT(array_get_field_short(obj, a));
+	NEXT(1);
+
+op_iastore:
+	b = POP_INT();
+	a = POP_INT();
+	obj = POP_REF();
+	if (!interp_check_array(obj, a))
+		THROW();
+	array_set_field_int(obj, a, b);
+	NEXT(1);
+
+op_lastore:
+	la = POP_LONG();
+	a = POP_INT();
+	obj = POP_REF();
+	if (!interp_check_array(obj, a))
+		THROW();
+	array_set_field_long(obj, a, la);
+	NEXT(1);
+
+op_fastore:
+	fa = POP_FLOAT();
+	a = POP_INT();
+	obj = POP_REF();
+	if (!interp_check_array(obj, a))
+		THROW();
+	array_set_field_float(obj, a, fa);
+	NEXT(1);
+
+op_dastore:
+	da = POP_DOUBLE();
+	a = POP_INT();
+	obj = POP_REF();
+	if (!interp_check_array(obj, a))
+		THROW();
+	array_set_field_double(obj, a, da);
+	NEXT(1);
+
+op_aastore:
+	obj2 = POP_REF();
+	a = POP_INT();
+	obj = POP_REF();
+	if (!interp_check_array(obj, a))
+		THROW();
+	array_store_check(obj, obj2);
+	if (exception_occurred())
+		THROW();
+	array_set_field_object(obj, a, obj2);
+	NEXT(1);
+
+op_bastore:
+	b = POP_INT();
+	a = POP_INT();
+	obj = POP_REF();
+	if (!interp_check_array(obj, a))
+		THROW();
+	array_set_field_byte(obj, a, b);
+	NEXT(1);
+
+op_castore:
+	b = POP_INT();
+	a = POP_INT();
+	obj = POP_REF();
+	if (!interp_check_array(obj, a))
+		THROW();
+	array_set_field_char(obj, a, b);
+	NEXT(1);
 
-	pc = 0;
-	while (pc < method->code_attribute.code_length) {
-		uint8_t opc = method->code_attribute.code[pc];
+op_sastore:
+	b = POP_INT();
+	a = POP_INT();
+	obj = POP_REF();
+	if (!interp_check_array(obj, a))
+		THROW();
+	array_set_field_short(obj, a, b);
+	NEXT(1);
 
-		if (interp(opc) == INTERP_RETURN)
+op_pop:
+	sp--;
+	NEXT(1);
+
+op_pop2:
+	sp -= 2;
+	NEXT(1);
+
+op_dup:
+	sp[0] = sp[-1];
+	sp++;
+	NEXT(1);
+
+op_dup_x1:
+	sp[0] = sp[-1];
+	sp[-1] = sp[-2];
+	sp[-2] = sp[0];
+	sp++;
+	NEXT(1);
+
+op_dup_x2:
+	sp[0] = sp[-1];
+	sp[-1] = sp[-2];
+	sp[-2] = sp[-3];
+	sp[-3] = sp[0];
+	sp++;
+	NEXT(1);
+
+op_dup2:
+	sp[0] = sp[-2];
+	sp[1] = sp[-1];
+	sp += 2;
+	NEXT(1);
+
+op_dup2_x1:
+	sp[1] = sp[-1];
+	sp[0] = sp[-2];
+	sp[-1] = sp[-3];
+	sp[-2] = sp[1];
+	sp[-3] = sp[0];
+	sp += 2;
+	NEXT(1);
+
+op_dup2_x2:
+	sp[1] = sp[-1];
+	sp[0] = sp[-2];
+	sp[-1] = sp[-3];
+	sp[-2] = sp[-4];
+	sp[-3] = sp[1];
+	sp[-4] = sp[0];
+	sp += 2;
+	NEXT(1);
+
+op_swap:
+	sp[0] = sp[-1];
+	sp[-1] = sp[-2];
+	sp[-2] = sp[0];
+	NEXT(1);
+
+op_iadd:
+	b = POP_INT();
+	a = POP_INT();
+	PUSH_INT((uint32_t) a + (uint32_t) b);
+	NEXT(1);
+
+op_ladd:
+	lb = POP_LONG();
+	la = POP_LONG();
+	PUSH_LONG((uint64_t) la + (uint64_t) lb);
+	NEXT(1);
+
+op_fadd:
+	fb = POP_FLOAT();
+	fa = POP_FLOAT();
+	PUSH_FLOAT(fa + fb);
+	NEXT(1);
+
+op_dadd:
+	db = POP_DOUBLE();
+	da = POP_DOUBLE();
+	PUSH_DOUBLE(da + db);
+	NEXT(1);
+
+op_isub:
+	b = POP_INT();
+	a = POP_INT();
+	PUSH_INT((uint32_t) a - (uint32_t) b);
+	NEXT(1);
+
+op_lsub:
+	lb = POP_LONG();
+	la = POP_LONG();
+	PUSH_LONG((uint64_t) la - (uint64_t) lb);
+	NEXT(1);
+
+op_fsub:
+	fb = POP_FLOAT();
+	fa = POP_FLOAT();
+	PUSH_FLOAT(fa - fb);
+	NEXT(1);
+
+op_dsub:
+	db = POP_DOUBLE();
+	da = POP_DOUBLE();
+	PUSH_DOUBLE(da - db);
+	NEXT(1);
+
+op_imul:
+	b = POP_INT();
+	a = POP_INT();
+	PUSH_INT((uint32_t) a * (uint32_t) b);
+	NEXT(1);
+
+op_lmul:
+	lb = POP_LONG();
+	la = POP_LONG();
+	PUSH_LONG((uint64_t) la * (uint64_t) lb);
+	NEXT(1);
+
+op_fmul:
+	fb = POP_FLOAT();
+	fa = POP_FLOAT();
+	PUSH_FLOAT(fa * fb);
+	NEXT(1);
+
+op_dmul:
+	db = POP_DOUBLE();
+	da = POP_DOUBLE();
+	PUSH_DOUBLE(da * db);
+	NEXT(1);
+
+op_idiv:
+	b = POP_INT();
+	a = POP_INT();
+	if (b == 0)
+		goto division_by_zero;
+	/* INT_MIN / -1 traps on x86 */
+	PUSH_INT(b == -1 ? (jint) -(uint32_t) a : a / b);
+	NEXT(1);
+
+op_ldiv:
+	lb = POP_LONG();
+	la = POP_LONG();
+	if (lb == 0)
+		goto division_by_zero;
+	PUSH_LONG(lb == -1 ? (jlong) -(uint64_t) la : la / lb);
+	NEXT(1);
+
+op_fdiv:
+	fb = POP_FLOAT();
+	fa = POP_FLOAT();
+	PUSH_FLOAT(fa / fb);
+	NEXT(1);
+
+op_ddiv:
+	db = POP_DOUBLE();
+	da = POP_DOUBLE();
+	PUSH_DOUBLE(da / db);
+	NEXT(1);
+
+op_irem:
+	b = POP_INT();
+	a = POP_INT();
+	if (b == 0)
+		goto division_by_zero;
+	PUSH_INT(b == -1 ? 0 : a % b);
+	NEXT(1);
+
+op_lrem:
+	lb = POP_LONG();
+	la = POP_LONG();
+	if (lb == 0)
+		goto division_by_zero;
+	PUSH_LONG(lb == -1 ? 0 : la % lb);
+	NEXT(1);
+
+op_frem:
+	fb = POP_FLOAT();
+	fa = POP_FLOAT();
+	PUSH_FLOAT(fmodf(fa, fb));
+	NEXT(1);
+
+op_drem:
+	db = POP_DOUBLE();
+	da = POP_DOUBLE();
+	PUSH_DOUBLE(fmod(da, db));
+	NEXT(1);
+
+op_ineg:
+	a = POP_INT();
+	PUSH_INT(-(uint32_t) a);
+	NEXT(1);
+
+op_lneg:
+	la = POP_LONG();
+	PUSH_LONG(-(uint64_t) la);
+	NEXT(1);
+
+op_fneg:
+	fa = POP_FLOAT();
+	PUSH_FLOAT(-fa);
+	NEXT(1);
+
+op_dneg:
+	da = POP_DOUBLE();
+	PUSH_DOUBLE(-da);
+	NEXT(1);
+
+op_ishl:
+	b = POP_INT();
+	a = POP_INT();
+	PUSH_INT((uint32_t) a << (b & 0x1f));
+	NEXT(1);
+
+op_lshl:
+	b = POP_INT();
+	la = POP_LONG();
+	PUSH_LONG((uint64_t) la << (b & 0x3f));
+	NEXT(1);
+
+op_ishr:
+	b = POP_INT();
+	a = POP_INT();
+	PUSH_INT(a >> (b & 0x1f));
+	NEXT(1);
+
+op_lshr:
+	b = POP_INT();
+	la = POP_LONG();
+	PUSH_LONG(la >> (b & 0x3f));
+	NEXT(1);
+
+op_iushr:
+	b = POP_INT();
+	a = POP_INT();
+	PUSH_INT((uint32_t) a >> (b & 0x1f));
+	NEXT(1);
+
+op_lushr:
+	b = POP_INT();
+	la = POP_LONG();
+	PUSH_LONG((uint64_t) la >> (b & 0x3f));
+	NEXT(1);
+
+op_iand:
+	b = POP_INT();
+	a = POP_INT();
+	PUSH_INT(a & b);
+	NEXT(1);
+
+op_land:
+	lb = POP_LONG();
+	la = POP_LONG();
+	PUSH_LONG(la & lb);
+	NEXT(1);
+
+op_ior:
+	b = POP_INT();
+	a = POP_INT();
+	PUSH_INT(a | b);
+	NEXT(1);
+
+op_lor:
+	lb = POP_LONG();
+	la = POP_LONG();
+	PUSH_LONG(la | lb);
+	NEXT(1);
+
+op_ixor:
+	b = POP_INT();
+	a = POP_INT();
+	PUSH_INT(a ^ b);
+	NEXT(1);
+
+op_lxor:
+	lb = POP_LONG();
+	la = POP_LONG();
+	PUSH_LONG(la ^ lb);
+	NEXT(1);
+
+op_iinc:
+	idx = code[pc + 1];
+	slot_set_int(&locals[idx], (uint32_t) slot_get_int(&locals[idx]) + (int8_t) code[pc + 2]);
+	NEXT(3);
+
+op_i2l:
+	a = POP_INT();
+	PUSH_LONG(a);
+	NEXT(1);
+
+op_i2f:
+	a = POP_INT();
+	PUSH_FLOAT(a);
+	NEXT(1);
+
+op_i2d:
+	a = POP_INT();
+	PUSH_DOUBLE(a);
+	NEXT(1);
+
+op_l2i:
+	la = POP_LONG();
+	PUSH_INT((jint) la);
+	NEXT(1);
+
+op_l2f:
+	la = POP_LONG();
+	PUSH_FLOAT(la);
+	NEXT(1);
+
+op_l2d:
+	la = POP_LONG();
+	PUSH_DOUBLE(la);
+	NEXT(1);
+
+op_f2i:
+	fa = POP_FLOAT();
+	PUSH_INT(emulate_f2i(fa));
+	NEXT(1);
+
+op_f2l:
+	fa = POP_FLOAT();
+	PUSH_LONG(emulate_f2l(fa));
+	NEXT(1);
+
+op_f2d:
+	fa = POP_FLOAT();
+	PUSH_DOUBLE(fa);
+	NEXT(1);
+
+op_d2i:
+	da = POP_DOUBLE();
+	PUSH_INT(emulate_d2i(da));
+	NEXT(1);
+
+op_d2l:
+	da = POP_DOUBLE();
+	PUSH_LONG(emulate_d2l(da));
+	NEXT(1);
+
+op_d2f:
+	da = POP_DOUBLE();
+	PUSH_FLOAT(da);
+	NEXT(1);
+
+op_i2b:
+	a = POP_INT();
+	PUSH_INT((jbyte) a);
+	NEXT(1);
+
+op_i2c:
+	a = POP_INT();
+	PUSH_INT((jchar) a);
+	NEXT(1);
+
+op_i2s:
+	a = POP_INT();
+	PUSH_INT((jshort) a);
+	NEXT(1);
+
+op_lcmp:
+	lb = POP_LONG();
+	la = POP_LONG();
+	PUSH_INT(emulate_lcmp(la, lb));
+	NEXT(1);
+
+op_fcmpl:
+	fb = POP_FLOAT();
+	fa = POP_FLOAT();
+	PUSH_INT(emulate_fcmpl(fa, fb));
+	NEXT(1);
+
+op_fcmpg:
+	fb = POP_FLOAT();
+	fa = POP_FLOAT();
+	PUSH_INT(emulate_fcmpg(fa, fb));
+	NEXT(1);
+
+op_dcmpl:
+	db = POP_DOUBLE();
+	da = POP_DOUBLE();
+	PUSH_INT(emulate_dcmpl(da, db));
+	NEXT(1);
+
+op_dcmpg:
+	db = POP_DOUBLE();
+	da = POP_DOUBLE();
+	PUSH_INT(emulate_dcmpg(da, db));
+	NEXT(1);
+
+op_ifeq:
+	if (POP_INT() == 0)
+		BRANCH(read_s16(&code[pc + 1]));
+	NEXT(3);
+
+op_ifne:
+	if (POP_INT() != 0)
+		BRANCH(read_s16(&code[pc + 1]));
+	NEXT(3);
+
+op_iflt:
+	if (POP_INT() < 0)
+		BRANCH(read_s16(&code[pc + 1]));
+	NEXT(3);
+
+op_ifge:
+	if (POP_INT() >= 0)
+		BRANCH(read_s16(&code[pc + 1]));
+	NEXT(3);
+
+op_ifgt:
+	if (POP_INT() > 0)
+		BRANCH(read_s16(&code[pc + 1]));
+	NEXT(3);
+
+op_ifle:
+	if (POP_INT() <= 0)
+		BRANCH(read_s16(&code[pc + 1]));
+	NEXT(3);
+
+op_if_icmpeq:
+	b = POP_INT();
+	a = POP_INT();
+	if (a == b)
+		BRANCH(read_s16(&code[pc + 1]));
+	NEXT(3);
+
+op_if_icmpne:
+	b = POP_INT();
+	a = POP_INT();
+	if (a != b)
+		BRANCH(read_s16(&code[pc + 1]));
+	NEXT(3);
+
+op_if_icmplt:
+	b = POP_INT();
+	a = POP_INT();
+	if (a < b)
+		BRANCH(read_s16(&code[pc + 1]));
+	NEXT(3);
+
+op_if_icmpge:
+	b = POP_INT();
+	a = POP_INT();
+	if (a >= b)
+		BRANCH(read_s16(&code[pc + 1]));
+	NEXT(3);
+
+op_if_icmpgt:
+	b = POP_INT();
+	a = POP_INT();
+	if (a > b)
+		BRANCH(read_s16(&code[pc + 1]));
+	NEXT(3);
+
+op_if_icmple:
+	b = POP_INT();
+	a = POP_INT();
+	if (a <= b)
+		BRANCH(read_s16(&code[pc + 1]));
+	NEXT(3);
+
+op_if_acmpeq:
+	obj2 = POP_REF();
+	obj = POP_REF();
+	if (obj == obj2)
+		BRANCH(read_s16(&code[pc + 1]));
+	NEXT(3);
+
+op_if_acmpne:
+	obj2 = POP_REF();
+	obj = POP_REF();
+	if (obj != obj2)
+		BRANCH(read_s16(&code[pc + 1]));
+	NEXT(3);
+
+op_ifnull:
+	if (POP_REF() == NULL)
+		BRANCH(read_s16(&code[pc + 1]));
+	NEXT(3);
+
+op_ifnonnull:
+	if (POP_REF() != NULL)
+		BRANCH(read_s16(&code[pc + 1]));
+	NEXT(3);
+
+op_goto:
+	BRANCH(read_s16(&code[pc + 1]));
+
+op_goto_w:
+	BRANCH(read_s32(&code[pc + 1]));
+
+op_jsr:
+	*sp++ = pc + 3;
+	BRANCH(read_s16(&code[pc + 1]));
+
+op_jsr_w:
+	*sp++ = pc + 5;
+	BRANCH(read_s32(&code[pc + 1]));
+
+op_ret:
+	pc = locals[code[pc + 1]];
+	DISPATCH();
+
+op_tableswitch:
+	get_tableswitch_info(code, pc, &ts);
+	a = POP_INT();
+	if (a < (int32_t) ts.low || a > (int32_t) ts.high)
+		BRANCH(ts.default_target);
+	BRANCH(read_s32(ts.targets + (a - (int32_t) ts.low) * 4));
+
+op_lookupswitch:
+	get_lookupswitch_info(code, pc, &ls);
+	a = POP_INT();
+	for (n = 0; n < ls.count; n++) {
+		if (read_lookupswitch_match(&ls, n) == a)
+			BRANCH(read_lookupswitch_target(&ls, n));
+	}
+	BRANCH(ls.default_target);
+
+op_ireturn:
+	result->i = POP_INT();
+	return;
+
+op_lreturn:
+	result->j = POP_LONG();
+	return;
+
+op_freturn:
+	result->f = POP_FLOAT();
+	return;
+
+op_dreturn:
+	result->d = POP_DOUBLE();
+	return;
+
+op_areturn:
+	result->l = POP_REF();
+	return;
+
+op_return:
+	return;
+
+op_getstatic:
+	field = vm_class_resolve_field_recursive(class, read_u16(&code[pc + 1]));
+	if (!field)
+		goto no_such_field;
+	if (vm_class_ensure_init(field->class))
+		THROW();
+	sp += interp_load(sp, vm_field_type(field), &field->class->static_values[field->offset]);
+	NEXT(3);
+
+op_putstatic:
+	field = vm_class_resolve_field_recursive(class, read_u16(&code[pc + 1]));
+	if (!field)
+		goto no_such_field;
+	if (vm_class_ensure_init(field->class))
+		THROW();
+	sp -= vm_type_is_pair(vm_field_type(field)) ? 2 : 1;
+	interp_store(&field->class->static_values[field->offset], vm_field_type(field), sp);
+	NEXT(3);
+
+op_getfield:
+	field = vm_class_resolve_field_recursive(class, read_u16(&code[pc + 1]));
+	if (!field)
+		goto no_such_field;
+	obj = POP_REF();
+	if (!obj)
+		goto null_pointer;
+	sp += interp_load(sp, vm_field_type(field), &vm_object_fields(obj)[field->offset]);
+	NEXT(3);
+
+op_putfield:
+	field = vm_class_resolve_field_recursive(class, read_u16(&code[pc + 1]));
+	if (!field)
+		goto no_such_field;
+	sp -= vm_type_is_pair(vm_field_type(field)) ? 2 : 1;
+	obj = slot_get_ref(sp - 1);
+	if (!obj)
+		goto null_pointer;
+	interp_store(&vm_object_fields(obj)[field->offset], vm_field_type(field), sp);
+	sp--;
+	NEXT(3);
+
+op_invokevirtual:
+	target = vm_class_resolve_method_recursive(class, read_u16(&code[pc + 1]), 0);
+	if (!target)
+		goto no_such_method;
+	n = vm_method_arg_slots(target) + 1;
+	obj = slot_get_ref(sp - n);
+	if (!obj)
+		goto null_pointer;
+	if (vm_method_is_virtual(target)) {
+		target = vm_class_get_virtual_method(obj->class, target);
+		if (!target)
+			goto no_such_method;
+	}
+	goto invoke;
+
+op_invokespecial:
+	target = vm_class_resolve_method_recursive(class, read_u16(&code[pc + 1]), 0);
+	if (!target)
+		goto no_such_method;
+	n = vm_method_arg_slots(target) + 1;
+	if (!slot_get_ref(sp - n))
+		goto null_pointer;
+	goto invoke;
+
+op_invokestatic:
+	target = vm_class_resolve_method_recursive(class, read_u16(&code[pc + 1]), CAFEBABE_CLASS_ACC_STATIC);
+	if (!target)
+		goto no_such_method;
+	if (vm_class_ensure_init(target->class))
+		THROW();
+	n = vm_method_arg_slots(target);
+	goto invoke;
+
+op_invokeinterface:
+	target = vm_class_resolve_interface_method_recursive(class, read_u16(&code[pc + 1]));
+	if (!target)
+		goto no_such_method;
+	n = vm_method_arg_slots(target) + 1;
+	obj = slot_get_ref(sp - n);
+	if (!obj)
+		goto null_pointer;
+	target = vm_class_get_method_recursive(obj->class, target->name, target->type);
+	if (!target)
+		goto no_such_method;
+invoke:
+	sp -= n;
+	if (!interp_invoke(target, sp, &ret))
+		THROW();
+	sp += interp_push_result(sp, target->return_type.vm_type, &ret);
+	NEXT(code[pc] == OPC_INVOKEINTERFACE ? 5 : 3);
+
+op_new:
+	vmc = vm_class_resolve_class(class, read_u16(&code[pc + 1]));
+	if (!vmc)
+		goto no_class_def;
+	if (vm_class_ensure_init(vmc))
+		THROW();
+	obj = vm_object_alloc(vmc);
+	if (!obj)
+		THROW();
+	PUSH_REF(obj);
+	NEXT(3);
+
+op_newarray:
+	a = POP_INT();
+	if (a < 0)
+		goto negative_array_size;
+	obj = vm_object_alloc_primitive_array(code[pc + 1], a);
+	if (!obj)
+		THROW();
+	PUSH_REF(obj);
+	NEXT(2);
+
+op_anewarray:
+	vmc = vm_class_resolve_class(class, read_u16(&code[pc + 1]));
+	if (!vmc)
+		goto no_class_def;
+	a = POP_INT();
+	if (a < 0)
+		goto negative_array_size;
+	obj = vm_object_alloc_array_of(vmc, a);
+	if (!obj)
+		THROW();
+	PUSH_REF(obj);
+	NEXT(3);
+
+op_multianewarray:
+	vmc = vm_class_resolve_class(class, read_u16(&code[pc + 1]));
+	if (!vmc)
+		goto no_class_def;
+	n = code[pc + 3];
+	sp -= n;
+	{
+		jint counts[n];
+
+		for (idx = 0; idx < n; idx++) {
+			counts[idx] = slot_get_int(&sp[idx]);
+			if (counts[idx] < 0)
+				goto negative_array_size;
+		}
+
+		obj = vm_object_alloc_multi_array_a(vmc, n, counts);
+	}
+	if (!obj)
+		THROW();
+	PUSH_REF(obj);
+	NEXT(4);
+
+op_arraylength:
+	obj = POP_REF();
+	if (!obj)
+		goto null_pointer;
+	PUSH_INT(vm_array_length(obj));
+	NEXT(1);
+
+op_athrow:
+	obj = POP_REF();
+	if (!obj)
+		goto null_pointer;
+	signal_exception(obj);
+	THROW();
+
+op_checkcast:
+	vmc = vm_class_resolve_class(class, read_u16(&code[pc + 1]));
+	if (!vmc)
+		goto no_class_def;
+	vm_object_check_cast(slot_get_ref(sp - 1), vmc);
+	if (exception_occurred())
+		THROW();
+	NEXT(3);
+
+op_instanceof:
+	vmc = vm_class_resolve_class(class, read_u16(&code[pc + 1]));
+	if (!vmc)
+		goto no_class_def;
+	obj = POP_REF();
+	PUSH_INT(vm_object_is_instance_of(obj, vmc));
+	NEXT(3);
+
+op_monitorenter:
+	obj = POP_REF();
+	if (!obj)
+		goto null_pointer;
+	if (vm_object_lock(obj))
+		THROW();
+	NEXT(1);
+
+op_monitorexit:
+	obj = POP_REF();
+	if (!obj)
+		goto null_pointer;
+	if (vm_object_unlock(obj))
+		THROW();
+	NEXT(1);
+
+op_wide:
+	idx = read_u16(&code[pc + 2]);
+
+	switch (code[pc + 1]) {
+	case OPC_ILOAD:
+	case OPC_FLOAD:
+	case OPC_ALOAD:
+		*sp++ = locals[idx];
+		break;
+	case OPC_LLOAD:
+	case OPC_DLOAD:
+		sp[0] = locals[idx];
+		sp[1] = locals[idx + 1];
+		sp += 2;
+		break;
+	case OPC_ISTORE:
+	case OPC_FSTORE:
+	case OPC_ASTORE:
+		locals[idx] = *--sp;
+		break;
+	case OPC_LSTORE:
+	case OPC_DSTORE:
+		sp -= 2;
+		locals[idx] = sp[0];
+		locals[idx + 1] = sp[1];
+		break;
+	case OPC_IINC:
+		slot_set_int(&locals[idx], (uint32_t) slot_get_int(&locals[idx]) + read_s16(&code[pc + 4]));
+		NEXT(6);
+	case OPC_RET:
+		pc = locals[idx];
+		DISPATCH();
+	default:
+		goto op_invalid;
+	}
+	NEXT(4);
+
+op_invalid:
+	signal_new_exception(vm_java_lang_VerifyError, "invalid bytecode %d", code[pc]);
+	THROW();
+
+division_by_zero:
+	signal_new_exception(vm_java_lang_ArithmeticException, "division by zero");
+	THROW();
+
+negative_array_size:
+	signal_new_exception(vm_java_lang_NegativeArraySizeException, NULL);
+	THROW();
+
+null_pointer:
+	throw_npe();
+	THROW();
+
+no_such_field:
+	interp_signal_error(vm_java_lang_NoSuchFieldError);
+	THROW();
+
+no_such_method:
+	interp_signal_error(vm_java_lang_NoSuchMethodError);
+	THROW();
+
+no_class_def:
+	interp_signal_error(vm_java_lang_NoClassDefFoundError);
+	THROW();
+
+exception:
+	obj = exception_occurred();
+	assert(obj != NULL);
+
+	handler = interp_find_handler(method, pc, obj);
+	if (handler < 0)
+		return;
+
+	clear_exception();
+
+	sp = stack;
+	PUSH_REF(obj);
+	pc = handler;
+	DISPATCH();
+}
+
+void vm_interp_method_a(struct vm_method *method, unsigned long *args, union jvalue *result)
+{
+	unsigned long nr_args = vm_method_arg_slots(method) + !vm_method_is_static(method);
+	unsigned long locals[method->code_attribute.max_locals + 1];
+	unsigned long stack[method->code_attribute.max_stack + 2];
+	struct vm_object *lock = NULL;
+
+	assert(!vm_method_is_native(method) && !vm_method_is_abstract(method));
+
+	memcpy(locals, args, nr_args * sizeof(unsigned long));
+
+	if (vm_method_is_synchronized(method)) {
+		if (!vm_method_is_static(method))
+			lock = slot_get_ref(&locals[0]);
+		else if (!vm_class_ensure_object(method->class))
+			lock = method->class->object;
+		else
 			return;
 
-		pc++;
+		if (vm_object_lock(lock))
+			return;
 	}
+
+	interp(method, locals, stack, result);
+
+	if (lock)
+		vm_object_unlock(lock);
+}
+
+void vm_interp_method_v(struct vm_method *method, va_list args, union jvalue *result)
+{
+	unsigned long args_array[method->args_count];
+
+	for (int i = 0; i < method->args_count; i++)
+		args_array[i] = va_arg(args, unsigned long);
+
+	vm_interp_method_a(method, args_array, result);
 }
@@ -19,6 +19,7 @@
 #include "vm/classloader.h"
 #include "vm/die.h"
 #include "vm/errors.h"
+#include "vm/gc.h"
 #include "vm/jni.h"
 #include "vm/method.h"
 #include "vm/object.h"
@@ -1234,14 +1235,37 @@ DECLARE_NEW_XXX_ARRAY(long, Long, T_LONG);
 DECLARE_NEW_XXX_ARRAY(float, Float, T_FLOAT);
 DECLARE_NEW_XXX_ARRAY(double, Double, T_DOUBLE);
 
+/*
+ * Primitive array elements are handed to native code as a direct pointer to
+ * the array body. The array is pinned until the elements are released so
+ * that it stays alive even if native code drops its reference to it.
+ */
+static void *get_array_elements(jobject array, jboolean *isCopy)
+{
+	if (gc_pin_object(array))
+		return throw_oom_error();
+
+	if (isCopy)
+		*isCopy = JNI_FALSE;
+
+	return vm_array_elems(array);
+}
+
+static void release_array_elements(jobject array, void *elems, jint mode)
+{
+	/* The elements are the array body so there is nothing to copy back. */
+	if (mode == JNI_COMMIT)
+		return;
+
+	gc_unpin_object(array);
+}
+
 // FIXME: the jobject array type should be j<primitive type>Array
 #define DECLARE_GET_XXX_ARRAY_ELEMENTS(type, typename)				\
 static j ## type * JNI_Get ## typename ## ArrayElements(JNIEnv *env,		\
 				       jobject array,			\
 				       jboolean *isCopy)		\
 {									\
-	j ## type *result;						\
-									\
 	enter_vm_from_jni();						\
 									\
 	if (!vm_class_is_array_class(array->class) ||			\
@@ -1249,17 +1273,7 @@ static j ## type * JNI_Get ## typename ## ArrayElements(JNIEnv *env,		\
 	    != vm_ ## type ## _class)					\
 		return NULL;						\
 									\
-	result = malloc(sizeof(j ## type) * vm_array_length(array));	\
-	if (!result)							\
-		return NULL;						\
-									\
-	for (long i = 0; i < vm_array_length(array); i++)		\
-		result[i] = array_get_field_##type(array, i);		\
-									\
-	if (isCopy)							\
-		*isCopy = JNI_TRUE;					\
-									\
-	return result;							\
+	return get_array_elements(array, isCopy);			\
 }
 
 DECLARE_GET_XXX_ARRAY_ELEMENTS(boolean, Boolean);
@@ -1284,13 +1298,7 @@ static void JNI_Release ## typename ## ArrayElements(JNIEnv *env,	\
 	    != vm_ ## type ## _class)					\
 		return;							\
 									\
-	if (mode == 0 || mode == JNI_COMMIT) { /* copy back */		\
-		for (long i = 0; i < vm_array_length(array); i++)	\
-			array_set_field_ ## type(array, i, elems[i]);	\
-	}								\
-									\
-	if (mode == JNI_ABORT) /* free buffer */			\
-		free(elems);						\
+	release_array_elements(array, elems, mode);			\
 }
 
 DECLARE_RELEASE_XXX_ARRAY_ELEMENTS(boolean, Boolean);
@@ -1426,47 +1434,6 @@ static void JNI_GetStringUTFRegion(JNIEnv *env, jstring str, jsize start, jsize
 	return;
 }
 
-#define DECLARE_GET_XXX_ARRAY_CRITICAL(type)				\
-static void *								\
-get_ ## type ## _array_critical (jobject array, jboolean *is_copy)	\
-{									\
-	j ## type *result;						\
-									\
-	result = malloc(sizeof(j ## type) * vm_array_length(array));	\
-	if (!result)							\
-		return NULL;						\
-									\
-	for (long i = 0; i < vm_array_length(array); i++)		\
-		result[i] = array_get_field_##type(array, i);		\
-									\
-	if (is_copy)							\
-		*is_copy = JNI_TRUE;					\
-									\
-	return result;							\
-}
-
-DECLARE_GET_XXX_ARRAY_CRITICAL(byte);
-DECLARE_GET_XXX_ARRAY_CRITICAL(char);
-DECLARE_GET_XXX_ARRAY_CRITICAL(double);
-DECLARE_GET_XXX_ARRAY_CRITICAL(float);
-DECLARE_GET_XXX_ARRAY_CRITICAL(int);
-DECLARE_GET_XXX_ARRAY_CRITICAL(long);
-DECLARE_GET_XXX_ARRAY_CRITICAL(short);
-DECLARE_GET_XXX_ARRAY_CRITICAL(boolean);
-
-typedef void *get_array_critical_fn(jobject array, jboolean *is_copy);
-
-get_array_critical_fn *get_array_critical_fns[] = {
-	[J_BYTE]	= get_byte_array_critical,
-	[J_CHAR]	= get_char_array_critical,
-	[J_DOUBLE]	= get_double_array_critical,
-	[J_FLOAT]	= get_float_array_critical,
-	[J_INT]		= get_int_array_critical,
-	[J_LONG]	= get_long_array_critical,
-	[J_SHORT]	= get_short_array_critical,
-	[J_BOOLEAN]	= get_boolean_array_critical
-};
-
 static void * JNI_GetPrimitiveArrayCritical(JNIEnv *env, jarray array, jboolean *isCopy)
 {
 	enter_vm_from_jni();
@@ -1483,51 +1450,9 @@ static void * JNI_GetPrimitiveArrayCritical(JNIEnv *env, jarray array, jboolean
 	if (!vm_class_is_primitive_class(elem_class))
 		return NULL;
 
-	enum vm_type elem_type
-		= vm_class_get_storage_vmtype(elem_class);
-
-	get_array_critical_fn *get_array_critical
-		= get_array_critical_fns[elem_type];
-
-	assert(get_array_critical);
-	return get_array_critical(array, isCopy);
+	return get_array_elements(array, isCopy);
 }
 
-#define DECLARE_RELEASE_XXX_ARRAY_CRITICAL(type)			\
-static void								\
-release_ ## type ## _array_critical (jobject array, j ## type *elems, jint mode) \
-{									\
-	if (mode == 0 || mode == JNI_COMMIT) { /* copy back */		\
-		for (long i = 0; i < vm_array_length(array); i++)	\
-			array_set_field_ ## type(array, i, elems[i]);	\
-	}								\
-									\
-	if (mode == JNI_ABORT) /* free buffer */			\
-		free(elems);						\
-}
-
-DECLARE_RELEASE_XXX_ARRAY_CRITICAL(byte);
-DECLARE_RELEASE_XXX_ARRAY_CRITICAL(char);
-DECLARE_RELEASE_XXX_ARRAY_CRITICAL(double);
-DECLARE_RELEASE_XXX_ARRAY_CRITICAL(float);
-DECLARE_RELEASE_XXX_ARRAY_CRITICAL(int);
-DECLARE_RELEASE_XXX_ARRAY_CRITICAL(long);
-DECLARE_RELEASE_XXX_ARRAY_CRITICAL(short);
-DECLARE_RELEASE_XXX_ARRAY_CRITICAL(boolean);
-
-typedef void release_array_critical_fn(jobject array, void *carray, jint mode);
-
-release_array_critical_fn *release_array_critical_fns[] = {
-	[J_BYTE]	= (release_array_critical_fn*) release_byte_array_critical,
-	[J_CHAR]	= (release_array_critical_fn*) release_char_array_critical,
-	[J_DOUBLE]	= (release_array_critical_fn*) release_double_array_critical,
-	[J_FLOAT]	= (release_array_critical_fn*) release_float_array_critical,
-	[J_INT]		= (release_array_critical_fn*) release_int_array_critical,
-	[J_LONG]	= (release_array_critical_fn*) release_long_array_critical,
-	[J_SHORT]	= (release_array_critical_fn*) release_short_array_critical,
-	[J_BOOLEAN]	= (release_array_critical_fn*) release_boolean_array_critical
-};
-
 // FIXME: the jobject array should be jarray array
 static void JNI_ReleasePrimitiveArrayCritical(JNIEnv *env, jobject array, void *carray, jint mode)
 {
@@ -1545,14 +1470,7 @@ static void JNI_ReleasePrimitiveArrayCritical(JNIEnv *env, jobject array, void *
 	if (!vm_class_is_primitive_class(elem_class))
 		return;
 
-	enum vm_type elem_type
-		= vm_class_get_storage_vmtype(elem_class);
-
-	release_array_critical_fn *release_array_critical
-		= release_array_critical_fns[elem_type];
-
-	assert(release_array_critical);
-	release_array_critical(array, carray, mode);
+	release_array_elements(array, carray, mode);
 }
 
 static const jchar * JNI_GetStringCritical(JNIEnv *env, jstring string, jboolean *isCopy)
@@ -18,7 +18,7 @@
 #include "vm/stack-trace.h"
 #include "vm/gc.h"
 
-#include "lib/hash-map.h"
+#include "lib/concurrent-hash-map.h"
 #include "lib/string.h"
 
 struct jni_object {
@@ -26,7 +26,7 @@ struct jni_object {
 	struct vm_object *classloader;
 };
 
-struct hash_map *jni_objects;
+struct concurrent_hash_map *jni_objects;
 
 static char *vm_jni_get_mangled_name(const char *name)
 {
@@ -72,9 +72,9 @@ static char *vm_jni_get_mangled_name(const char *name)
 
 static int vm_jni_add_object(void *handle, struct vm_object *classloader)
 {
-	struct jni_object *object;
+	struct jni_object *object, *old;
 
-	if (hash_map_contains(jni_objects, handle))
+	if (concurrent_hash_map_get(jni_objects, handle))
 		return 0;
 
 	object = malloc(sizeof(*object));
@@ -84,17 +84,20 @@ static int vm_jni_add_object(void *handle, struct vm_object *classloader)
 	object->handle = handle;
 	object->classloader = classloader;
 
-	if (hash_map_put(jni_objects, handle, object)) {
+	if (concurrent_hash_map_put_if_absent(jni_objects, handle, object, (void **) &old)) {
 		free(object);
 		return -1;
 	}
 
+	if (old)
+		free(object);
+
 	return 0;
 }
 
 void vm_jni_init(void)
 {
-	jni_objects = alloc_hash_map(&pointer_key);
+	jni_objects = alloc_concurrent_hash_map(&pointer_key);
 	if (!jni_objects)
 		error("failed to create jni_objects hash map");
 }
@@ -130,9 +133,9 @@ int vm_jni_load_object(const char *name, struct vm_object *classloader)
 
 static void *vm_jni_lookup_symbol(const char *symbol_name)
 {
-	struct hash_map_entry *this;
+	struct concurrent_hash_map_entry *this;
 
-	hash_map_for_each_entry(this, jni_objects) {
+	concurrent_hash_map_for_each_entry(this, jni_objects) {
 		struct jni_object *object;
 		void *addr;
 
@@ -43,20 +43,13 @@ unsigned int vm_method_arg_stack_count(struct vm_method *vmm)
 /* Returns the method vmm is overriding or NULL. */
 struct vm_method *vm_method_get_overridden(struct vm_method *vmm)
 {
-	unsigned int i;
 	struct vm_class *super;
 
 	super = vmm->class->super;
 	if (!super)
 		return NULL;
 
-	for (i = 0; i < super->nr_methods; i++) {
-		if (!strcmp(super->methods[i].name, vmm->name)
-			&& !strcmp(super->methods[i].type, vmm->type))
-			return &super->methods[i];
-	}
-
-	return NULL;
+	return vm_class_get_method(super, vmm->name, vmm->type);
 }
 
 static void init_abstract_method(struct vm_method *vmm)
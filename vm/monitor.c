@@ -7,6 +7,7 @@
 
 #include <errno.h>
 #include <pthread.h>
+#include <unistd.h>
 
 #include "arch/memory.h"
 #include "arch/atomic.h"
@@ -19,6 +20,83 @@
 #include "vm/errors.h"
 #include "vm/class.h"
 
+bool opt_use_thin_locks = true;
+bool opt_use_spinning = true;
+
+/*
+ * Bounds of the number of spin iterations before a contending thread
+ * blocks. The limit of a monitor record is doubled when spinning acquires
+ * the monitor and halved when it doesn't so that monitors with short
+ * critical sections are spun on and monitors with long ones are not.
+ */
+#define SPIN_LIMIT_MIN		16
+#define SPIN_LIMIT_INITIAL	512
+#define SPIN_LIMIT_MAX		16384
+
+__thread unsigned long thin_lock_word;
+
+/*
+ * Maps thin lock ids to the execution environments that hold them. Ids
+ * are handed out and recycled under thin_lock_ids_mutex. The same mutex
+ * is held while a thin lock is inflated on behalf of its owner so that the
+ * id in the lock word can't be given to another thread in the meantime.
+ */
+static struct vm_exec_env *thin_lock_owners[THIN_LOCK_MAX_ID + 1];
+static uint16_t free_thin_lock_ids[THIN_LOCK_MAX_ID];
+static unsigned int nr_free_thin_lock_ids;
+static unsigned int next_thin_lock_id = 1;
+static pthread_mutex_t thin_lock_ids_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+int vm_monitor_alloc_thin_lock_id(struct vm_exec_env *ee)
+{
+	unsigned int id;
+
+	pthread_mutex_lock(&thin_lock_ids_mutex);
+
+	if (nr_free_thin_lock_ids > 0)
+		id = free_thin_lock_ids[--nr_free_thin_lock_ids];
+	else if (next_thin_lock_id <= THIN_LOCK_MAX_ID)
+		id = next_thin_lock_id++;
+	else {
+		pthread_mutex_unlock(&thin_lock_ids_mutex);
+		return -ENOMEM;
+	}
+
+	thin_lock_owners[id]	= ee;
+	ee->thin_lock_word	= ((unsigned long) id << THIN_LOCK_ID_SHIFT) | THIN_LOCK_BIT;
+
+	pthread_mutex_unlock(&thin_lock_ids_mutex);
+
+	return 0;
+}
+
+void vm_monitor_free_thin_lock_id(struct vm_exec_env *ee)
+{
+	unsigned int id = ee->thin_lock_word >> THIN_LOCK_ID_SHIFT;
+
+	pthread_mutex_lock(&thin_lock_ids_mutex);
+
+	thin_lock_owners[id] = NULL;
+	free_thin_lock_ids[nr_free_thin_lock_ids++] = id;
+
+	pthread_mutex_unlock(&thin_lock_ids_mutex);
+}
+
+static inline bool is_thin_lock(unsigned long word)
+{
+	return word & THIN_LOCK_BIT;
+}
+
+static inline unsigned long thin_lock_count(unsigned long word)
+{
+	return (word & THIN_LOCK_COUNT_MASK) >> THIN_LOCK_COUNT_SHIFT;
+}
+
+static inline bool thin_lock_is_owned(unsigned long word)
+{
+	return (word & ~THIN_LOCK_COUNT_MASK) == thin_lock_word;
+}
+
 /*
  * Get new monitor record with .owner set to the current execution
  * environment and .lock_count set to 1.
@@ -35,6 +113,10 @@ static struct vm_monitor_record *get_monitor_record(void)
 				       struct vm_monitor_record,
 				       ee_free_list_node);
 		list_del(&record->ee_free_list_node);
+
+		record->owner		= ee;
+		record->lock_count	= 1;
+		record->spin_limit	= SPIN_LIMIT_INITIAL;
 		return record;
 	}
 
@@ -44,6 +126,7 @@ static struct vm_monitor_record *get_monitor_record(void)
 
 	record->owner		= ee;
 	record->lock_count	= 1;
+	record->spin_limit	= SPIN_LIMIT_INITIAL;
 
 	atomic_set(&record->nr_blocked, 0);
 	atomic_set(&record->nr_waiting, 0);
@@ -83,6 +166,85 @@ static inline void wake_one(struct vm_monitor_record *record)
 	}
 }
 
+/*
+ * Spinning only makes sense if the owner can run at the same time.
+ */
+static bool spinning_enabled(void)
+{
+	static long nr_cpus;
+
+	if (!opt_use_spinning)
+		return false;
+
+	if (!nr_cpus)
+		nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return nr_cpus > 1;
+}
+
+/*
+ * Spins until the owner releases @record and tries to take it over.
+ * Returns true if the current thread became the owner. The caller must be
+ * counted in .nr_blocked so that the record is not deflated and reused
+ * under us.
+ */
+static bool spin_acquire(struct vm_object *object, struct vm_monitor_record *record,
+			 struct vm_exec_env *ee)
+{
+	int limit = record->spin_limit;
+
+	for (int i = 0; i < limit; i++) {
+		if (object->monitor_record != record)
+			return false;
+
+		if (!record->owner && !cmpxchg_ptr(&record->owner, NULL, ee)) {
+			if (limit < SPIN_LIMIT_MAX)
+				record->spin_limit = limit * 2;
+
+			return true;
+		}
+
+		cpu_relax();
+	}
+
+	if (limit > SPIN_LIMIT_MIN)
+		record->spin_limit = limit / 2;
+
+	return false;
+}
+
+/*
+ * Spins until a thin lock is released. Returns true if it was released
+ * before the spin limit was reached so that the caller can retry without
+ * inflating the lock.
+ */
+static bool spin_thin_lock(struct vm_object *object, unsigned long word)
+{
+	for (int i = 0; i < SPIN_LIMIT_INITIAL; i++) {
+		if ((unsigned long) object->monitor_record != word)
+			return true;
+
+		cpu_relax();
+	}
+
+	return false;
+}
+
+/*
+ * Called when a thread that is counted in .nr_blocked becomes the owner.
+ * wake_one() wakes only one of the threads that sleep on the semaphore
+ * and clears .candidate so make sure that the next unlock wakes another
+ * one if there are any left.
+ */
+static inline void contended_acquire(struct vm_monitor_record *record)
+{
+	if (atomic_read(&record->nr_blocked) > 1)
+		atomic_set(&record->candidate, 1);
+
+	atomic_dec(&record->nr_blocked);
+	record->lock_count = 1;
+}
+
 /*
  * Block current thread on monitor
  */
@@ -98,6 +260,7 @@ static inline
 int owner_check(struct vm_object *object, struct vm_monitor_record **record_p)
 {
 	struct vm_monitor_record *record;
+	unsigned long word;
 
 	/*
 	 * Both atomic_read() calls do not need a memory barrier.
@@ -106,8 +269,9 @@ int owner_check(struct vm_object *object, struct vm_monitor_record **record_p)
 	 * those values were set by this thread.
 	 */
 
-	record	= object->monitor_record;
-	if (record && record->owner == vm_get_exec_env()) {
+	word	= (unsigned long) object->monitor_record;
+	record	= (struct vm_monitor_record *) word;
+	if (word && !is_thin_lock(word) && record->owner == vm_get_exec_env()) {
 		*record_p = record;
 		return 0;
 	}
@@ -116,6 +280,54 @@ int owner_check(struct vm_object *object, struct vm_monitor_record **record_p)
 	return -1;
 }
 
+/*
+ * Replaces the thin lock @word in the header of @object with a monitor
+ * record that is owned by the thread that holds the thin lock. Nothing is
+ * done if the lock word has changed in the meantime.
+ */
+static int inflate(struct vm_object *object, unsigned long word)
+{
+	struct vm_monitor_record *record;
+
+	record = get_monitor_record();
+	if (!record)
+		return -1;
+
+	pthread_mutex_lock(&thin_lock_ids_mutex);
+
+	record->owner		= thin_lock_owners[word >> THIN_LOCK_ID_SHIFT];
+	record->lock_count	= thin_lock_count(word) + 1;
+
+	/* The record is published with a full barrier. */
+	if (cmpxchg_ptr(&object->monitor_record, (void *) word, record) == (void *) word) {
+		pthread_mutex_unlock(&thin_lock_ids_mutex);
+		return 0;
+	}
+
+	pthread_mutex_unlock(&thin_lock_ids_mutex);
+
+	put_monitor_record(record);
+	return 0;
+}
+
+/*
+ * Inflates the thin lock on @object if it is held by the current thread.
+ */
+static int inflate_owned(struct vm_object *object)
+{
+	unsigned long word;
+
+	for (;;) {
+		word = (unsigned long) object->monitor_record;
+
+		if (!is_thin_lock(word) || !thin_lock_is_owned(word))
+			return 0;
+
+		if (inflate(object, word))
+			return -1;
+	}
+}
+
 /*
  * Acquire the lock on object's monitor. This implementation uses
  * relaxed-locking protocol based on David Dice's work: "Implementing
@@ -127,11 +339,48 @@ int vm_object_lock(struct vm_object *self)
 {
 	struct vm_monitor_record *old_record;
 	struct vm_exec_env *ee;
+	unsigned long word;
 
 	ee = vm_get_exec_env();
 
 	while (true) {
-		old_record	= self->monitor_record;
+		word		= (unsigned long) self->monitor_record;
+		old_record	= (struct vm_monitor_record *) word;
+
+		if (!word && opt_use_thin_locks) {
+			if (!cmpxchg_ptr(&self->monitor_record, NULL, (void *) thin_lock_word))
+				return 0;
+
+			continue;
+		}
+
+		if (is_thin_lock(word)) {
+			if (thin_lock_is_owned(word) &&
+			    (word & THIN_LOCK_COUNT_MASK) != THIN_LOCK_COUNT_MASK) {
+				unsigned long new_word = word + THIN_LOCK_COUNT_ONE;
+
+				if (cmpxchg_ptr(&self->monitor_record, (void *) word, (void *) new_word) == (void *) word)
+					return 0;
+
+				continue;
+			}
+
+			/*
+			 * Contended or the recursion count would overflow.
+			 * Short critical sections are waited out, otherwise
+			 * inflate the lock and go through the slow path.
+			 */
+			if (!thin_lock_is_owned(word) && spinning_enabled() &&
+			    spin_thin_lock(self, word))
+				continue;
+
+			if (inflate(self, word)) {
+				throw_oom_error();
+				return -1;
+			}
+
+			continue;
+		}
 
 		if (!old_record) {
 			struct vm_monitor_record *record = get_monitor_record();
@@ -167,6 +416,18 @@ int vm_object_lock(struct vm_object *self)
 
 		while (self->monitor_record == old_record) {
 
+			/*
+			 * Critical sections are often short so spin a
+			 * while before blocking.
+			 */
+			if (spinning_enabled() && spin_acquire(self, old_record, ee)) {
+				contended_acquire(old_record);
+				return 0;
+			}
+
+			if (self->monitor_record != old_record)
+				break;
+
 			/*
 			 * The unlocking thread checks for it in
 			 * wake_one() and if it is not set then it
@@ -182,8 +443,7 @@ int vm_object_lock(struct vm_object *self)
 			atomic_set(&old_record->candidate, 1);
 
 			if (!cmpxchg_ptr(&old_record->owner, NULL, ee)) {
-				atomic_dec(&old_record->nr_blocked);
-				old_record->lock_count = 1;
+				contended_acquire(old_record);
 				return 0;
 			}
 
@@ -209,6 +469,30 @@ int vm_object_lock(struct vm_object *self)
 int vm_object_unlock(struct vm_object *self)
 {
 	struct vm_monitor_record *record;
+	unsigned long word;
+
+	word = (unsigned long) self->monitor_record;
+
+	while (is_thin_lock(word)) {
+		unsigned long new_word, old_word;
+
+		if (!thin_lock_is_owned(word)) {
+			signal_new_exception(vm_java_lang_IllegalMonitorStateException, NULL);
+			return -1;
+		}
+
+		if (thin_lock_count(word))
+			new_word = word - THIN_LOCK_COUNT_ONE;
+		else
+			new_word = 0;
+
+		/* Fails only if another thread inflated the lock. */
+		old_word = (unsigned long) cmpxchg_ptr(&self->monitor_record, (void *) word, (void *) new_word);
+		if (old_word == word)
+			return 0;
+
+		word = old_word;
+	}
 
 	if (owner_check(self, &record))
 		return -1;
@@ -289,6 +573,12 @@ static int vm_object_do_wait(struct vm_object *self, struct timespec *timespec)
 	int old_lock_count;
 	int err;
 
+	/* Waiting needs the notify queue of a monitor record. */
+	if (inflate_owned(self)) {
+		throw_oom_error();
+		return -1;
+	}
+
 	if (owner_check(self, &record))
 		return -1;
 
@@ -376,10 +666,24 @@ int vm_object_wait(struct vm_object *self)
 	return vm_object_do_wait(self, NULL);
 }
 
+/*
+ * Returns true if the current thread holds a thin lock on @object. A
+ * thread can only wait on an inflated lock so there is nobody to notify.
+ */
+static bool thin_lock_is_held(struct vm_object *object)
+{
+	unsigned long word = (unsigned long) object->monitor_record;
+
+	return is_thin_lock(word) && thin_lock_is_owned(word);
+}
+
 int vm_object_notify(struct vm_object *self)
 {
 	struct vm_monitor_record *record;
 
+	if (thin_lock_is_held(self))
+		return 0;
+
 	if (owner_check(self, &record))
 		return -1;
 
@@ -394,6 +698,9 @@ int vm_object_notify_all(struct vm_object *self)
 {
 	struct vm_monitor_record *record;
 
+	if (thin_lock_is_held(self))
+		return 0;
+
 	if (owner_check(self, &record)) {
 		signal_new_exception(vm_java_lang_IllegalMonitorStateException, NULL);
 		return -1;
@@ -7,6 +7,7 @@
 #include "vm/errors.h"
 #include "vm/stdlib.h"
 #include "vm/string.h"
+#include "vm/tlab.h"
 #include "vm/class.h"
 #include "vm/types.h"
 #include "vm/call.h"
@@ -65,7 +66,7 @@ struct vm_object *vm_object_alloc(struct vm_class *class)
 	if (vm_class_ensure_init(class))
 		return rethrow_exception();
 
-	res = gc_alloc(sizeof(*res) + class->object_size);
+	res = tlab_alloc(sizeof(*res) + class->object_size);
 	if (!res)
 		return throw_oom_error();
 
@@ -79,7 +80,7 @@ struct vm_object *vm_object_alloc_array_raw(struct vm_class *class, size_t elem_
 {
 	struct vm_array *ret;
 
-	ret = gc_alloc(sizeof(*ret) + elem_size * count);
+	ret = tlab_alloc(sizeof(*ret) + elem_size * count);
 	if (!ret)
 		return throw_oom_error();
 
@@ -94,12 +95,23 @@ struct vm_object *vm_object_alloc_array_raw(struct vm_class *class, size_t elem_
 struct vm_object *vm_object_alloc_primitive_array(int type, int count)
 {
 	struct vm_array *res;
+	size_t size;
 	int vm_type;
 
 	vm_type = bytecode_type_to_vmtype(type);
 	assert(vm_type != J_VOID);
 
-	res = gc_alloc_noscan(sizeof(*res) + vmtype_get_size(vm_type) * count);
+	size = sizeof(*res) + vmtype_get_size(vm_type) * count;
+
+	/*
+	 * Small arrays are allocated from the thread-local allocation buffer
+	 * like objects are. The GC scans them but that's cheap for arrays of
+	 * this size.
+	 */
+	if (tlab_enabled() && size <= TLAB_MAX_SIZE)
+		res = tlab_alloc(size);
+	else
+		res = gc_alloc_noscan(size);
 	if (!res)
 		return throw_oom_error();
 
@@ -145,8 +157,8 @@ struct vm_object *vm_object_alloc_primitive_array(int type, int count)
 	return &res->object;
 }
 
-static struct vm_object *
-do_vm_object_alloc_multi_array(struct vm_class *class, int nr_dimensions, va_list ap)
+struct vm_object *
+vm_object_alloc_multi_array_a(struct vm_class *class, int nr_dimensions, const jint *counts)
 {
 	struct vm_class *elem_class;
 	struct vm_array *res;
@@ -161,7 +173,7 @@ do_vm_object_alloc_multi_array(struct vm_class *class, int nr_dimensions, va_lis
 	elem_class = vm_class_get_array_element_class(class);
 	elem_size  = vmtype_get_size(vm_class_get_storage_vmtype(elem_class));
 
-	len = va_arg(ap, int);
+	len = counts[0];
 
 	if (len < 0) {
 		signal_new_exception(vm_java_lang_NegativeArraySizeException, NULL);
@@ -182,11 +194,9 @@ do_vm_object_alloc_multi_array(struct vm_class *class, int nr_dimensions, va_lis
 
 	struct vm_object **elems = vm_array_elems(&res->object);
 	for (int i = 0; i < res->array_length; ++i) {
-		va_list dup_ap;
-
-		va_copy(dup_ap, ap);
-
-		elems[i] = do_vm_object_alloc_multi_array(elem_class, nr_dimensions - 1, dup_ap);
+		elems[i] = vm_object_alloc_multi_array_a(elem_class, nr_dimensions - 1, counts + 1);
+		if (!elems[i])
+			return NULL;
 	}
 
 	return &res->object;
@@ -195,15 +205,17 @@ do_vm_object_alloc_multi_array(struct vm_class *class, int nr_dimensions, va_lis
 struct vm_object *
 vm_object_alloc_multi_array(struct vm_class *class, int nr_dimensions, ...)
 {
-	va_list ap, dup_ap;
+	jint counts[nr_dimensions];
+	va_list ap;
 
 	va_start(ap, nr_dimensions);
 
-	va_copy(dup_ap, ap);
+	for (int i = 0; i < nr_dimensions; i++)
+		counts[i] = va_arg(ap, int);
 
 	va_end(ap);
 
-	return do_vm_object_alloc_multi_array(class, nr_dimensions, ap);
+	return vm_object_alloc_multi_array_a(class, nr_dimensions, counts);
 }
 
 struct vm_object *vm_object_alloc_array(struct vm_class *class, int count)
@@ -213,7 +225,7 @@ struct vm_object *vm_object_alloc_array(struct vm_class *class, int count)
 	if (vm_class_ensure_init(class))
 		return rethrow_exception();
 
-	res = gc_alloc(sizeof(*res) + sizeof(struct vm_object *) * count);
+	res = tlab_alloc(sizeof(*res) + sizeof(struct vm_object *) * count);
 	if (!res)
 		return throw_oom_error();
 
@@ -6,14 +6,17 @@
  * file LICENSE for details.
  */
 
+#include <pthread.h>
 #include <stdio.h>
 
 #include "vm/die.h"
 #include "vm/classloader.h"
 #include "vm/natives.h"
 #include "vm/preload.h"
+#include "vm/thread.h"
 #include "vm/class.h"
 
+#include "jit/intrinsics.h"
 #include "jit/cu-mapping.h"
 
 enum {
@@ -137,29 +140,145 @@ static struct vm_method **native_override_entries[] = {
 	&vm_java_lang_VMString_intern,
 };
 
+/*
+ * Methods in this table are replaced with VM natives only when intrinsics
+ * are enabled. See "jit/intrinsics.h".
+ */
+static struct vm_method **intrinsic_override_entries[] = {
+	&vm_java_lang_String_equals,
+	&vm_java_lang_String_hashCode,
+	&vm_java_lang_String_indexOf_II,
+};
+
 bool preload_finished;
 
+/* Number of threads that load the preloaded classes (-Xclassload:threads=) */
+unsigned int preload_nr_threads = 1;
+
 int nr_class_fixups;
 struct vm_class **class_fixups;
 
+static pthread_mutex_t class_fixups_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 int vm_preload_add_class_fixup(struct vm_class *vmc)
 {
-	int new_size = sizeof(struct vm_class *) * (nr_class_fixups + 1);
-	struct vm_class **new_array = realloc(class_fixups, new_size);
+	struct vm_class **new_array;
+	int err = 0;
+
+	pthread_mutex_lock(&class_fixups_mutex);
 
-	if (!new_array)
-		return -ENOMEM;
+	new_array = realloc(class_fixups, sizeof(struct vm_class *) * (nr_class_fixups + 1));
+	if (!new_array) {
+		err = -ENOMEM;
+		goto out_unlock;
+	}
 
 	class_fixups = new_array;
 	class_fixups[nr_class_fixups++] = vmc;
+
+ out_unlock:
+	pthread_mutex_unlock(&class_fixups_mutex);
+
+	return err;
+}
+
+/*
+ * With more than one preload thread, the classes in preload_entries are
+ * loaded and linked by a pool of threads that take the next entry from the
+ * list until it is empty. A class that is needed by several threads, such as
+ * a common superclass, is loaded by the first thread that asks for it while
+ * the others wait for it in the class loader. Array classes are linked
+ * against java/lang/Object and java/lang/Cloneable so they are left for
+ * preload_vm_classes() to load after the pool has finished. Nothing is
+ * allocated from the garbage collected heap before preloading has finished
+ * so the threads don't need to take part in collections.
+ */
+static unsigned int preload_next_entry;
+static pthread_mutex_t preload_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void preload_classes(void)
+{
+	for (;;) {
+		const struct preload_entry *pe;
+		unsigned int i;
+
+		pthread_mutex_lock(&preload_mutex);
+		i = preload_next_entry++;
+		pthread_mutex_unlock(&preload_mutex);
+
+		if (i >= ARRAY_SIZE(preload_entries))
+			break;
+
+		pe = &preload_entries[i];
+		if (pe->name[0] == '[')
+			continue;
+
+		*pe->class = classloader_load(NULL, pe->name);
+	}
+}
+
+static void *preload_thread(void *arg)
+{
+	if (vm_exec_env_attach())
+		return NULL;
+
+	preload_classes();
+
+	vm_exec_env_detach();
+
+	return NULL;
+}
+
+static void preload_classes_parallel(void)
+{
+	unsigned int nr_threads = preload_nr_threads - 1;
+	pthread_t threads[nr_threads];
+	unsigned int i;
+
+	for (i = 0; i < nr_threads; i++) {
+		if (pthread_create(&threads[i], NULL, preload_thread, NULL))
+			break;
+	}
+
+	/* The main thread does its share of the work. */
+	preload_classes();
+
+	while (i--)
+		pthread_join(threads[i], NULL);
+}
+
+static int override_with_vm_native(struct vm_method *vmm)
+{
+	struct compilation_unit *cu;
+
+	vmm->flags |= VM_METHOD_FLAG_VM_NATIVE;
+
+	cu = vmm->compilation_unit;
+
+	cu->entry_point = vm_lookup_native(vmm->class->name, vmm->name);
+	if (!cu->entry_point)
+		error("no VM native for overriden method: %s.%s%s",
+		      vmm->class->name, vmm->name, vmm->type);
+
+	cu->state = COMPILATION_STATE_COMPILED;
+
+	if (add_cu_mapping((unsigned long)cu->entry_point, cu))
+		return -EINVAL;
+
 	return 0;
 }
 
 int preload_vm_classes(void)
 {
+	if (preload_nr_threads > 1)
+		preload_classes_parallel();
+
 	for (unsigned int i = 0; i < ARRAY_SIZE(preload_entries); ++i) {
 		const struct preload_entry *pe = &preload_entries[i];
 
+		if (*pe->class)
+			continue;
+
 		struct vm_class *class = classloader_load(NULL, pe->name);
 		if (!class) {
 			if (pe->optional == PRELOAD_OPTIONAL)
@@ -232,27 +351,13 @@ int preload_vm_classes(void)
 	}
 
 	for (unsigned int i = 0; i < ARRAY_SIZE(native_override_entries); ++i) {
-		struct cafebabe_method_info *m_info;
-		struct compilation_unit *cu;
-		struct vm_method *vmm;
-
-		vmm = *native_override_entries[i];
-		vmm->flags |= VM_METHOD_FLAG_VM_NATIVE;
-
-		cu = vmm->compilation_unit;
-
-		cu->entry_point = vm_lookup_native(vmm->class->name, vmm->name);
-		if (!cu->entry_point)
-			error("no VM native for overriden method: %s.%s%s",
-			      vmm->class->name, vmm->name, vmm->type);
-
-		cu->state = COMPILATION_STATE_COMPILED;
-
-		if (add_cu_mapping((unsigned long)cu->entry_point, cu))
+		if (override_with_vm_native(*native_override_entries[i]))
 			return -EINVAL;
+	}
 
-		m_info = (struct cafebabe_method_info *)vmm->method;
-		m_info->access_flags |= CAFEBABE_METHOD_ACC_NATIVE;
+	for (unsigned int i = 0; opt_use_intrinsics && i < ARRAY_SIZE(intrinsic_override_entries); ++i) {
+		if (override_with_vm_native(*intrinsic_override_entries[i]))
+			return -EINVAL;
 	}
 
 	preload_finished = true;
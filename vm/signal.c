@@ -184,9 +184,17 @@ void setup_signal_handlers(void)
 	sigemptyset(&sa.sa_mask);
 	sa.sa_flags	= SA_RESTART | SA_SIGINFO;
 
+	/*
+	 * Threads that enter a GC safepoint through the guard page must not
+	 * be stopped by the collector a second time.
+	 */
+	sigaddset(&sa.sa_mask, SIGUSR1);
+
 	sa.sa_sigaction	= sigsegv_handler;
 	sigaction(SIGSEGV, &sa, NULL);
 
+	sigdelset(&sa.sa_mask, SIGUSR1);
+
 	sa.sa_sigaction	= sigill_handler;
 	sigaction(SIGILL, &sa, NULL);
 
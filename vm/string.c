@@ -15,13 +15,11 @@
 #include "vm/die.h"
 #include "vm/reference.h"
 
-#include "lib/hash-map.h"
+#include "lib/concurrent-hash-map.h"
 
-#include <pthread.h>
 #include <memory.h>
 
-static struct hash_map *literals;
-static pthread_mutex_t literals_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct concurrent_hash_map *literals;
 
 /*
  * Compare key1 string and key2 weak reference to string.
@@ -77,35 +75,33 @@ static struct key_operations string_obj_key_ops = {
 
 void init_literals_hash_map(void)
 {
-	literals = alloc_hash_map(&string_obj_key_ops);
+	literals = alloc_concurrent_hash_map(&string_obj_key_ops);
 	if (!literals)
 		error("failed to initialize literals hash map");
 }
 
 struct vm_object *vm_string_intern(struct vm_object *string)
 {
-	struct vm_reference *intern;
-	struct vm_object *result;
+	struct vm_reference *intern, *old;
 
-	pthread_mutex_lock(&literals_mutex);
+	intern = concurrent_hash_map_get(literals, string);
+	if (intern)
+		return vm_reference_get(intern);
 
-	if (hash_map_get(literals, string, (void **) &intern) == 0) {
-		pthread_mutex_unlock(&literals_mutex);
-		result = vm_reference_get(intern);
-		return result;
-	}
+	intern = vm_reference_alloc(string, VM_REFERENCE_STRONG);
+	if (!intern)
+		return throw_oom_error();
 
-	result = string;
-	intern = vm_reference_alloc(result, VM_REFERENCE_STRONG);
-	if (!intern) {
-		result = throw_oom_error();
-		goto out;
+	if (concurrent_hash_map_put_if_absent(literals, string, intern, (void **) &old)) {
+		vm_reference_free(intern);
+		return throw_oom_error();
 	}
 
-	if (hash_map_put(literals, string, intern))
-		result = throw_oom_error();
+	/* Another thread interned an equal string first. */
+	if (old) {
+		vm_reference_free(intern);
+		return vm_reference_get(old);
+	}
 
- out:
-	pthread_mutex_unlock(&literals_mutex);
-	return result;
+	return string;
 }
@@ -21,11 +21,24 @@
 
 #include "jit/exception.h"
 
+#include "sys/futex.h"
+
 #include <pthread.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <stdio.h>
 
+/*
+ * The park state is the futex word that parked threads sleep on. An
+ * unpark that comes before park leaves a permit that the next park
+ * consumes without blocking.
+ */
+enum {
+	PARK_STATE_PARKED	= -1,
+	PARK_STATE_EMPTY	= 0,
+	PARK_STATE_PERMIT	= 1,
+};
+
 pthread_key_t current_exec_env_key;
 
 __thread struct vm_exec_env *current_exec_env;
@@ -61,9 +74,9 @@ static struct vm_thread *vm_thread_alloc(void)
 	thread->interrupted = false;
 	thread->waiting_mon = NULL;
 	thread->thread_state = VM_THREAD_STATE_CONSISTENT;
-	pthread_cond_init(&thread->park_cond, NULL);
-	pthread_mutex_init(&thread->park_mutex, NULL);
-	thread->unpark_called = false;
+	atomic_set(&thread->park_state, PARK_STATE_EMPTY);
+	thread->start_routine = NULL;
+	thread->start_arg = NULL;
 	INIT_LIST_HEAD(&thread->list_node);
 
 	return thread;
@@ -76,8 +89,6 @@ static struct vm_thread *vm_thread_alloc(void)
 static void vm_thread_free(struct vm_thread *thread)
 {
 	pthread_mutex_destroy(&thread->mutex);
-	pthread_mutex_destroy(&thread->park_mutex);
-	pthread_cond_destroy(&thread->park_cond);
 	free(thread);
 }
 
@@ -225,6 +236,25 @@ int init_threading(void)
 	return 0;
 }
 
+static void *current_stack_end(void)
+{
+	pthread_attr_t attr;
+	void *stack_addr;
+	size_t stack_size;
+
+	if (pthread_getattr_np(pthread_self(), &attr) != 0)
+		return NULL;
+
+	if (pthread_attr_getstack(&attr, &stack_addr, &stack_size) != 0) {
+		pthread_attr_destroy(&attr);
+		return NULL;
+	}
+
+	pthread_attr_destroy(&attr);
+
+	return stack_addr + stack_size;
+}
+
 static struct vm_exec_env *alloc_exec_env(void)
 {
 	struct vm_exec_env *ee;
@@ -239,6 +269,15 @@ static struct vm_exec_env *alloc_exec_env(void)
 	INIT_LIST_HEAD(&ee->free_monitor_recs);
 	ee->in_safepoint	= false;
 	ee->trace_buffer = NULL;
+	ee->stack_end		= NULL;
+	ee->gc_frame		= NULL;
+	ee->gc_regs		= NULL;
+	tlab_init(&ee->tlab);
+
+	if (vm_monitor_alloc_thin_lock_id(ee)) {
+		vm_free(ee);
+		return NULL;
+	}
 
 	return ee;
 }
@@ -252,6 +291,7 @@ static void free_exec_env(struct vm_exec_env *env)
 		vm_monitor_record_free(this);
 	}
 
+	vm_monitor_free_thin_lock_id(env);
 	vm_free(env);
 }
 
@@ -264,7 +304,46 @@ void init_exec_env(void)
 	if (!vm_exec_env)
 		error("out of memory");
 
+	vm_exec_env->stack_end = current_stack_end();
+
 	pthread_setspecific(current_exec_env_key, vm_exec_env);
+	current_exec_env = vm_exec_env;
+	thin_lock_word = vm_exec_env->thin_lock_word;
+}
+
+/*
+ * Gives the calling native thread an execution environment so that it can
+ * load and link classes before threading has been initialized. The thread
+ * has no vm_thread and must not run Java code.
+ */
+int vm_exec_env_attach(void)
+{
+	struct vm_exec_env *ee;
+
+	ee = alloc_exec_env();
+	if (!ee)
+		return -ENOMEM;
+
+	ee->stack_end = current_stack_end();
+
+	pthread_setspecific(current_exec_env_key, ee);
+	current_exec_env = ee;
+	thin_lock_word = ee->thin_lock_word;
+
+	thread_init_exceptions();
+
+	return 0;
+}
+
+void vm_exec_env_detach(void)
+{
+	struct vm_exec_env *ee = vm_get_exec_env();
+
+	pthread_setspecific(current_exec_env_key, NULL);
+	current_exec_env = NULL;
+	thin_lock_word = 0;
+
+	free_exec_env(ee);
 }
 
 /**
@@ -275,7 +354,11 @@ static void *vm_thread_entry(void *arg)
 	struct vm_exec_env *ee = arg;
 	struct vm_thread *thread = ee->thread;
 
+	ee->stack_end = current_stack_end();
+
 	pthread_setspecific(current_exec_env_key, ee);
+	current_exec_env = ee;
+	thin_lock_word = ee->thin_lock_word;
 
 	setup_signal_handlers();
 	thread_init_exceptions();
@@ -288,7 +371,10 @@ static void *vm_thread_entry(void *arg)
 	if (!vmthread_ref)
 		return throw_oom_error();
 
-	vm_call_method(vm_java_lang_VMThread_run, thread->vmthread);
+	if (thread->start_routine)
+		thread->start_routine(thread->start_arg);
+	else
+		vm_call_method(vm_java_lang_VMThread_run, thread->vmthread);
 
 	if (exception_occurred())
 		vm_print_exception(exception_occurred());
@@ -307,10 +393,8 @@ static void *vm_thread_entry(void *arg)
 	return NULL;
 }
 
-/**
- * Creates new native thread representing a java thread.
- */
-int vm_thread_start(struct vm_object *vmthread)
+static int __vm_thread_start(struct vm_object *vmthread,
+			     void *(*start_routine)(void *), void *arg)
 {
 	/* Force object finalizer execution for vmthread */
 	if (gc_register_finalizer(vmthread, vm_object_finalizer)) {
@@ -345,6 +429,8 @@ int vm_thread_start(struct vm_object *vmthread)
 	/* XXX: no need to lock because @thread is not yet visible to
 	 * other threads. */
 	thread->vmthread = vmthread;
+	thread->start_routine = start_routine;
+	thread->start_arg = arg;
 
 	atomic_set(&thread->state, VM_THREAD_STATE_RUNNABLE);
 
@@ -386,6 +472,51 @@ int vm_thread_start(struct vm_object *vmthread)
 	return -1;
 }
 
+/**
+ * Creates new native thread representing a java thread.
+ */
+int vm_thread_start(struct vm_object *vmthread)
+{
+	return __vm_thread_start(vmthread, NULL, NULL);
+}
+
+/**
+ * Creates a daemon thread that runs @start_routine instead of
+ * java.lang.VMThread.run(). The thread gets a java.lang.Thread of its own
+ * so that VM internal threads, like JIT compiler threads, can call into
+ * Java code to load classes.
+ */
+int vm_thread_start_native(const char *name, void *(*start_routine)(void *), void *arg)
+{
+	struct vm_object *thread_name;
+	struct vm_object *vmthread;
+	struct vm_object *thread;
+
+	thread = vm_object_alloc(vm_java_lang_Thread);
+	if (!thread)
+		return -1;
+
+	thread_name = vm_object_alloc_string_from_c(name);
+	if (!thread_name)
+		return -1;
+
+	vmthread = vm_object_alloc(vm_java_lang_VMThread);
+	if (!vmthread)
+		return -1;
+
+	vm_call_method_object(vm_java_lang_Thread_init, thread,
+			      vmthread, thread_name,
+			      5 /* priority */,
+			      1 /* daemon */);
+	if (exception_occurred())
+		return -1;
+
+	field_set_object(vmthread, vm_java_lang_VMThread_thread, thread);
+	field_set_object(thread, vm_java_lang_Thread_group, main_thread_group);
+
+	return __vm_thread_start(vmthread, start_routine, arg);
+}
+
 void vm_thread_wait_for_non_daemons(void)
 {
 	pthread_mutex_lock(&threads_mutex);
@@ -443,6 +574,9 @@ void vm_thread_interrupt(struct vm_thread *thread)
 	obj = thread->waiting_mon;
 	pthread_mutex_unlock(&thread->mutex);
 
+	/* Interrupt makes a parked thread return from park(). */
+	vm_thread_unpark(thread);
+
 	if (!obj)
 		return;
 
@@ -475,6 +609,63 @@ void vm_thread_yield(void)
 	sched_yield();
 }
 
+/*
+ * Blocks the current thread until it is unparked or interrupted, or the
+ * timeout expires. A relative @timeout is in nanoseconds and zero means
+ * no timeout. An absolute @timeout is in milliseconds since the epoch.
+ * Like java.util.concurrent.locks.LockSupport.park() this may also return
+ * spuriously.
+ */
+void vm_thread_park(bool is_absolute, int64_t timeout)
+{
+	struct vm_thread *self = vm_thread_self();
+	int *word = &self->park_state.counter;
+	struct timespec timespec;
+
+	if (atomic_xchg(&self->park_state, PARK_STATE_EMPTY) == PARK_STATE_PERMIT)
+		return;
+
+	if (timeout < 0 || (is_absolute && timeout == 0))
+		return;
+
+	if (vm_thread_is_interrupted(self))
+		return;
+
+	if (atomic_cmpxchg(&self->park_state, PARK_STATE_EMPTY, PARK_STATE_PARKED) != PARK_STATE_EMPTY) {
+		/* Unparked in the meantime. */
+		atomic_set(&self->park_state, PARK_STATE_EMPTY);
+		return;
+	}
+
+	if (timeout == 0) {
+		vm_thread_set_state(self, VM_THREAD_STATE_WAITING);
+		futex_wait(word, PARK_STATE_PARKED, NULL);
+	} else if (is_absolute) {
+		timespec.tv_sec  = timeout / 1000l;
+		timespec.tv_nsec = (timeout % 1000l) * 1000000l;
+
+		vm_thread_set_state(self, VM_THREAD_STATE_TIMED_WAITING);
+		futex_wait_until(word, PARK_STATE_PARKED, &timespec);
+	} else {
+		timespec.tv_sec  = timeout / 1000000000l;
+		timespec.tv_nsec = timeout % 1000000000l;
+
+		vm_thread_set_state(self, VM_THREAD_STATE_TIMED_WAITING);
+		futex_wait(word, PARK_STATE_PARKED, &timespec);
+	}
+
+	vm_thread_set_state(self, VM_THREAD_STATE_RUNNABLE);
+
+	/* Consume the permit of the unpark that woke us up, if any. */
+	atomic_set(&self->park_state, PARK_STATE_EMPTY);
+}
+
+void vm_thread_unpark(struct vm_thread *thread)
+{
+	if (atomic_xchg(&thread->park_state, PARK_STATE_PERMIT) == PARK_STATE_PARKED)
+		futex_wake(&thread->park_state.counter, 1);
+}
+
 struct vm_thread *vm_thread_from_vmthread(struct vm_object *vmthread)
 {
 	return (struct vm_thread *)field_get_object(vmthread, vm_java_lang_VMThread_vmdata);
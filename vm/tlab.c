@@ -0,0 +1,100 @@
+/*
+ * Thread-local allocation buffers
+ *
+ * This file is released under the 2-clause BSD license. Please refer to the
+ * file LICENSE for details.
+ *
+ * The Boehm GC manages every object separately so a thread-local buffer
+ * can't be a single chunk of memory that objects are bump-allocated from:
+ * any reachable object would keep the whole chunk alive and finalizers can
+ * only be registered for the start of a chunk. Instead, every thread keeps a
+ * free list of pre-cleared objects per size class in struct vm_exec_env that
+ * is refilled with gc_alloc_many() which takes the allocation lock only once
+ * for a whole batch of objects.
+ *
+ * The free lists are reachable through the execution environment which is
+ * allocated with vm_alloc() so the collector does not reclaim objects that
+ * are waiting on a list.
+ */
+
+#include "vm/tlab.h"
+
+#include "vm/errors.h"
+#include "vm/thread.h"
+#include "vm/gc.h"
+
+#include <string.h>
+#include <assert.h>
+
+bool opt_use_tlab = true;
+
+void tlab_init(struct tlab *tlab)
+{
+	memset(tlab, 0, sizeof(*tlab));
+}
+
+bool tlab_enabled(void)
+{
+	return opt_use_tlab && gc_ops.gc_alloc_many != NULL;
+}
+
+static void *tlab_pop(void **free_list)
+{
+	void **obj = *free_list;
+
+	*free_list = *obj;
+	*obj = NULL;
+
+	return obj;
+}
+
+/*
+ * Refills @free_list which must be one of the free lists of the current
+ * thread and allocates an object from it. This is the slow path of inline
+ * allocation in JIT code. Returns NULL and signals OutOfMemoryError if the
+ * heap is exhausted.
+ */
+void *tlab_refill(void **free_list)
+{
+	struct tlab *tlab = &vm_get_exec_env()->tlab;
+	unsigned int size_class;
+
+	size_class = free_list - tlab->free_list;
+	assert(size_class < TLAB_NR_SIZE_CLASSES);
+
+	if (!*free_list) {
+		*free_list = gc_alloc_many(tlab_size_class_size(size_class));
+		if (!*free_list)
+			return throw_oom_error();
+	}
+
+	return tlab_pop(free_list);
+}
+
+/*
+ * Allocates a collectable and scanned memory region of @size bytes like
+ * gc_alloc() does but uses the thread-local allocation buffer for small
+ * regions.
+ */
+void *tlab_alloc(size_t size)
+{
+	struct vm_exec_env *ee;
+	void **free_list;
+
+	if (!tlab_enabled() || size > TLAB_MAX_SIZE)
+		return gc_alloc(size);
+
+	/* Threads that are not attached to the VM have no buffer. */
+	ee = vm_get_exec_env();
+	if (!ee)
+		return gc_alloc(size);
+
+	free_list = &ee->tlab.free_list[tlab_size_class(size)];
+	if (!*free_list) {
+		*free_list = gc_alloc_many(tlab_size_class_size(tlab_size_class(size)));
+		if (!*free_list)
+			return NULL;
+	}
+
+	return tlab_pop(free_list);
+}